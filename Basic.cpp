@@ -8,9 +8,13 @@
  */
 
 #include <cctype>
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 #include "exp.h"
+#include "forkserver.h"
+#include "inputlog.h"
 #include "parser.h"
 #include "statement.h"
 #include "program.h"
@@ -22,16 +26,73 @@
 //#include "../StanfordCPPLib/lexicon.h"
 using namespace std;
 
+/*
+ * Type: Options
+ * -------------
+ * The command-line options, read before the interpreter for the chosen
+ * value type is set up.
+ */
+
+struct Options {
+   bool keepSource;
+   bool lazy;
+   int gosubDepth;       //-1 keeps the default limit
+   string values;
+   string recordInput;   //the input log to write, or empty
+   string replayInput;   //the input log to read, or empty
+   bool paced;
+   string serve;         //the socket to serve the files on, or empty
+   string request;       //the socket to send a request to, or empty
+   vector<string> files; //the program files served, or the name requested
+};
+
+/*
+ * Constant: CHECKPOINT_SECONDS
+ * ----------------------------
+ * The seconds between two checkpoints when CHECKPOINT names none.
+ */
+
+const int CHECKPOINT_SECONDS = 60;
+
 /* Function prototypes */
 
-void processLine(string line, Program & program, EvalState & state);
+void processOptions(int argc, char * argv[], Options & options);
+template <typename Value>
+int interpret(const Options & options);
+template <typename Value>
+int serveFiles(const Options & options);
+template <typename Value>
+void processLine(string line, Program<Value> & program, EvalState<Value> & state);
 
 /* Main program */
 
-int main() {
+int main(int argc, char * argv[]) {
+   Options options;
+   processOptions(argc, argv, options);
+   if (!options.request.empty()) return request(options.request, options.files.empty() ? "" : options.files[0]);
+   if (options.values == ValueTraits<long long>::NAME) return interpret<long long>(options);
+   if (options.values == ValueTraits<double>::NAME) return interpret<double>(options);
+   if (options.values == ValueTraits<BigInt>::NAME) return interpret<BigInt>(options);
+   return interpret<int>(options);
+}
+
+/*
+ * Function: interpret
+ * Usage: return interpret<Value>(options);
+ * ----------------------------------------
+ * Runs the interpreter with values of type Value until the input ends
+ * or QUIT, or serves the program files with --serve.
+ */
+
+template <typename Value>
+int interpret(const Options & options) {
+   if (!options.serve.empty()) return serveFiles<Value>(options);
    //init
-   EvalState state;
-   Program program;
+   EvalState<Value> state;
+   Program<Value> program;
+   program.setKeepSource(options.keepSource);
+   program.setLazy(options.lazy);
+   if (options.gosubDepth >= 0) state.setReturnLimit(options.gosubDepth);
    //Loop . Print . Eval . Read
 
    //loop
@@ -50,6 +111,142 @@ int main() {
    return 0;
 }
 
+/*
+ * Function: serveFiles
+ * Usage: return serveFiles<Value>(options);
+ * -----------------------------------------
+ * Loads the program files, whose lines must all be numbered program
+ * lines, links each program and serves requests to run them by file
+ * name.  Returns 1 if a file cannot be loaded.
+ */
+
+template <typename Value>
+int serveFiles(const Options & options) {
+   vector<Program<Value> *> programs;
+   EvalState<Value> state;
+   int status = 0;
+   for (size_t i = 0; status == 0 && i < options.files.size(); i++) {
+      Program<Value> * program = new Program<Value>;
+      programs.push_back(program);
+      program->setKeepSource(options.keepSource);
+      program->setLazy(options.lazy);
+      ifstream file(options.files[i].c_str());
+      if (!file) {
+         cerr << options.files[i] << ": cannot read" << endl;
+         status = 1;
+      }
+      string line;
+      for (int number = 1; status == 0 && getline(file, line); number++) {
+         size_t start = line.find_first_not_of(" \t\r");
+         if (start == string::npos) continue;
+         try {
+            if (!isdigit(line[start])) error("SYNTAX ERROR");
+            processLine(line, *program, state);
+         } catch (ErrorException & ex) {
+            cerr << options.files[i] << ":" << number << ": " << ex.getMessage() << endl;
+            status = 1;
+         }
+      }
+      try {
+         if (status == 0) program->prelink();
+      } catch (ErrorException & ex) {
+         cerr << options.files[i] << ": " << ex.getMessage() << endl;
+         status = 1;
+      }
+   }
+   if (status == 0) status = serve(options.serve, options.files, programs, options.gosubDepth);
+   for (size_t i = 0; i < programs.size(); i++) {
+      delete programs[i];
+   }
+   return status;
+}
+
+/*
+ * Function: processOptions
+ * Usage: processOptions(argc, argv, options);
+ * -------------------------------------------
+ * Reads the command-line options:
+ *
+ *   --drop-source   do not keep the source text of program lines;
+ *                   LIST regenerates them from the parsed statements
+ *   --lazy          store program lines unparsed and parse each one
+ *                   the first time a run reaches it
+ *   --gosub-depth=N allow N nested GOSUBs (1024 by default)
+ *   --values=TYPE   compute with int32 (the default), int64, double or
+ *                   bigint values; bigint integers never overflow
+ *   --record-input=FILE
+ *                   record the lines INPUT reads into the log FILE
+ *   --replay-input=FILE
+ *                   take the lines INPUT reads from the log FILE
+ *   --paced         wait the recorded time before each replayed line
+ *   --serve=SOCKET FILE...
+ *                   load and link the programs in the files, then fork
+ *                   a child to run one for each request on the socket
+ *   --request=SOCKET [FILE]
+ *                   ask the server on the socket to run the program of
+ *                   the file, or its first, on this standard input and
+ *                   output, and exit with the status of the request
+ */
+
+void processOptions(int argc, char * argv[], Options & options) {
+   options.keepSource = true;
+   options.lazy = false;
+   options.gosubDepth = -1;
+   options.values = ValueTraits<int>::NAME;
+   options.paced = false;
+   for (int i = 1; i < argc; i++) {
+      string option = argv[i];
+      if (option == "--drop-source") {
+         options.keepSource = false;
+      } else if (option == "--lazy") {
+         options.lazy = true;
+      } else if (option.compare(0, 14, "--gosub-depth=") == 0 && option.size() > 14
+                 && option.size() <= 23 && option.find_first_not_of("0123456789", 14) == string::npos) {
+         options.gosubDepth = str2int(option.substr(14));
+      } else if (option.compare(0, 9, "--values=") == 0
+                 && (option.substr(9) == ValueTraits<int>::NAME || option.substr(9) == ValueTraits<long long>::NAME
+                     || option.substr(9) == ValueTraits<double>::NAME || option.substr(9) == ValueTraits<BigInt>::NAME)) {
+         options.values = option.substr(9);
+      } else if (option.compare(0, 15, "--record-input=") == 0 && option.size() > 15) {
+         options.recordInput = option.substr(15);
+      } else if (option.compare(0, 15, "--replay-input=") == 0 && option.size() > 15) {
+         options.replayInput = option.substr(15);
+      } else if (option == "--paced") {
+         options.paced = true;
+      } else if (option.compare(0, 8, "--serve=") == 0 && option.size() > 8) {
+         options.serve = option.substr(8);
+      } else if (option.compare(0, 10, "--request=") == 0 && option.size() > 10) {
+         options.request = option.substr(10);
+      } else if (option.compare(0, 2, "--") != 0) {
+         options.files.push_back(option);
+      } else {
+         cerr << "usage: " << argv[0] << " [--drop-source] [--lazy] [--gosub-depth=N]"
+              << " [--values=int32|int64|double|bigint]"
+              << " [--record-input=FILE | --replay-input=FILE [--paced]]"
+              << " [--serve=SOCKET FILE... | --request=SOCKET [FILE]]" << endl;
+         exit(1);
+      }
+   }
+   if ((options.serve.empty() && options.request.empty() && !options.files.empty())
+       || (!options.serve.empty() && (options.files.empty() || !options.request.empty()))
+       || (!options.request.empty() && options.files.size() > 1)) {
+      cerr << "usage: " << argv[0] << " --serve=SOCKET FILE... | --request=SOCKET [FILE]" << endl;
+      exit(1);
+   }
+   if (!options.recordInput.empty() && !options.replayInput.empty()) {
+      cerr << argv[0] << ": cannot record and replay input at once" << endl;
+      exit(1);
+   }
+   if (!options.recordInput.empty() && !getInputLog().record(options.recordInput)) {
+      cerr << argv[0] << ": cannot write " << options.recordInput << endl;
+      exit(1);
+   }
+   if (!options.replayInput.empty() && !getInputLog().replay(options.replayInput, options.paced)) {
+      cerr << argv[0] << ": cannot replay " << options.replayInput << endl;
+      exit(1);
+   }
+}
+
 /*
  * Function: processLine
  * Usage: processLine(line, program, state);
@@ -59,11 +256,11 @@ int main() {
  * or one of the BASIC commands, such as LIST or RUN.
  */
 
-void processLine(string line, Program & program, EvalState & state) {
+template <typename Value>
+void processLine(string line, Program<Value> & program, EvalState<Value> & state) {
    //setup
    TokenScanner scanner;
-   scanner.ignoreWhitespace();
-   scanner.scanNumbers();
+   setupScanner(scanner);
    scanner.setInput(line);
 
    if (!scanner.hasMoreTokens()){ //empty input
@@ -75,8 +272,13 @@ void processLine(string line, Program & program, EvalState & state) {
        int ln = str2int(token);
        if (ln >= 0){
            if (scanner.hasMoreTokens()){  //add line
-               Statement * stmt = parseStatement(scanner);
-               program.addSourceLine(ln, line, stmt);
+               if (program.isLazy()){
+                   checkStatement(scanner);
+                   program.addSourceLine(ln, line, NULL);
+               }else{
+                   Statement<Value> * stmt = parseStatement<Value>(scanner);
+                   program.addSourceLine(ln, line, stmt);
+               }
            }else{
                program.removeSourceLine(ln);
            }
@@ -86,13 +288,57 @@ void processLine(string line, Program & program, EvalState & state) {
        return;
    }
    //direct execute
-   if (token == "LET" || token == "INPUT" || token == "PRINT"){
+   if (token == "LET" || token == "INPUT" || token == "PRINT" || token == "DIM" || token == "MAT"){
        scanner.saveToken(token);
-       Statement * stmt = parseDirect(scanner);
+       Statement<Value> * stmt = parseDirect<Value>(scanner);
        stmt->execute(state);
        delete stmt;
        return;
    }
+   //debugger commands
+   if (token == "BREAK" || token == "UNBREAK"){
+       string ln = scanner.nextToken();
+       if (scanner.getTokenType(ln) != NUMBER || scanner.hasMoreTokens()){
+           error("SYNTAX ERROR");
+       }
+       program.setBreakpoint(str2int(ln), token == "BREAK");
+       return;
+   }
+   if (token == "WATCH" || token == "UNWATCH"){
+       string name = scanner.nextToken();
+       if (scanner.getTokenType(name) != WORD || scanner.hasMoreTokens()){
+           error("SYNTAX ERROR");
+       }
+       program.setWatch(name, token == "WATCH");
+       return;
+   }
+   //checkpoint commands
+   if (token == "CHECKPOINT"){
+       string path = scanner.nextToken();
+       if (path == "OFF" && !scanner.hasMoreTokens()){
+           program.setCheckpoint("", 0);
+           return;
+       }
+       if (scanner.getTokenType(path) != STRING) error("SYNTAX ERROR");
+       int seconds = CHECKPOINT_SECONDS;
+       if (scanner.hasMoreTokens()){
+           string interval = scanner.nextToken();
+           if (scanner.getTokenType(interval) != NUMBER || scanner.hasMoreTokens()){
+               error("SYNTAX ERROR");
+           }
+           seconds = str2int(interval);
+       }
+       program.setCheckpoint(scanner.getStringValue(path), seconds);
+       return;
+   }
+   if (token == "RESUME"){
+       string path = scanner.nextToken();
+       if (scanner.getTokenType(path) != STRING || scanner.hasMoreTokens()){
+           error("SYNTAX ERROR");
+       }
+       program.restore(state, scanner.getStringValue(path));
+       return;
+   }
    //interpreter commands
    if (scanner.hasMoreTokens()){ //fix the bug
        error("SYNTAX ERROR");
@@ -111,11 +357,36 @@ void processLine(string line, Program & program, EvalState & state) {
        cout << "Yet another basic interpreter" << endl;
        return;
    }
+   if (token == "CHECK"){
+       program.check();
+       return;
+   }
+   if (token == "LINK"){
+       program.link();
+       return;
+   }
    if (token == "RUN")
    {
        program.run(state);
        return;
    }
+   if (token == "CONT"){
+       program.resume(state);
+       return;
+   }
+   if (token == "STEP"){
+       program.step(state);
+       return;
+   }
+   if (token == "VARS"){
+       vector<string> names = state.getNames();
+       for (size_t i = 0; i < names.size(); i++){
+           cout << names[i] << " = ";
+           ValueTraits<Value>::print(cout, state.getValue(names[i]));
+           cout << endl;
+       }
+       return;
+   }
    if (token == "CLEAR"){
        program.clear();
        state.clear();
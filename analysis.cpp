@@ -0,0 +1,326 @@
+/*
+ * File: analysis.cpp
+ * ------------------
+ * This file implements the definite-assignment analysis.
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "analysis.h"
+#include "data.h"
+#include "exp.h"
+#include "fileio.h"
+#include "function.h"
+#include "native.h"
+#include "statement.h"
+using namespace std;
+
+/*
+ * Implementation notes: VarSet
+ * ----------------------------
+ * A set of variable indices stored as a bit vector, so the meet over
+ * the predecessors of a line is a word-wise AND.
+ */
+
+namespace {
+
+const int WORD_BITS = 64;
+
+struct VarSet {
+   vector<unsigned long long> words;
+
+   VarSet(int size, bool full) :words((size + WORD_BITS - 1) / WORD_BITS, full ? ~0ULL : 0ULL) {}
+
+   void add(int var) {
+      words[var / WORD_BITS] |= 1ULL << (var % WORD_BITS);
+   }
+
+   bool contains(int var) const {
+      return (words[var / WORD_BITS] >> (var % WORD_BITS)) & 1ULL;
+   }
+
+   void intersect(const VarSet & other) {
+      for (size_t i = 0; i < words.size(); i++) words[i] &= other.words[i];
+   }
+
+   bool operator!=(const VarSet & other) const {
+      return words != other.words;
+   }
+};
+
+}
+
+//the index of a variable, numbering new variables as they are seen
+static int varIndex(map<string, int> & vars, string name)
+{
+    map<string, int>::iterator it = vars.find(name);
+    if (it != vars.end()) return it->second;
+    int index = vars.size();
+    vars[name] = index;
+    return index;
+}
+
+//append the identifiers read by an expression
+template <typename Value>
+static void collectReads(Expression<Value> * exp, vector<IdentifierExp<Value> *> & reads)
+{
+    if (exp->getType() == IDENTIFIER){
+        reads.push_back((IdentifierExp<Value> *) exp);
+    }else if (exp->getType() == COMPOUND){
+        collectReads(((CompoundExp<Value> *) exp)->getLHS(), reads);
+        collectReads(((CompoundExp<Value> *) exp)->getRHS(), reads);
+    }else if (exp->getType() == ARRAY){
+        collectReads(((ArrayExp<Value> *) exp)->getRow(), reads);
+        if (((ArrayExp<Value> *) exp)->getCol() != NULL) collectReads(((ArrayExp<Value> *) exp)->getCol(), reads);
+    }else if (exp->getType() == CALL){
+        for (int i = 0; i < ((CallExp<Value> *) exp)->getArgumentCount(); i++){
+            collectReads(((CallExp<Value> *) exp)->getArgument(i), reads);
+        }
+    }else if (exp->getType() == NATIVE){
+        for (int i = 0; i < ((NativeCallExp<Value> *) exp)->getArgumentCount(); i++){
+            collectReads(((NativeCallExp<Value> *) exp)->getArgument(i), reads);
+        }
+    }
+}
+
+//append the identifiers read by a statement
+template <typename Value>
+static void collectStatementReads(Statement<Value> * stmt, vector<IdentifierExp<Value> *> & reads)
+{
+    switch (stmt->getType()){
+        case LET_STMT:
+            collectReads(((LetStatement<Value> *) stmt)->getExp(), reads);
+            break;
+        case PRINT_STMT:
+            collectReads(((PrintStatement<Value> *) stmt)->getExp(), reads);
+            break;
+        case IF_STMT:
+            collectReads(((IfStatement<Value> *) stmt)->getCond()->getLHS(), reads);
+            collectReads(((IfStatement<Value> *) stmt)->getCond()->getRHS(), reads);
+            break;
+        case DIM_STMT:
+            for (int i = 0; i < ((DimStatement<Value> *) stmt)->getCount(); i++){
+                collectReads(((DimStatement<Value> *) stmt)->getRows(i), reads);
+                if (((DimStatement<Value> *) stmt)->getCols(i) != NULL) collectReads(((DimStatement<Value> *) stmt)->getCols(i), reads);
+            }
+            break;
+        case FOR_STMT:
+            collectReads(((ForStatement<Value> *) stmt)->getFrom(), reads);
+            collectReads(((ForStatement<Value> *) stmt)->getTo(), reads);
+            if (((ForStatement<Value> *) stmt)->getStep() != NULL) collectReads(((ForStatement<Value> *) stmt)->getStep(), reads);
+            break;
+        case MAT_STMT:
+            if (((MatStatement<Value> *) stmt)->getFactor() != NULL) collectReads(((MatStatement<Value> *) stmt)->getFactor(), reads);
+            break;
+        case ARRAY_LET_STMT:
+            collectReads(((ArrayLetStatement<Value> *) stmt)->getTarget(), reads);
+            collectReads(((ArrayLetStatement<Value> *) stmt)->getExp(), reads);
+            break;
+        case ON_GOTO_STMT:
+            collectReads(((OnGotoStatement<Value> *) stmt)->getExp(), reads);
+            break;
+        case COMPUTED_GOTO_STMT:
+            collectReads(((ComputedGotoStatement<Value> *) stmt)->getExp(), reads);
+            break;
+        case FILE_PRINT_STMT:
+            if (((FilePrintStatement<Value> *) stmt)->getExp() != NULL) collectReads(((FilePrintStatement<Value> *) stmt)->getExp(), reads);
+            break;
+        case READ_STMT:
+            for (int i = 0; i < ((ReadStatement<Value> *) stmt)->getCount(); i++){
+                Expression<Value> * target = ((ReadStatement<Value> *) stmt)->getTarget(i);
+                if (target->getType() == ARRAY) collectReads(target, reads);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+//the set at the entry of line i, from the exit sets of its predecessors
+static VarSet entrySet(int i, vector<vector<int> > & preds, vector<VarSet> & out, int nvars)
+{
+    VarSet entry(nvars, i != 0);
+    if (i != 0){
+        for (size_t p = 0; p < preds[i].size(); p++){
+            entry.intersect(out[preds[i][p]]);
+        }
+    }
+    return entry;
+}
+
+/*
+ * Implementation notes: buildLineGraph
+ * ------------------------------------
+ * A NEXT may jump back to the line after any FOR over its variable
+ * that is active, or after any FOR at all if it names no variable.
+ * Rather than an edge from every NEXT to every such line, each loop
+ * variable gets a node after the lines: the NEXT lines over it lead to
+ * the node, and the node leads to the line after each FOR over it.
+ * Likewise every RETURN leads to one more node, which leads to the line
+ * after every GOSUB, and every computed GOTO to another, which leads to
+ * every line.
+ */
+
+template <typename Value>
+void buildLineGraph(const vector<int> & numbers, const vector<Statement<Value> *> & stmts, vector<vector<int> > & preds)
+{
+    int n = stmts.size();
+    map<int, int> position;
+    for (int i = 0; i < n; i++){
+        position[numbers[i]] = i;
+    }
+
+    //number the loop nodes, which follow the lines
+    map<string, int> loops;
+    for (int i = 0; i < n; i++){
+        if (stmts[i]->getType() != FOR_STMT) continue;
+        string name = ((ForStatement<Value> *) stmts[i])->getName();
+        if (loops.find(name) == loops.end()){
+            int node = n + loops.size();
+            loops[name] = node;
+        }
+    }
+    int returns = n + loops.size();
+    int anywhere = returns + 1;
+    int nodes = anywhere + 1;
+
+    //build the predecessor lists of the line graph
+    preds.assign(nodes, vector<int>());
+    for (int i = 0; i < n; i++){
+        Statement<Value> * stmt = stmts[i];
+        StatementType type = stmt->getType();
+        int target = -1;
+        if (type == GOTO_STMT) target = ((GotoStatement<Value> *) stmt)->getTarget();
+        if (type == IF_STMT) target = ((IfStatement<Value> *) stmt)->getTarget();
+        if (type == GOSUB_STMT){
+            target = ((GosubStatement<Value> *) stmt)->getTarget();
+            if (i + 1 < n) preds[i + 1].push_back(returns);
+        }
+        if (type == RETURN_STMT) preds[returns].push_back(i);
+        if (type == COMPUTED_GOTO_STMT) preds[anywhere].push_back(i);
+        if (type == ON_GOTO_STMT){
+            OnGotoStatement<Value> * onGoto = (OnGotoStatement<Value> *) stmt;
+            for (int k = 0; k < onGoto->getCount(); k++){
+                map<int, int>::iterator it = position.find(onGoto->getTarget(k));
+                if (it != position.end()) preds[it->second].push_back(i);
+            }
+        }
+        if (type == FOR_STMT){
+            target = ((ForStatement<Value> *) stmt)->getExit();
+            if (i + 1 < n) preds[i + 1].push_back(loops[((ForStatement<Value> *) stmt)->getName()]);
+        }
+        if (type == NEXT_STMT){
+            string name = ((NextStatement<Value> *) stmt)->getName();
+            for (map<string, int>::iterator it = loops.begin(); it != loops.end(); it++){
+                if (name.empty() || it->first == name) preds[it->second].push_back(i);
+            }
+        }
+        if (target >= 0){
+            map<int, int>::iterator it = position.find(target);
+            if (it != position.end()) preds[it->second].push_back(i);
+        }
+        if (type != GOTO_STMT && type != END_STMT && type != GOSUB_STMT && type != RETURN_STMT
+                && type != COMPUTED_GOTO_STMT && i + 1 < n){
+            preds[i + 1].push_back(i);
+        }
+    }
+    if (!preds[anywhere].empty()){
+        for (int i = 0; i < n; i++){
+            preds[i].push_back(anywhere);
+        }
+    }
+}
+
+/*
+ * Implementation notes: markDefinedReads
+ * --------------------------------------
+ * This is a forward must-analysis.  The set at the entry of the first
+ * line is empty; the set at the entry of every other line is the
+ * intersection of the exit sets of its predecessors, and starts out
+ * full so that loops converge to the greatest fixed point.  A line
+ * with no predecessor is unreachable and keeps the full set, which is
+ * harmless because it never runs.
+ */
+
+template <typename Value>
+void markDefinedReads(const vector<int> & numbers, const vector<Statement<Value> *> & stmts)
+{
+    int n = stmts.size();
+
+    //a line that is not parsed yet may jump anywhere: keep every check
+    if (find(stmts.begin(), stmts.end(), (Statement<Value> *) NULL) != stmts.end()){
+        vector<IdentifierExp<Value> *> reads;
+        for (int i = 0; i < n; i++){
+            if (stmts[i] != NULL) collectStatementReads(stmts[i], reads);
+        }
+        for (size_t r = 0; r < reads.size(); r++){
+            reads[r]->setChecked(true);
+        }
+        return;
+    }
+
+    map<string, int> vars;
+
+    //collect what each line assigns and reads; the reads of line i are
+    //reads[first[i] .. first[i + 1] - 1]
+    vector<int> def(n, -1);
+    vector<IdentifierExp<Value> *> reads;
+    vector<int> first(n + 1);
+    for (int i = 0; i < n; i++){
+        first[i] = reads.size();
+        Statement<Value> * stmt = stmts[i];
+        collectStatementReads(stmt, reads);
+        if (stmt->getType() == LET_STMT) def[i] = varIndex(vars, ((LetStatement<Value> *) stmt)->getName());
+        if (stmt->getType() == INPUT_STMT) def[i] = varIndex(vars, ((InputStatement<Value> *) stmt)->getName());
+        if (stmt->getType() == FILE_INPUT_STMT) def[i] = varIndex(vars, ((FileInputStatement<Value> *) stmt)->getName());
+        if (stmt->getType() == FOR_STMT) def[i] = varIndex(vars, ((ForStatement<Value> *) stmt)->getName());
+        if (stmt->getType() == MAT_STMT && (((MatStatement<Value> *) stmt)->getOp() == MAT_SUM
+                || ((MatStatement<Value> *) stmt)->getOp() == MAT_DOT)) def[i] = varIndex(vars, ((MatStatement<Value> *) stmt)->getTarget());
+    }
+    first[n] = reads.size();
+    vector<int> readVars(reads.size());
+    for (size_t r = 0; r < reads.size(); r++){
+        readVars[r] = varIndex(vars, reads[r]->getName());
+    }
+    int nvars = vars.size();
+
+    vector<vector<int> > preds;
+    buildLineGraph(numbers, stmts, preds);
+    int nodes = preds.size();
+    def.resize(nodes, -1);
+
+    //iterate to the fixed point; only the exit sets are stored
+    vector<VarSet> out(nodes, VarSet(nvars, true));
+    bool changed = true;
+    while (changed){
+        changed = false;
+        for (int i = 0; i < nodes; i++){
+            VarSet exit = entrySet(i, preds, out, nvars);
+            if (def[i] >= 0) exit.add(def[i]);
+            if (exit != out[i]){
+                out[i] = exit;
+                changed = true;
+            }
+        }
+    }
+
+    //mark the reads; a node shared by equal subexpressions is checked
+    //if any of its places needs the check
+    for (size_t r = 0; r < reads.size(); r++){
+        reads[r]->setChecked(false);
+    }
+    for (int i = 0; i < n; i++){
+        VarSet entry = entrySet(i, preds, out, nvars);
+        for (int r = first[i]; r < first[i + 1]; r++){
+            if (!entry.contains(readVars[r])) reads[r]->setChecked(true);
+        }
+    }
+}
+
+#define INSTANTIATE_ANALYSIS(Value) \
+    template void buildLineGraph<Value>(const vector<int> & numbers, const vector<Statement<Value> *> & stmts, \
+                                        vector<vector<int> > & preds); \
+    template void markDefinedReads<Value>(const vector<int> & numbers, const vector<Statement<Value> *> & stmts);
+FOR_EACH_VALUE_TYPE(INSTANTIATE_ANALYSIS)
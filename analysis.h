@@ -0,0 +1,63 @@
+/*
+ * File: analysis.h
+ * ----------------
+ * This interface exports the definite-assignment analysis, a
+ * control-flow analysis over the lines of a BASIC program that finds
+ * the variable reads which can never see an undefined variable.
+ */
+
+#ifndef _analysis_h
+#define _analysis_h
+
+#include <vector>
+#include "exp.h"
+#include "statement.h"
+
+/*
+ * Function: buildLineGraph
+ * Usage: buildLineGraph(numbers, stmts, preds);
+ * ---------------------------------------------
+ * Builds the line graph of a program whose lines are all parsed, as
+ * the predecessor lists of its nodes.  Node i is line i, and the nodes
+ * after the lines merge the jumps of NEXT, RETURN and computed GOTO,
+ * whose targets are only known at run time; the edges are the ones
+ * markDefinedReads describes.
+ */
+
+template <typename Value>
+void buildLineGraph(const std::vector<int> & numbers, const std::vector<Statement<Value> *> & stmts,
+                    std::vector<std::vector<int> > & preds);
+
+/*
+ * Function: markDefinedReads
+ * Usage: markDefinedReads(numbers, stmts);
+ * ----------------------------------------
+ * Computes which variables are definitely assigned when each line of a
+ * program starts executing.  The lines are given in line order by
+ * their numbers and statements.  The line graph has an edge from every
+ * line to the next one, except after END, GOTO, GOSUB and RETURN, and
+ * an edge from every GOTO, IF and GOSUB to its target, from every ON
+ * GOTO to each of its targets, from every computed GOTO to every line,
+ * from every FOR to the line after its NEXT, from every NEXT to the
+ * line after each FOR it may close, and from every RETURN to the line
+ * after every GOSUB.  A variable is definitely assigned at a line if a LET, INPUT,
+ * INPUT #, FOR, MAT SUM or MAT DOT assigns it on every path from the
+ * first line.
+ *
+ * Every IdentifierExp whose variable is definitely assigned is marked
+ * unchecked, so eval skips the "VARIABLE NOT DEFINED" test.  All other
+ * reads keep the check, so the errors a program raises do not change.
+ *
+ * The facts of the lines are collected into flat arrays that live only
+ * for the duration of the call; the program calls it again after it
+ * has been edited.  Each call solves the whole program rather than only
+ * the lines an edit can reach: an edit may add or remove the edges of
+ * its neighbours as well as its own, and the program rebuilds its line
+ * graph and runs its other passes over every line anyway, so the
+ * solution is a small part of the cost of preparing a run.
+ */
+
+template <typename Value>
+void markDefinedReads(const std::vector<int> & numbers, const std::vector<Statement<Value> *> & stmts);
+
+#endif
@@ -0,0 +1,394 @@
+/*
+ * File: bigint.cpp
+ * ----------------
+ * This file implements the slow paths of the BigInt class, which work
+ * on magnitudes stored as vectors of 32-bit limbs.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "bigint.h"
+using namespace std;
+
+typedef vector<unsigned int> Digits;
+
+namespace {
+
+const unsigned long long BASE = 1ULL << 32;
+
+//operands with at least this many limbs are multiplied by Karatsuba
+const size_t KARATSUBA_THRESHOLD = 32;
+
+//the decimal digits converted at a time
+const unsigned int CHUNK = 1000000000;
+const int CHUNK_DIGITS = 9;
+
+}
+
+//drop the leading zero limbs
+static void trim(Digits & d)
+{
+   while (!d.empty() && d.back() == 0) d.pop_back();
+}
+
+static int compareDigits(const Digits & a, const Digits & b)
+{
+   if (a.size() != b.size()) return (a.size() < b.size()) ? -1 : 1;
+   for (size_t i = a.size(); i-- > 0;) {
+      if (a[i] != b[i]) return (a[i] < b[i]) ? -1 : 1;
+   }
+   return 0;
+}
+
+//acc += x * BASE^shift
+static void addShifted(Digits & acc, const Digits & x, size_t shift)
+{
+   if (acc.size() < x.size() + shift) acc.resize(x.size() + shift, 0);
+   unsigned long long carry = 0;
+   size_t i = 0;
+   for (; i < x.size(); i++) {
+      unsigned long long sum = (unsigned long long) acc[i + shift] + x[i] + carry;
+      acc[i + shift] = (unsigned int) sum;
+      carry = sum >> 32;
+   }
+   for (i += shift; carry != 0; i++) {
+      if (i == acc.size()) acc.push_back(0);
+      unsigned long long sum = (unsigned long long) acc[i] + carry;
+      acc[i] = (unsigned int) sum;
+      carry = sum >> 32;
+   }
+}
+
+//acc -= x, with acc >= x
+static void subtractDigits(Digits & acc, const Digits & x)
+{
+   long long borrow = 0;
+   size_t i = 0;
+   for (; i < x.size(); i++) {
+      long long difference = (long long) acc[i] - x[i] - borrow;
+      borrow = (difference < 0) ? 1 : 0;
+      acc[i] = (unsigned int) difference;
+   }
+   for (; borrow != 0 && i < acc.size(); i++) {
+      borrow = (acc[i] == 0) ? 1 : 0;
+      acc[i]--;
+   }
+   trim(acc);
+}
+
+static Digits multiplySchoolbook(const Digits & a, const Digits & b)
+{
+   Digits product(a.size() + b.size(), 0);
+   for (size_t i = 0; i < a.size(); i++) {
+      unsigned long long carry = 0;
+      for (size_t j = 0; j < b.size(); j++) {
+         unsigned long long t = (unsigned long long) a[i] * b[j] + product[i + j] + carry;
+         product[i + j] = (unsigned int) t;
+         carry = t >> 32;
+      }
+      product[i + b.size()] = (unsigned int) carry;
+   }
+   trim(product);
+   return product;
+}
+
+/*
+ * Implementation notes: multiplyDigits
+ * ------------------------------------
+ * Karatsuba splits both operands at half the longer one, a = a1 B + a0
+ * and b = b1 B + b0, and gets the product from three half-size
+ * products instead of four:
+ *
+ *    z0 = a0 b0,  z2 = a1 b1,  z1 = (a0 + a1)(b0 + b1) - z0 - z2
+ *    a b = z2 B^2 + z1 B + z0
+ *
+ * When one operand has no upper half, a b = (a1 b) B + a0 b instead,
+ * with a the longer one.  Below the threshold the schoolbook product is
+ * faster.
+ */
+
+static Digits multiplyDigits(const Digits & a, const Digits & b)
+{
+   if (a.size() < KARATSUBA_THRESHOLD || b.size() < KARATSUBA_THRESHOLD) return multiplySchoolbook(a, b);
+   size_t half = max(a.size(), b.size()) / 2;
+   Digits a0(a.begin(), a.begin() + min(half, a.size()));
+   Digits a1(a.begin() + min(half, a.size()), a.end());
+   Digits b0(b.begin(), b.begin() + min(half, b.size()));
+   Digits b1(b.begin() + min(half, b.size()), b.end());
+   trim(a0);
+   trim(b0);
+   if (a1.empty() || b1.empty()) {
+      const Digits & whole = a1.empty() ? a : b;
+      const Digits & low = a1.empty() ? b0 : a0;
+      const Digits & high = a1.empty() ? b1 : a1;
+      Digits product = multiplyDigits(low, whole);
+      addShifted(product, multiplyDigits(high, whole), half);
+      trim(product);
+      return product;
+   }
+   Digits z0 = multiplyDigits(a0, b0);
+   Digits z2 = multiplyDigits(a1, b1);
+   Digits sa = a0;
+   addShifted(sa, a1, 0);
+   Digits sb = b0;
+   addShifted(sb, b1, 0);
+   Digits z1 = multiplyDigits(sa, sb);
+   trim(z1);
+   subtractDigits(z1, z0);
+   subtractDigits(z1, z2);
+   Digits product = z0;
+   addShifted(product, z1, half);
+   addShifted(product, z2, 2 * half);
+   trim(product);
+   return product;
+}
+
+//d = d / divisor, returns the remainder
+static unsigned int divideSmall(Digits & d, unsigned int divisor)
+{
+   unsigned long long remainder = 0;
+   for (size_t i = d.size(); i-- > 0;) {
+      unsigned long long t = (remainder << 32) | d[i];
+      d[i] = (unsigned int) (t / divisor);
+      remainder = t % divisor;
+   }
+   trim(d);
+   return (unsigned int) remainder;
+}
+
+//d = d * factor + addend
+static void multiplyAddSmall(Digits & d, unsigned int factor, unsigned int addend)
+{
+   unsigned long long carry = addend;
+   for (size_t i = 0; i < d.size(); i++) {
+      unsigned long long t = (unsigned long long) d[i] * factor + carry;
+      d[i] = (unsigned int) t;
+      carry = t >> 32;
+   }
+   if (carry != 0) d.push_back((unsigned int) carry);
+}
+
+/*
+ * Implementation notes: divideDigits
+ * ----------------------------------
+ * This is the long division of Knuth's Algorithm D.  Both operands are
+ * shifted so the top limb of the divisor has its high bit set; then
+ * each quotient limb estimated from the top two limbs of the remainder
+ * is at most two too large, and the estimate is corrected before the
+ * multiply-and-subtract step, which adds the divisor back in the rare
+ * case where it is still one too large.
+ */
+
+static Digits divideDigits(const Digits & u, const Digits & v)
+{
+   if (compareDigits(u, v) < 0) return Digits();
+   if (v.size() == 1) {
+      Digits q = u;
+      divideSmall(q, v[0]);
+      return q;
+   }
+   size_t n = v.size();
+   size_t m = u.size();
+   int s = __builtin_clz(v.back());
+   Digits vn(n);
+   Digits un(m + 1);
+   for (size_t i = n; i-- > 0;) {
+      vn[i] = v[i] << s;
+      if (s != 0 && i > 0) vn[i] |= v[i - 1] >> (32 - s);
+   }
+   un[m] = (s == 0) ? 0 : u[m - 1] >> (32 - s);
+   for (size_t i = m; i-- > 0;) {
+      un[i] = u[i] << s;
+      if (s != 0 && i > 0) un[i] |= u[i - 1] >> (32 - s);
+   }
+   Digits q(m - n + 1, 0);
+   for (size_t j = m - n + 1; j-- > 0;) {
+      unsigned long long top = ((unsigned long long) un[j + n] << 32) | un[j + n - 1];
+      unsigned long long qhat = top / vn[n - 1];
+      unsigned long long rhat = top % vn[n - 1];
+      while (qhat >= BASE || qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+         qhat--;
+         rhat += vn[n - 1];
+         if (rhat >= BASE) break;
+      }
+      long long borrow = 0;
+      long long t;
+      for (size_t i = 0; i < n; i++) {
+         unsigned long long p = qhat * vn[i];
+         t = (long long) un[i + j] - borrow - (long long) (p & 0xFFFFFFFFULL);
+         un[i + j] = (unsigned int) t;
+         borrow = (long long) (p >> 32) - (t >> 32);
+      }
+      t = (long long) un[j + n] - borrow;
+      un[j + n] = (unsigned int) t;
+      q[j] = (unsigned int) qhat;
+      if (t < 0) {
+         q[j]--;
+         unsigned long long carry = 0;
+         for (size_t i = 0; i < n; i++) {
+            unsigned long long sum = (unsigned long long) un[i + j] + vn[i] + carry;
+            un[i + j] = (unsigned int) sum;
+            carry = sum >> 32;
+         }
+         un[j + n] += (unsigned int) carry;
+      }
+   }
+   trim(q);
+   return q;
+}
+
+/* Implementation of the BigInt class */
+
+void BigInt::copyLimbs(const BigInt & other) {
+   big = new Limbs(*other.big);
+}
+
+BigInt BigInt::fromMagnitude(bool negative, Digits & digits) {
+   trim(digits);
+   if (digits.size() <= 2) {
+      unsigned long long magnitude = 0;
+      if (digits.size() > 0) magnitude = digits[0];
+      if (digits.size() > 1) magnitude |= (unsigned long long) digits[1] << 32;
+      if (!negative && magnitude <= (unsigned long long) LLONG_MAX) return BigInt((long long) magnitude);
+      if (negative && magnitude <= (unsigned long long) LLONG_MAX) return BigInt(-(long long) magnitude);
+      if (negative && magnitude == (unsigned long long) LLONG_MAX + 1) return BigInt(LLONG_MIN);
+   }
+   BigInt value;
+   value.big = new Limbs;
+   value.big->negative = negative;
+   value.big->digits.swap(digits);
+   return value;
+}
+
+const Digits & BigInt::magnitude(bool & negative, Digits & scratch) const {
+   if (big != NULL) {
+      negative = big->negative;
+      return big->digits;
+   }
+   negative = small < 0;
+   unsigned long long value = negative ? 0ULL - (unsigned long long) small : (unsigned long long) small;
+   scratch.clear();
+   scratch.push_back((unsigned int) value);
+   scratch.push_back((unsigned int) (value >> 32));
+   trim(scratch);
+   return scratch;
+}
+
+BigInt BigInt::add(const BigInt & a, const BigInt & b, bool subtract) {
+   bool aNegative, bNegative;
+   Digits aScratch, bScratch;
+   const Digits & x = a.magnitude(aNegative, aScratch);
+   const Digits & y = b.magnitude(bNegative, bScratch);
+   if (subtract) bNegative = !bNegative;
+   Digits result;
+   if (aNegative == bNegative) {
+      result = x;
+      addShifted(result, y, 0);
+      return fromMagnitude(aNegative, result);
+   }
+   if (compareDigits(x, y) >= 0) {
+      result = x;
+      subtractDigits(result, y);
+      return fromMagnitude(aNegative, result);
+   }
+   result = y;
+   subtractDigits(result, x);
+   return fromMagnitude(bNegative, result);
+}
+
+BigInt BigInt::multiply(const BigInt & a, const BigInt & b) {
+   bool aNegative, bNegative;
+   Digits aScratch, bScratch;
+   const Digits & x = a.magnitude(aNegative, aScratch);
+   const Digits & y = b.magnitude(bNegative, bScratch);
+   Digits product = multiplyDigits(x, y);
+   return fromMagnitude(aNegative != bNegative, product);
+}
+
+BigInt BigInt::divide(const BigInt & a, const BigInt & b) {
+   bool aNegative, bNegative;
+   Digits aScratch, bScratch;
+   const Digits & x = a.magnitude(aNegative, aScratch);
+   const Digits & y = b.magnitude(bNegative, bScratch);
+   if (y.empty()) return BigInt();
+   Digits quotient = divideDigits(x, y);
+   return fromMagnitude(aNegative != bNegative, quotient);
+}
+
+int BigInt::compare(const BigInt & a, const BigInt & b) {
+   bool aNegative, bNegative;
+   Digits aScratch, bScratch;
+   const Digits & x = a.magnitude(aNegative, aScratch);
+   const Digits & y = b.magnitude(bNegative, bScratch);
+   if (aNegative != bNegative) return aNegative ? -1 : 1;
+   int order = compareDigits(x, y);
+   return aNegative ? -order : order;
+}
+
+/*
+ * Implementation notes: parse
+ * ---------------------------
+ * Up to 18 digits always fit in a long long.  Longer numbers are built
+ * nine decimal digits at a time.
+ */
+
+bool BigInt::parse(const string & text, BigInt & value) {
+   size_t start = 0;
+   while (start < text.size() && isspace((unsigned char) text[start])) start++;
+   size_t end = text.size();
+   while (end > start && isspace((unsigned char) text[end - 1])) end--;
+   bool negative = false;
+   if (start < end && (text[start] == '+' || text[start] == '-')) {
+      negative = text[start] == '-';
+      start++;
+   }
+   if (start == end) return false;
+   for (size_t i = start; i < end; i++) {
+      if (!isdigit((unsigned char) text[i])) return false;
+   }
+   while (start + 1 < end && text[start] == '0') start++;
+   if (end - start <= 18) {
+      long long small = 0;
+      for (size_t i = start; i < end; i++) small = small * 10 + (text[i] - '0');
+      value = BigInt(negative ? -small : small);
+      return true;
+   }
+   Digits digits;
+   size_t first = start + (end - start) % CHUNK_DIGITS;
+   if (first == start) first += CHUNK_DIGITS;
+   for (size_t i = start; i < end;) {
+      unsigned int chunk = 0;
+      unsigned int factor = 1;
+      for (; i < first; i++) {
+         chunk = chunk * 10 + (text[i] - '0');
+         factor *= 10;
+      }
+      multiplyAddSmall(digits, factor, chunk);
+      first += CHUNK_DIGITS;
+   }
+   value = fromMagnitude(negative, digits);
+   return true;
+}
+
+string BigInt::toString() const {
+   ostringstream out;
+   if (big == NULL) {
+      out << small;
+      return out.str();
+   }
+   Digits digits = big->digits;
+   vector<unsigned int> chunks;
+   while (!digits.empty()) chunks.push_back(divideSmall(digits, CHUNK));
+   if (big->negative) out << '-';
+   out << chunks.back();
+   for (size_t i = chunks.size() - 1; i-- > 0;) {
+      out.width(CHUNK_DIGITS);
+      out.fill('0');
+      out << chunks[i];
+   }
+   return out.str();
+}
@@ -0,0 +1,227 @@
+/*
+ * File: bigint.h
+ * --------------
+ * This interface exports the BigInt class, the value type of the
+ * interpreter when it computes with exact integers of any size.
+ */
+
+#ifndef _bigint_h
+#define _bigint_h
+
+#include <climits>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+ * Class: BigInt
+ * -------------
+ * A BigInt holds an integer in one of two ways:
+ *
+ *  1. Inline, as a long long, whenever the value fits in one.  The
+ *     arithmetic on two such values uses the checked builtins of the
+ *     compiler and stays inline unless the result overflows, so a
+ *     program whose values stay in 64 bits never allocates.
+ *  2. On the heap, as a sign and a magnitude of 32-bit limbs, least
+ *     significant first, only for a value that does not fit.
+ *
+ * A result that fits in a long long is always stored inline, so two
+ * BigInts are equal exactly when their representations are.
+ */
+
+class BigInt {
+
+public:
+
+/*
+ * Constructor: BigInt
+ * Usage: BigInt value;
+ *        BigInt value(n);
+ * -----------------------
+ * Creates the integer 0, or n.
+ */
+
+   BigInt(long long value = 0) : small(value), big(NULL) {}
+
+/*
+ * Copy and move constructors, assignment operators and destructor
+ * ---------------------------------------------------------------
+ * A copy has its own limbs.
+ */
+
+   BigInt(const BigInt & other) : small(other.small), big(NULL) {
+      if (other.big != NULL) copyLimbs(other);
+   }
+
+   BigInt(BigInt && other) : small(other.small), big(other.big) {
+      other.big = NULL;
+   }
+
+   BigInt & operator=(const BigInt & other) {
+      if (big == NULL && other.big == NULL) {
+         small = other.small;
+      } else if (this != &other) {
+         delete big;
+         big = NULL;
+         small = other.small;
+         if (other.big != NULL) copyLimbs(other);
+      }
+      return *this;
+   }
+
+   BigInt & operator=(BigInt && other) {
+      if (this != &other) {
+         delete big;
+         small = other.small;
+         big = other.big;
+         other.big = NULL;
+      }
+      return *this;
+   }
+
+   ~BigInt() {
+      delete big;
+   }
+
+/*
+ * Methods: isSmall, toSmall
+ * Usage: if (value.isSmall()) n = value.toSmall();
+ * ------------------------------------------------
+ * isSmall returns true if the value fits in a long long, and toSmall
+ * returns it then.
+ */
+
+   bool isSmall() const {
+      return big == NULL;
+   }
+
+   long long toSmall() const {
+      return small;
+   }
+
+/*
+ * Method: parse
+ * Usage: if (BigInt::parse(token, value)) . . .
+ * ---------------------------------------------
+ * Converts a decimal integer with an optional sign, surrounded by
+ * optional whitespace.  Returns false if the text is not one.
+ */
+
+   static bool parse(const std::string & text, BigInt & value);
+
+/*
+ * Method: toString
+ * Usage: string str = value.toString();
+ * -------------------------------------
+ * Returns the value in decimal.
+ */
+
+   std::string toString() const;
+
+/*
+ * Operators: +, -, *, /, +=, comparisons
+ * --------------------------------------
+ * The arithmetic is exact; / truncates towards zero like the division
+ * of the other value types.  Dividing by zero is left to the caller.
+ */
+
+   friend BigInt operator+(const BigInt & a, const BigInt & b);
+   friend BigInt operator-(const BigInt & a, const BigInt & b);
+   friend BigInt operator*(const BigInt & a, const BigInt & b);
+   friend BigInt operator/(const BigInt & a, const BigInt & b);
+   friend bool operator==(const BigInt & a, const BigInt & b);
+   friend bool operator<(const BigInt & a, const BigInt & b);
+
+   BigInt & operator+=(const BigInt & other) {
+      return *this = *this + other;
+   }
+
+private:
+
+   //the sign and magnitude of a value that does not fit in a long long
+   struct Limbs {
+      bool negative;
+      std::vector<unsigned int> digits;
+   };
+
+   void copyLimbs(const BigInt & other);
+
+   //the slow paths, for operands on the heap or results that overflow
+   static BigInt add(const BigInt & a, const BigInt & b, bool subtract);
+   static BigInt multiply(const BigInt & a, const BigInt & b);
+   static BigInt divide(const BigInt & a, const BigInt & b);
+   static int compare(const BigInt & a, const BigInt & b);
+
+   //the value from a sign and a magnitude, inline if it fits
+   static BigInt fromMagnitude(bool negative, std::vector<unsigned int> & digits);
+   //the sign and magnitude of any value; the magnitude of an inline
+   //value is stored in scratch
+   const std::vector<unsigned int> & magnitude(bool & negative, std::vector<unsigned int> & scratch) const;
+
+   long long small;   //the value, when big is NULL
+   Limbs *big;
+
+};
+
+inline BigInt operator+(const BigInt & a, const BigInt & b) {
+   long long sum;
+   if (a.big == NULL && b.big == NULL && !__builtin_add_overflow(a.small, b.small, &sum)) return BigInt(sum);
+   return BigInt::add(a, b, false);
+}
+
+inline BigInt operator-(const BigInt & a, const BigInt & b) {
+   long long difference;
+   if (a.big == NULL && b.big == NULL && !__builtin_sub_overflow(a.small, b.small, &difference)) {
+      return BigInt(difference);
+   }
+   return BigInt::add(a, b, true);
+}
+
+inline BigInt operator*(const BigInt & a, const BigInt & b) {
+   long long product;
+   if (a.big == NULL && b.big == NULL && !__builtin_mul_overflow(a.small, b.small, &product)) {
+      return BigInt(product);
+   }
+   return BigInt::multiply(a, b);
+}
+
+inline BigInt operator/(const BigInt & a, const BigInt & b) {
+   if (a.big == NULL && b.big == NULL && b.small != 0 && !(b.small == -1 && a.small == LLONG_MIN)) {
+      return BigInt(a.small / b.small);
+   }
+   return BigInt::divide(a, b);
+}
+
+inline bool operator==(const BigInt & a, const BigInt & b) {
+   if (a.big == NULL && b.big == NULL) return a.small == b.small;
+   return BigInt::compare(a, b) == 0;
+}
+
+inline bool operator<(const BigInt & a, const BigInt & b) {
+   if (a.big == NULL && b.big == NULL) return a.small < b.small;
+   return BigInt::compare(a, b) < 0;
+}
+
+inline bool operator!=(const BigInt & a, const BigInt & b) {
+   return !(a == b);
+}
+
+inline bool operator>(const BigInt & a, const BigInt & b) {
+   return b < a;
+}
+
+inline bool operator<=(const BigInt & a, const BigInt & b) {
+   return !(b < a);
+}
+
+inline bool operator>=(const BigInt & a, const BigInt & b) {
+   return !(a < b);
+}
+
+inline std::ostream & operator<<(std::ostream & out, const BigInt & value) {
+   if (value.isSmall()) return out << value.toSmall();
+   return out << value.toString();
+}
+
+#endif
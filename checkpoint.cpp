@@ -0,0 +1,317 @@
+/*
+ * File: checkpoint.cpp
+ * --------------------
+ * This file implements the checkpoint encoding and the CheckpointFile
+ * class.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../StanfordCPPLib/error.h"
+#include "checkpoint.h"
+
+using namespace std;
+
+/* Implementation of the encoding */
+
+void putNumber(string & out, unsigned long long n) {
+   while (n >= 0x80) {
+      out += (char) ((n & 0x7f) | 0x80);
+      n >>= 7;
+   }
+   out += (char) n;
+}
+
+void putInteger(string & out, long long n) {
+   putNumber(out, ((unsigned long long) n << 1) ^ (unsigned long long) (n >> 63));
+}
+
+void putString(string & out, const string & text) {
+   putNumber(out, text.size());
+   out += text;
+}
+
+void putBytes(string & out, const void *bytes, size_t length) {
+   out.append((const char *) bytes, length);
+}
+
+bool getNumber(const string & bytes, size_t & pos, unsigned long long & n) {
+   n = 0;
+   for (int shift = 0; pos < bytes.size() && shift < 64; shift += 7) {
+      unsigned char byte = bytes[pos++];
+      n |= (unsigned long long) (byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) return true;
+   }
+   return false;
+}
+
+CheckpointReader::CheckpointReader(const string & init_contents) :contents(init_contents), pos(0) {}
+
+unsigned long long CheckpointReader::readNumber() {
+   unsigned long long n;
+   if (!getNumber(contents, pos, n)) error("CHECKPOINT ERROR");
+   return n;
+}
+
+long long CheckpointReader::readInteger() {
+   unsigned long long n = readNumber();
+   return (long long) (n >> 1) ^ -(long long) (n & 1);
+}
+
+string CheckpointReader::readString() {
+   unsigned long long length = readNumber();
+   if (length > contents.size() - pos) error("CHECKPOINT ERROR");
+   pos += length;
+   return contents.substr(pos - length, length);
+}
+
+void CheckpointReader::readBytes(void *bytes, size_t length) {
+   if (length > contents.size() - pos) error("CHECKPOINT ERROR");
+   memcpy(bytes, contents.data() + pos, length);
+   pos += length;
+}
+
+/*
+ * Implementation notes: the CheckpointFile class
+ * ----------------------------------------------
+ * The slot that is written held the checkpoint before the latest, and
+ * its header still names that one, so until the new header is written
+ * the slot fails its checksum and the latest checkpoint stays the one
+ * in the other slot.  The contents are synced before the header, and
+ * the header is written within one sector.
+ *
+ * A checkpoint too large for a slot is written, with slots twice its
+ * size, into a new file that then replaces the old one, so the file is
+ * never rearranged in place.
+ */
+
+static const char MAGIC[] = "BASCKPT1";
+static const size_t MAGIC_SIZE = 8;
+static const size_t PAGE = 4096;
+static const size_t INITIAL_SLOT = 64 * PAGE;
+
+struct SlotHeader {
+   unsigned long long sequence;
+   unsigned long long length;
+   unsigned long long checksum;    //of the contents
+   unsigned long long check;       //of the three fields above
+};
+
+//the 64-bit FNV-1a hash of some bytes
+static unsigned long long hashBytes(const void *bytes, size_t length,
+                                    unsigned long long hash = 14695981039346656037ULL) {
+   const unsigned char *p = (const unsigned char *) bytes;
+   for (size_t i = 0; i < length; i++) {
+      hash = (hash ^ p[i]) * 1099511628211ULL;
+   }
+   return hash;
+}
+
+//the slot holding the latest whole checkpoint of a mapped file, or -1
+static int findLatest(const char *base, size_t size, size_t slotSize, unsigned long long & sequence) {
+   int latest = -1;
+   sequence = 0;
+   for (int k = 0; k < 2; k++) {
+      if (PAGE + (k + 1) * slotSize > size) break;
+      const char *slot = base + PAGE + k * slotSize;
+      SlotHeader header;
+      memcpy(&header, slot, sizeof header);
+      if (header.sequence == 0 || hashBytes(&header, 3 * sizeof(unsigned long long)) != header.check) continue;
+      if (header.length > slotSize - PAGE) continue;
+      if (hashBytes(slot + PAGE, header.length) != header.checksum) continue;
+      if (latest < 0 || header.sequence > sequence) {
+         latest = k;
+         sequence = header.sequence;
+      }
+   }
+   return latest;
+}
+
+//true if a mapped file of this size starts with a checkpoint file header
+static bool readHeader(const char *base, size_t size, size_t & slotSize) {
+   if (size < PAGE || memcmp(base, MAGIC, MAGIC_SIZE) != 0) return false;
+   unsigned long long slot;
+   memcpy(&slot, base + MAGIC_SIZE, sizeof slot);
+   if (slot <= PAGE || slot % PAGE != 0 || (size - PAGE) / 2 < slot) return false;
+   slotSize = slot;
+   return true;
+}
+
+//sync a range of a mapping to disk, returning false on an error
+static bool syncRange(char *start, size_t length) {
+   size_t align = (size_t) (uintptr_t) start % sysconf(_SC_PAGESIZE);
+   return msync(start - align, length + align, MS_SYNC) == 0;
+}
+
+//write the header of a slot whose contents are in place
+static bool commitSlot(char *slot, unsigned long long sequence, const string & contents) {
+   SlotHeader header;
+   header.sequence = sequence;
+   header.length = contents.size();
+   header.checksum = hashBytes(contents.data(), contents.size());
+   header.check = hashBytes(&header, 3 * sizeof(unsigned long long));
+   memcpy(slot, &header, sizeof header);
+   return syncRange(slot, sizeof header);
+}
+
+CheckpointFile::CheckpointFile() :fd(-1), base(NULL), size(0), slotSize(0), latest(-1), sequence(0) {}
+
+CheckpointFile::~CheckpointFile() {
+   close();
+}
+
+bool CheckpointFile::map(int init_fd, size_t init_size) {
+   void *mapping = mmap(NULL, init_size, PROT_READ | PROT_WRITE, MAP_SHARED, init_fd, 0);
+   if (mapping == MAP_FAILED) return false;
+   fd = init_fd;
+   base = (char *) mapping;
+   size = init_size;
+   return true;
+}
+
+bool CheckpointFile::open(const string & init_path) {
+   close();
+   int file = ::open(init_path.c_str(), O_RDWR | O_CREAT, 0666);
+   if (file < 0) return false;
+   struct stat info;
+   if (fstat(file, &info) != 0) {
+      ::close(file);
+      return false;
+   }
+   if (info.st_size == 0) {
+      size_t fresh = PAGE + 2 * INITIAL_SLOT;
+      if (ftruncate(file, fresh) != 0 || !map(file, fresh)) {
+         ::close(file);
+         return false;
+      }
+      unsigned long long slot = INITIAL_SLOT;
+      memcpy(base, MAGIC, MAGIC_SIZE);
+      memcpy(base + MAGIC_SIZE, &slot, sizeof slot);
+      slotSize = INITIAL_SLOT;
+      path = init_path;
+      if (!syncRange(base, PAGE)) {
+         close();
+         return false;
+      }
+      return true;
+   }
+   if (!map(file, info.st_size)) {
+      ::close(file);
+      return false;
+   }
+   if (!readHeader(base, size, slotSize)) {
+      close();
+      return false;
+   }
+   path = init_path;
+   latest = findLatest(base, size, slotSize, sequence);
+   return true;
+}
+
+void CheckpointFile::close() {
+   if (base != NULL) munmap(base, size);
+   if (fd >= 0) ::close(fd);
+   fd = -1;
+   base = NULL;
+   size = slotSize = 0;
+   latest = -1;
+   sequence = 0;
+}
+
+bool CheckpointFile::isOpen() {
+   return fd >= 0;
+}
+
+void CheckpointFile::write(const string & contents) {
+   if (contents.size() > slotSize - PAGE) {
+      grow(contents);
+      return;
+   }
+   int target = (latest == 0) ? 1 : 0;
+   char *slot = base + PAGE + target * slotSize;
+   char *data = slot + PAGE;
+   size_t dirty = 0, dirtyEnd = 0;    //the pages written and not yet synced
+   for (size_t offset = 0; offset < contents.size(); offset += PAGE) {
+      size_t count = min(PAGE, contents.size() - offset);
+      if (memcmp(data + offset, contents.data() + offset, count) == 0) continue;
+      memcpy(data + offset, contents.data() + offset, count);
+      if (offset != dirtyEnd) {
+         if (dirtyEnd > dirty && !syncRange(data + dirty, dirtyEnd - dirty)) error("CHECKPOINT ERROR");
+         dirty = offset;
+      }
+      dirtyEnd = offset + count;
+   }
+   if (dirtyEnd > dirty && !syncRange(data + dirty, dirtyEnd - dirty)) error("CHECKPOINT ERROR");
+   if (!commitSlot(slot, sequence + 1, contents)) error("CHECKPOINT ERROR");
+   sequence++;
+   latest = target;
+}
+
+void CheckpointFile::grow(const string & contents) {
+   size_t newSlot = (2 * (PAGE + contents.size()) + PAGE - 1) / PAGE * PAGE;
+   size_t newSize = PAGE + 2 * newSlot;
+   string temporary = path + ".tmp";
+   int file = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+   if (file < 0) error("CHECKPOINT ERROR");
+   void *mapping = MAP_FAILED;
+   if (ftruncate(file, newSize) == 0) {
+      mapping = mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+   }
+   char *newBase = (char *) mapping;
+   bool ok = mapping != MAP_FAILED;
+   if (ok) {
+      unsigned long long slot = newSlot;
+      memcpy(newBase, MAGIC, MAGIC_SIZE);
+      memcpy(newBase + MAGIC_SIZE, &slot, sizeof slot);
+      memcpy(newBase + 2 * PAGE, contents.data(), contents.size());
+      ok = syncRange(newBase, 2 * PAGE + contents.size())
+           && commitSlot(newBase + PAGE, sequence + 1, contents)
+           && rename(temporary.c_str(), path.c_str()) == 0;
+   }
+   if (!ok) {
+      if (mapping != MAP_FAILED) munmap(mapping, newSize);
+      ::close(file);
+      unlink(temporary.c_str());
+      error("CHECKPOINT ERROR");
+   }
+   munmap(base, size);
+   ::close(fd);
+   fd = file;
+   base = newBase;
+   size = newSize;
+   slotSize = newSlot;
+   latest = 0;
+   sequence++;
+}
+
+bool CheckpointFile::read(const string & path, string & contents) {
+   int file = ::open(path.c_str(), O_RDONLY);
+   if (file < 0) return false;
+   struct stat info;
+   if (fstat(file, &info) != 0 || info.st_size < (off_t) PAGE) {
+      ::close(file);
+      return false;
+   }
+   void *mapping = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, file, 0);
+   ::close(file);
+   if (mapping == MAP_FAILED) return false;
+   const char *base = (const char *) mapping;
+   size_t slotSize;
+   unsigned long long sequence;
+   int latest = -1;
+   if (readHeader(base, info.st_size, slotSize)) latest = findLatest(base, info.st_size, slotSize, sequence);
+   if (latest >= 0) {
+      SlotHeader header;
+      memcpy(&header, base + PAGE + latest * slotSize, sizeof header);
+      contents.assign(base + 2 * PAGE + latest * slotSize, header.length);
+   }
+   munmap(mapping, info.st_size);
+   return latest >= 0;
+}
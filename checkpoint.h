@@ -0,0 +1,158 @@
+/*
+ * File: checkpoint.h
+ * ------------------
+ * This interface exports the CheckpointFile class, which keeps the
+ * latest saved state of a running program in a memory-mapped file so
+ * that it survives a crash, and the functions that encode that state.
+ */
+
+#ifndef _checkpoint_h
+#define _checkpoint_h
+
+#include <cstddef>
+#include <string>
+
+/*
+ * Functions: putNumber, putInteger, putString, putBytes
+ * Usage: putNumber(out, n);
+ * -------------------------
+ * Append to a checkpoint an unsigned number or a signed integer, as
+ * LEB128, a string, as its length and its characters, or raw bytes.
+ */
+
+void putNumber(std::string & out, unsigned long long n);
+void putInteger(std::string & out, long long n);
+void putString(std::string & out, const std::string & text);
+void putBytes(std::string & out, const void *bytes, size_t length);
+
+/*
+ * Function: getNumber
+ * Usage: if (getNumber(bytes, pos, n)) . . .
+ * ------------------------------------------
+ * Reads the LEB128 number putNumber appended at pos in bytes, moving
+ * pos past it.  Returns false if bytes end before the number does.
+ */
+
+bool getNumber(const std::string & bytes, size_t & pos, unsigned long long & n);
+
+/*
+ * Class: CheckpointReader
+ * -----------------------
+ * Reads back, in order, what the put functions appended.  Each method
+ * raises "CHECKPOINT ERROR" if the checkpoint ends before the item.
+ */
+
+class CheckpointReader {
+
+public:
+
+   CheckpointReader(const std::string & init_contents);
+
+   unsigned long long readNumber();
+   long long readInteger();
+   std::string readString();
+   void readBytes(void *bytes, size_t length);
+
+private:
+
+   const std::string & contents;
+   size_t pos;                 //where reading continues
+
+};
+
+/*
+ * Class: CheckpointFile
+ * ---------------------
+ * A file holding the latest checkpoint of a program.  The file has two
+ * slots and a checkpoint is written into the one not holding the
+ * latest, which becomes the latest only when its header is written
+ * after the contents are on disk, so a crash at any time leaves a
+ * whole checkpoint to resume from.  Only the pages that differ from
+ * what the slot held are written, so the cost of a checkpoint on disk
+ * follows the pages that changed since the one before the last, as
+ * long as the contents keep their layout; the contents are still
+ * compared and checksummed in full.
+ *
+ * The file starts with a page holding the eight bytes "BASCKPT1" and
+ * the size of a slot; each slot is a page of header, with the
+ * sequence number, length and checksum of its contents, followed by
+ * the contents.
+ */
+
+class CheckpointFile {
+
+public:
+
+   CheckpointFile();
+   ~CheckpointFile();
+
+/*
+ * Method: open
+ * Usage: if (file.open(path)) . . .
+ * ---------------------------------
+ * Opens the checkpoint file at path, creating it if it does not exist
+ * or is empty, and keeping the checkpoint it holds otherwise.  Returns
+ * false if the file cannot be written or is not a checkpoint file.
+ */
+
+   bool open(const std::string & path);
+
+/*
+ * Method: close
+ * Usage: file.close();
+ * --------------------
+ * Unmaps and closes the file, if it is open.
+ */
+
+   void close();
+
+/*
+ * Method: isOpen
+ * Usage: if (file.isOpen()) . . .
+ * -------------------------------
+ * Returns true if a file is open.
+ */
+
+   bool isOpen();
+
+/*
+ * Method: write
+ * Usage: file.write(contents);
+ * ----------------------------
+ * Makes contents the latest checkpoint, and returns when it is on
+ * disk.  Raises "CHECKPOINT ERROR" if it cannot be written, in which
+ * case the previous checkpoint is still the latest.
+ */
+
+   void write(const std::string & contents);
+
+/*
+ * Method: read
+ * Usage: if (CheckpointFile::read(path, contents)) . . .
+ * ------------------------------------------------------
+ * Sets contents to the latest whole checkpoint of the file at path,
+ * returning false if the file cannot be read or holds none.
+ */
+
+   static bool read(const std::string & path, std::string & contents);
+
+private:
+
+   bool map(int fd, size_t size);
+   void grow(const std::string & contents);
+
+   std::string path;
+   int fd;                     //-1 if no file is open
+   char *base;                 //the mapping of the file
+   size_t size;
+   size_t slotSize;
+   int latest;                 //the slot of the latest checkpoint, or -1
+   unsigned long long sequence;
+
+   //not copyable: the mapping is owned
+   CheckpointFile(const CheckpointFile &);
+   CheckpointFile & operator=(const CheckpointFile &);
+
+};
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * File: cse.cpp
+ * -------------
+ * This file implements the common-subexpression pass.
+ */
+
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "cse.h"
+#include "data.h"
+#include "exp.h"
+#include "fileio.h"
+#include "function.h"
+#include "native.h"
+#include "statement.h"
+using namespace std;
+
+template <typename Value>
+void collectExpressions(Statement<Value> * stmt, vector<Expression<Value> *> & roots)
+{
+    switch (stmt->getType()){
+        case LET_STMT:
+            roots.push_back(((LetStatement<Value> *) stmt)->getExp());
+            break;
+        case PRINT_STMT:
+            roots.push_back(((PrintStatement<Value> *) stmt)->getExp());
+            break;
+        case IF_STMT:
+            roots.push_back(((IfStatement<Value> *) stmt)->getCond()->getLHS());
+            roots.push_back(((IfStatement<Value> *) stmt)->getCond()->getRHS());
+            break;
+        case DIM_STMT:
+            for (int i = 0; i < ((DimStatement<Value> *) stmt)->getCount(); i++){
+                roots.push_back(((DimStatement<Value> *) stmt)->getRows(i));
+                if (((DimStatement<Value> *) stmt)->getCols(i) != NULL) roots.push_back(((DimStatement<Value> *) stmt)->getCols(i));
+            }
+            break;
+        case FOR_STMT:
+            roots.push_back(((ForStatement<Value> *) stmt)->getFrom());
+            roots.push_back(((ForStatement<Value> *) stmt)->getTo());
+            if (((ForStatement<Value> *) stmt)->getStep() != NULL) roots.push_back(((ForStatement<Value> *) stmt)->getStep());
+            break;
+        case MAT_STMT:
+            if (((MatStatement<Value> *) stmt)->getFactor() != NULL) roots.push_back(((MatStatement<Value> *) stmt)->getFactor());
+            break;
+        case ARRAY_LET_STMT:
+            roots.push_back(((ArrayLetStatement<Value> *) stmt)->getTarget());
+            roots.push_back(((ArrayLetStatement<Value> *) stmt)->getExp());
+            break;
+        case ON_GOTO_STMT:
+            roots.push_back(((OnGotoStatement<Value> *) stmt)->getExp());
+            break;
+        case COMPUTED_GOTO_STMT:
+            roots.push_back(((ComputedGotoStatement<Value> *) stmt)->getExp());
+            break;
+        case FILE_PRINT_STMT:
+            if (((FilePrintStatement<Value> *) stmt)->getExp() != NULL) roots.push_back(((FilePrintStatement<Value> *) stmt)->getExp());
+            break;
+        case READ_STMT:
+            for (int i = 0; i < ((ReadStatement<Value> *) stmt)->getCount(); i++){
+                roots.push_back(((ReadStatement<Value> *) stmt)->getTarget(i));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+//add the variables an expression reads
+template <typename Value>
+static void collectVariables(Expression<Value> * exp, set<string> & vars)
+{
+    if (exp->getType() == IDENTIFIER){
+        vars.insert(((IdentifierExp<Value> *) exp)->getName());
+    }else if (exp->getType() == COMPOUND){
+        collectVariables(((CompoundExp<Value> *) exp)->getLHS(), vars);
+        collectVariables(((CompoundExp<Value> *) exp)->getRHS(), vars);
+    }
+}
+
+/*
+ * Implementation notes: collectCopies
+ * -----------------------------------
+ * Removes the memo of every operator and lists each one whose operands
+ * are interned under the operator and the addresses of its operands.
+ * An interned operator is listed once for every place it occurs.
+ * Array elements and function calls are never interned, so an operator
+ * over one of them is never listed, but their subscripts and arguments
+ * are searched.
+ */
+
+template <typename Value>
+static void collectCopies(Expression<Value> * exp, map<string, vector<CompoundExp<Value> *> > & copies)
+{
+    if (exp->getType() == COMPOUND){
+        CompoundExp<Value> * compound = (CompoundExp<Value> *) exp;
+        compound->setMemo(NULL);
+        collectCopies(compound->getLHS(), copies);
+        collectCopies(compound->getRHS(), copies);
+        if (compound->getLHS()->isInterned() && compound->getRHS()->isInterned()){
+            ostringstream key;
+            key << compound->getOp() << ' ' << (void *) compound->getLHS() << ' ' << (void *) compound->getRHS();
+            copies[key.str()].push_back(compound);
+        }
+    }else if (exp->getType() == ARRAY){
+        collectCopies(((ArrayExp<Value> *) exp)->getRow(), copies);
+        if (((ArrayExp<Value> *) exp)->getCol() != NULL) collectCopies(((ArrayExp<Value> *) exp)->getCol(), copies);
+    }else if (exp->getType() == CALL){
+        for (int i = 0; i < ((CallExp<Value> *) exp)->getArgumentCount(); i++){
+            collectCopies(((CallExp<Value> *) exp)->getArgument(i), copies);
+        }
+    }else if (exp->getType() == NATIVE){
+        for (int i = 0; i < ((NativeCallExp<Value> *) exp)->getArgumentCount(); i++){
+            collectCopies(((NativeCallExp<Value> *) exp)->getArgument(i), copies);
+        }
+    }
+}
+
+template <typename Value>
+void markCommonSubexpressions(const vector<Statement<Value> *> & stmts, vector<ExpMemo<Value> > & memos,
+                              map<string, vector<int> > & watched)
+{
+    vector<Expression<Value> *> roots;
+    for (size_t i = 0; i < stmts.size(); i++){
+        if (stmts[i] != NULL) collectExpressions(stmts[i], roots);
+    }
+    map<string, vector<CompoundExp<Value> *> > copies;
+    for (size_t r = 0; r < roots.size(); r++){
+        collectCopies(roots[r], copies);
+    }
+
+    //the subexpressions worth a memo: more than one copy, and a variable
+    vector<vector<CompoundExp<Value> *> *> common;
+    typename map<string, vector<CompoundExp<Value> *> >::iterator it;
+    for (it = copies.begin(); it != copies.end(); it++){
+        if (it->second.size() < 2) continue;
+        set<string> vars;
+        collectVariables(it->second[0], vars);
+        if (vars.empty()) continue;
+        for (set<string>::iterator var = vars.begin(); var != vars.end(); var++){
+            addClock(watched[*var], COMMON_CLOCK);
+        }
+        common.push_back(&it->second);
+    }
+
+    ExpMemo<Value> fresh = { Value(), 0, COMMON_CLOCK };
+    memos.assign(common.size(), fresh);
+    for (size_t k = 0; k < common.size(); k++){
+        for (size_t c = 0; c < common[k]->size(); c++){
+            (*common[k])[c]->setMemo(&memos[k]);
+        }
+    }
+}
+
+#define INSTANTIATE_CSE(Value) \
+    template void collectExpressions<Value>(Statement<Value> * stmt, vector<Expression<Value> *> & roots); \
+    template void markCommonSubexpressions<Value>(const vector<Statement<Value> *> & stmts, \
+                                                  vector<ExpMemo<Value> > & memos, map<string, vector<int> > & watched);
+FOR_EACH_VALUE_TYPE(INSTANTIATE_CSE)
@@ -0,0 +1,54 @@
+/*
+ * File: cse.h
+ * -----------
+ * This interface exports the common-subexpression pass, which makes
+ * the equal subexpressions of a BASIC program share the value last
+ * computed for them while the variables they read are unchanged.
+ */
+
+#ifndef _cse_h
+#define _cse_h
+
+#include <map>
+#include <string>
+#include <vector>
+#include "exp.h"
+#include "statement.h"
+
+/*
+ * Function: collectExpressions
+ * Usage: collectExpressions(stmt, roots);
+ * ---------------------------------------
+ * Appends the numeric expressions of a statement to roots.  An array
+ * element the statement assigns is appended as its ArrayExp.
+ */
+
+template <typename Value>
+void collectExpressions(Statement<Value> * stmt, std::vector<Expression<Value> *> & roots);
+
+/*
+ * Function: markCommonSubexpressions
+ * Usage: markCommonSubexpressions(stmts, memos, watched);
+ * -------------------------------------------------------
+ * Finds the operators of the numeric expressions of the parsed lines
+ * that read a variable and only variables, constants and other such
+ * operators.  Their operands are interned by the parser, so two of them
+ * are equal exactly when they have the same operator and operands.
+ * Every operator that occurs more than once, in one line or in several,
+ * is given the memo shared by its copies, and COMMON_CLOCK is added to
+ * the clocks watching each variable it reads.  memos is refilled with
+ * one memo for each such subexpression, and the memos set by an
+ * earlier call are removed first, so the program calls it again after
+ * it has been edited, before it marks anything else.
+ *
+ * A memo is only trusted within the epoch of COMMON_CLOCK it was
+ * computed in, which ends when one of the watched variables changes,
+ * so a line sees the value computed by an earlier one only if none of
+ * its variables were assigned in between.
+ */
+
+template <typename Value>
+void markCommonSubexpressions(const std::vector<Statement<Value> *> & stmts, std::vector<ExpMemo<Value> > & memos,
+                              std::map<std::string, std::vector<int> > & watched);
+
+#endif
@@ -0,0 +1,196 @@
+/*
+ * File: data.cpp
+ * --------------
+ * This file implements the DATA, READ and RESTORE statements and the
+ * data segment they share.
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../StanfordCPPLib/error.h"
+#include "../StanfordCPPLib/strlib.h"
+#include "data.h"
+using namespace std;
+
+/* Implementation of the data statement class */
+
+template <typename Value>
+DataStatement<Value>::DataStatement(vector<Value> init_values):values(init_values) {}
+
+template <typename Value>
+DataStatement<Value>::~DataStatement()
+{
+    /* Empty */
+}
+
+template <typename Value>
+void DataStatement<Value>::execute(EvalState<Value> & state)
+{
+    /* Empty */
+}
+
+template <typename Value>
+StatementType DataStatement<Value>::getType()
+{
+    return DATA_STMT;
+}
+
+template <typename Value>
+string DataStatement<Value>::toString()
+{
+    ostringstream oss;
+    oss << "DATA ";
+    for (size_t i = 0; i < values.size(); i++){
+        if (i > 0) oss << ", ";
+        ValueTraits<Value>::print(oss, values[i]);
+    }
+    return oss.str();
+}
+
+template <typename Value>
+const vector<Value> & DataStatement<Value>::getValues()
+{
+    return values;
+}
+
+/* Implementation of the read statement class */
+
+template <typename Value>
+ReadStatement<Value>::ReadStatement(vector<Expression<Value> *> init_targets):targets(init_targets) {}
+
+template <typename Value>
+ReadStatement<Value>::~ReadStatement()
+{
+    for (size_t i = 0; i < targets.size(); i++){
+        delete targets[i];
+    }
+}
+
+template <typename Value>
+void ReadStatement<Value>::execute(EvalState<Value> & state)
+{
+    Value value;
+    for (size_t i = 0; i < targets.size(); i++){
+        if (!state.readData(value)) error("OUT OF DATA");
+        if (targets[i]->getType() == IDENTIFIER){
+            state.setValue(((IdentifierExp<Value> *) targets[i])->getName(), value);
+        }else{
+            *((ArrayExp<Value> *) targets[i])->locate(state) = value;
+        }
+    }
+}
+
+template <typename Value>
+StatementType ReadStatement<Value>::getType()
+{
+    return READ_STMT;
+}
+
+template <typename Value>
+string ReadStatement<Value>::toString()
+{
+    string str = "READ ";
+    for (size_t i = 0; i < targets.size(); i++){
+        if (i > 0) str += ", ";
+        str += targets[i]->toString();
+    }
+    return str;
+}
+
+template <typename Value>
+int ReadStatement<Value>::getCount()
+{
+    return targets.size();
+}
+
+template <typename Value>
+Expression<Value> * ReadStatement<Value>::getTarget(int i)
+{
+    return targets[i];
+}
+
+/* Implementation of the restore statement class */
+
+template <typename Value>
+RestoreStatement<Value>::RestoreStatement(int init_line):line(init_line), offset(init_line < 0 ? 0 : -1) {}
+
+template <typename Value>
+RestoreStatement<Value>::~RestoreStatement()
+{
+    /* Empty */
+}
+
+template <typename Value>
+void RestoreStatement<Value>::execute(EvalState<Value> & state)
+{
+    if (offset < 0) error("LINE NUMBER ERROR");
+    state.restoreData(offset);
+}
+
+template <typename Value>
+StatementType RestoreStatement<Value>::getType()
+{
+    return RESTORE_STMT;
+}
+
+template <typename Value>
+string RestoreStatement<Value>::toString()
+{
+    if (line < 0) return "RESTORE";
+    return "RESTORE " + integerToString(line);
+}
+
+template <typename Value>
+int RestoreStatement<Value>::getLine()
+{
+    return line;
+}
+
+template <typename Value>
+void RestoreStatement<Value>::setOffset(int init_offset)
+{
+    offset = init_offset;
+}
+
+/*
+ * Implementation notes: buildDataSegment
+ * --------------------------------------
+ * starts[i] is the offset of the first constant of line i or of the
+ * lines after it, so RESTORE n finds its offset by a binary search for
+ * line n.  An unparsed line is not a DATA line as far as the segment
+ * is concerned; the program parses the DATA lines before building it.
+ */
+
+template <typename Value>
+void buildDataSegment(const vector<int> & numbers, const vector<Statement<Value> *> & stmts, vector<Value> & data)
+{
+    data.clear();
+    vector<int> starts(stmts.size());
+    for (size_t i = 0; i < stmts.size(); i++){
+        starts[i] = data.size();
+        if (stmts[i] == NULL || stmts[i]->getType() != DATA_STMT) continue;
+        const vector<Value> & values = ((DataStatement<Value> *) stmts[i])->getValues();
+        data.insert(data.end(), values.begin(), values.end());
+    }
+    for (size_t i = 0; i < stmts.size(); i++){
+        if (stmts[i] == NULL || stmts[i]->getType() != RESTORE_STMT) continue;
+        RestoreStatement<Value> * restore = (RestoreStatement<Value> *) stmts[i];
+        if (restore->getLine() < 0) continue;
+        vector<int>::const_iterator it = lower_bound(numbers.begin(), numbers.end(), restore->getLine());
+        if (it == numbers.end() || *it != restore->getLine()){
+            restore->setOffset(-1);
+        }else{
+            restore->setOffset(starts[it - numbers.begin()]);
+        }
+    }
+}
+
+#define INSTANTIATE_DATA(Value) \
+    template class DataStatement<Value>; \
+    template class ReadStatement<Value>; \
+    template class RestoreStatement<Value>; \
+    template void buildDataSegment<Value>(const vector<int> & numbers, const vector<Statement<Value> *> & stmts, \
+                                          vector<Value> & data);
+FOR_EACH_VALUE_TYPE(INSTANTIATE_DATA)
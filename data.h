@@ -0,0 +1,199 @@
+/*
+ * File: data.h
+ * ------------
+ * This interface exports the statements that feed constants to a
+ * program: DATA, which holds them, READ, which assigns the next one,
+ * and RESTORE, which rewinds to the first or a given DATA line, along
+ * with buildDataSegment, which collects the constants of a program.
+ */
+
+#ifndef _data_h
+#define _data_h
+
+#include <string>
+#include <vector>
+#include "evalstate.h"
+#include "exp.h"
+#include "statement.h"
+
+/*
+ * Class: DataStatement
+ * --------------------
+ * This subclass of Statement represents the line DATA c1, c2, ...  The
+ * constants are parsed with the line; running it does nothing.
+ */
+
+template <typename Value>
+class DataStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: DataStatement
+ * ----------------------
+ * The constructor initializes a data statement from its constants.
+ */
+
+   DataStatement(std::vector<Value> init_values);
+
+/*
+ * Destructor: ~DataStatement
+ * Usage: delete data_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ */
+
+   virtual ~DataStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  execute a data statement will do nothing
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Method: getValues
+ * Usage: const vector<Value> & values = ((DataStatement<Value> *) stmt)->getValues();
+ * ----------------------------------------------------------------------------------
+ * Returns the constants of the line.
+ */
+
+   const std::vector<Value> & getValues();
+
+    private:
+        std::vector<Value> values;
+};
+
+/*
+ * Class: ReadStatement
+ * --------------------
+ * This subclass of Statement represents READ t1, t2, ..., where each
+ * target is a variable or an array element.  Each target is assigned
+ * the next constant of the data segment; running out of constants
+ * raises "OUT OF DATA".
+ */
+
+template <typename Value>
+class ReadStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: ReadStatement
+ * ----------------------
+ * The constructor initializes a read statement from its targets, each
+ * an IdentifierExp or an ArrayExp.
+ */
+
+   ReadStatement(std::vector<Expression<Value> *> init_targets);
+
+/*
+ * Destructor: ~ReadStatement
+ * Usage: delete read_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ */
+
+   virtual ~ReadStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  execute a read statement will assign the targets in order
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Methods: getCount, getTarget
+ * Usage: Expression<Value> * target = ((ReadStatement<Value> *) stmt)->getTarget(i);
+ * ----------------------------------------------------------------------------------
+ * Return the number of targets and each of them.
+ */
+
+   int getCount();
+   Expression<Value> * getTarget(int i);
+
+    private:
+        std::vector<Expression<Value> *> targets;
+};
+
+/*
+ * Class: RestoreStatement
+ * -----------------------
+ * This subclass of Statement represents RESTORE, which makes the next
+ * READ start over from the first constant, and RESTORE n, which makes
+ * it start from the first DATA line numbered n or more.  Line n must
+ * exist, or the statement raises "LINE NUMBER ERROR".
+ */
+
+template <typename Value>
+class RestoreStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: RestoreStatement
+ * ----------------------
+ * The constructor initializes a restore statement from its line
+ * number, or -1 for none.
+ */
+
+   RestoreStatement(int init_line);
+
+/*
+ * Destructor: ~RestoreStatement
+ * Usage: delete restore_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ */
+
+   virtual ~RestoreStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  execute a restore statement will move the data cursor
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Methods: getLine, setOffset
+ * Usage: restore->setOffset(offset);
+ * ----------------------------------
+ * Return the line number, and set the position in the data segment
+ * the statement moves the cursor to, -1 if the line does not exist.
+ */
+
+   int getLine();
+   void setOffset(int offset);
+
+    private:
+        int line;
+        int offset;
+};
+
+/*
+ * Function: buildDataSegment
+ * Usage: buildDataSegment(numbers, stmts, data);
+ * ----------------------------------------------
+ * Concatenates the constants of the DATA lines, in line order, into
+ * data, and points every RESTORE at its position there.  The lines are
+ * given by their numbers and statements, which may be NULL for lines
+ * not parsed yet.
+ */
+
+template <typename Value>
+void buildDataSegment(const std::vector<int> & numbers, const std::vector<Statement<Value> *> & stmts,
+                      std::vector<Value> & data);
+
+#endif
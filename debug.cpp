@@ -0,0 +1,85 @@
+/*
+ * File: debug.cpp
+ * ---------------
+ * This file implements the TrapStatement class.
+ */
+
+#include <iostream>
+#include <string>
+#include "debug.h"
+#include "evalstate.h"
+#include "statement.h"
+using namespace std;
+
+template <typename Value>
+TrapStatement<Value>::TrapStatement(Statement<Value> * init_original, int init_line, bool init_stop, string init_watch)
+    :original(init_original), line(init_line), stop(init_stop), watch(init_watch), resumed(false), ran(false) {}
+
+template <typename Value>
+TrapStatement<Value>::~TrapStatement()
+{
+    /* Empty */
+}
+
+/*
+ * Implementation notes: TrapStatement::execute
+ * --------------------------------------------
+ * A watched assignment is a LET or INPUT, which never jumps, so the
+ * program counter it leaves can be replaced by BREAK.  An error in the
+ * line propagates before the stop, as it would without the trap.
+ */
+
+template <typename Value>
+void TrapStatement<Value>::execute(EvalState<Value> & state)
+{
+    if (stop && !resumed){
+        cout << "BREAK IN LINE " << line << endl;
+        state.setPC(EvalState<Value>::BREAK);
+        return;
+    }
+    resumed = false;
+    original->execute(state);
+    if (!watch.empty()){
+        cout << "WATCH " << watch << " = ";
+        ValueTraits<Value>::print(cout, state.getValue(watch));
+        cout << " IN LINE " << line << endl;
+        ran = true;
+        state.setPC(EvalState<Value>::BREAK);
+    }
+}
+
+template <typename Value>
+StatementType TrapStatement<Value>::getType()
+{
+    return original->getType();
+}
+
+template <typename Value>
+string TrapStatement<Value>::toString()
+{
+    return original->toString();
+}
+
+template <typename Value>
+Statement<Value> * TrapStatement<Value>::getOriginal()
+{
+    return original;
+}
+
+template <typename Value>
+void TrapStatement<Value>::resume()
+{
+    resumed = true;
+}
+
+template <typename Value>
+bool TrapStatement<Value>::stoppedAfter()
+{
+    bool after = ran;
+    ran = false;
+    return after;
+}
+
+#define INSTANTIATE_DEBUG(Value) \
+    template class TrapStatement<Value>;
+FOR_EACH_VALUE_TYPE(INSTANTIATE_DEBUG)
@@ -0,0 +1,86 @@
+/*
+ * File: debug.h
+ * -------------
+ * This interface exports the TrapStatement class, which stops a run
+ * at a breakpoint or after an assignment to a watched variable.
+ */
+
+#ifndef _debug_h
+#define _debug_h
+
+#include <string>
+#include "evalstate.h"
+#include "statement.h"
+
+/*
+ * Class: TrapStatement
+ * --------------------
+ * A TrapStatement stands in, in the executable image, for a line with
+ * a breakpoint, or for a LET or INPUT line that assigns a watched
+ * variable.  At a breakpoint it stops the run before the line; after
+ * an assignment to a watched variable it runs the line and then stops
+ * the run, printing the new value.  It stops the run by setting the
+ * program counter to EvalState::BREAK, so the lines without a trap run
+ * exactly as they do without a debugger.
+ */
+
+template <typename Value>
+class TrapStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: TrapStatement
+ * ----------------------
+ * The constructor initializes a trap for the statement of a line,
+ * which is not owned, and its line number.  stop sets a breakpoint
+ * and watch names the variable whose assignment stops the run, or is
+ * empty.
+ */
+
+   TrapStatement(Statement<Value> * init_original, int init_line, bool init_stop, std::string init_watch);
+
+/*
+ * Destructor: ~TrapStatement
+ * Usage: delete trap;
+ * -------------------
+ * The destructor deallocates the storage for this trap, but not for
+ * the statement it stands in for.
+ */
+
+   virtual ~TrapStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  stop before the line, or run it and stop after an assignment
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Methods: getOriginal, resume, stoppedAfter
+ * Usage: if (trap->stoppedAfter()) . . .
+ * --------------------------------------
+ * getOriginal returns the statement the trap stands in for.  resume
+ * makes the next execute run the line instead of stopping before it,
+ * for a run that continues from the line.  stoppedAfter returns true
+ * if the last stop came after the line ran, and forgets it.
+ */
+
+   Statement<Value> * getOriginal();
+   void resume();
+   bool stoppedAfter();
+
+    private:
+        Statement<Value> * original;
+        int line;
+        bool stop;
+        std::string watch;
+        bool resumed;                        //pass the breakpoint once
+        bool ran;                            //stopped after the line
+};
+
+#endif
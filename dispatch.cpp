@@ -0,0 +1,161 @@
+/*
+ * File: dispatch.cpp
+ * ------------------
+ * This file implements the SwitchDispatch class.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <string>
+#include <vector>
+#include "dispatch.h"
+#include "evalstate.h"
+#include "exp.h"
+#include "statement.h"
+using namespace std;
+
+//read a line IF V = c THEN n, or IF c = V THEN n
+template <typename Value>
+static bool readCase(Statement<Value> * stmt, IdentifierExp<Value> * & var, Value & key, int & target)
+{
+    if (stmt == NULL || stmt->getType() != IF_STMT) return false;
+    BoolExp<Value> * cond = ((IfStatement<Value> *) stmt)->getCond();
+    if (cond->getOp() != "=") return false;
+    Expression<Value> * lhs = cond->getLHS();
+    Expression<Value> * rhs = cond->getRHS();
+    if (lhs->getType() == CONSTANT) swap(lhs, rhs);
+    if (lhs->getType() != IDENTIFIER || rhs->getType() != CONSTANT) return false;
+    var = (IdentifierExp<Value> *) lhs;
+    key = ((ConstantExp<Value> *) rhs)->getValue();
+    target = ((IfStatement<Value> *) stmt)->getTarget();
+    return true;
+}
+
+//orders the cases of a ladder by key, and by line among equal keys
+template <typename Value>
+struct CaseOrder {
+    const vector<Value> * keys;
+    bool operator()(int a, int b) const {
+        if ((*keys)[a] < (*keys)[b]) return true;
+        if ((*keys)[b] < (*keys)[a]) return false;
+        return a < b;
+    }
+};
+
+/*
+ * Implementation notes: makeSwitchDispatch
+ * ----------------------------------------
+ * The ladder ends at the first line that is not such an IF on the same
+ * variable.  When a constant is tested twice, only its first IF can
+ * jump, so the later ones are dropped.  The variable is read through
+ * the IdentifierExp of the first IF, so an undefined variable raises
+ * the same error there.
+ */
+
+template <typename Value>
+Statement<Value> *makeSwitchDispatch(const vector<int> & numbers, const vector<Statement<Value> *> & stmts,
+                                     int i, int & length)
+{
+    IdentifierExp<Value> * var = NULL;
+    vector<Value> caseKeys;
+    vector<int> caseTargets;
+    int n = stmts.size();
+    int j = i;
+    while (j < n){
+        IdentifierExp<Value> * other;
+        Value key;
+        int target;
+        if (!readCase(stmts[j], other, key, target)) break;
+        if (var != NULL && other->getName() != var->getName()) break;
+        var = other;
+        caseKeys.push_back(key);
+        caseTargets.push_back(target);
+        j++;
+    }
+    length = j - i;
+    if (length < MIN_SWITCH_CASES) return NULL;
+
+    vector<int> order(length);
+    for (int k = 0; k < length; k++) order[k] = k;
+    CaseOrder<Value> less = { &caseKeys };
+    sort(order.begin(), order.end(), less);
+    vector<Value> keys;
+    vector<int> targets;
+    for (int k = 0; k < length; k++){
+        const Value & key = caseKeys[order[k]];
+        if (!keys.empty() && keys.back() == key) continue;
+        keys.push_back(key);
+        targets.push_back(caseTargets[order[k]]);
+    }
+    int exit = (j < n) ? numbers[j] : EvalState<Value>::HALT;
+    return new SwitchDispatch<Value>((IfStatement<Value> *) stmts[i], var, keys, targets, exit);
+}
+
+/*
+ * Implementation notes: the table
+ * -------------------------------
+ * The keys are indexed by a table when every one is an integer that
+ * toInteger gives exactly and the table would be at most twice as long
+ * as the list of keys.  A value that misses the table cannot equal any
+ * key, since every key is in it; the key found is still compared with
+ * the value, which rules out a fraction truncated onto a key.
+ */
+
+template <typename Value>
+SwitchDispatch<Value>::SwitchDispatch(IfStatement<Value> * init_first, IdentifierExp<Value> * init_var,
+                                      vector<Value> init_keys, vector<int> init_targets, int init_exit)
+    :first(init_first), var(init_var), keys(init_keys), targets(init_targets), exit(init_exit), low(0)
+{
+    for (size_t k = 0; k < keys.size(); k++){
+        long long key = ValueTraits<Value>::toInteger(keys[k]);
+        if (key == LLONG_MIN || !(Value(key) == keys[k])) return;
+    }
+    low = ValueTraits<Value>::toInteger(keys.front());
+    unsigned long long span = (unsigned long long) ValueTraits<Value>::toInteger(keys.back()) - low;
+    if (span >= 2 * keys.size()) return;
+    table.assign(span + 1, -1);
+    for (size_t k = 0; k < keys.size(); k++){
+        table[ValueTraits<Value>::toInteger(keys[k]) - low] = k;
+    }
+}
+
+template <typename Value>
+SwitchDispatch<Value>::~SwitchDispatch()
+{
+    /* Empty */
+}
+
+template <typename Value>
+void SwitchDispatch<Value>::execute(EvalState<Value> & state)
+{
+    Value value = var->eval(state);
+    int found = -1;
+    if (!table.empty()){
+        long long key = ValueTraits<Value>::toInteger(value);
+        unsigned long long slot = (unsigned long long) key - low;
+        if (key != LLONG_MIN && slot < table.size()) found = table[slot];
+        if (found >= 0 && !(keys[found] == value)) found = -1;
+    }else{
+        typename vector<Value>::iterator it = lower_bound(keys.begin(), keys.end(), value);
+        if (it != keys.end() && *it == value) found = it - keys.begin();
+    }
+    state.setPC((found >= 0) ? targets[found] : exit);
+}
+
+template <typename Value>
+StatementType SwitchDispatch<Value>::getType()
+{
+    return IF_STMT;
+}
+
+template <typename Value>
+string SwitchDispatch<Value>::toString()
+{
+    return first->toString();
+}
+
+#define INSTANTIATE_DISPATCH(Value) \
+    template class SwitchDispatch<Value>; \
+    template Statement<Value> *makeSwitchDispatch<Value>(const vector<int> & numbers, \
+                                                         const vector<Statement<Value> *> & stmts, int i, int & length);
+FOR_EACH_VALUE_TYPE(INSTANTIATE_DISPATCH)
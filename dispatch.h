@@ -0,0 +1,106 @@
+/*
+ * File: dispatch.h
+ * ----------------
+ * This interface exports the SwitchDispatch class, which runs a ladder
+ * of IF lines that test one variable for equality as a single lookup.
+ */
+
+#ifndef _dispatch_h
+#define _dispatch_h
+
+#include <string>
+#include <vector>
+#include "evalstate.h"
+#include "exp.h"
+#include "statement.h"
+
+/*
+ * Class: SwitchDispatch
+ * ---------------------
+ * A multiway branch on a variable is often written as a ladder
+ *
+ *    100 IF S = 1 THEN 1000
+ *    110 IF S = 2 THEN 2000
+ *    120 IF S = 5 THEN 5000
+ *    130 ...
+ *
+ * A SwitchDispatch stands in for the first IF line of such a ladder.
+ * It reads the variable once and finds the line to jump to among the
+ * constants: by indexing a table when the constants are integers close
+ * together, and by a binary search otherwise.  When no constant
+ * matches, it jumps to the line after the ladder, where the last IF
+ * would have fallen through.  The other IF lines are left as they are,
+ * so a jump into the middle of the ladder runs them one by one.
+ */
+
+template <typename Value>
+class SwitchDispatch : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: SwitchDispatch
+ * ----------------------
+ * The constructor initializes a dispatch from the first IF statement
+ * of the ladder, the variable it reads, the constants with the lines
+ * they jump to, and the line after the ladder, or HALT if there is
+ * none.  The statement and the variable are not owned.
+ */
+
+   SwitchDispatch(IfStatement<Value> * init_first, IdentifierExp<Value> * init_var,
+                  std::vector<Value> init_keys, std::vector<int> init_targets, int init_exit);
+
+/*
+ * Destructor: ~SwitchDispatch
+ * Usage: delete dispatch;
+ * -------------------
+ * The destructor deallocates the storage for this dispatch, but not
+ * for the statement it stands in for.
+ */
+
+   virtual ~SwitchDispatch();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  set the program counter to the line of the matching constant
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+    private:
+        IfStatement<Value> * first;
+        IdentifierExp<Value> * var;
+        std::vector<Value> keys;             //sorted
+        std::vector<int> targets;            //the line of each key
+        int exit;
+        long long low;                       //the key of table[0]
+        std::vector<int> table;              //key index by key - low, or -1;
+                                             //empty if the keys are sparse
+};
+
+/*
+ * Constant: MIN_SWITCH_CASES
+ * --------------------------
+ * The fewest IF lines of a ladder that is run as a SwitchDispatch.
+ */
+
+const int MIN_SWITCH_CASES = 3;
+
+/*
+ * Function: makeSwitchDispatch
+ * Usage: Statement<Value> *dispatch = makeSwitchDispatch(numbers, stmts, i, length);
+ * ----------------------------------------------------------------------------------
+ * Returns a new SwitchDispatch if the lines from index i on start with
+ * at least MIN_SWITCH_CASES lines IF V = c THEN n, or IF c = V THEN n,
+ * with the same variable V and constants c, and sets length to the
+ * number of those lines.  Returns NULL otherwise.
+ */
+
+template <typename Value>
+Statement<Value> *makeSwitchDispatch(const std::vector<int> & numbers, const std::vector<Statement<Value> *> & stmts,
+                                     int i, int & length);
+
+#endif
@@ -6,47 +6,362 @@
  * methods are simple enough that they need no individual documentation.
  */
 
+#include <algorithm>
 #include <string>
+#include <vector>
+#include <new>
+#include <climits>
+#include "checkpoint.h"
 #include "evalstate.h"
+#include "native.h"
 
 #include "../StanfordCPPLib/map.h"
 using namespace std;
 
 /* Implementation of the EvalState class */
 
-EvalState::EvalState() {
-    program_counter = SEQUENTIAL;
+//the names of the array slots, in slot order
+static vector<string> & arrayNames() {
+   static vector<string> names;
+   return names;
+}
 
+template <typename Value>
+EvalState<Value>::EvalState() {
+    program_counter = SEQUENTIAL;
+    jump_index = 0;
+    ownsArrays = true;
+    loopDepth = 0;
+    returns.resize(DEFAULT_RETURNS);
+    returnDepth = 0;
+    functions = NULL;
+    frameBase = 0;
+    files = NULL;
+    setData(NULL, 0);
+    epochs.assign(INVARIANT_CLOCK, 1);
+    lastEpoch = 1;
+    watched = NULL;
 }
 
-EvalState::~EvalState() {
-   /* Empty */
+template <typename Value>
+EvalState<Value>::~EvalState() {
+   clear();
 }
 
-void EvalState::setValue(string var, int value) {
+template <typename Value>
+void EvalState<Value>::setValue(string var, Value value) {
    symbolTable.put(var, value);
+   if (watched != NULL) nextEpoch(getClocks(var));
+}
+
+template <typename Value>
+void EvalState<Value>::nextEpoch() {
+   for (size_t c = 0; c < epochs.size(); c++) {
+      if (epochs[c] != 0) epochs[c] = ++lastEpoch;
+   }
+}
+
+template <typename Value>
+void EvalState<Value>::setWatched(const map<string, vector<int> > *clocks) {
+   watched = clocks;
+   size_t count = epochs.size();
+   map<string, vector<int> >::const_iterator it;
+   for (it = clocks->begin(); it != clocks->end(); it++) {
+      for (size_t i = 0; i < it->second.size(); i++) {
+         count = max(count, (size_t) it->second[i] + 1);
+      }
+   }
+   epochs.resize(count, 1);
+   nextEpoch();
 }
 
-int EvalState::getValue(string var) {
+template <typename Value>
+Value EvalState<Value>::getValue(string var) {
    return symbolTable.get(var);
 }
 
-bool EvalState::isDefined(string var) {
+template <typename Value>
+vector<string> EvalState<Value>::getNames() {
+   Vector<string> keys = symbolTable.keys();
+   vector<string> names;
+   for (int i = 0; i < keys.size(); i++) {
+      names.push_back(keys[i]);
+   }
+   return names;
+}
+
+template <typename Value>
+bool EvalState<Value>::isDefined(string var) {
    return symbolTable.containsKey(var);
 }
 
-void EvalState::setPC(int line_number)
+template <typename Value>
+Value *EvalState<Value>::getReference(string var) {
+   return &symbolTable[var];
+}
+
+template <typename Value>
+StringValue *EvalState<Value>::getString(string var) {
+   return stringTable.containsKey(var) ? &stringTable[var] : NULL;
+}
+
+template <typename Value>
+StringValue *EvalState<Value>::getStringReference(string var) {
+   return &stringTable[var];
+}
+
+template <typename Value>
+int EvalState<Value>::arraySlot(string name) {
+   static Map<string,int> slots;
+   if (!slots.containsKey(name)) {
+      slots.put(name, slots.size());
+      arrayNames().push_back(name);
+   }
+   return slots.get(name);
+}
+
+template <typename Value>
+string EvalState<Value>::arrayName(int slot) {
+   return arrayNames()[slot];
+}
+
+/*
+ * Implementation notes: dimArray
+ * ------------------------------
+ * The array object of a slot is kept when it is created again, so a
+ * pointer to it stays valid until clear.
+ */
+
+template <typename Value>
+void EvalState<Value>::dimArray(int slot, int rows, int cols) {
+   if (rows <= 0 || cols < 0) error("SUBSCRIPT OUT OF RANGE");
+   long long size = (long long) rows * (cols > 0 ? cols : 1);
+   if (size > INT_MAX) error("OUT OF MEMORY");
+   if (slot >= (int) arrays.size()) arrays.resize(slot + 1, NULL);
+   if (arrays[slot] == NULL) arrays[slot] = new ArrayValue<Value>;
+   try {
+      arrays[slot]->data.assign(size, 0);
+   } catch (bad_alloc &) {
+      delete arrays[slot];
+      arrays[slot] = NULL;
+      error("OUT OF MEMORY");
+   }
+   arrays[slot]->rows = rows;
+   arrays[slot]->cols = cols;
+}
+
+template <typename Value>
+void EvalState<Value>::pushLoop(const LoopFrame<Value> & frame) {
+   for (int i = loopDepth - 1; i >= 0; i--) {
+      if (loops[i].var == frame.var) {
+         loopDepth = i;
+         break;
+      }
+   }
+   if (loopDepth == MAX_LOOPS) error("OUT OF MEMORY");
+   loops[loopDepth++] = frame;
+}
+
+template <typename Value>
+LoopFrame<Value> *EvalState<Value>::findLoop(const string & name) {
+   for (int i = loopDepth - 1; i >= 0; i--) {
+      if (name.empty() || *loops[i].name == name) {
+         loopDepth = i + 1;
+         return &loops[i];
+      }
+   }
+   return NULL;
+}
+
+template <typename Value>
+void EvalState<Value>::pushReturn(int position) {
+   if (returnDepth == (int) returns.size()) error("STACK OVERFLOW");
+   returns[returnDepth++] = position;
+}
+
+template <typename Value>
+int EvalState<Value>::popReturn() {
+   if (returnDepth == 0) error("RETURN WITHOUT GOSUB");
+   return returns[--returnDepth];
+}
+
+template <typename Value>
+void EvalState<Value>::setReturnLimit(int depth) {
+   returns.assign(depth, 0);
+   returnDepth = 0;
+}
+
+template <typename Value>
+void EvalState<Value>::makeView(EvalState & owner) {
+   clear();
+   symbolTable = owner.symbolTable;
+   arrays = owner.arrays;
+   ownsArrays = false;
+   epochs.assign(owner.epochs.size(), 0);
+}
+
+/*
+ * Implementation notes: save, load
+ * --------------------------------
+ * Arrays are saved by name, since the slots are numbered in the order
+ * the parser first meets the names.  They are saved before the
+ * variables, so that a string that grows does not move them in the
+ * file, and the pages of an array that did not change are not written
+ * again.  A loop frame points to the name of its FOR statement, which a
+ * loaded frame cannot, so the loaded names are kept in loopNames.  The
+ * epochs of all clocks are ended, since every variable may have
+ * changed.
+ */
+
+template <typename Value>
+void EvalState<Value>::save(string & out, const vector<int> & numbers) {
+   int count = 0;
+   for (size_t slot = 0; slot < arrays.size(); slot++) {
+      if (arrays[slot] != NULL) count++;
+   }
+   putNumber(out, count);
+   for (size_t slot = 0; slot < arrays.size(); slot++) {
+      if (arrays[slot] == NULL) continue;
+      putString(out, arrayName(slot));
+      putNumber(out, arrays[slot]->rows);
+      putNumber(out, arrays[slot]->cols);
+      for (size_t i = 0; i < arrays[slot]->data.size(); i++) {
+         ValueTraits<Value>::save(out, arrays[slot]->data[i]);
+      }
+   }
+   Vector<string> names = symbolTable.keys();
+   putNumber(out, names.size());
+   for (int i = 0; i < names.size(); i++) {
+      putString(out, names[i]);
+      ValueTraits<Value>::save(out, symbolTable[names[i]]);
+   }
+   names = stringTable.keys();
+   putNumber(out, names.size());
+   for (int i = 0; i < names.size(); i++) {
+      StringValue & text = stringTable[names[i]];
+      putString(out, names[i]);
+      putString(out, string(text.data(), text.size()));
+   }
+   putNumber(out, loopDepth);
+   for (int i = 0; i < loopDepth; i++) {
+      putString(out, *loops[i].name);
+      ValueTraits<Value>::save(out, loops[i].limit);
+      ValueTraits<Value>::save(out, loops[i].step);
+      putInteger(out, loops[i].body);
+   }
+   putNumber(out, returnDepth);
+   for (int i = 0; i < returnDepth; i++) {
+      putInteger(out, (returns[i] >= 0) ? numbers[returns[i]] : returns[i]);
+   }
+   putNumber(out, dataCursor);
+   putNumber(out, randomSeed());
+}
+
+template <typename Value>
+void EvalState<Value>::load(CheckpointReader & in, const vector<int> & numbers) {
+   symbolTable.clear();
+   stringTable.clear();
+   for (size_t i = 0; i < arrays.size(); i++) {
+      delete arrays[i];
+   }
+   arrays.clear();
+   loopDepth = 0;
+   loopNames.clear();
+   returnDepth = 0;
+   for (unsigned long long n = in.readNumber(); n > 0; n--) {
+      int slot = arraySlot(in.readString());
+      int rows = in.readNumber();
+      int cols = in.readNumber();
+      dimArray(slot, rows, cols);
+      for (size_t i = 0; i < arrays[slot]->data.size(); i++) {
+         ValueTraits<Value>::load(in, arrays[slot]->data[i]);
+      }
+   }
+   for (unsigned long long n = in.readNumber(); n > 0; n--) {
+      string name = in.readString();
+      ValueTraits<Value>::load(in, symbolTable[name]);
+   }
+   for (unsigned long long n = in.readNumber(); n > 0; n--) {
+      string name = in.readString();
+      string text = in.readString();
+      StringValue value(text.data(), text.size());
+      stringTable[name].swap(value);
+   }
+   unsigned long long depth = in.readNumber();
+   if (depth > MAX_LOOPS) error("CHECKPOINT ERROR");
+   for (unsigned long long i = 0; i < depth; i++) {
+      LoopFrame<Value> frame;
+      frame.name = &*loopNames.insert(in.readString()).first;
+      ValueTraits<Value>::load(in, frame.limit);
+      ValueTraits<Value>::load(in, frame.step);
+      frame.body = in.readInteger();
+      frame.var = getReference(*frame.name);
+      frame.clocks = getClocks(*frame.name);
+      loops[loopDepth++] = frame;
+   }
+   depth = in.readNumber();
+   if (depth > returns.size()) error("STACK OVERFLOW");
+   for (unsigned long long i = 0; i < depth; i++) {
+      long long number = in.readInteger();
+      int index = (int) number;
+      if (number >= 0) {
+         vector<int>::const_iterator it = lower_bound(numbers.begin(), numbers.end(), number);
+         if (it == numbers.end() || *it != number) error("CHECKPOINT DOES NOT MATCH PROGRAM");
+         index = it - numbers.begin();
+      }
+      returns[returnDepth++] = index;
+   }
+   unsigned long long cursor = in.readNumber();
+   if (cursor > (unsigned long long) dataSize) error("CHECKPOINT DOES NOT MATCH PROGRAM");
+   dataCursor = cursor;
+   seedRandom(in.readNumber());
+   nextEpoch();
+}
+
+template <typename Value>
+void EvalState<Value>::setPC(int line_number)
 {
     program_counter = line_number;
 }
 
-int EvalState::getPC()
+template <typename Value>
+int EvalState<Value>::getPC()
 {
     return program_counter;
 }
 
-void EvalState::clear()
+template <typename Value>
+void EvalState<Value>::setJump(int index)
+{
+    program_counter = JUMP;
+    jump_index = index;
+}
+
+template <typename Value>
+int EvalState<Value>::getJump()
+{
+    return jump_index;
+}
+
+template <typename Value>
+void EvalState<Value>::clear()
 {
     symbolTable.clear();
+    stringTable.clear();
+    for (size_t i = 0; ownsArrays && i < arrays.size(); i++) {
+       delete arrays[i];
+    }
+    arrays.clear();
+    loopDepth = 0;
+    returnDepth = 0;
+    functions = NULL;
+    clearArguments();
+    files = NULL;
+    setData(NULL, 0);
+    watched = NULL;
+    nextEpoch();
     program_counter = SEQUENTIAL;
 }
+
+#define INSTANTIATE_EVALSTATE(Value) template class EvalState<Value>;
+FOR_EACH_VALUE_TYPE(INSTANTIATE_EVALSTATE)
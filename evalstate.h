@@ -9,8 +9,71 @@
 #ifndef _evalstate_h
 #define _evalstate_h
 
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 #include "../StanfordCPPLib/map.h"
+#include "stringvalue.h"
+#include "value.h"
+
+template <typename Value>
+class FunctionTable;
+class FileTable;
+
+/*
+ * Type: ArrayValue
+ * ----------------
+ * The storage of an array created by DIM: its elements in one
+ * contiguous buffer, row by row, and its extents.  A 1-D array has
+ * cols == 0.
+ */
+
+template <typename Value>
+struct ArrayValue {
+   std::vector<Value> data;
+   int rows;
+   int cols;
+};
+
+/*
+ * Type: MemoClock
+ * ---------------
+ * The clocks whose epochs the memos of subexpressions are kept for:
+ * one for the common subexpressions, and one for each loop for the
+ * subexpressions that do not change in it.  The loop clocks are
+ * numbered from INVARIANT_CLOCK, so an assignment in one loop does not
+ * end the epoch of the invariants of another.  A set of clocks is a
+ * vector with each clock once, which addClock keeps.
+ */
+
+enum MemoClock { COMMON_CLOCK, INVARIANT_CLOCK };
+
+inline void addClock(std::vector<int> & clocks, int clock) {
+   for (size_t i = 0; i < clocks.size(); i++) {
+      if (clocks[i] == clock) return;
+   }
+   clocks.push_back(clock);
+}
+
+/*
+ * Type: LoopFrame
+ * ---------------
+ * The control record of an active FOR loop: the storage of its
+ * variable, its limit and step, evaluated once by FOR, and the line
+ * number NEXT jumps back to.  name points to the variable name held by
+ * the FOR statement, and clocks is the mask of the clocks watching it.
+ */
+
+template <typename Value>
+struct LoopFrame {
+   Value *var;
+   Value limit;
+   Value step;
+   int body;
+   const std::string *name;
+   const std::vector<int> *clocks;
+};
 
 /*
  * Class: EvalState
@@ -20,15 +83,22 @@
  * environment that the evaluator may need to know.  In this
  * version, the information maintained by the EvalState class
  * is a symbol table that maps variable names into their values and a
- * program counter.
+ * program counter.  It is a template over the type of the values.
  */
 
+template <typename Value>
 class EvalState {
 
 public:
 
     static const int SEQUENTIAL = -1;  //Special Line Number for sequential executive;
     static const int HALT = -2;  //Special Line Number for halting;
+    static const int CALL = -3;  //Special Line Number for GOSUB to the line it names;
+    static const int RETURN = -4;  //Special Line Number for RETURN;
+    static const int BREAK = -5;  //Special Line Number for stopping at a trap of the debugger;
+    static const int JUMP = -6;  //Special Line Number for a jump to the image index set by setJump;
+    static const int MAX_LOOPS = 256;  //Capacity of the loop-control stack;
+    static const int DEFAULT_RETURNS = 1024;  //Default capacity of the return stack;
 
 
 /*
@@ -56,7 +126,7 @@ public:
  * Sets the value associated with the specified var.
  */
 
-   void setValue(std::string var, int value);
+   void setValue(std::string var, Value value);
 
 /*
  * Method: getValue
@@ -65,7 +135,16 @@ public:
  * Returns the value associated with the specified variable.
  */
 
-   int getValue(std::string var);
+   Value getValue(std::string var);
+
+/*
+ * Method: getNames
+ * Usage: vector<string> names = state.getNames();
+ * -----------------------------------------------
+ * Returns the names of the variables that are defined, in order.
+ */
+
+   std::vector<std::string> getNames();
 
 /*
  * Method: isDefined
@@ -76,6 +155,321 @@ public:
 
    bool isDefined(std::string var);
 
+/*
+ * Method: getReference
+ * Usage: Value *var = state.getReference(var);
+ * ------------------------------------------
+ * Returns the storage of the specified variable, defining it with the
+ * value 0 if needed.  The pointer stays valid until clear.
+ */
+
+   Value *getReference(std::string var);
+
+/*
+ * Methods: getString, getStringReference
+ * Usage: StringValue *value = state.getString(var);
+ * -------------------------------------------------
+ * Return the storage of the specified string variable.  getString
+ * returns NULL if the variable is not defined, and getStringReference
+ * defines it as the empty string if needed.  The pointers stay valid
+ * until clear.
+ */
+
+   StringValue *getString(std::string var);
+   StringValue *getStringReference(std::string var);
+
+/*
+ * Method: arraySlot
+ * Usage: int slot = EvalState::arraySlot(name);
+ * ---------------------------------------------
+ * Returns the slot number of the array with the specified name.
+ * Every name gets its own slot the first time it is seen, so the
+ * parser resolves array names once and eval indexes the arrays of a
+ * state directly.
+ */
+
+   static int arraySlot(std::string name);
+
+/*
+ * Method: arrayName
+ * Usage: string name = EvalState::arrayName(slot);
+ * ------------------------------------------------
+ * Returns the name of the array with the specified slot number.
+ */
+
+   static std::string arrayName(int slot);
+
+/*
+ * Method: dimArray
+ * Usage: state.dimArray(slot, rows, cols);
+ * ----------------------------------------
+ * Creates the array in slot with the given extents (cols == 0 for a
+ * 1-D array), all elements 0.  An existing array is replaced.
+ */
+
+   void dimArray(int slot, int rows, int cols);
+
+/*
+ * Method: getArray
+ * Usage: ArrayValue<Value> *array = state.getArray(slot);
+ * ------------------------------------------------
+ * Returns the array in slot, or NULL if it has not been created.
+ */
+
+   ArrayValue<Value> *getArray(int slot) {
+      return (slot < (int) arrays.size()) ? arrays[slot] : NULL;
+   }
+
+/*
+ * Method: pushLoop
+ * Usage: state.pushLoop(frame);
+ * -----------------------------
+ * Pushes the frame of a FOR loop on the loop-control stack.  A frame
+ * for the same variable and all frames above it are removed first, so
+ * a FOR run again, or a loop left by GOTO and entered again, does not
+ * grow the stack.  Raises "OUT OF MEMORY" when the stack is full.
+ */
+
+   void pushLoop(const LoopFrame<Value> & frame);
+
+/*
+ * Method: findLoop
+ * Usage: LoopFrame<Value> *frame = state.findLoop(name);
+ * -----------------------------------------------
+ * Returns the innermost frame, or the innermost frame of the loop
+ * over name if name is not empty, after removing the frames above it.
+ * Returns NULL if there is no such frame.
+ */
+
+   LoopFrame<Value> *findLoop(const std::string & name);
+
+/*
+ * Methods: popLoop, clearLoops
+ * Usage: state.popLoop();
+ * -----------------------
+ * Remove the innermost frame, or all of them.
+ */
+
+   void popLoop() {
+      loopDepth--;
+   }
+
+   void clearLoops() {
+      loopDepth = 0;
+   }
+
+/*
+ * Methods: pushReturn, popReturn
+ * Usage: state.pushReturn(position);
+ *        int position = state.popReturn();
+ * ----------------------------------------
+ * Push and pop the return stack of GOSUB.  A position is where the
+ * program resumes, as resolved by the program, so RETURN needs no line
+ * lookup.  pushReturn raises "STACK OVERFLOW" when the stack is full,
+ * and popReturn raises "RETURN WITHOUT GOSUB" when it is empty.
+ */
+
+   void pushReturn(int position);
+   int popReturn();
+
+/*
+ * Method: setReturnLimit
+ * Usage: state.setReturnLimit(depth);
+ * -----------------------------------
+ * Sets the capacity of the return stack, which also empties it.
+ */
+
+   void setReturnLimit(int depth);
+
+/*
+ * Method: clearReturns
+ * Usage: state.clearReturns();
+ * ----------------------------
+ * Empties the return stack.
+ */
+
+   void clearReturns() {
+      returnDepth = 0;
+   }
+
+/*
+ * Methods: setFunctions, getFunctions
+ * Usage: state.setFunctions(&functions);
+ * --------------------------------------
+ * Set and get the DEF FN functions that calls are resolved against.
+ * There are none until a program runs, and none after clear.
+ */
+
+   void setFunctions(const FunctionTable<Value> *table) {
+      functions = table;
+   }
+
+   const FunctionTable<Value> *getFunctions() {
+      return functions;
+   }
+
+/*
+ * Methods: setFiles, getFiles
+ * Usage: state.setFiles(&files);
+ * ------------------------------
+ * Set and get the channels of OPEN, INPUT #, PRINT # and CLOSE.  There
+ * are none until a program runs, and none after clear.
+ */
+
+   void setFiles(FileTable *table) {
+      files = table;
+   }
+
+   FileTable *getFiles() {
+      return files;
+   }
+
+/*
+ * Methods: pushArgument, enterFrame, getArgument, leaveFrame
+ * Usage: int base = state.getArgumentCount();
+ *        state.pushArgument(value);
+ *        int saved = state.enterFrame(base);
+ *        Value x = state.getArgument(0);
+ *        state.leaveFrame(base, saved);
+ * ----------------------------------------------
+ * The frames of the DEF FN calls being evaluated.  The arguments of a
+ * call are pushed on one stack from base on, and the call's frame
+ * starts there while its body runs.  The stack keeps its capacity, so
+ * a call does not allocate once the stack has grown to the deepest
+ * nesting of calls.
+ */
+
+   int getArgumentCount() {
+      return arguments.size();
+   }
+
+   void pushArgument(const Value & value) {
+      arguments.push_back(value);
+   }
+
+   int enterFrame(int base) {
+      int saved = frameBase;
+      frameBase = base;
+      return saved;
+   }
+
+   const Value & getArgument(int index) {
+      return arguments[frameBase + index];
+   }
+
+   void leaveFrame(int base, int saved) {
+      arguments.resize(base);
+      frameBase = saved;
+   }
+
+/*
+ * Method: clearArguments
+ * Usage: state.clearArguments();
+ * ------------------------------
+ * Empties the argument stack, which a call left by an error does not.
+ */
+
+   void clearArguments() {
+      arguments.clear();
+      frameBase = 0;
+   }
+
+/*
+ * Methods: setData, readData, restoreData
+ * Usage: state.setData(data.data(), data.size());
+ *        if (!state.readData(value)) . . .
+ * ----------------------------------------------
+ * The data segment of the running program and the cursor of READ in
+ * it.  setData puts the cursor at the first constant, readData copies
+ * the constant at the cursor and advances it, returning false at the
+ * end, and restoreData moves it to the given offset.  The segment is
+ * owned by the program.
+ */
+
+   void setData(const Value *values, int count) {
+      data = values;
+      dataSize = count;
+      dataCursor = 0;
+   }
+
+   bool readData(Value & value) {
+      if (dataCursor == dataSize) return false;
+      value = data[dataCursor++];
+      return true;
+   }
+
+   void restoreData(int offset) {
+      dataCursor = offset;
+   }
+
+/*
+ * Methods: getEpoch, nextEpoch, getClocks, setWatched
+ * Usage: if (memo->epoch == state.getEpoch(memo->clock)) . . .
+ * ------------------------------------------------------------
+ * The values of subexpressions are kept for an epoch of a clock, which
+ * ends whenever a variable watched by the clock may change: when
+ * setValue assigns it, when FOR or NEXT steps it, and for every clock
+ * when the state is cleared.  nextEpoch ends the epochs of a set of
+ * clocks, or of all of them, and getClocks gives the set of the clocks
+ * watching a variable, or NULL.  setWatched sets those sets, which the
+ * program owns, and starts a new epoch of every clock.  Every new
+ * epoch is numbered past all the earlier ones of the state, whatever
+ * their clock.  A view stays in epoch 0, in which no values are kept.
+ */
+
+   unsigned long long getEpoch(int clock) {
+      return epochs[clock];
+   }
+
+   void nextEpoch(const std::vector<int> *clocks) {
+      if (clocks == NULL) return;
+      for (size_t i = 0; i < clocks->size(); i++) {
+         unsigned long long & epoch = epochs[(*clocks)[i]];
+         if (epoch != 0) epoch = ++lastEpoch;
+      }
+   }
+
+   void nextEpoch();
+
+   const std::vector<int> *getClocks(const std::string & var) {
+      if (watched == NULL) return NULL;
+      std::map<std::string, std::vector<int> >::const_iterator it = watched->find(var);
+      return (it == watched->end()) ? NULL : &it->second;
+   }
+
+   void setWatched(const std::map<std::string, std::vector<int> > *clocks);
+
+/*
+ * Method: makeView
+ * Usage: view.makeView(state);
+ * ----------------------------
+ * Makes this state a view of another one, for a thread running part of
+ * a PARALLEL FOR: the view gets a copy of the variables and shares the
+ * arrays, which stay owned by the other state.  It gets no string
+ * variables, which a parallel loop never uses.  The view must not
+ * outlive the other state or create arrays.
+ */
+
+   void makeView(EvalState & owner);
+
+/*
+ * Methods: save, load
+ * Usage: state.save(out, numbers);
+ *        state.load(in, numbers);
+ * -------------------------------
+ * save appends to a checkpoint the arrays, the variables, the loop and
+ * return stacks, the position in the data segment and the seed of
+ * RND; load replaces them with those read from a checkpoint.  The
+ * return stack holds the indexes of lines in the image of the program,
+ * which are saved as their line numbers, numbers[index], so that a
+ * checkpoint outlives the image; load raises "CHECKPOINT DOES NOT MATCH
+ * PROGRAM" for a line that is not in the image.  load needs the
+ * functions, data and clocks of the run to be set already.
+ */
+
+   void save(std::string & out, const std::vector<int> & numbers);
+   void load(CheckpointReader & in, const std::vector<int> & numbers);
+
 /*
  * Method: setPC
  * Usage: state.setPC(line_number);
@@ -93,6 +487,19 @@ public:
  */
 
    int getPC();
+
+/*
+ * Methods: setJump, getJump
+ * Usage: state.setJump(index);
+ *        int index = state.getJump();
+ * -----------------------------------
+ * setJump sets the program counter to JUMP, for a jump to an index of
+ * the executable image that the statement resolved when it was linked,
+ * and getJump returns that index.
+ */
+
+   void setJump(int index);
+   int getJump();
 /*
  * Method: clear
  * Usage: evalstate.clear()
@@ -105,7 +512,30 @@ public:
 private:
 
    int program_counter; //store the address of the next instruction
-   Map<std::string,int> symbolTable;
+   int jump_index;      //the image index of a JUMP
+   Map<std::string,Value> symbolTable;
+   Map<std::string,StringValue> stringTable;
+   std::vector<ArrayValue<Value> *> arrays;  //indexed by slot, NULL if not created
+   bool ownsArrays;                   //false in a view
+   LoopFrame<Value> loops[MAX_LOOPS];        //the loop-control stack
+   std::set<std::string> loopNames;   //the names of the loaded loop frames
+   int loopDepth;
+   std::vector<int> returns;          //the return stack, at its capacity
+   int returnDepth;
+   const FunctionTable<Value> *functions;
+   std::vector<Value> arguments;      //the argument stack of DEF FN calls
+   int frameBase;
+   FileTable *files;
+   const Value *data;                 //the data segment of READ
+   int dataSize;
+   int dataCursor;
+   std::vector<unsigned long long> epochs;    //of the values of subexpressions
+   unsigned long long lastEpoch;
+   const std::map<std::string, std::vector<int> > *watched;  //the clocks of the variables they read
+
+   //not copyable: the arrays are owned
+   EvalState(const EvalState &);
+   EvalState & operator=(const EvalState &);
 
 };
 
@@ -4,7 +4,9 @@
  * This file implements the Expression class and its subclasses.
  */
 
+#include <sstream>
 #include <string>
+#include <unordered_map>
 #include "../StanfordCPPLib/error.h"
 #include "evalstate.h"
 #include "exp.h"
@@ -16,15 +18,85 @@ using namespace std;
 /*
  * Implementation notes: the Expression class
  * ------------------------------------------
- * The Expression class declares no instance variables and needs no code.
+ * The Expression class counts the owners of an expression, which is
+ * more than one only for an interned expression.
  */
 
-Expression::Expression() {
+template <typename Value>
+Expression<Value>::Expression() :owners(1), interned(false) {}
+
+template <typename Value>
+Expression<Value>::~Expression() {
    /* Empty */
 }
 
-Expression::~Expression() {
-   /* Empty */
+/*
+ * Implementation notes: intern
+ * ----------------------------
+ * The table maps a key of each interned expression to it.  The key of
+ * an operator names its operands by address, which is enough because
+ * they are interned themselves, so an equal operand is the same node.
+ * An expression leaves the table when it is deleted, before another
+ * one can take its address.  The table is never destroyed, so the
+ * expressions deleted when the program exits still find it.
+ */
+
+template <typename Value>
+static unordered_map<string, Expression<Value> *> & internTable() {
+   static unordered_map<string, Expression<Value> *> *table = new unordered_map<string, Expression<Value> *>();
+   return *table;
+}
+
+//the key of an expression that can be interned, or false
+template <typename Value>
+static bool internKey(Expression<Value> *exp, string & key) {
+   ostringstream oss;
+   if (exp->getType() == CONSTANT) {
+      oss << 'C';
+      ValueTraits<Value>::print(oss, ((ConstantExp<Value> *) exp)->getValue());
+   } else if (exp->getType() == IDENTIFIER) {
+      oss << 'I' << ((IdentifierExp<Value> *) exp)->getName();
+   } else if (exp->getType() == COMPOUND) {
+      CompoundExp<Value> *compound = (CompoundExp<Value> *) exp;
+      if (!compound->getLHS()->isInterned() || !compound->getRHS()->isInterned()) return false;
+      oss << 'E' << compound->getOp() << ' ' << (void *) compound->getLHS() << ' ' << (void *) compound->getRHS();
+   } else {
+      return false;
+   }
+   key = oss.str();
+   return true;
+}
+
+template <typename Value>
+Expression<Value> *Expression<Value>::intern(Expression *exp) {
+   string key;
+   if (exp->interned || !internKey(exp, key)) return exp;
+   unordered_map<string, Expression *> & table = internTable<Value>();
+   typename unordered_map<string, Expression *>::iterator it = table.find(key);
+   if (it == table.end()) {
+      table[key] = exp;
+      exp->interned = true;
+      return exp;
+   }
+   it->second->owners++;
+   delete exp;
+   return it->second;
+}
+
+template <typename Value>
+void Expression<Value>::release(Expression *exp) {
+   if (exp == NULL || --exp->owners > 0) return;
+   if (exp->interned) {
+      string key;
+      internKey(exp, key);
+      internTable<Value>().erase(key);
+   }
+   delete exp;
+}
+
+template <typename Value>
+bool Expression<Value>::isInterned() {
+   return interned;
 }
 
 /*
@@ -35,21 +107,28 @@ Expression::~Expression() {
  * value of state but needs it to match the general prototype for eval.
  */
 
-ConstantExp::ConstantExp(int val) :value(val) {}
+template <typename Value>
+ConstantExp<Value>::ConstantExp(Value val) :value(val) {}
 
-int ConstantExp::eval(EvalState & state) {
+template <typename Value>
+Value ConstantExp<Value>::eval(EvalState<Value> & state) {
    return value;
 }
 
-string ConstantExp::toString() {
-   return integerToString(value);
+template <typename Value>
+string ConstantExp<Value>::toString() {
+   ostringstream oss;
+   ValueTraits<Value>::print(oss, value);
+   return oss.str();
 }
 
-ExpressionType ConstantExp::getType() {
+template <typename Value>
+ExpressionType ConstantExp<Value>::getType() {
    return CONSTANT;
 }
 
-int ConstantExp::getValue() {
+template <typename Value>
+Value ConstantExp<Value>::getValue() {
    return value;
 }
 
@@ -61,38 +140,58 @@ int ConstantExp::getValue() {
  * look this variable up in the evaluation state.
  */
 
-IdentifierExp::IdentifierExp(string id) :name(id) {}
+template <typename Value>
+IdentifierExp<Value>::IdentifierExp(string id) :name(id), checked(true) {}
 
-int IdentifierExp::eval(EvalState & state) {
-   if (!state.isDefined(name)) error("VARIABLE NOT DEFINED");
+template <typename Value>
+Value IdentifierExp<Value>::eval(EvalState<Value> & state) {
+   if (checked && !state.isDefined(name)) error("VARIABLE NOT DEFINED");
    return state.getValue(name);
 }
 
-string IdentifierExp::toString() {
+template <typename Value>
+string IdentifierExp<Value>::toString() {
    return name;
 }
 
-ExpressionType IdentifierExp::getType() {
+template <typename Value>
+ExpressionType IdentifierExp<Value>::getType() {
    return IDENTIFIER;
 }
 
-string IdentifierExp::getName() {
+template <typename Value>
+string IdentifierExp<Value>::getName() {
    return name;
 }
 
+template <typename Value>
+void IdentifierExp<Value>::setChecked(bool flag) {
+   checked = flag;
+}
+
+template <typename Value>
+bool IdentifierExp<Value>::isChecked() {
+   return checked;
+}
+
 /*
  * Implementation notes: the CompoundExp subclass
  * ----------------------------------------------
  * The CompoundExp subclass declares instance variables for the operator
  * and the left and right subexpressions.  The implementation of eval 
  * evaluates the subexpressions recursively and then applies the operator.
+ * The subexpressions may be interned, so they are released rather than
+ * deleted.
  */
 
-CompoundExp::CompoundExp(string _op, Expression * _lhs, Expression * _rhs) :op(_op), lhs(_lhs), rhs(_rhs) {}
+template <typename Value>
+CompoundExp<Value>::CompoundExp(string _op, Expression<Value> * _lhs, Expression<Value> * _rhs)
+   :op(_op), lhs(_lhs), rhs(_rhs), memo(NULL) {}
 
-CompoundExp::~CompoundExp() {
-   delete lhs;
-   delete rhs;
+template <typename Value>
+CompoundExp<Value>::~CompoundExp() {
+   Expression<Value>::release(lhs);
+   Expression<Value>::release(rhs);
 }
 
 /*
@@ -103,11 +202,28 @@ CompoundExp::~CompoundExp() {
  * the assignment operator does not evaluate its left operand.
  *
  * Note: Assignment abandoned!!!
+ *
+ * With a memo, eval only calls compute, which does the work, the first
+ * time in an epoch of its clock in the state.  A state with epoch 0,
+ * such as a view on another thread, neither reads nor writes the memo.
  */
 
-int CompoundExp::eval(EvalState & state) {
-   int left = lhs->eval(state);
-   int right = rhs->eval(state);
+template <typename Value>
+Value CompoundExp<Value>::eval(EvalState<Value> & state) {
+   if (memo == NULL) return compute(state);
+   unsigned long long epoch = state.getEpoch(memo->clock);
+   if (epoch == 0) return compute(state);
+   if (memo->epoch == epoch) return memo->value;
+   Value value = compute(state);
+   memo->value = value;
+   memo->epoch = epoch;
+   return value;
+}
+
+template <typename Value>
+Value CompoundExp<Value>::compute(EvalState<Value> & state) {
+   Value left = lhs->eval(state);
+   Value right = rhs->eval(state);
    if (op == "+") return left + right;
    if (op == "-") return left - right;
    if (op == "*") return left * right;
@@ -122,26 +238,121 @@ int CompoundExp::eval(EvalState & state) {
    return 0;
 }
 
-string CompoundExp::toString() {
+template <typename Value>
+string CompoundExp<Value>::toString() {
    return '(' + lhs->toString() + ' ' + op + ' ' + rhs->toString() + ')';
 }
 
-ExpressionType CompoundExp::getType() {
+template <typename Value>
+ExpressionType CompoundExp<Value>::getType() {
    return COMPOUND;
 }
 
-string CompoundExp::getOp() {
+template <typename Value>
+string CompoundExp<Value>::getOp() {
    return op;
 }
 
-Expression *CompoundExp::getLHS() {
+template <typename Value>
+Expression<Value> *CompoundExp<Value>::getLHS() {
    return lhs;
 }
 
-Expression *CompoundExp::getRHS() {
+template <typename Value>
+Expression<Value> *CompoundExp<Value>::getRHS() {
    return rhs;
 }
 
+template <typename Value>
+void CompoundExp<Value>::setMemo(ExpMemo<Value> *init_memo) {
+   memo = init_memo;
+}
+
+template <typename Value>
+ExpMemo<Value> *CompoundExp<Value>::getMemo() {
+   return memo;
+}
+
+/*
+ * Implementation notes: the ArrayExp subclass
+ * -------------------------------------------
+ * The ArrayExp subclass keeps the slot of its array, so that finding
+ * the array is an index into the state rather than a name lookup.
+ */
+
+template <typename Value>
+ArrayExp<Value>::ArrayExp(string id, Expression<Value> * _row, Expression<Value> * _col)
+   :name(id), slot(EvalState<Value>::arraySlot(id)), row(_row), col(_col), checked(true) {}
+
+template <typename Value>
+ArrayExp<Value>::~ArrayExp() {
+   delete row;
+   delete col;
+}
+
+template <typename Value>
+Value ArrayExp<Value>::eval(EvalState<Value> & state) {
+   return *locate(state);
+}
+
+template <typename Value>
+Value *ArrayExp<Value>::locate(EvalState<Value> & state) {
+   ArrayValue<Value> *array = state.getArray(slot);
+   long long i = ValueTraits<Value>::toInteger(row->eval(state));
+   if (!checked) {
+      if (col == NULL) return &array->data[i];
+      return &array->data[i * array->cols + ValueTraits<Value>::toInteger(col->eval(state))];
+   }
+   if (array == NULL) error("ARRAY NOT DEFINED");
+   if ((col == NULL) != (array->cols == 0)) error("SUBSCRIPT OUT OF RANGE");
+   if (i < 0 || i >= array->rows) error("SUBSCRIPT OUT OF RANGE");
+   if (col == NULL) return &array->data[i];
+   long long j = ValueTraits<Value>::toInteger(col->eval(state));
+   if (j < 0 || j >= array->cols) error("SUBSCRIPT OUT OF RANGE");
+   return &array->data[i * array->cols + j];
+}
+
+template <typename Value>
+string ArrayExp<Value>::toString() {
+   if (col == NULL) return name + '(' + row->toString() + ')';
+   return name + '(' + row->toString() + ", " + col->toString() + ')';
+}
+
+template <typename Value>
+ExpressionType ArrayExp<Value>::getType() {
+   return ARRAY;
+}
+
+template <typename Value>
+string ArrayExp<Value>::getName() {
+   return name;
+}
+
+template <typename Value>
+int ArrayExp<Value>::getSlot() {
+   return slot;
+}
+
+template <typename Value>
+Expression<Value> *ArrayExp<Value>::getRow() {
+   return row;
+}
+
+template <typename Value>
+Expression<Value> *ArrayExp<Value>::getCol() {
+   return col;
+}
+
+template <typename Value>
+void ArrayExp<Value>::setChecked(bool flag) {
+   checked = flag;
+}
+
+template <typename Value>
+bool ArrayExp<Value>::isChecked() {
+   return checked;
+}
+
 /*
  * Implementation notes: the line number subclass
  * ----------------------------------------------
@@ -157,7 +368,7 @@ LineNumber::LineNumber(int ln) {
 
 LineNumber::~LineNumber() {}
 
-int LineNumber::eval(EvalState & state) {
+int LineNumber::getValue() {
    return value;
 }
 
@@ -169,9 +380,11 @@ int LineNumber::eval(EvalState & state) {
  * evaluates the subexpressions recursively and then compares them.
  */
 
-BoolExp::BoolExp(string _op, Expression * _lhs, Expression * _rhs) :op(_op), lhs(_lhs), rhs(_rhs) {}
+template <typename Value>
+BoolExp<Value>::BoolExp(string _op, Expression<Value> * _lhs, Expression<Value> * _rhs) :op(_op), lhs(_lhs), rhs(_rhs) {}
 
-BoolExp::~BoolExp() {
+template <typename Value>
+BoolExp<Value>::~BoolExp() {
    delete lhs;
    delete rhs;
 }
@@ -181,12 +394,43 @@ BoolExp::~BoolExp() {
  * --------------------------
  */
 
-bool BoolExp::eval(EvalState & state) {
-   int left = lhs->eval(state);
-   int right = rhs->eval(state);
+template <typename Value>
+bool BoolExp<Value>::eval(EvalState<Value> & state) {
+   Value left = lhs->eval(state);
+   Value right = rhs->eval(state);
    if (op == "<") return left < right;
    if (op == ">") return left > right;
    if (op == "=") return left == right;
    error("SYNTAX ERROR");
    return false;
 }
+
+template <typename Value>
+string BoolExp<Value>::toString() {
+   return lhs->toString() + ' ' + op + ' ' + rhs->toString();
+}
+
+
+template <typename Value>
+string BoolExp<Value>::getOp() {
+   return op;
+}
+
+template <typename Value>
+Expression<Value> *BoolExp<Value>::getLHS() {
+   return lhs;
+}
+
+template <typename Value>
+Expression<Value> *BoolExp<Value>::getRHS() {
+   return rhs;
+}
+
+#define INSTANTIATE_EXP(Value) \
+   template class Expression<Value>; \
+   template class ConstantExp<Value>; \
+   template class IdentifierExp<Value>; \
+   template class CompoundExp<Value>; \
+   template class ArrayExp<Value>; \
+   template class BoolExp<Value>;
+FOR_EACH_VALUE_TYPE(INSTANTIATE_EXP)
@@ -10,15 +10,32 @@
 #define _exp_h
 
 #include "evalstate.h"
+#include "nodepool.h"
 
 /*
  * Type: ExpressionType
  * --------------------
- * This enumerated type is used to differentiate the three different
- * expression types: CONSTANT, IDENTIFIER, and COMPOUND.
+ * This enumerated type is used to differentiate the eight different
+ * expression types: CONSTANT, IDENTIFIER, COMPOUND, ARRAY, LENGTH,
+ * PARAMETER, CALL and NATIVE.
  */
 
-enum ExpressionType { CONSTANT, IDENTIFIER, COMPOUND };
+enum ExpressionType { CONSTANT, IDENTIFIER, COMPOUND, ARRAY, LENGTH, PARAMETER, CALL, NATIVE };
+
+/*
+ * Type: ExpMemo
+ * -------------
+ * The value of a subexpression, kept for the epoch of the clock of the
+ * EvalState in which it was computed.  The equal copies of a common
+ * subexpression in a program share one memo.
+ */
+
+template <typename Value>
+struct ExpMemo {
+   Value value;
+   unsigned long long epoch;
+   int clock;
+};
 
 /*
  * Class: Expression
@@ -29,13 +46,19 @@ enum ExpressionType { CONSTANT, IDENTIFIER, COMPOUND };
  * objects of its own.  Any object must be one of the three
  * concrete subclasses of Expression:
  *
- *  1. ConstantExp   -- an integer constant
+ *  1. ConstantExp   -- a constant
  *  2. IdentifierExp -- a string representing an identifier
  *  3. CompoundExp   -- two expressions combined by an operator
+ *  4. ArrayExp      -- an element of an array
+ *  5. LengthExp     -- the length of a string, declared in strexp.h
+ *  6. ParameterExp  -- a parameter of a function, declared in function.h
+ *  7. CallExp       -- a call of a function, declared in function.h
+ *  8. NativeCallExp -- a call of a native function, declared in native.h
  *
  * The Expression class defines the interface common to all
  * Expression objects; each subclass provides its own specific
- * implementation of the common interface.
+ * implementation of the common interface.  The classes are templates
+ * over the type Value of the values, as described in value.h.
  *
  * Note on syntax: Each of the virtual methods in the Expression
  * class is marked with the designation = 0 on the prototype line.
@@ -43,6 +66,7 @@ enum ExpressionType { CONSTANT, IDENTIFIER, COMPOUND };
  * purely virtual and will always be supplied by the subclass.
  */
 
+template <typename Value>
 class Expression {
 
 public:
@@ -50,8 +74,8 @@ public:
 /*
  * Constructor: Expression
  * -----------------------
- * The base class constructor is empty.  Each subclass must provide
- * its own constructor.
+ * The base class constructor makes the caller the only owner of the
+ * expression.  Each subclass must provide its own constructor.
  */
 
    Expression();
@@ -67,15 +91,31 @@ public:
 
    virtual ~Expression();
 
+/*
+ * Operators: new, delete
+ * Usage: delete exp;
+ * ------------------
+ * Every expression is allocated from the node pool, and freed with the
+ * size of its subclass, which the virtual destructor gives.
+ */
+
+   static void *operator new(size_t size) {
+      return allocateNode(size);
+   }
+
+   static void operator delete(void *node, size_t size) {
+      freeNode(node, size);
+   }
+
 /*
  * Method: eval
- * Usage: int value = exp->eval(state);
- * ------------------------------------
+ * Usage: Value value = exp->eval(state);
+ * --------------------------------------
  * Evaluates this expression and returns its value in the context of
  * the specified EvalState object.
  */
 
-   virtual int eval(EvalState & state) = 0;
+   virtual Value eval(EvalState<Value> & state) = 0;
 
 /*
  * Method: toString
@@ -91,32 +131,57 @@ public:
  * Usage: ExpressionType type = exp->getType();
  * --------------------------------------------
  * Returns the type of the expression, which must be one of the constants
- * CONSTANT, IDENTIFIER, or COMPOUND.
+ * CONSTANT, IDENTIFIER, COMPOUND, ARRAY or LENGTH.
  */
 
    virtual ExpressionType getType() = 0;
 
+/*
+ * Methods: intern, release, isInterned
+ * Usage: Expression<Value> *child = Expression<Value>::intern(exp);
+ *        Expression<Value>::release(child);
+ * -----------------------------------------------------------------
+ * intern hash-conses a new expression, so that equal subexpressions
+ * are one node.  If exp is a constant, a variable, or an operator
+ * applied to two interned expressions, and an equal expression is
+ * interned already, intern deletes exp and returns that one, which
+ * has one more owner; otherwise exp becomes the interned one.  Any
+ * other expression is returned as it is.  An owner gives up an
+ * expression that may be interned with release, which deletes it with
+ * its last owner.
+ */
+
+   static Expression *intern(Expression *exp);
+   static void release(Expression *exp);
+   bool isInterned();
+
+private:
+
+   int owners;
+   bool interned;
+
 };
 
 /*
  * Class: ConstantExp
  * ------------------
- * This subclass represents a constant integer expression.
+ * This subclass represents a constant expression.
  */
 
-class ConstantExp: public Expression {
+template <typename Value>
+class ConstantExp: public Expression<Value> {
 
 public:
 
 /*
  * Constructor: ConstantExp
- * Usage: Expression *exp = new ConstantExp(value);
- * ------------------------------------------------
- * The constructor initializes a new integer constant expression
- * to the given value.
+ * Usage: Expression<Value> *exp = new ConstantExp<Value>(value);
+ * --------------------------------------------------------------
+ * The constructor initializes a new constant expression to the given
+ * value.
  */
 
-   ConstantExp(int val);
+   ConstantExp(Value val);
 
 /*
  * Prototypes for the virtual methods
@@ -125,23 +190,23 @@ public:
  * base class and don't require additional documentation.
  */
 
-   virtual int eval(EvalState & state);
+   virtual Value eval(EvalState<Value> & state);
    virtual std::string toString();
    virtual ExpressionType getType();
 
 /*
  * Method: getValue
- * Usage: int value = ((ConstantExp *) exp)->getValue();
- * -----------------------------------------------------
+ * Usage: Value value = ((ConstantExp<Value> *) exp)->getValue();
+ * --------------------------------------------------------------
  * Returns the value field without calling eval and can be applied
  * only to an object known to be a ConstantExp.
  */
 
-   int getValue();
+   Value getValue();
 
 private:
 
-   int value;
+   Value value;
 
 };
 
@@ -151,14 +216,15 @@ private:
  * This subclass represents an expression corresponding to a variable.
  */
 
-class IdentifierExp : public Expression {
+template <typename Value>
+class IdentifierExp : public Expression<Value> {
 
 public:
 
 /*
  * Constructor: IdentifierExp
- * Usage: Expression *exp = new IdentifierExp(name);
- * -------------------------------------------------
+ * Usage: Expression<Value> *exp = new IdentifierExp<Value>(name);
+ * ---------------------------------------------------------------
  * The constructor initializes a new identifier expression
  * for the variable named by id.
  */
@@ -172,23 +238,37 @@ public:
  * base class and don't require additional documentation.
  */
 
-   virtual int eval(EvalState & state);
+   virtual Value eval(EvalState<Value> & state);
    virtual std::string toString();
    virtual ExpressionType getType();
 
 /*
  * Method: getName
- * Usage: string name = ((IdentifierExp *) exp)->getName();
- * --------------------------------------------------------
+ * Usage: string name = ((IdentifierExp<Value> *) exp)->getName();
+ * ---------------------------------------------------------------
  * Returns the name field of the identifier node and can be applied only
  * to an object known to be an IdentifierExp.
  */
 
    std::string getName();
 
+/*
+ * Methods: setChecked, isChecked
+ * Usage: ((IdentifierExp<Value> *) exp)->setChecked(false);
+ * ---------------------------------------------------------
+ * Controls whether eval checks that the variable is defined before
+ * reading it.  The check is on by default; the definite-assignment
+ * analysis turns it off for reads that are always preceded by an
+ * assignment on every path through the program.
+ */
+
+   void setChecked(bool flag);
+   bool isChecked();
+
 private:
 
    std::string name;
+   bool checked;
 
 };
 
@@ -199,20 +279,21 @@ private:
  * two subexpressions joined by an operator.
  */
 
-class CompoundExp: public Expression {
+template <typename Value>
+class CompoundExp: public Expression<Value> {
 
 public:
 
 /*
  * Constructor: CompoundExp
- * Usage: Expression *exp = new CompoundExp(op, lhs, rhs);
- * -------------------------------------------------------
+ * Usage: Expression<Value> *exp = new CompoundExp<Value>(op, lhs, rhs);
+ * ---------------------------------------------------------------------
  * The constructor initializes a new compound expression
  * which is composed of the operator (op) and the left and
  * right subexpression (lhs and rhs).
  */
 
-   CompoundExp(std::string _op, Expression * _lhs, Expression * _rhs);
+   CompoundExp(std::string _op, Expression<Value> * _lhs, Expression<Value> * _rhs);
 
 /*
  * Prototypes for the virtual methods
@@ -222,28 +303,121 @@ public:
  */
 
    virtual ~CompoundExp();
-   virtual int eval(EvalState & state);
+   virtual Value eval(EvalState<Value> & state);
    virtual std::string toString();
    virtual ExpressionType getType();
 
 /*
  * Methods: getOp, getLHS, getRHS
- * Usage: string op = ((CompoundExp *) exp)->getOp();
- *        Expression *lhs = ((CompoundExp *) exp)->getLHS();
- *        Expression *rhs = ((CompoundExp *) exp)->getRHS();
- * ---------------------------------------------------------
+ * Usage: string op = ((CompoundExp<Value> *) exp)->getOp();
+ *        Expression<Value> *lhs = ((CompoundExp<Value> *) exp)->getLHS();
+ *        Expression<Value> *rhs = ((CompoundExp<Value> *) exp)->getRHS();
+ * ----------------------------------------------------------------------
  * These methods return the components of a compound node and can
  * be applied only to an object known to be a CompoundExp.
  */
 
    std::string getOp();
-   Expression *getLHS();
-   Expression *getRHS();
+   Expression<Value> *getLHS();
+   Expression<Value> *getRHS();
+
+/*
+ * Methods: setMemo, getMemo
+ * Usage: ((CompoundExp<Value> *) exp)->setMemo(memo);
+ * ---------------------------------------------------
+ * Make eval keep the value in memo, or not if memo is NULL.  While
+ * the memo is from the current epoch of its clock in the state, eval
+ * returns it without evaluating the subexpressions.
+ */
+
+   void setMemo(ExpMemo<Value> *memo);
+   ExpMemo<Value> *getMemo();
 
 private:
 
+   Value compute(EvalState<Value> & state);
+
    std::string op;
-   Expression *lhs, *rhs;
+   Expression<Value> *lhs, *rhs;
+   ExpMemo<Value> *memo;
+
+};
+
+/*
+ * Class: ArrayExp
+ * ---------------
+ * This subclass represents an element of an array, A(I) or A(I, J).
+ * The array name is resolved to its slot in EvalState when the
+ * expression is built.
+ */
+
+template <typename Value>
+class ArrayExp: public Expression<Value> {
+
+public:
+
+/*
+ * Constructor: ArrayExp
+ * Usage: Expression<Value> *exp = new ArrayExp<Value>(name, row, col);
+ * --------------------------------------------------------------------
+ * The constructor initializes a new element expression for the array
+ * named by id, with one subscript (col == NULL) or two.
+ */
+
+   ArrayExp(std::string id, Expression<Value> * _row, Expression<Value> * _col = NULL);
+
+/*
+ * Prototypes for the virtual methods
+ * ----------------------------------
+ * These methods have the same prototypes as those in the Expression
+ * base class and don't require additional documentation.
+ */
+
+   virtual ~ArrayExp();
+   virtual Value eval(EvalState<Value> & state);
+   virtual std::string toString();
+   virtual ExpressionType getType();
+
+/*
+ * Method: locate
+ * Usage: Value *element = ((ArrayExp<Value> *) exp)->locate(state);
+ * -----------------------------------------------------------------
+ * Evaluates the subscripts and returns the address of the element,
+ * which LET uses to assign it.
+ */
+
+   Value *locate(EvalState<Value> & state);
+
+/*
+ * Methods: getName, getRow, getCol
+ * Usage: string name = ((ArrayExp<Value> *) exp)->getName();
+ * ----------------------------------------------------------
+ * These methods return the components of an element expression.
+ */
+
+   std::string getName();
+   int getSlot();
+   Expression<Value> *getRow();
+   Expression<Value> *getCol();
+
+/*
+ * Methods: setChecked, isChecked
+ * Usage: ((ArrayExp<Value> *) exp)->setChecked(false);
+ * ----------------------------------------------------
+ * Controls whether locate checks that the array exists and that the
+ * subscripts are in range.  A loop that has proved the whole range of
+ * its subscripts in bounds turns the check off while it runs.
+ */
+
+   void setChecked(bool flag);
+   bool isChecked();
+
+private:
+
+   std::string name;
+   int slot;
+   Expression<Value> *row, *col;
+   bool checked;
 
 };
 
@@ -276,7 +450,19 @@ public:
  * the specified EvalState object.
  */
 
-   int eval(EvalState & state);
+   template <typename Value>
+   int eval(EvalState<Value> & state) {
+      return value;
+   }
+
+/*
+ * Method: getValue
+ * Usage: int value = ln->getValue();
+ * ----------------------------------
+ * Returns the line number without an evaluation state.
+ */
+
+   int getValue();
 
 private:
    int value;
@@ -289,27 +475,42 @@ private:
  * two subexpressions joined by a comparer.
  */
 
+template <typename Value>
 class BoolExp {
 
 public:
 
 /*
  * Constructor: BoolExp
- * Usage: BoolExp *exp = new BoolExp(op, lhs, rhs);
- * -------------------------------------------------------
+ * Usage: BoolExp<Value> *exp = new BoolExp<Value>(op, lhs, rhs);
+ * ---------------------------------------------------------------
  * The constructor initializes a new bool expression
  * which is composed of the operator (op) and the left and
  * right subexpression (lhs and rhs).
  */
 
-   BoolExp(std::string _op, Expression * _lhs, Expression * _rhs);
+   BoolExp(std::string _op, Expression<Value> * _lhs, Expression<Value> * _rhs);
 
    ~BoolExp();
-   bool eval(EvalState & state);
+   bool eval(EvalState<Value> & state);
+   std::string toString();
+
+/*
+ * Methods: getOp, getLHS, getRHS
+ * Usage: string op = cond->getOp();
+ *        Expression<Value> *lhs = cond->getLHS();
+ *        Expression<Value> *rhs = cond->getRHS();
+ * ---------------------------------------
+ * These methods return the components of a bool expression.
+ */
+
+   std::string getOp();
+   Expression<Value> *getLHS();
+   Expression<Value> *getRHS();
 
 private:
 
    std::string op;
-   Expression *lhs, *rhs;
+   Expression<Value> *lhs, *rhs;
 };
 #endif
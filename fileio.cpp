@@ -0,0 +1,491 @@
+/*
+ * File: fileio.cpp
+ * ----------------
+ * This file implements the files of a program and the statements that
+ * use them.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../StanfordCPPLib/error.h"
+#include "../StanfordCPPLib/strlib.h"
+#include "fileio.h"
+
+using namespace std;
+
+/*
+ * Implementation notes: the InputFile class
+ * -----------------------------------------
+ * The mapping is advised as sequential, so the kernel reads ahead of
+ * the parser and drops the pages behind it.  A file that is empty or
+ * cannot be mapped is read with read(2) into the buffer; either way,
+ * the contents lie between begin and end.
+ */
+
+//true for the characters between the tokens of an input file
+static inline bool isSeparator(char ch) {
+   return ch == ' ' || ch == '\n' || ch == ',' || ch == '\t' || ch == '\r';
+}
+
+InputFile::InputFile() :begin(NULL), end(NULL), pos(NULL), mapping(NULL), mappedSize(0) {}
+
+InputFile::~InputFile() {
+   if (mapping != NULL) munmap(mapping, mappedSize);
+}
+
+bool InputFile::open(const string & path) {
+   int fd = ::open(path.c_str(), O_RDONLY);
+   if (fd < 0) return false;
+   struct stat info;
+   if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+      void *map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map != MAP_FAILED) {
+         madvise(map, info.st_size, MADV_SEQUENTIAL);
+         ::close(fd);
+         mapping = map;
+         mappedSize = info.st_size;
+         begin = pos = (const char *) map;
+         end = begin + mappedSize;
+         return true;
+      }
+   }
+   char chunk[1 << 16];
+   while (true) {
+      ssize_t count = read(fd, chunk, sizeof chunk);
+      if (count == 0) break;
+      if (count < 0) {
+         if (errno == EINTR) continue;
+         ::close(fd);
+         return false;
+      }
+      buffer.insert(buffer.end(), chunk, chunk + count);
+   }
+   ::close(fd);
+   begin = pos = buffer.data();
+   end = begin + buffer.size();
+   return true;
+}
+
+bool InputFile::readToken(const char * & start, size_t & length) {
+   while (pos < end && isSeparator(*pos)) pos++;
+   if (pos == end) return false;
+   start = pos;
+   while (pos < end && !isSeparator(*pos)) pos++;
+   length = pos - start;
+   return true;
+}
+
+bool InputFile::readLine(const char * & start, size_t & length) {
+   if (pos == end) return false;
+   start = pos;
+   const char *newline = (const char *) memchr(pos, '\n', end - pos);
+   if (newline == NULL) {
+      length = end - pos;
+      pos = end;
+   } else {
+      length = newline - pos;
+      pos = newline + 1;
+   }
+   if (length > 0 && start[length - 1] == '\r') length--;
+   return true;
+}
+
+/*
+ * Implementation notes: the OutputFile class
+ * ------------------------------------------
+ * A write larger than the buffer goes straight to the file once the
+ * buffer is flushed, rather than through the buffer in pieces.
+ */
+
+//write all the characters to a descriptor, raising WRITE ERROR if it fails
+static void writeAll(int fd, const char *chars, size_t length) {
+   while (length > 0) {
+      ssize_t count = ::write(fd, chars, length);
+      if (count < 0) {
+         if (errno == EINTR) continue;
+         error("WRITE ERROR");
+      }
+      chars += count;
+      length -= count;
+   }
+}
+
+OutputFile::OutputFile() :fd(-1), used(0) {}
+
+OutputFile::~OutputFile() {
+   if (fd >= 0) ::close(fd);
+}
+
+bool OutputFile::open(const string & path) {
+   fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+   if (fd < 0) return false;
+   buffer.resize(WRITE_BUFFER_SIZE);
+   used = 0;
+   return true;
+}
+
+void OutputFile::write(const char *chars, size_t length) {
+   if (length > buffer.size() - used) {
+      flush();
+      if (length >= buffer.size()) {
+         writeAll(fd, chars, length);
+         return;
+      }
+   }
+   memcpy(&buffer[used], chars, length);
+   used += length;
+}
+
+void OutputFile::writeInteger(long long value) {
+   char digits[24];
+   char *p = digits + sizeof digits;
+   unsigned long long magnitude = (value < 0) ? 0ULL - (unsigned long long) value : value;
+   do {
+      *--p = '0' + magnitude % 10;
+      magnitude /= 10;
+   } while (magnitude != 0);
+   if (value < 0) *--p = '-';
+   write(p, digits + sizeof digits - p);
+}
+
+void OutputFile::flush() {
+   size_t count = used;
+   used = 0;
+   writeAll(fd, buffer.data(), count);
+}
+
+void OutputFile::close() {
+   if (fd < 0) return;
+   int closing = fd;
+   fd = -1;
+   try {
+      writeAll(closing, buffer.data(), used);
+   } catch (ErrorException &) {
+      ::close(closing);
+      throw;
+   }
+   used = 0;
+   if (::close(closing) != 0) error("WRITE ERROR");
+}
+
+/*
+ * Implementation notes: the FileTable class
+ * -----------------------------------------
+ * closeAll closes every file even if writing one of them fails, and
+ * raises the error after.
+ */
+
+FileTable::FileTable() {
+   for (int i = 0; i <= MAX_FILES; i++) {
+      inputs[i] = NULL;
+      outputs[i] = NULL;
+   }
+}
+
+FileTable::~FileTable() {
+   for (int i = 0; i <= MAX_FILES; i++) {
+      delete inputs[i];
+      delete outputs[i];
+   }
+}
+
+void FileTable::openInput(int channel, const string & path) {
+   if (inputs[channel] != NULL || outputs[channel] != NULL) error("FILE ALREADY OPEN");
+   InputFile *file = new InputFile;
+   if (!file->open(path)) {
+      delete file;
+      error("CANNOT OPEN FILE");
+   }
+   inputs[channel] = file;
+}
+
+void FileTable::openOutput(int channel, const string & path) {
+   if (inputs[channel] != NULL || outputs[channel] != NULL) error("FILE ALREADY OPEN");
+   OutputFile *file = new OutputFile;
+   if (!file->open(path)) {
+      delete file;
+      error("CANNOT OPEN FILE");
+   }
+   outputs[channel] = file;
+}
+
+InputFile *FileTable::getInput(int channel) {
+   if (inputs[channel] == NULL) error("FILE NOT OPEN");
+   return inputs[channel];
+}
+
+OutputFile *FileTable::getOutput(int channel) {
+   if (outputs[channel] == NULL) error("FILE NOT OPEN");
+   return outputs[channel];
+}
+
+void FileTable::close(int channel) {
+   if (inputs[channel] != NULL) {
+      delete inputs[channel];
+      inputs[channel] = NULL;
+      return;
+   }
+   OutputFile *file = getOutput(channel);
+   outputs[channel] = NULL;
+   try {
+      file->close();
+   } catch (ErrorException &) {
+      delete file;
+      throw;
+   }
+   delete file;
+}
+
+void FileTable::closeAll() {
+   bool failed = false;
+   for (int i = 0; i <= MAX_FILES; i++) {
+      delete inputs[i];
+      inputs[i] = NULL;
+      if (outputs[i] == NULL) continue;
+      try {
+         outputs[i]->close();
+      } catch (ErrorException &) {
+         failed = true;
+      }
+      delete outputs[i];
+      outputs[i] = NULL;
+   }
+   if (failed) error("WRITE ERROR");
+}
+
+/*
+ * Implementation notes: reading and writing values
+ * ------------------------------------------------
+ * The 32- and 64-bit integers are parsed in place and written by
+ * hand, so neither goes through a string or a stream.  A negative
+ * number is accumulated downwards, so the most negative value parses
+ * too.  The other value types go through their traits.
+ */
+
+template <typename T>
+static bool parseInteger(const char *p, size_t length, T & value) {
+   const char *end = p + length;
+   bool negative = false;
+   if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+   if (p == end) return false;
+   T result = 0;
+   for (; p < end; p++) {
+      if (*p < '0' || *p > '9') return false;
+      T digit = *p - '0';
+      if (__builtin_mul_overflow(result, (T) 10, &result)) return false;
+      if (negative ? __builtin_sub_overflow(result, digit, &result)
+                   : __builtin_add_overflow(result, digit, &result)) return false;
+   }
+   value = result;
+   return true;
+}
+
+static bool parseNumber(const char *p, size_t length, int & value) {
+   return parseInteger(p, length, value);
+}
+
+static bool parseNumber(const char *p, size_t length, long long & value) {
+   return parseInteger(p, length, value);
+}
+
+template <typename Value>
+static bool parseNumber(const char *p, size_t length, Value & value) {
+   return ValueTraits<Value>::parse(string(p, length), value);
+}
+
+static void writeNumber(OutputFile *file, int value) {
+   file->writeInteger(value);
+}
+
+static void writeNumber(OutputFile *file, long long value) {
+   file->writeInteger(value);
+}
+
+template <typename Value>
+static void writeNumber(OutputFile *file, const Value & value) {
+   ostringstream oss;
+   ValueTraits<Value>::print(oss, value);
+   string text = oss.str();
+   file->write(text.data(), text.size());
+}
+
+//the channels of a state, which has none outside a program
+template <typename Value>
+static FileTable *filesOf(EvalState<Value> & state) {
+   if (state.getFiles() == NULL) error("FILE NOT OPEN");
+   return state.getFiles();
+}
+
+/* Implementation of the open statement class */
+
+template <typename Value>
+OpenStatement<Value>::OpenStatement(StringExp<Value> * init_path, bool init_output, int init_channel)
+    :path(init_path), output(init_output), channel(init_channel) {}
+
+template <typename Value>
+OpenStatement<Value>::~OpenStatement()
+{
+    delete path;
+}
+
+template <typename Value>
+void OpenStatement<Value>::execute(EvalState<Value> & state)
+{
+    StringValue name = path->eval(state);
+    string file(name.data(), name.size());
+    if (output){
+        filesOf(state)->openOutput(channel, file);
+    }else{
+        filesOf(state)->openInput(channel, file);
+    }
+}
+
+template <typename Value>
+StatementType OpenStatement<Value>::getType()
+{
+    return OPEN_STMT;
+}
+
+template <typename Value>
+string OpenStatement<Value>::toString()
+{
+    return "OPEN " + path->toString() + (output ? " FOR OUTPUT AS #" : " FOR INPUT AS #") + integerToString(channel);
+}
+
+/* Implementation of the close statement class */
+
+template <typename Value>
+CloseStatement<Value>::CloseStatement(int init_channel):channel(init_channel) {}
+
+template <typename Value>
+CloseStatement<Value>::~CloseStatement()
+{
+    /* Empty */
+}
+
+template <typename Value>
+void CloseStatement<Value>::execute(EvalState<Value> & state)
+{
+    filesOf(state)->close(channel);
+}
+
+template <typename Value>
+StatementType CloseStatement<Value>::getType()
+{
+    return CLOSE_STMT;
+}
+
+template <typename Value>
+string CloseStatement<Value>::toString()
+{
+    return "CLOSE #" + integerToString(channel);
+}
+
+/* Implementation of the file input statement class */
+
+template <typename Value>
+FileInputStatement<Value>::FileInputStatement(int init_channel, string init_name)
+    :channel(init_channel), name(init_name), stringVar(init_name[init_name.size() - 1] == '$') {}
+
+template <typename Value>
+FileInputStatement<Value>::~FileInputStatement()
+{
+    /* Empty */
+}
+
+template <typename Value>
+void FileInputStatement<Value>::execute(EvalState<Value> & state)
+{
+    InputFile * file = filesOf(state)->getInput(channel);
+    const char * start;
+    size_t length;
+    if (stringVar){
+        if (!file->readLine(start, length)) error("END OF FILE");
+        StringValue res(start, length);
+        state.getStringReference(name)->swap(res);
+        return;
+    }
+    if (!file->readToken(start, length)) error("END OF FILE");
+    Value res;
+    if (!parseNumber(start, length, res)) error("INVALID NUMBER");
+    state.setValue(name, res);
+}
+
+template <typename Value>
+StatementType FileInputStatement<Value>::getType()
+{
+    return FILE_INPUT_STMT;
+}
+
+template <typename Value>
+string FileInputStatement<Value>::toString()
+{
+    return "INPUT #" + integerToString(channel) + ", " + name;
+}
+
+template <typename Value>
+string FileInputStatement<Value>::getName()
+{
+    return name;
+}
+
+/* Implementation of the file print statement class */
+
+template <typename Value>
+FilePrintStatement<Value>::FilePrintStatement(int init_channel, Expression<Value> * init_exp, StringExp<Value> * init_text)
+    :channel(init_channel), exp(init_exp), text(init_text) {}
+
+template <typename Value>
+FilePrintStatement<Value>::~FilePrintStatement()
+{
+    delete exp;
+    delete text;
+}
+
+template <typename Value>
+void FilePrintStatement<Value>::execute(EvalState<Value> & state)
+{
+    if (exp != NULL){
+        Value res = exp->eval(state);
+        OutputFile * file = filesOf(state)->getOutput(channel);
+        writeNumber(file, res);
+        file->write("\n", 1);
+    }else{
+        StringValue res = text->eval(state);
+        OutputFile * file = filesOf(state)->getOutput(channel);
+        file->write(res.data(), res.size());
+        file->write("\n", 1);
+    }
+}
+
+template <typename Value>
+StatementType FilePrintStatement<Value>::getType()
+{
+    return FILE_PRINT_STMT;
+}
+
+template <typename Value>
+string FilePrintStatement<Value>::toString()
+{
+    return "PRINT #" + integerToString(channel) + ", " + (exp != NULL ? exp->toString() : text->toString());
+}
+
+template <typename Value>
+Expression<Value> * FilePrintStatement<Value>::getExp()
+{
+    return exp;
+}
+
+#define INSTANTIATE_FILEIO(Value) \
+    template class OpenStatement<Value>; \
+    template class CloseStatement<Value>; \
+    template class FileInputStatement<Value>; \
+    template class FilePrintStatement<Value>;
+FOR_EACH_VALUE_TYPE(INSTANTIATE_FILEIO)
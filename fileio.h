@@ -0,0 +1,417 @@
+/*
+ * File: fileio.h
+ * --------------
+ * This interface exports the files a program reads and writes through
+ * numbered channels: the InputFile and OutputFile classes, the
+ * FileTable of the channels, and the OPEN, CLOSE, INPUT # and PRINT #
+ * statements.
+ */
+
+#ifndef _fileio_h
+#define _fileio_h
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "evalstate.h"
+#include "exp.h"
+#include "statement.h"
+#include "strexp.h"
+
+/*
+ * Constants: MAX_FILES, WRITE_BUFFER_SIZE
+ * ---------------------------------------
+ * The channels are numbered 1 to MAX_FILES.  An output file collects
+ * up to WRITE_BUFFER_SIZE bytes before it writes them.
+ */
+
+const int MAX_FILES = 16;
+const size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+/*
+ * Class: InputFile
+ * ----------------
+ * A file open for reading.  A regular file is mapped into memory, so
+ * reading it copies nothing: the tokens are parsed where they lie in
+ * the mapping.  Any other file, such as a pipe, is read into a buffer
+ * when it is opened.
+ */
+
+class InputFile {
+
+public:
+
+   InputFile();
+   ~InputFile();
+
+/*
+ * Method: open
+ * Usage: if (file.open(path)) . . .
+ * ---------------------------------
+ * Opens the file, returning false if it cannot be read.
+ */
+
+   bool open(const std::string & path);
+
+/*
+ * Method: readToken
+ * Usage: if (file.readToken(start, length)) . . .
+ * -----------------------------------------------
+ * Skips whitespace and commas and sets start and length to the token
+ * up to the next whitespace or comma, which stays in the file.
+ * Returns false at the end of the file.
+ */
+
+   bool readToken(const char * & start, size_t & length);
+
+/*
+ * Method: readLine
+ * Usage: if (file.readLine(start, length)) . . .
+ * ----------------------------------------------
+ * Sets start and length to the rest of the current line, without its
+ * end, and moves to the next line.  Returns false at the end of the
+ * file.
+ */
+
+   bool readLine(const char * & start, size_t & length);
+
+private:
+
+   const char *begin;          //the contents of the file
+   const char *end;
+   const char *pos;            //where reading continues
+   void *mapping;              //the mapping, or NULL
+   size_t mappedSize;
+   std::vector<char> buffer;   //the contents when not mapped
+
+   //not copyable: the mapping is owned
+   InputFile(const InputFile &);
+   InputFile & operator=(const InputFile &);
+
+};
+
+/*
+ * Class: OutputFile
+ * -----------------
+ * A file open for writing.  What is written collects in a buffer of
+ * WRITE_BUFFER_SIZE bytes, which is written to the file in one system
+ * call when it is full and when the file is closed.
+ */
+
+class OutputFile {
+
+public:
+
+   OutputFile();
+   ~OutputFile();
+
+/*
+ * Method: open
+ * Usage: if (file.open(path)) . . .
+ * ---------------------------------
+ * Creates or truncates the file, returning false if it cannot be
+ * written.
+ */
+
+   bool open(const std::string & path);
+
+/*
+ * Methods: write, writeInteger
+ * Usage: file.write(chars, length);
+ *        file.writeInteger(n);
+ * --------------------------------
+ * Append characters, or an integer in decimal, to the file.  Raises
+ * "WRITE ERROR" if the buffer cannot be written.
+ */
+
+   void write(const char *chars, size_t length);
+   void writeInteger(long long value);
+
+/*
+ * Method: close
+ * Usage: file.close();
+ * --------------------
+ * Writes what is left in the buffer and closes the file.  Raises
+ * "WRITE ERROR" if either fails; the file is closed anyway.
+ */
+
+   void close();
+
+private:
+
+   void flush();
+
+   int fd;                     //-1 when closed
+   std::vector<char> buffer;
+   size_t used;
+
+   //not copyable: the descriptor is owned
+   OutputFile(const OutputFile &);
+   OutputFile & operator=(const OutputFile &);
+
+};
+
+/*
+ * Class: FileTable
+ * ----------------
+ * The open files of a program, by channel.  A channel holds at most
+ * one file, open either for reading or for writing.
+ */
+
+class FileTable {
+
+public:
+
+   FileTable();
+   ~FileTable();
+
+/*
+ * Methods: openInput, openOutput
+ * Usage: files.openInput(channel, path);
+ * --------------------------------------
+ * Open a file on a free channel.  Raise "FILE ALREADY OPEN" if the
+ * channel is in use, and "CANNOT OPEN FILE" if the file cannot be
+ * opened.
+ */
+
+   void openInput(int channel, const std::string & path);
+   void openOutput(int channel, const std::string & path);
+
+/*
+ * Methods: getInput, getOutput
+ * Usage: InputFile *file = files.getInput(channel);
+ * -------------------------------------------------
+ * Return the file on a channel.  Raise "FILE NOT OPEN" if the channel
+ * has no file open the right way.
+ */
+
+   InputFile *getInput(int channel);
+   OutputFile *getOutput(int channel);
+
+/*
+ * Methods: close, closeAll
+ * Usage: files.closeAll();
+ * ------------------------
+ * Close the file on a channel, which raises "FILE NOT OPEN" if there
+ * is none, or all the files, as a program does when it stops.
+ */
+
+   void close(int channel);
+   void closeAll();
+
+private:
+
+   InputFile *inputs[MAX_FILES + 1];     //indexed by channel
+   OutputFile *outputs[MAX_FILES + 1];
+
+   //not copyable: the files are owned
+   FileTable(const FileTable &);
+   FileTable & operator=(const FileTable &);
+
+};
+
+/*
+ * Class: OpenStatement
+ * --------------------
+ * This subclass of Statement represents
+ *
+ *    OPEN path FOR INPUT AS #n
+ *    OPEN path FOR OUTPUT AS #n
+ *
+ * where path is a string expression.
+ */
+
+template <typename Value>
+class OpenStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: OpenStatement
+ * ----------------------
+ * The constructor initializes an open statement from the path, the
+ * direction and the channel.
+ */
+
+   OpenStatement(StringExp<Value> * init_path, bool init_output, int init_channel);
+
+/*
+ * Destructor: ~OpenStatement
+ * Usage: delete open_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ */
+
+   virtual ~OpenStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  execute an open statement will open the file on the channel
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+    private:
+        StringExp<Value> * path;
+        bool output;
+        int channel;
+};
+
+/*
+ * Class: CloseStatement
+ * ---------------------
+ * This subclass of Statement represents CLOSE #n.
+ */
+
+template <typename Value>
+class CloseStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: CloseStatement
+ * ----------------------
+ * The constructor initializes a close statement from the channel.
+ */
+
+   CloseStatement(int init_channel);
+
+/*
+ * Destructor: ~CloseStatement
+ * Usage: delete close_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ */
+
+   virtual ~CloseStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  execute a close statement will close the file on the channel
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+    private:
+        int channel;
+};
+
+/*
+ * Class: FileInputStatement
+ * -------------------------
+ * This subclass of Statement represents INPUT #n, var.  A numeric
+ * variable reads the next number, and a string variable the rest of
+ * the current line.  Reading past the end of the file raises "END OF
+ * FILE", and a token that is not a number "INVALID NUMBER".
+ */
+
+template <typename Value>
+class FileInputStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: FileInputStatement
+ * ----------------------
+ * The constructor initializes an input statement from the channel and
+ * the name of the variable.
+ */
+
+   FileInputStatement(int init_channel, std::string init_name);
+
+/*
+ * Destructor: ~FileInputStatement
+ * Usage: delete input_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ */
+
+   virtual ~FileInputStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  execute a file input statement will read the variable from the file
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Method: getName
+ * Usage: string name = ((FileInputStatement<Value> *) stmt)->getName();
+ * ---------------------------------------------------------------------
+ * Returns the name of the variable.
+ */
+
+   std::string getName();
+
+    private:
+        int channel;
+        std::string name;
+        bool stringVar;   //true for a string variable
+};
+
+/*
+ * Class: FilePrintStatement
+ * -------------------------
+ * This subclass of Statement represents PRINT #n, exp, which writes
+ * the value of a numeric or string expression and a newline.
+ */
+
+template <typename Value>
+class FilePrintStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: FilePrintStatement
+ * ----------------------
+ * The constructor initializes a print statement from the channel and
+ * either a numeric or a string expression; the other one is NULL.
+ */
+
+   FilePrintStatement(int init_channel, Expression<Value> * init_exp, StringExp<Value> * init_text);
+
+/*
+ * Destructor: ~FilePrintStatement
+ * Usage: delete print_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ */
+
+   virtual ~FilePrintStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  execute a file print statement will write the value to the file
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Method: getExp
+ * Usage: Expression<Value> * exp = ((FilePrintStatement<Value> *) stmt)->getExp();
+ * --------------------------------------------------------------------------------
+ * Returns the numeric expression, or NULL for a string.
+ */
+
+   Expression<Value> * getExp();
+
+    private:
+        int channel;
+        Expression<Value> * exp;
+        StringExp<Value> * text;
+};
+
+#endif
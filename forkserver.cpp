@@ -0,0 +1,219 @@
+/*
+ * File: forkserver.cpp
+ * --------------------
+ * This file implements the fork server and its client.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../StanfordCPPLib/error.h"
+#include "evalstate.h"
+#include "forkserver.h"
+#include "program.h"
+
+using namespace std;
+
+/*
+ * Implementation notes: the requests
+ * ----------------------------------
+ * A request is one message: a byte with the length of the name, the
+ * name, and the two descriptors as SCM_RIGHTS.  The child keeps the
+ * connection open while it runs, so the client waits for the status
+ * byte, and sees the connection close without one if the child dies.
+ */
+
+//how long a child waits for the request on its connection
+static const int REQUEST_SECONDS = 10;
+
+//fill the address of the socket at path, returning false if too long
+static bool socketAddress(const string & path, sockaddr_un & address) {
+   memset(&address, 0, sizeof address);
+   address.sun_family = AF_UNIX;
+   if (path.size() >= sizeof address.sun_path) return false;
+   strcpy(address.sun_path, path.c_str());
+   return true;
+}
+
+//send a request, returning false on an error
+static bool sendRequest(int socket, const string & name, int in, int out) {
+   char message[256];
+   message[0] = (char) name.size();
+   memcpy(message + 1, name.data(), name.size());
+   iovec data = { message, name.size() + 1 };
+   char control[CMSG_SPACE(2 * sizeof(int))];
+   memset(control, 0, sizeof control);
+   msghdr header;
+   memset(&header, 0, sizeof header);
+   header.msg_iov = &data;
+   header.msg_iovlen = 1;
+   header.msg_control = control;
+   header.msg_controllen = sizeof control;
+   cmsghdr *rights = CMSG_FIRSTHDR(&header);
+   rights->cmsg_level = SOL_SOCKET;
+   rights->cmsg_type = SCM_RIGHTS;
+   rights->cmsg_len = CMSG_LEN(2 * sizeof(int));
+   int fds[2] = { in, out };
+   memcpy(CMSG_DATA(rights), fds, sizeof fds);
+   return sendmsg(socket, &header, MSG_NOSIGNAL) == (ssize_t) (name.size() + 1);
+}
+
+//receive a request, returning false if it is not whole; the descriptors
+//it carries are closed then
+static bool receiveRequest(int socket, string & name, int & in, int & out) {
+   char message[256];
+   iovec data = { message, sizeof message };
+   char control[CMSG_SPACE(2 * sizeof(int))];
+   msghdr header;
+   memset(&header, 0, sizeof header);
+   header.msg_iov = &data;
+   header.msg_iovlen = 1;
+   header.msg_control = control;
+   header.msg_controllen = sizeof control;
+   ssize_t count;
+   do {
+      count = recvmsg(socket, &header, MSG_CMSG_CLOEXEC);
+   } while (count < 0 && errno == EINTR);
+   in = out = -1;
+   cmsghdr *rights = CMSG_FIRSTHDR(&header);
+   if (count > 0 && rights != NULL && rights->cmsg_level == SOL_SOCKET && rights->cmsg_type == SCM_RIGHTS) {
+      int fds[2] = { -1, -1 };
+      memcpy(fds, CMSG_DATA(rights), min(sizeof fds, (size_t) (rights->cmsg_len - CMSG_LEN(0))));
+      in = fds[0];
+      out = fds[1];
+   }
+   if (count < 1 || count != (unsigned char) message[0] + 1 || in < 0 || out < 0) {
+      if (in >= 0) close(in);
+      if (out >= 0) close(out);
+      return false;
+   }
+   name.assign(message + 1, count - 1);
+   return true;
+}
+
+//send the status of a request
+static void sendStatus(int socket, int status) {
+   char byte = (char) status;
+   send(socket, &byte, 1, MSG_NOSIGNAL);
+}
+
+//run a program in a child, on the descriptors of its request
+template <typename Value>
+static int runChild(Program<Value> & program, int gosubDepth, int in, int out) {
+   if (dup2(in, 0) < 0 || dup2(out, 1) < 0) return RUN_FAILED;
+   close(in);
+   close(out);
+   cin.clear();
+   EvalState<Value> state;
+   if (gosubDepth >= 0) state.setReturnLimit(gosubDepth);
+   int status = RUN_OK;
+   try {
+      program.run(state);
+   } catch (ErrorException & ex) {
+      cout << ex.getMessage() << endl;
+      status = RUN_ERROR;
+   }
+   cout.flush();
+   return status;
+}
+
+//read the request on a connection and run it, returning its status
+template <typename Value>
+static int runRequest(int connection, const vector<string> & names,
+                      const vector<Program<Value> *> & programs, int gosubDepth) {
+   timeval timeout = { REQUEST_SECONDS, 0 };
+   setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+   string name;
+   int in, out;
+   if (!receiveRequest(connection, name, in, out)) return RUN_FAILED;
+   int k = name.empty() ? 0 : -1;
+   for (size_t i = 0; k < 0 && i < names.size(); i++) {
+      if (names[i] == name) k = i;
+   }
+   int status = RUN_NO_PROGRAM;
+   if (k < 0) {
+      close(in);
+      close(out);
+   } else {
+      status = runChild(*programs[k], gosubDepth, in, out);
+   }
+   sendStatus(connection, status);
+   return status;
+}
+
+/*
+ * Implementation notes: serve
+ * ---------------------------
+ * The server forks as soon as it accepts a connection and the child
+ * reads the request, so a client that connects and sends nothing holds
+ * up only its own child, which gives up after REQUEST_SECONDS.  The
+ * children are reaped by the kernel, since SIGCHLD is ignored; they set
+ * it back, so that a program that starts processes of its own could
+ * wait for them.  Output is flushed before each fork, so that nothing
+ * buffered in the server is written again by a child.
+ */
+
+template <typename Value>
+int serve(const string & path, const vector<string> & names,
+          const vector<Program<Value> *> & programs, int gosubDepth) {
+   sockaddr_un address;
+   if (!socketAddress(path, address)) {
+      cerr << path << ": socket path too long" << endl;
+      return 1;
+   }
+   int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+   unlink(path.c_str());
+   if (listener < 0 || bind(listener, (sockaddr *) &address, sizeof address) != 0 || listen(listener, 128) != 0) {
+      cerr << path << ": " << strerror(errno) << endl;
+      return 1;
+   }
+   signal(SIGCHLD, SIG_IGN);
+   while (true) {
+      int connection = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+      if (connection < 0) {
+         if (errno == EINTR || errno == ECONNABORTED) continue;
+         cerr << path << ": " << strerror(errno) << endl;
+         return 1;
+      }
+      cout.flush();
+      pid_t child = fork();
+      if (child == 0) {
+         close(listener);
+         signal(SIGCHLD, SIG_DFL);
+         _exit(runRequest(connection, names, programs, gosubDepth));
+      }
+      if (child < 0) sendStatus(connection, RUN_FAILED);
+      close(connection);
+   }
+}
+
+int request(const string & path, const string & name) {
+   sockaddr_un address;
+   if (name.size() > 255 || !socketAddress(path, address)) return RUN_FAILED;
+   int server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+   if (server < 0 || connect(server, (sockaddr *) &address, sizeof address) != 0
+       || !sendRequest(server, name, 0, 1)) {
+      cerr << path << ": " << strerror(errno) << endl;
+      return RUN_FAILED;
+   }
+   char status;
+   ssize_t count;
+   do {
+      count = read(server, &status, 1);
+   } while (count < 0 && errno == EINTR);
+   close(server);
+   return (count == 1) ? status : RUN_FAILED;
+}
+
+#define INSTANTIATE_FORKSERVER(Value) \
+   template int serve<Value>(const string & path, const vector<string> & names, \
+                             const vector<Program<Value> *> & programs, int gosubDepth);
+FOR_EACH_VALUE_TYPE(INSTANTIATE_FORKSERVER)
@@ -0,0 +1,60 @@
+/*
+ * File: forkserver.h
+ * ------------------
+ * This interface exports the fork server, which loads and links
+ * programs once and runs each request in a child forked from it, and
+ * the client that sends it a request.
+ */
+
+#ifndef _forkserver_h
+#define _forkserver_h
+
+#include <string>
+#include <vector>
+#include "program.h"
+
+/*
+ * Constants: the request statuses
+ * -------------------------------
+ * The byte a server sends back when a request is over: the program
+ * ran to its end, stopped with an error, was not one the server has,
+ * or could not be started.
+ */
+
+const int RUN_OK = 0;
+const int RUN_ERROR = 1;
+const int RUN_NO_PROGRAM = 2;
+const int RUN_FAILED = 3;
+
+/*
+ * Function: serve
+ * Usage: return serve(path, names, programs, gosubDepth);
+ * -------------------------------------------------------
+ * Listens on the Unix socket at path and serves requests until it is
+ * killed, returning only if the socket cannot be set up.  A request
+ * names one of the programs, or is empty for the first, and passes
+ * the descriptors to use as standard input and output; the server
+ * forks a child that runs the program on them with a fresh state, and
+ * the child sends the status when the program stops.  The programs
+ * should be linked beforehand: each child then shares the parsed and
+ * linked program with the server, copying a page only when the run
+ * writes to it.  gosubDepth is the limit of the return stack, or -1
+ * for the default.
+ */
+
+template <typename Value>
+int serve(const std::string & path, const std::vector<std::string> & names,
+          const std::vector<Program<Value> *> & programs, int gosubDepth);
+
+/*
+ * Function: request
+ * Usage: return request(path, name);
+ * ----------------------------------
+ * Asks the server listening at path to run the program with the name
+ * on the standard input and output of this process, and returns the
+ * status of the request when it is over.
+ */
+
+int request(const std::string & path, const std::string & name);
+
+#endif
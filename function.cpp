@@ -0,0 +1,433 @@
+/*
+ * File: function.cpp
+ * ------------------
+ * This file implements the user functions defined by DEF FN.
+ */
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "../StanfordCPPLib/error.h"
+#include "../StanfordCPPLib/strlib.h"
+#include "evalstate.h"
+#include "exp.h"
+#include "function.h"
+#include "native.h"
+#include "strexp.h"
+
+using namespace std;
+
+/*
+ * Implementation notes: the ParameterExp subclass
+ * -----------------------------------------------
+ * The arguments of the call being evaluated are the top frame of the
+ * argument stack in the state, so a parameter is read by its index.
+ */
+
+template <typename Value>
+ParameterExp<Value>::ParameterExp(string name, int index) :name(name), index(index) {}
+
+template <typename Value>
+ParameterExp<Value>::~ParameterExp() {
+   /* Empty */
+}
+
+template <typename Value>
+Value ParameterExp<Value>::eval(EvalState<Value> & state) {
+   return state.getArgument(index);
+}
+
+template <typename Value>
+string ParameterExp<Value>::toString() {
+   return name;
+}
+
+template <typename Value>
+ExpressionType ParameterExp<Value>::getType() {
+   return PARAMETER;
+}
+
+template <typename Value>
+int ParameterExp<Value>::getIndex() {
+   return index;
+}
+
+/*
+ * Implementation notes: the DefStatement subclass
+ * -----------------------------------------------
+ * The definition owns the body of the function; the calls only point
+ * to it, or to copies of their own.
+ */
+
+template <typename Value>
+DefStatement<Value>::DefStatement(string init_name, vector<string> init_params, Expression<Value> * init_body)
+    :name(init_name), params(init_params), body(init_body) {}
+
+template <typename Value>
+DefStatement<Value>::~DefStatement()
+{
+    delete body;
+}
+
+template <typename Value>
+void DefStatement<Value>::execute(EvalState<Value> & state)
+{
+    /* Empty */
+}
+
+template <typename Value>
+StatementType DefStatement<Value>::getType()
+{
+    return DEF_STMT;
+}
+
+template <typename Value>
+string DefStatement<Value>::toString()
+{
+    string str = "DEF " + name + "(";
+    for (size_t i = 0; i < params.size(); i++){
+        if (i > 0) str += ", ";
+        str += params[i];
+    }
+    return str + ") = " + body->toString();
+}
+
+template <typename Value>
+string DefStatement<Value>::getName()
+{
+    return name;
+}
+
+template <typename Value>
+int DefStatement<Value>::getArity()
+{
+    return params.size();
+}
+
+template <typename Value>
+Expression<Value> * DefStatement<Value>::getBody()
+{
+    return body;
+}
+
+/*
+ * Implementation notes: walking a body
+ * ------------------------------------
+ * scanBody counts the nodes of a body and the reads of each parameter,
+ * notes whether it measures a string, and collects the functions it
+ * calls.  The calls may hide in the positions of a string function
+ * inside LEN, so the string expressions are walked too.
+ */
+
+namespace {
+
+struct BodyScan {
+   int nodes;
+   bool strings;
+   vector<int> uses;
+   vector<string> calls;
+};
+
+}
+
+template <typename Value>
+static void scanBody(Expression<Value> *exp, BodyScan & scan);
+
+template <typename Value>
+static void scanString(StringExp<Value> *exp, BodyScan & scan) {
+   if (exp->getType() == CONCAT) {
+      scanString(((ConcatExp<Value> *) exp)->getLHS(), scan);
+      scanString(((ConcatExp<Value> *) exp)->getRHS(), scan);
+   } else if (exp->getType() == SUBSTRING) {
+      SubstringExp<Value> *sub = (SubstringExp<Value> *) exp;
+      scanString(sub->getSource(), scan);
+      if (sub->getFirst() != NULL) scanBody(sub->getFirst(), scan);
+      if (sub->getSecond() != NULL) scanBody(sub->getSecond(), scan);
+   }
+}
+
+template <typename Value>
+static void scanBody(Expression<Value> *exp, BodyScan & scan) {
+   scan.nodes++;
+   switch (exp->getType()) {
+    case COMPOUND:
+      scanBody(((CompoundExp<Value> *) exp)->getLHS(), scan);
+      scanBody(((CompoundExp<Value> *) exp)->getRHS(), scan);
+      break;
+    case ARRAY:
+      scanBody(((ArrayExp<Value> *) exp)->getRow(), scan);
+      if (((ArrayExp<Value> *) exp)->getCol() != NULL) scanBody(((ArrayExp<Value> *) exp)->getCol(), scan);
+      break;
+    case LENGTH:
+      scan.strings = true;
+      scanString(((LengthExp<Value> *) exp)->getSource(), scan);
+      break;
+    case PARAMETER:
+      scan.uses[((ParameterExp<Value> *) exp)->getIndex()]++;
+      break;
+    case CALL: {
+      CallExp<Value> *call = (CallExp<Value> *) exp;
+      scan.calls.push_back(call->getName());
+      for (int i = 0; i < call->getArgumentCount(); i++) {
+         scanBody(call->getArgument(i), scan);
+      }
+      break;
+    }
+    case NATIVE: {
+      NativeCallExp<Value> *call = (NativeCallExp<Value> *) exp;
+      for (int i = 0; i < call->getArgumentCount(); i++) {
+         scanBody(call->getArgument(i), scan);
+      }
+      break;
+    }
+    default:
+      break;
+   }
+}
+
+/*
+ * Implementation notes: the FunctionTable class
+ * ---------------------------------------------
+ * The generation is counted across all tables, so a call that was
+ * resolved against a table that has since been destroyed and another
+ * one built at the same address still notices the change.
+ */
+
+static int nextGeneration = 0;
+
+template <typename Value>
+FunctionTable<Value>::FunctionTable() :generation(nextGeneration++) {}
+
+template <typename Value>
+void FunctionTable<Value>::build(const vector<int> & numbers, const vector<Statement<Value> *> & stmts) {
+   clear();
+   for (size_t i = 0; i < stmts.size(); i++) {
+      if (stmts[i] == NULL || stmts[i]->getType() != DEF_STMT) continue;
+      DefStatement<Value> *def = (DefStatement<Value> *) stmts[i];
+      if (entries.find(def->getName()) != entries.end()) {
+         entries.clear();
+         error("FUNCTION " + def->getName() + " DEFINED TWICE IN LINE " + integerToString(numbers[i]));
+      }
+      BodyScan scan;
+      scan.nodes = 0;
+      scan.strings = false;
+      scan.uses.assign(def->getArity(), 0);
+      scanBody(def->getBody(), scan);
+      Entry & entry = entries[def->getName()];
+      entry.def = def;
+      entry.line = numbers[i];
+      entry.inlinable = !scan.strings && scan.nodes <= MAX_INLINED_NODES;
+      entry.uses = scan.uses;
+      entry.calls = scan.calls;
+      if (scan.nodes > MAX_INLINED_NODES) {
+         cerr << "FUNCTION " << def->getName() << " IN LINE " << numbers[i] << " IS NOT INLINED: TOO LARGE" << endl;
+      }
+   }
+
+   //a depth-first search over the calls; a function met again while it
+   //is still on the path calls itself
+   map<string, int> color;   //1 on the path, 2 done
+   typename map<string, Entry>::iterator it;
+   for (it = entries.begin(); it != entries.end(); it++) {
+      if (color[it->first] != 0) continue;
+      vector<pair<string, size_t> > path;
+      path.push_back(make_pair(it->first, (size_t) 0));
+      color[it->first] = 1;
+      while (!path.empty()) {
+         const Entry & entry = entries[path.back().first];
+         if (path.back().second == entry.calls.size()) {
+            color[path.back().first] = 2;
+            path.pop_back();
+            continue;
+         }
+         string callee = entry.calls[path.back().second++];
+         if (entries.find(callee) == entries.end()) continue;
+         if (color[callee] == 1) {
+            int line = entries[callee].line;
+            entries.clear();
+            error("RECURSIVE FUNCTION " + callee + " IN LINE " + integerToString(line));
+         }
+         if (color[callee] == 0) {
+            color[callee] = 1;
+            path.push_back(make_pair(callee, (size_t) 0));
+         }
+      }
+   }
+}
+
+template <typename Value>
+void FunctionTable<Value>::clear() {
+   entries.clear();
+   generation = nextGeneration++;
+}
+
+template <typename Value>
+DefStatement<Value> *FunctionTable<Value>::find(const string & name) const {
+   typename map<string, Entry>::const_iterator it = entries.find(name);
+   if (it == entries.end()) return NULL;
+   return it->second.def;
+}
+
+template <typename Value>
+const vector<int> *FunctionTable<Value>::getUses(const string & name) const {
+   typename map<string, Entry>::const_iterator it = entries.find(name);
+   if (it == entries.end() || !it->second.inlinable) return NULL;
+   return &it->second.uses;
+}
+
+template <typename Value>
+int FunctionTable<Value>::getGeneration() const {
+   return generation;
+}
+
+/*
+ * Implementation notes: inlining
+ * ------------------------------
+ * copyInlined copies a body, putting a copy of the argument in place
+ * of each parameter.  A body that is inlined has no LEN, so it is made
+ * of numbers, variables, operators, elements of arrays and calls of
+ * functions and native functions.  The
+ * variables of the copy keep the checks of the originals: a variable
+ * of the body is checked, and an argument is never checked, since only
+ * a variable the definite-assignment analysis proved assigned at the
+ * call is inlined.
+ */
+
+template <typename Value>
+static Expression<Value> *copyInlined(Expression<Value> *exp, const vector<Expression<Value> *> & args) {
+   switch (exp->getType()) {
+    case CONSTANT:
+      return new ConstantExp<Value>(((ConstantExp<Value> *) exp)->getValue());
+    case IDENTIFIER: {
+      IdentifierExp<Value> *copy = new IdentifierExp<Value>(((IdentifierExp<Value> *) exp)->getName());
+      copy->setChecked(((IdentifierExp<Value> *) exp)->isChecked());
+      return copy;
+    }
+    case COMPOUND: {
+      CompoundExp<Value> *compound = (CompoundExp<Value> *) exp;
+      return new CompoundExp<Value>(compound->getOp(), copyInlined(compound->getLHS(), args),
+                                    copyInlined(compound->getRHS(), args));
+    }
+    case ARRAY: {
+      ArrayExp<Value> *array = (ArrayExp<Value> *) exp;
+      Expression<Value> *col = (array->getCol() == NULL) ? NULL : copyInlined(array->getCol(), args);
+      return new ArrayExp<Value>(array->getName(), copyInlined(array->getRow(), args), col);
+    }
+    case PARAMETER:
+      return copyInlined(args[((ParameterExp<Value> *) exp)->getIndex()], vector<Expression<Value> *>());
+    case CALL: {
+      CallExp<Value> *call = (CallExp<Value> *) exp;
+      vector<Expression<Value> *> callArgs;
+      for (int i = 0; i < call->getArgumentCount(); i++) {
+         callArgs.push_back(copyInlined(call->getArgument(i), args));
+      }
+      return new CallExp<Value>(call->getName(), callArgs);
+    }
+    case NATIVE: {
+      NativeCallExp<Value> *call = (NativeCallExp<Value> *) exp;
+      vector<Expression<Value> *> callArgs;
+      for (int i = 0; i < call->getArgumentCount(); i++) {
+         callArgs.push_back(copyInlined(call->getArgument(i), args));
+      }
+      return new NativeCallExp<Value>(call->getName(), call->getFunction(), callArgs);
+    }
+    default:
+      error("CANNOT INLINE " + exp->toString());
+      return NULL;
+   }
+}
+
+/*
+ * Implementation notes: the CallExp subclass
+ * ------------------------------------------
+ * A call remembers the table and generation it was resolved against
+ * and resolves again when either differs, which happens once per run
+ * of a program whose lines have not changed.  A frame call pushes its
+ * arguments above the frame of the call it is nested in, so calls
+ * made while evaluating them see the right parameters, and makes them
+ * the current frame only for the body.  An error leaves the stack as
+ * it is; it stops the program, and the next run clears it.
+ */
+
+template <typename Value>
+CallExp<Value>::CallExp(string name, vector<Expression<Value> *> args)
+   :name(name), args(args), table(NULL), generation(-1), function(NULL), inlined(NULL) {}
+
+template <typename Value>
+CallExp<Value>::~CallExp() {
+   for (size_t i = 0; i < args.size(); i++) delete args[i];
+   delete inlined;
+}
+
+template <typename Value>
+Value CallExp<Value>::eval(EvalState<Value> & state) {
+   if (table != state.getFunctions() || table == NULL || generation != table->getGeneration()) resolve(state);
+   if (inlined != NULL) return inlined->eval(state);
+   int base = state.getArgumentCount();
+   for (size_t i = 0; i < args.size(); i++) {
+      state.pushArgument(args[i]->eval(state));
+   }
+   int saved = state.enterFrame(base);
+   Value result = function->getBody()->eval(state);
+   state.leaveFrame(base, saved);
+   return result;
+}
+
+template <typename Value>
+void CallExp<Value>::resolve(EvalState<Value> & state) {
+   delete inlined;
+   inlined = NULL;
+   table = NULL;
+   const FunctionTable<Value> *functions = state.getFunctions();
+   function = (functions == NULL) ? NULL : functions->find(name);
+   if (function == NULL) error("UNDEFINED FUNCTION");
+   if (function->getArity() != (int) args.size()) error("WRONG NUMBER OF ARGUMENTS");
+   const vector<int> *uses = functions->getUses(name);
+   bool inlinable = (uses != NULL);
+   for (size_t i = 0; inlinable && i < args.size(); i++) {
+      ExpressionType type = args[i]->getType();
+      inlinable = type == CONSTANT || (type == IDENTIFIER && (*uses)[i] > 0
+                                       && !((IdentifierExp<Value> *) args[i])->isChecked());
+   }
+   if (inlinable) inlined = copyInlined(function->getBody(), args);
+   table = functions;
+   generation = functions->getGeneration();
+}
+
+template <typename Value>
+string CallExp<Value>::toString() {
+   string str = name + "(";
+   for (size_t i = 0; i < args.size(); i++) {
+      if (i > 0) str += ", ";
+      str += args[i]->toString();
+   }
+   return str + ")";
+}
+
+template <typename Value>
+ExpressionType CallExp<Value>::getType() {
+   return CALL;
+}
+
+template <typename Value>
+string CallExp<Value>::getName() {
+   return name;
+}
+
+template <typename Value>
+int CallExp<Value>::getArgumentCount() {
+   return args.size();
+}
+
+template <typename Value>
+Expression<Value> *CallExp<Value>::getArgument(int index) {
+   return args[index];
+}
+
+#define INSTANTIATE_FUNCTION(Value) \
+   template class ParameterExp<Value>; \
+   template class DefStatement<Value>; \
+   template class FunctionTable<Value>; \
+   template class CallExp<Value>;
+FOR_EACH_VALUE_TYPE(INSTANTIATE_FUNCTION)
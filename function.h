@@ -0,0 +1,237 @@
+/*
+ * File: function.h
+ * ----------------
+ * This interface exports the user functions defined by DEF FN: the
+ * DefStatement that defines one, the CallExp and ParameterExp nodes
+ * of the expressions that use one, and the FunctionTable a program
+ * resolves calls against.
+ */
+
+#ifndef _function_h
+#define _function_h
+
+#include <map>
+#include <string>
+#include <vector>
+#include "evalstate.h"
+#include "exp.h"
+#include "statement.h"
+
+/*
+ * Constant: MAX_INLINED_NODES
+ * ---------------------------
+ * The largest function body, counted in expression nodes, that is
+ * inlined into its calls.
+ */
+
+const int MAX_INLINED_NODES = 16;
+
+/*
+ * Class: ParameterExp
+ * -------------------
+ * This subclass of Expression represents a parameter inside the body
+ * of a function.  Its value is the argument of the call being
+ * evaluated.
+ */
+
+template <typename Value>
+class ParameterExp : public Expression<Value> {
+
+public:
+
+   ParameterExp(std::string name, int index);
+   virtual ~ParameterExp();
+
+   virtual Value eval(EvalState<Value> & state);
+   virtual std::string toString();
+   virtual ExpressionType getType();
+
+/*
+ * Method: getIndex
+ * Usage: int index = ((ParameterExp<Value> *) exp)->getIndex();
+ * -------------------------------------------------------------
+ * Returns the position of the parameter in the parameter list.
+ */
+
+   int getIndex();
+
+private:
+
+   std::string name;
+   int index;
+
+};
+
+/*
+ * Class: DefStatement
+ * -------------------
+ * This subclass of Statement represents a function definition
+ *
+ *    DEF FNA(X, Y) = expression
+ *
+ * The name of a function starts with FN.  In the body, the parameters
+ * are ParameterExp nodes; every other name is a variable, read when
+ * the function is called.  A definition does nothing when it runs:
+ * the functions of a program are known before it starts, wherever
+ * their lines are.
+ */
+
+template <typename Value>
+class DefStatement : public Statement<Value>
+{
+    public:
+        DefStatement(std::string init_name, std::vector<std::string> init_params, Expression<Value> * init_body);
+        virtual ~DefStatement();
+        virtual void execute(EvalState<Value> & state);
+        virtual StatementType getType();
+        virtual std::string toString();
+        std::string getName();
+        int getArity();
+        Expression<Value> * getBody();
+    private:
+        std::string name;
+        std::vector<std::string> params;
+        Expression<Value> * body;
+};
+
+/*
+ * Class: FunctionTable
+ * --------------------
+ * The functions of a program, by name.  build collects them from the
+ * lines of the program, which must not change until the table is
+ * built again or cleared.
+ */
+
+template <typename Value>
+class FunctionTable {
+
+public:
+
+   FunctionTable();
+
+/*
+ * Method: build
+ * Usage: functions.build(numbers, stmts);
+ * ---------------------------------------
+ * Collects the DEF lines among the lines given by their numbers and
+ * statements, which may be NULL for lines not parsed yet.  Raises
+ * "FUNCTION FNA DEFINED TWICE IN LINE n" and
+ * "RECURSIVE FUNCTION FNA IN LINE n", the latter for a function that
+ * calls itself, directly or through other functions.  A function too
+ * large to inline is reported on cerr; its calls use a frame.
+ */
+
+   void build(const std::vector<int> & numbers, const std::vector<Statement<Value> *> & stmts);
+
+/*
+ * Method: clear
+ * Usage: functions.clear();
+ * -------------------------
+ * Removes all the functions, before the lines they are defined on
+ * change.
+ */
+
+   void clear();
+
+/*
+ * Method: find
+ * Usage: DefStatement<Value> *def = functions->find(name);
+ * --------------------------------------------------------
+ * Returns the definition of a function, or NULL if there is none.
+ */
+
+   DefStatement<Value> *find(const std::string & name) const;
+
+/*
+ * Method: getUses
+ * Usage: const std::vector<int> *uses = functions->getUses(name);
+ * ---------------------------------------------------------------
+ * Returns how many times the body of a function that can be inlined
+ * reads each parameter, or NULL if the function cannot be inlined.
+ */
+
+   const std::vector<int> *getUses(const std::string & name) const;
+
+/*
+ * Method: getGeneration
+ * Usage: if (generation != functions->getGeneration()) . . .
+ * ----------------------------------------------------------
+ * Returns a number that changes whenever the functions do, so a call
+ * knows when to resolve its function again.
+ */
+
+   int getGeneration() const;
+
+private:
+
+   struct Entry {
+      DefStatement<Value> *def;
+      int line;
+      bool inlinable;
+      std::vector<int> uses;      //reads of each parameter
+      std::vector<std::string> calls;
+   };
+
+   std::map<std::string, Entry> entries;
+   int generation;
+
+};
+
+/*
+ * Class: CallExp
+ * --------------
+ * This subclass of Expression represents a call FNA(e1, e2) of a
+ * function.  The call is resolved the first time it is evaluated with
+ * a new set of functions.  A small function whose arguments are all
+ * constants or definitely assigned variables its body reads is
+ * inlined: the call keeps a copy of the body with the arguments in
+ * place of the parameters and evaluates that.  The result is the same,
+ * since evaluating such an argument cannot fail or change anything, so
+ * it does not matter when or how often that happens.  A variable that
+ * may be undefined is not inlined, since the body could then raise
+ * another error before reading it.  Other calls evaluate the arguments
+ * into a frame on the argument stack of the state and the body of the
+ * function against it.
+ *
+ * Calling a function that is not defined raises "UNDEFINED FUNCTION",
+ * and calling it with the wrong number of arguments raises
+ * "WRONG NUMBER OF ARGUMENTS".
+ */
+
+template <typename Value>
+class CallExp : public Expression<Value> {
+
+public:
+
+   CallExp(std::string name, std::vector<Expression<Value> *> args);
+   virtual ~CallExp();
+
+   virtual Value eval(EvalState<Value> & state);
+   virtual std::string toString();
+   virtual ExpressionType getType();
+
+/*
+ * Methods: getName, getArgumentCount, getArgument
+ * Usage: Expression<Value> *arg = ((CallExp<Value> *) exp)->getArgument(i);
+ * -------------------------------------------------------------------------
+ * Return the name of the function and the arguments of the call.
+ */
+
+   std::string getName();
+   int getArgumentCount();
+   Expression<Value> *getArgument(int index);
+
+private:
+
+   void resolve(EvalState<Value> & state);
+
+   std::string name;
+   std::vector<Expression<Value> *> args;
+   const FunctionTable<Value> *table;   //the functions resolved against
+   int generation;
+   DefStatement<Value> *function;
+   Expression<Value> *inlined;          //the inlined body, or NULL
+
+};
+
+#endif
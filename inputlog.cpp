@@ -0,0 +1,128 @@
+/*
+ * File: inputlog.cpp
+ * ------------------
+ * This file implements the InputLog class.
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../StanfordCPPLib/error.h"
+#include "checkpoint.h"
+#include "inputlog.h"
+
+using namespace std;
+
+static const char MAGIC[] = "BASINPT2";
+static const size_t MAGIC_SIZE = 8;
+
+/*
+ * Implementation notes: the InputLog class
+ * ----------------------------------------
+ * Each record is written with one write(2) as soon as its line is
+ * read, so a log holds every line read before the program stopped,
+ * however it stopped.  The lines come at the pace of a person typing,
+ * so nothing is gained by buffering them.  A replayed log is read into
+ * memory when it is opened, and the terminal is never touched.  The
+ * numbers are LEB128, with the encoder the checkpoints use.
+ */
+
+//write all the bytes, returning false on an error
+static bool writeAll(int fd, const char *bytes, size_t length) {
+   while (length > 0) {
+      ssize_t count = write(fd, bytes, length);
+      if (count < 0) {
+         if (errno == EINTR) continue;
+         return false;
+      }
+      bytes += count;
+      length -= count;
+   }
+   return true;
+}
+
+InputLog::InputLog() :out(-1), replaying(false), paced(false), pos(0) {}
+
+InputLog::~InputLog() {
+   if (out >= 0) ::close(out);
+}
+
+bool InputLog::record(const string & path) {
+   int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+   if (fd < 0) return false;
+   if (!writeAll(fd, MAGIC, MAGIC_SIZE)) {
+      ::close(fd);
+      return false;
+   }
+   if (out >= 0) ::close(out);
+   out = fd;
+   replaying = false;
+   return true;
+}
+
+bool InputLog::replay(const string & path, bool init_paced) {
+   int fd = ::open(path.c_str(), O_RDONLY);
+   if (fd < 0) return false;
+   string bytes;
+   char chunk[1 << 16];
+   while (true) {
+      ssize_t count = read(fd, chunk, sizeof chunk);
+      if (count == 0) break;
+      if (count < 0) {
+         if (errno == EINTR) continue;
+         ::close(fd);
+         return false;
+      }
+      bytes.append(chunk, count);
+   }
+   ::close(fd);
+   if (bytes.size() < MAGIC_SIZE || memcmp(bytes.data(), MAGIC, MAGIC_SIZE) != 0) return false;
+   if (out >= 0) ::close(out);
+   out = -1;
+   contents.swap(bytes);
+   pos = MAGIC_SIZE;
+   replaying = true;
+   paced = init_paced;
+   return true;
+}
+
+bool InputLog::readLine(string & line) {
+   if (replaying) {
+      if (pos == contents.size()) error("INPUT LOG ENDED");
+      unsigned long long wait, length;
+      if (!getNumber(contents, pos, wait) || !getNumber(contents, pos, length)
+          || length > contents.size() - pos + 1) {
+         error("INPUT LOG ERROR");
+      }
+      if (paced) this_thread::sleep_for(chrono::microseconds(wait));
+      if (length == 0) return false;
+      length--;
+      line.assign(contents.data() + pos, length);
+      pos += length;
+      return true;
+   }
+   if (out < 0) return (bool) getline(cin, line);
+   chrono::steady_clock::time_point start = chrono::steady_clock::now();
+   bool read = (bool) getline(cin, line);
+   unsigned long long wait = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+   string bytes;
+   putNumber(bytes, wait);
+   if (read) {
+      putNumber(bytes, line.size() + 1);
+      putBytes(bytes, line.data(), line.size());
+   } else {
+      putNumber(bytes, 0);
+   }
+   if (!writeAll(out, bytes.data(), bytes.size())) error("INPUT LOG ERROR");
+   return read;
+}
+
+InputLog & getInputLog() {
+   static InputLog log;
+   return log;
+}
@@ -0,0 +1,96 @@
+/*
+ * File: inputlog.h
+ * ----------------
+ * This interface exports the InputLog class, which records the lines
+ * that INPUT statements read from the terminal into a file, or feeds
+ * them back from such a file, so that a run can be repeated exactly.
+ */
+
+#ifndef _inputlog_h
+#define _inputlog_h
+
+#include <cstddef>
+#include <string>
+
+/*
+ * Class: InputLog
+ * ---------------
+ * The source of the lines that INPUT reads.  It reads standard input
+ * until record or replay is called.  When recording, every line read,
+ * including the ones rejected as INVALID NUMBER, is written to the log
+ * with the time the program waited for it.  When replaying, the lines
+ * come from the log, at once or after the recorded wait.
+ *
+ * A log starts with the eight bytes "BASINPT2", followed by one record
+ * per line: the wait in microseconds and the length of the line plus
+ * one, each as an unsigned LEB128 number, then the characters of the
+ * line without its end.  A record with the length 0 and no characters
+ * is a read that met the end of standard input, so that replay meets
+ * it at the same INPUT.
+ */
+
+class InputLog {
+
+public:
+
+   InputLog();
+   ~InputLog();
+
+/*
+ * Method: record
+ * Usage: if (log.record(path)) . . .
+ * ----------------------------------
+ * Creates or truncates the log at path and records into it from now
+ * on, returning false if it cannot be written.
+ */
+
+   bool record(const std::string & path);
+
+/*
+ * Method: replay
+ * Usage: if (log.replay(path, paced)) . . .
+ * -----------------------------------------
+ * Reads the log at path and takes the lines from it from now on,
+ * waiting the recorded time before each if paced is true.  Returns
+ * false if the file cannot be read or is not a log.
+ */
+
+   bool replay(const std::string & path, bool paced);
+
+/*
+ * Method: readLine
+ * Usage: if (log.readLine(line)) . . .
+ * ------------------------------------
+ * Sets line to the next line of input, without its end, and returns
+ * false at the end of standard input, or where the replayed log
+ * recorded it.  Raises "INPUT LOG ENDED" if a replayed log has no more
+ * records, and "INPUT LOG ERROR" if it is cut short or a record cannot
+ * be written.
+ */
+
+   bool readLine(std::string & line);
+
+private:
+
+   int out;                    //the descriptor recorded into, or -1
+   bool replaying;
+   bool paced;
+   std::string contents;       //the log replayed
+   size_t pos;                 //where replay continues
+
+   //not copyable: the descriptor is owned
+   InputLog(const InputLog &);
+   InputLog & operator=(const InputLog &);
+
+};
+
+/*
+ * Function: getInputLog
+ * Usage: getInputLog().readLine(line);
+ * ------------------------------------
+ * Returns the log that INPUT statements read through.
+ */
+
+InputLog & getInputLog();
+
+#endif
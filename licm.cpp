@@ -0,0 +1,259 @@
+/*
+ * File: licm.cpp
+ * --------------
+ * This file implements the loop-invariant pass.
+ */
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "analysis.h"
+#include "cse.h"
+#include "data.h"
+#include "exp.h"
+#include "fileio.h"
+#include "function.h"
+#include "licm.h"
+#include "native.h"
+#include "statement.h"
+using namespace std;
+
+//true if node h is on every path from the first line to node j
+static bool dominates(int h, int j, const vector<vector<int> > & succs)
+{
+    if (h == 0) return true;
+    vector<bool> seen(succs.size(), false);
+    vector<int> stack(1, 0);
+    seen[0] = true;
+    while (!stack.empty()){
+        int node = stack.back();
+        stack.pop_back();
+        if (node == j) return false;
+        for (size_t k = 0; k < succs[node].size(); k++){
+            int next = succs[node][k];
+            if (next == h || seen[next]) continue;
+            seen[next] = true;
+            stack.push_back(next);
+        }
+    }
+    return true;
+}
+
+//the nodes of the natural loop of the back edge from j to h
+static vector<bool> loopNodes(int h, int j, const vector<vector<int> > & preds)
+{
+    vector<bool> inLoop(preds.size(), false);
+    inLoop[h] = true;
+    vector<int> stack;
+    if (!inLoop[j]){
+        inLoop[j] = true;
+        stack.push_back(j);
+    }
+    while (!stack.empty()){
+        int node = stack.back();
+        stack.pop_back();
+        for (size_t k = 0; k < preds[node].size(); k++){
+            int prev = preds[node][k];
+            if (inLoop[prev]) continue;
+            inLoop[prev] = true;
+            stack.push_back(prev);
+        }
+    }
+    return inLoop;
+}
+
+//add the variables a statement may assign; a NEXT without a variable
+//may step any loop variable
+template <typename Value>
+static void collectWrites(Statement<Value> * stmt, const set<string> & loopVars, set<string> & written)
+{
+    switch (stmt->getType()){
+        case LET_STMT:
+            written.insert(((LetStatement<Value> *) stmt)->getName());
+            break;
+        case INPUT_STMT:
+            written.insert(((InputStatement<Value> *) stmt)->getName());
+            break;
+        case FILE_INPUT_STMT:
+            written.insert(((FileInputStatement<Value> *) stmt)->getName());
+            break;
+        case FOR_STMT:
+            written.insert(((ForStatement<Value> *) stmt)->getName());
+            break;
+        case NEXT_STMT:
+            if (((NextStatement<Value> *) stmt)->getName().empty()){
+                written.insert(loopVars.begin(), loopVars.end());
+            }else{
+                written.insert(((NextStatement<Value> *) stmt)->getName());
+            }
+            break;
+        case MAT_STMT:
+            if (((MatStatement<Value> *) stmt)->getOp() == MAT_SUM || ((MatStatement<Value> *) stmt)->getOp() == MAT_DOT){
+                written.insert(((MatStatement<Value> *) stmt)->getTarget());
+            }
+            break;
+        case READ_STMT:
+            for (int i = 0; i < ((ReadStatement<Value> *) stmt)->getCount(); i++){
+                Expression<Value> * target = ((ReadStatement<Value> *) stmt)->getTarget(i);
+                if (target->getType() == IDENTIFIER) written.insert(((IdentifierExp<Value> *) target)->getName());
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+//true if an expression reads only constants and variables not written
+template <typename Value>
+static bool isInvariant(Expression<Value> * exp, const set<string> & written)
+{
+    if (exp->getType() == CONSTANT) return true;
+    if (exp->getType() == IDENTIFIER) return written.count(((IdentifierExp<Value> *) exp)->getName()) == 0;
+    if (exp->getType() != COMPOUND) return false;
+    return isInvariant(((CompoundExp<Value> *) exp)->getLHS(), written)
+            && isInvariant(((CompoundExp<Value> *) exp)->getRHS(), written);
+}
+
+//add the variables an invariant expression reads
+template <typename Value>
+static void collectVariables(Expression<Value> * exp, set<string> & vars)
+{
+    if (exp->getType() == IDENTIFIER){
+        vars.insert(((IdentifierExp<Value> *) exp)->getName());
+    }else if (exp->getType() == COMPOUND){
+        collectVariables(((CompoundExp<Value> *) exp)->getLHS(), vars);
+        collectVariables(((CompoundExp<Value> *) exp)->getRHS(), vars);
+    }
+}
+
+/*
+ * Implementation notes: collectInvariants
+ * ---------------------------------------
+ * An operator over constants alone is left to be evaluated, since it
+ * would need no watching; array elements and function calls are never
+ * invariant, since an element may be assigned and RND changes, but
+ * their subscripts and arguments are searched.
+ */
+
+template <typename Value>
+static void collectInvariants(Expression<Value> * exp, const set<string> & written, vector<CompoundExp<Value> *> & found)
+{
+    if (exp->getType() == COMPOUND){
+        CompoundExp<Value> * compound = (CompoundExp<Value> *) exp;
+        if (isInvariant(exp, written)){
+            set<string> vars;
+            collectVariables(exp, vars);
+            if (!vars.empty()) found.push_back(compound);
+            return;
+        }
+        collectInvariants(compound->getLHS(), written, found);
+        collectInvariants(compound->getRHS(), written, found);
+    }else if (exp->getType() == ARRAY){
+        collectInvariants(((ArrayExp<Value> *) exp)->getRow(), written, found);
+        if (((ArrayExp<Value> *) exp)->getCol() != NULL) collectInvariants(((ArrayExp<Value> *) exp)->getCol(), written, found);
+    }else if (exp->getType() == CALL){
+        for (int i = 0; i < ((CallExp<Value> *) exp)->getArgumentCount(); i++){
+            collectInvariants(((CallExp<Value> *) exp)->getArgument(i), written, found);
+        }
+    }else if (exp->getType() == NATIVE){
+        for (int i = 0; i < ((NativeCallExp<Value> *) exp)->getArgumentCount(); i++){
+            collectInvariants(((NativeCallExp<Value> *) exp)->getArgument(i), written, found);
+        }
+    }
+}
+
+/*
+ * Implementation notes: markLoopInvariants
+ * ----------------------------------------
+ * A back edge is a jump from line j to a line h, no later than j, that
+ * dominates it: the first line cannot reach j without passing h.  Its
+ * natural loop is h and every node that reaches j without passing h,
+ * which includes the nodes standing for NEXT and RETURN jumps, so a
+ * GOSUB in the loop brings in the subroutine with its assignments.  A
+ * computed GOTO leads to every line, so no line after a reachable one
+ * dominates anything.
+ *
+ * The back edges to one line close one loop, which has its own clock,
+ * keyed by that line.  An operator found in several loops keeps the
+ * clock of the first; its variables are watched by that clock, so the
+ * memo is right whichever loop it is read in.
+ */
+
+template <typename Value>
+void markLoopInvariants(const vector<int> & numbers, const vector<Statement<Value> *> & stmts,
+                        vector<ExpMemo<Value> > & memos, map<string, vector<int> > & watched)
+{
+    memos.clear();
+    if (find(stmts.begin(), stmts.end(), (Statement<Value> *) NULL) != stmts.end()) return;
+    int n = stmts.size();
+    vector<vector<int> > preds;
+    buildLineGraph(numbers, stmts, preds);
+    vector<vector<int> > succs(preds.size());
+    for (size_t i = 0; i < preds.size(); i++){
+        for (size_t k = 0; k < preds[i].size(); k++){
+            succs[preds[i][k]].push_back(i);
+        }
+    }
+    map<int, int> position;
+    set<string> loopVars;
+    for (int i = 0; i < n; i++){
+        position[numbers[i]] = i;
+        if (stmts[i]->getType() == FOR_STMT) loopVars.insert(((ForStatement<Value> *) stmts[i])->getName());
+    }
+
+    //the clock of each invariant, that of the first loop it is found in
+    map<CompoundExp<Value> *, int> marked;
+    map<int, int> clocks;
+    for (int j = 0; j < n; j++){
+        int target = -1;
+        if (stmts[j]->getType() == GOTO_STMT) target = ((GotoStatement<Value> *) stmts[j])->getTarget();
+        if (stmts[j]->getType() == IF_STMT) target = ((IfStatement<Value> *) stmts[j])->getTarget();
+        map<int, int>::iterator it = position.find(target);
+        if (it == position.end() || it->second > j) continue;
+        int h = it->second;
+        if (!dominates(h, j, succs)) continue;
+        vector<bool> inLoop = loopNodes(h, j, preds);
+        set<string> written;
+        for (int i = 0; i < n; i++){
+            if (inLoop[i]) collectWrites(stmts[i], loopVars, written);
+        }
+        vector<CompoundExp<Value> *> found;
+        for (int i = 0; i < n; i++){
+            if (!inLoop[i]) continue;
+            vector<Expression<Value> *> roots;
+            collectExpressions(stmts[i], roots);
+            for (size_t r = 0; r < roots.size(); r++){
+                collectInvariants(roots[r], written, found);
+            }
+        }
+        if (found.empty()) continue;
+        if (clocks.count(h) == 0){
+            int clock = INVARIANT_CLOCK + clocks.size();
+            clocks[h] = clock;
+        }
+        for (size_t k = 0; k < found.size(); k++){
+            marked.insert(make_pair(found[k], clocks[h]));
+        }
+    }
+
+    ExpMemo<Value> fresh = { Value(), 0, INVARIANT_CLOCK };
+    memos.assign(marked.size(), fresh);
+    size_t k = 0;
+    typename map<CompoundExp<Value> *, int>::iterator it;
+    for (it = marked.begin(); it != marked.end(); it++, k++){
+        memos[k].clock = it->second;
+        it->first->setMemo(&memos[k]);
+        set<string> vars;
+        collectVariables(it->first, vars);
+        for (set<string>::iterator var = vars.begin(); var != vars.end(); var++){
+            addClock(watched[*var], it->second);
+        }
+    }
+}
+
+#define INSTANTIATE_LICM(Value) \
+    template void markLoopInvariants<Value>(const vector<int> & numbers, const vector<Statement<Value> *> & stmts, \
+                                            vector<ExpMemo<Value> > & memos, map<string, vector<int> > & watched);
+FOR_EACH_VALUE_TYPE(INSTANTIATE_LICM)
@@ -0,0 +1,44 @@
+/*
+ * File: licm.h
+ * ------------
+ * This interface exports the loop-invariant pass, which makes the
+ * subexpressions of a loop built from IF and GOTO lines that do not
+ * change in the loop be evaluated once each time the loop runs.
+ */
+
+#ifndef _licm_h
+#define _licm_h
+
+#include <map>
+#include <string>
+#include <vector>
+#include "exp.h"
+#include "statement.h"
+
+/*
+ * Function: markLoopInvariants
+ * Usage: markLoopInvariants(numbers, stmts, memos, watched);
+ * ----------------------------------------------------------
+ * Finds the natural loops of the line graph closed by an IF or GOTO
+ * that jumps back to a line which every path to it passes, and in the
+ * lines of each loop the largest operators that read a variable and
+ * only constants and variables that no line of the loop assigns.  Each
+ * such operator is given a memo of the clock of its loop, numbered
+ * from INVARIANT_CLOCK, and that clock is added to the clocks watching
+ * each variable it reads.  memos is refilled with those memos; the
+ * program calls this after markCommonSubexpressions, which removes the
+ * memos of an earlier call.
+ * Nothing is marked while a line is unparsed.
+ *
+ * The memo is filled where the operator is first evaluated in the
+ * loop, so the errors of the program are raised where they were, and
+ * is kept until one of its variables is assigned, which only happens
+ * outside the loop; an assignment that only the invariants of other
+ * loops read leaves it.
+ */
+
+template <typename Value>
+void markLoopInvariants(const std::vector<int> & numbers, const std::vector<Statement<Value> *> & stmts,
+                        std::vector<ExpMemo<Value> > & memos, std::map<std::string, std::vector<int> > & watched);
+
+#endif
@@ -0,0 +1,532 @@
+/*
+ * File: loop.cpp
+ * --------------
+ * This file implements the CountedLoop and ForLoop classes.
+ */
+
+#include <string>
+#include <vector>
+#include <climits>
+#include <algorithm>
+#include "loop.h"
+#include "evalstate.h"
+#include "fileio.h"
+#include "exp.h"
+#include "statement.h"
+using namespace std;
+
+/*
+ * Implementation notes: readStep
+ * ------------------------------
+ * Recognizes LET I = I + c, LET I = c + I and LET I = I - c with a
+ * constant c other than 0, and returns I and the signed step.
+ */
+
+template <typename Value>
+static bool readStep(LetStatement<Value> * let, string & name, int & step)
+{
+    if (let->getExp()->getType() != COMPOUND) return false;
+    CompoundExp<Value> * exp = (CompoundExp<Value> *) let->getExp();
+    Expression<Value> * lhs = exp->getLHS();
+    Expression<Value> * rhs = exp->getRHS();
+    name = let->getName();
+    if (exp->getOp() == "+" && rhs->getType() == IDENTIFIER && lhs->getType() == CONSTANT){
+        swap(lhs, rhs);
+    }
+    if (lhs->getType() != IDENTIFIER || ((IdentifierExp<Value> *) lhs)->getName() != name) return false;
+    if (rhs->getType() != CONSTANT) return false;
+    int c = (int) ValueTraits<Value>::toInteger(((ConstantExp<Value> *) rhs)->getValue());
+    if (exp->getOp() == "+"){
+        step = c;
+    }else if (exp->getOp() == "-" && c != INT_MIN){
+        step = -c;
+    }else{
+        return false;
+    }
+    return step != 0;
+}
+
+//true if the body assigns the variable
+template <typename Value>
+static bool assigns(vector<Statement<Value> *> & body, string name)
+{
+    for (size_t i = 0; i < body.size(); i++){
+        StatementType type = body[i]->getType();
+        if (type == LET_STMT && ((LetStatement<Value> *) body[i])->getName() == name) return true;
+        if (type == INPUT_STMT && ((InputStatement<Value> *) body[i])->getName() == name) return true;
+        if (type == FILE_INPUT_STMT && ((FileInputStatement<Value> *) body[i])->getName() == name) return true;
+    }
+    return false;
+}
+
+/*
+ * Implementation notes: readAffine
+ * --------------------------------
+ * Recognizes I + c, I - c, c + I, I and c for a constant c.
+ */
+
+template <typename Value>
+bool readAffine(Expression<Value> * exp, string induction, bool & usesInduction, int & offset)
+{
+    usesInduction = false;
+    offset = 0;
+    if (exp->getType() == CONSTANT){
+        offset = (int) ValueTraits<Value>::toInteger(((ConstantExp<Value> *) exp)->getValue());
+        return true;
+    }
+    if (exp->getType() == IDENTIFIER){
+        usesInduction = true;
+        return ((IdentifierExp<Value> *) exp)->getName() == induction;
+    }
+    if (exp->getType() != COMPOUND) return false;
+    CompoundExp<Value> * sum = (CompoundExp<Value> *) exp;
+    Expression<Value> * lhs = sum->getLHS();
+    Expression<Value> * rhs = sum->getRHS();
+    if (sum->getOp() == "+" && lhs->getType() == CONSTANT) swap(lhs, rhs);
+    if (lhs->getType() != IDENTIFIER || ((IdentifierExp<Value> *) lhs)->getName() != induction) return false;
+    if (rhs->getType() != CONSTANT) return false;
+    int c = (int) ValueTraits<Value>::toInteger(((ConstantExp<Value> *) rhs)->getValue());
+    usesInduction = true;
+    if (sum->getOp() == "+"){
+        offset = c;
+        return true;
+    }
+    if (sum->getOp() == "-" && c != INT_MIN){
+        offset = -c;
+        return true;
+    }
+    return false;
+}
+
+//append the array elements of an expression, subscripts included
+template <typename Value>
+static void collectElements(Expression<Value> * exp, vector<ArrayExp<Value> *> & elements)
+{
+    if (exp->getType() == COMPOUND){
+        collectElements(((CompoundExp<Value> *) exp)->getLHS(), elements);
+        collectElements(((CompoundExp<Value> *) exp)->getRHS(), elements);
+    }else if (exp->getType() == ARRAY){
+        ArrayExp<Value> * element = (ArrayExp<Value> *) exp;
+        elements.push_back(element);
+        collectElements(element->getRow(), elements);
+        if (element->getCol() != NULL) collectElements(element->getCol(), elements);
+    }
+}
+
+//true for a constant or a variable the body does not assign
+template <typename Value>
+static bool isInvariant(Expression<Value> * exp, vector<Statement<Value> *> & body)
+{
+    if (exp->getType() == CONSTANT) return true;
+    if (exp->getType() == IDENTIFIER) return !assigns(body, ((IdentifierExp<Value> *) exp)->getName());
+    return false;
+}
+
+//true if every body line is parsed and one that never jumps: a LET,
+//PRINT, INPUT, PRINT #, INPUT # or REM
+template <typename Value>
+static bool isStraight(vector<Statement<Value> *> & body)
+{
+    for (size_t i = 0; i < body.size(); i++){
+        if (body[i] == NULL) return false;
+        StatementType type = body[i]->getType();
+        if (type != LET_STMT && type != PRINT_STMT && type != INPUT_STMT && type != REM_STMT
+                && type != ARRAY_LET_STMT && type != STRING_LET_STMT && type != STRING_PRINT_STMT
+                && type != STRING_INPUT_STMT && type != FILE_INPUT_STMT && type != FILE_PRINT_STMT) return false;
+    }
+    return true;
+}
+
+//append the array elements of the body whose check can be hoisted
+template <typename Value>
+static void collectAccesses(vector<Statement<Value> *> & body, string induction, vector<ArrayAccess<Value> > & accesses)
+{
+    vector<ArrayExp<Value> *> elements;
+    for (size_t i = 0; i < body.size(); i++){
+        if (body[i]->getType() == LET_STMT) collectElements(((LetStatement<Value> *) body[i])->getExp(), elements);
+        if (body[i]->getType() == PRINT_STMT) collectElements(((PrintStatement<Value> *) body[i])->getExp(), elements);
+        if (body[i]->getType() == ARRAY_LET_STMT){
+            collectElements(((ArrayLetStatement<Value> *) body[i])->getTarget(), elements);
+            collectElements(((ArrayLetStatement<Value> *) body[i])->getExp(), elements);
+        }
+    }
+    for (size_t i = 0; i < elements.size(); i++){
+        ArrayAccess<Value> access;
+        access.element = elements[i];
+        access.colInduction = false;
+        access.colOffset = 0;
+        if (!readAffine(elements[i]->getRow(), induction, access.rowInduction, access.rowOffset)) continue;
+        if (elements[i]->getCol() != NULL
+                && !readAffine(elements[i]->getCol(), induction, access.colInduction, access.colOffset)) continue;
+        accesses.push_back(access);
+    }
+}
+
+//true if every subscript from lo + offset to hi + offset is below extent
+static bool inBounds(bool usesInduction, int offset, long long lo, long long hi, int extent)
+{
+    if (!usesInduction) return offset >= 0 && offset < extent;
+    return lo + offset >= 0 && hi + offset < extent;
+}
+
+/*
+ * Implementation notes: hoistAccesses
+ * -----------------------------------
+ * The body sees the induction variable at the values from lo to hi.
+ * Each element whose subscripts stay in bounds over that range runs
+ * unchecked, and goes into hoisted for restoreChecks.
+ */
+
+template <typename Value>
+static void hoistAccesses(EvalState<Value> & state, vector<ArrayAccess<Value> > & accesses, long long lo, long long hi,
+                          vector<ArrayExp<Value> *> & hoisted)
+{
+    for (size_t i = 0; i < accesses.size(); i++){
+        ArrayAccess<Value> & access = accesses[i];
+        ArrayValue<Value> * array = state.getArray(access.element->getSlot());
+        if (array == NULL) continue;
+        if ((access.element->getCol() == NULL) != (array->cols == 0)) continue;
+        if (!inBounds(access.rowInduction, access.rowOffset, lo, hi, array->rows)) continue;
+        if (access.element->getCol() != NULL
+                && !inBounds(access.colInduction, access.colOffset, lo, hi, array->cols)) continue;
+        access.element->setChecked(false);
+        hoisted.push_back(access.element);
+    }
+}
+
+//turn the hoisted checks back on
+template <typename Value>
+static void restoreChecks(vector<ArrayExp<Value> *> & hoisted)
+{
+    for (size_t i = 0; i < hoisted.size(); i++){
+        hoisted[i]->setChecked(true);
+    }
+    hoisted.clear();
+}
+
+template <typename Value>
+Statement<Value> *makeCountedLoop(IfStatement<Value> * test, vector<Statement<Value> *> & body)
+{
+    if (body.empty() || !isStraight(body)) return NULL;
+    if (body.back()->getType() != LET_STMT) return NULL;
+    string name;
+    int step;
+    if (!readStep((LetStatement<Value> *) body.back(), name, step)) return NULL;
+    BoolExp<Value> * cond = test->getCond();
+    Expression<Value> * lhs = cond->getLHS();
+    Expression<Value> * rhs = cond->getRHS();
+    bool onLeft = lhs->getType() == IDENTIFIER && ((IdentifierExp<Value> *) lhs)->getName() == name;
+    bool onRight = rhs->getType() == IDENTIFIER && ((IdentifierExp<Value> *) rhs)->getName() == name;
+    if (!onLeft && !onRight) return NULL;
+    return new CountedLoop<Value>(test, body);
+}
+
+/* Implementation of the CountedLoop class */
+
+/*
+ * Implementation notes: CountedLoop
+ * ---------------------------------
+ * The constructor decides once what applies.  The trip count can be
+ * computed when the limit is invariant, the step moves the induction
+ * variable towards it and only the last body line assigns it.  The
+ * closed form also needs every other body line to be a REM or an
+ * accumulation into its own variable by an invariant amount.  Both
+ * assume 32-bit values; for the other value types the loop only runs
+ * natively.
+ */
+
+template <typename Value>
+CountedLoop<Value>::CountedLoop(IfStatement<Value> * init_test, vector<Statement<Value> *> init_body)
+    :test(init_test), body(init_body), counted(false), closed(false), limit(NULL)
+{
+    readStep((LetStatement<Value> *) body.back(), induction, step);
+    BoolExp<Value> * cond = test->getCond();
+    op = cond->getOp();
+    limit = cond->getRHS();
+    if (cond->getLHS()->getType() != IDENTIFIER || ((IdentifierExp<Value> *) cond->getLHS())->getName() != induction){
+        limit = cond->getLHS();
+        if (op == "<") op = ">";
+        else if (op == ">") op = "<";
+    }
+    if (!isInvariant(limit, body)) return;
+    if (!(op == "<" && step > 0) && !(op == ">" && step < 0)) return;
+    vector<Statement<Value> *> rest(body.begin(), body.end() - 1);
+    if (assigns(rest, induction)) return;
+    if (!ValueTraits<Value>::INT32) return;
+    counted = true;
+
+    collectAccesses(body, induction, accesses);
+
+    for (size_t i = 0; i + 1 < body.size(); i++){
+        if (body[i]->getType() == REM_STMT) continue;
+        if (body[i]->getType() != LET_STMT) return;
+        LetStatement<Value> * let = (LetStatement<Value> *) body[i];
+        if (let->getExp()->getType() != COMPOUND) return;
+        CompoundExp<Value> * exp = (CompoundExp<Value> *) let->getExp();
+        Accumulator acc;
+        acc.name = let->getName();
+        acc.subtract = exp->getOp() == "-";
+        Expression<Value> * self = exp->getLHS();
+        acc.amount = exp->getRHS();
+        if (exp->getOp() == "+" && acc.amount->getType() == IDENTIFIER
+                && ((IdentifierExp<Value> *) acc.amount)->getName() == acc.name){
+            swap(self, acc.amount);
+        }
+        if (exp->getOp() != "+" && exp->getOp() != "-") return;
+        if (self->getType() != IDENTIFIER || ((IdentifierExp<Value> *) self)->getName() != acc.name) return;
+        if (!isInvariant(acc.amount, body)) return;
+        for (size_t j = 0; j < accumulators.size(); j++){
+            if (accumulators[j].name == acc.name) return;
+        }
+        accumulators.push_back(acc);
+    }
+    closed = true;
+}
+
+template <typename Value>
+CountedLoop<Value>::~CountedLoop()
+{
+    /* Empty */
+}
+
+template <typename Value>
+void CountedLoop<Value>::execute(EvalState<Value> & state)
+{
+    BoolExp<Value> * cond = test->getCond();
+    if (!cond->eval(state)) return;
+    if (closed && runClosedForm(state)) return;
+    hoistChecks(state);
+    try {
+        for (size_t i = 0; i < body.size(); i++){
+            body[i]->execute(state);
+        }
+        if (cond->eval(state)) runBound(state);
+    } catch (...) {
+        restoreChecks(hoisted);
+        throw;
+    }
+    restoreChecks(hoisted);
+}
+
+/*
+ * Implementation notes: runBound
+ * ------------------------------
+ * The body has no jumps, so after one iteration every variable it
+ * assigns is defined, and a LET can write the storage getReference
+ * gives, ending the epochs of its clocks as setValue would.  When the
+ * trip count can be computed, the last line is the step of the
+ * induction variable, which goes to its next value directly; the
+ * condition holds until the last iteration by the count.
+ */
+
+template <typename Value>
+void CountedLoop<Value>::runBound(EvalState<Value> & state)
+{
+    vector<Binding> lines(body.size());
+    for (size_t i = 0; i < body.size(); i++){
+        lines[i].var = NULL;
+        if (body[i]->getType() != LET_STMT) continue;
+        LetStatement<Value> * let = (LetStatement<Value> *) body[i];
+        lines[i].var = state.getReference(let->getName());
+        lines[i].exp = let->getExp();
+        lines[i].clocks = state.getClocks(let->getName());
+    }
+    long long first, times;
+    if (counted && tripCount(state, first, times)){
+        Binding & stepper = lines.back();
+        for (long long k = 1; k <= times; k++){
+            runLines(state, lines, lines.size() - 1);
+            *stepper.var = (int) (first + k * step);
+            state.nextEpoch(stepper.clocks);
+        }
+        return;
+    }
+    do {
+        runLines(state, lines, lines.size());
+    } while (test->getCond()->eval(state));
+}
+
+//run the first count lines of the body once
+template <typename Value>
+void CountedLoop<Value>::runLines(EvalState<Value> & state, vector<Binding> & lines, size_t count)
+{
+    for (size_t i = 0; i < count; i++){
+        if (lines[i].var == NULL){
+            body[i]->execute(state);
+        }else{
+            *lines[i].var = lines[i].exp->eval(state);
+            state.nextEpoch(lines[i].clocks);
+        }
+    }
+}
+
+template <typename Value>
+StatementType CountedLoop<Value>::getType()
+{
+    return IF_STMT;
+}
+
+template <typename Value>
+string CountedLoop<Value>::toString()
+{
+    return test->toString();
+}
+
+/*
+ * Implementation notes: tripCount
+ * -------------------------------
+ * Called with the condition just found true, so the body runs times
+ * >= 1 more times, starting with the induction variable at first.
+ * Returns false when the induction variable would overflow on the way.
+ */
+
+template <typename Value>
+bool CountedLoop<Value>::tripCount(EvalState<Value> & state, long long & first, long long & times)
+{
+    first = ValueTraits<Value>::toInteger(state.getValue(induction));
+    long long bound = ValueTraits<Value>::toInteger(limit->eval(state));
+    long long distance = (step > 0) ? bound - first : first - bound;
+    long long stride = (step > 0) ? step : -(long long) step;
+    times = (distance + stride - 1) / stride;
+    long long last = first + times * step;
+    return last <= INT_MAX && last >= INT_MIN;
+}
+
+/*
+ * Implementation notes: runClosedForm
+ * -----------------------------------
+ * The accumulators are updated modulo 2^32, which is what the wrapping
+ * additions give.  Returns false, leaving the state untouched, when a
+ * variable is undefined or the induction variable would overflow; the
+ * native loop then reproduces the original behaviour, error included.
+ */
+
+template <typename Value>
+bool CountedLoop<Value>::runClosedForm(EvalState<Value> & state)
+{
+    for (size_t i = 0; i < accumulators.size(); i++){
+        if (!state.isDefined(accumulators[i].name)) return false;
+        Expression<Value> * amount = accumulators[i].amount;
+        if (amount->getType() == IDENTIFIER && !state.isDefined(((IdentifierExp<Value> *) amount)->getName())){
+            return false;
+        }
+    }
+    long long first, times;
+    if (!tripCount(state, first, times)) return false;
+    for (size_t i = 0; i < accumulators.size(); i++){
+        unsigned int sum = ValueTraits<Value>::toInteger(state.getValue(accumulators[i].name));
+        unsigned int total = (unsigned int) times * (unsigned int) ValueTraits<Value>::toInteger(accumulators[i].amount->eval(state));
+        sum = accumulators[i].subtract ? sum - total : sum + total;
+        state.setValue(accumulators[i].name, (int) sum);
+    }
+    state.setValue(induction, (int) (first + times * step));
+    return true;
+}
+
+/*
+ * Implementation notes: hoistChecks
+ * ---------------------------------
+ * The induction variable only changes at the end of the body, so the
+ * body sees it at first, first + step, ... for the trip count.
+ */
+
+template <typename Value>
+void CountedLoop<Value>::hoistChecks(EvalState<Value> & state)
+{
+    if (!counted || accesses.empty()) return;
+    long long first, times;
+    if (!tripCount(state, first, times)) return;
+    long long lo = first;
+    long long hi = first + (times - 1) * step;
+    if (lo > hi) swap(lo, hi);
+    hoistAccesses(state, accesses, lo, hi, hoisted);
+}
+
+/* Implementation of the ForLoop class */
+
+template <typename Value>
+Statement<Value> *makeForLoop(ForStatement<Value> * stmt, vector<Statement<Value> *> & body, NextStatement<Value> * next)
+{
+    if (!ValueTraits<Value>::INT32 || stmt->isParallel() || !isStraight(body)) return NULL;
+    if (!next->getName().empty() && next->getName() != stmt->getName()) return NULL;
+    if (assigns(body, stmt->getName())) return NULL;
+    vector<ArrayAccess<Value> > accesses;
+    collectAccesses(body, stmt->getName(), accesses);
+    if (accesses.empty()) return NULL;
+    return new ForLoop<Value>(stmt, body, next);
+}
+
+template <typename Value>
+ForLoop<Value>::ForLoop(ForStatement<Value> * init_loop, vector<Statement<Value> *> init_body,
+                        NextStatement<Value> * init_next)
+    :loop(init_loop), body(init_body), next(init_next)
+{
+    collectAccesses(body, loop->getName(), accesses);
+}
+
+template <typename Value>
+ForLoop<Value>::~ForLoop()
+{
+    /* Empty */
+}
+
+/*
+ * Implementation notes: ForLoop::execute
+ * --------------------------------------
+ * The FOR jumps past the NEXT itself when the loop runs zero times.
+ * Otherwise its frame holds the first value, the limit and the step,
+ * and the loop variable takes the values first, first + step, ... that
+ * do not pass the limit, since NEXT stops before it would.  NEXT sets
+ * the program counter to the line after the FOR while the loop goes
+ * on, and leaves it alone when it pops the frame.
+ */
+
+template <typename Value>
+void ForLoop<Value>::execute(EvalState<Value> & state)
+{
+    loop->execute(state);
+    if (state.getPC() != EvalState<Value>::SEQUENTIAL) return;
+    LoopFrame<Value> * frame = state.findLoop(loop->getName());
+    long long first = ValueTraits<Value>::toInteger(*frame->var);
+    long long limit = ValueTraits<Value>::toInteger(frame->limit);
+    long long step = ValueTraits<Value>::toInteger(frame->step);
+    if (step != 0){
+        long long last = first + (limit - first) / step * step;
+        hoistAccesses(state, accesses, min(first, last), max(first, last), hoisted);
+    }
+    try {
+        do {
+            state.setPC(EvalState<Value>::SEQUENTIAL);
+            for (size_t i = 0; i < body.size(); i++){
+                body[i]->execute(state);
+            }
+            next->execute(state);
+        } while (state.getPC() != EvalState<Value>::SEQUENTIAL);
+    } catch (...) {
+        restoreChecks(hoisted);
+        throw;
+    }
+    restoreChecks(hoisted);
+    state.setPC(loop->getExit());
+}
+
+template <typename Value>
+StatementType ForLoop<Value>::getType()
+{
+    return FOR_STMT;
+}
+
+template <typename Value>
+string ForLoop<Value>::toString()
+{
+    return loop->toString();
+}
+
+#define INSTANTIATE_LOOP(Value) \
+    template class CountedLoop<Value>; \
+    template class ForLoop<Value>; \
+    template Statement<Value> *makeCountedLoop<Value>(IfStatement<Value> * test, vector<Statement<Value> *> & body); \
+    template Statement<Value> *makeForLoop<Value>(ForStatement<Value> * stmt, vector<Statement<Value> *> & body, \
+                                                  NextStatement<Value> * next); \
+    template bool readAffine<Value>(Expression<Value> * exp, string induction, bool & usesInduction, int & offset);
+FOR_EACH_VALUE_TYPE(INSTANTIATE_LOOP)
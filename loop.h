@@ -0,0 +1,224 @@
+/*
+ * File: loop.h
+ * ------------
+ * This interface exports the CountedLoop class, which runs a loop
+ * written with LET and IF as a native loop, and the ForLoop class,
+ * which does the same for a FOR loop.
+ */
+
+#ifndef _loop_h
+#define _loop_h
+
+#include <string>
+#include <vector>
+#include "evalstate.h"
+#include "exp.h"
+#include "statement.h"
+
+/*
+ * Type: ArrayAccess
+ * -----------------
+ * An array element of the body of a loop whose subscripts are the
+ * induction variable plus a constant, or a constant, so their range
+ * over the loop is known before it runs.
+ */
+
+template <typename Value>
+struct ArrayAccess {
+   ArrayExp<Value> *element;
+   bool rowInduction;
+   int rowOffset;
+   bool colInduction;
+   int colOffset;
+};
+
+/*
+ * Class: CountedLoop
+ * ------------------
+ * Without FOR, a counted loop is written as
+ *
+ *    100 ...body...
+ *    150 LET I = I + 1
+ *    160 IF I < N THEN 100
+ *
+ * A CountedLoop stands in for the IF line of such a loop.  When the
+ * condition holds, it runs the body lines and the condition directly
+ * until the condition fails, instead of returning to Program::run for
+ * a line lookup on every iteration.  It then falls through to the line
+ * after the IF, just as the IF would.  After the first iteration, the
+ * LETs of the body write the storage of their variables directly, and
+ * a loop whose trip count can be computed runs that many iterations
+ * without testing the condition.
+ *
+ * When the body only accumulates (LET S = S + K, with K a constant or a
+ * variable the loop does not assign), the remaining iterations are
+ * computed in closed form.  The closed form is only used when the
+ * induction variable cannot overflow and every variable it reads is
+ * defined; otherwise the loop runs natively, so overflow, the order of
+ * PRINT output and errors are exactly those of the original lines.
+ *
+ * Array elements of the body subscripted by the induction variable
+ * plus a constant (or by a constant) get their bounds check hoisted:
+ * before the native loop starts, the whole range of subscripts the
+ * loop will use is checked once against the array, and if it is in
+ * bounds the per-element check is turned off until the loop ends.
+ * Otherwise the check stays, and an out-of-range subscript raises its
+ * error at the same iteration as before.
+ *
+ * The closed form and the hoisted checks only apply to 32-bit values;
+ * with the other value types the loop just runs natively.
+ */
+
+template <typename Value>
+class CountedLoop : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: CountedLoop
+ * ----------------------
+ * The constructor initializes a loop from the IF statement that closes
+ * it and the statements of the lines from the IF target up to the LET
+ * that steps the induction variable.  The statements are not owned.
+ */
+
+   CountedLoop(IfStatement<Value> * init_test, std::vector<Statement<Value> *> init_body);
+
+/*
+ * Destructor: ~CountedLoop
+ * Usage: delete loop;
+ * -------------------
+ * The destructor deallocates the storage for this loop, but not for the
+ * statements it runs.
+ */
+
+   virtual ~CountedLoop();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  run the loop until the condition fails
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+    private:
+        //an accumulation LET S = S + K (or S - K) of the body
+        struct Accumulator {
+            std::string name;
+            bool subtract;
+            Expression<Value> * amount;
+        };
+
+        //a LET of the body bound to the storage of its variable, or a
+        //line that runs as a statement when var is NULL
+        struct Binding {
+            Value * var;
+            Expression<Value> * exp;
+            const std::vector<int> * clocks;
+        };
+
+        bool tripCount(EvalState<Value> & state, long long & first, long long & times);
+        bool runClosedForm(EvalState<Value> & state);
+        void hoistChecks(EvalState<Value> & state);
+        void runBound(EvalState<Value> & state);
+        void runLines(EvalState<Value> & state, std::vector<Binding> & lines, size_t count);
+
+        IfStatement<Value> * test;
+        std::vector<Statement<Value> *> body;
+        bool counted;                        //the trip count can be computed
+        bool closed;                         //body is pure accumulation
+        std::string induction;
+        int step;
+        Expression<Value> * limit;
+        std::string op;                      //induction op limit
+        std::vector<Accumulator> accumulators;
+        std::vector<ArrayAccess<Value> > accesses;
+        std::vector<ArrayExp<Value> *> hoisted;     //checks turned off while running
+};
+
+/*
+ * Class: ForLoop
+ * --------------
+ * A ForLoop stands in for the line of a FOR whose body, up to its
+ * NEXT, is made of the lines a CountedLoop runs and does not assign
+ * the loop variable.  It runs the FOR, then the body and the NEXT
+ * directly until the NEXT ends the loop, and jumps past the NEXT as
+ * the FOR would.  Its array elements get their bounds check hoisted as
+ * in a CountedLoop, over the values the FOR gives the loop variable;
+ * like that, it only applies to 32-bit values.
+ */
+
+template <typename Value>
+class ForLoop : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: ForLoop
+ * --------------------
+ * The constructor initializes a loop from its FOR statement, the
+ * statements of the lines between the FOR and the NEXT, and the NEXT
+ * statement.  The statements are not owned.
+ */
+
+   ForLoop(ForStatement<Value> * init_loop, std::vector<Statement<Value> *> init_body,
+           NextStatement<Value> * init_next);
+
+   virtual ~ForLoop();
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+    private:
+        ForStatement<Value> * loop;
+        std::vector<Statement<Value> *> body;
+        NextStatement<Value> * next;
+        std::vector<ArrayAccess<Value> > accesses;
+        std::vector<ArrayExp<Value> *> hoisted;     //checks turned off while running
+};
+
+/*
+ * Function: makeCountedLoop
+ * Usage: Statement<Value> *loop = makeCountedLoop(test, body);
+ * -----------------------------------------------------
+ * Returns a new CountedLoop if the body ends with LET I = I + c, the
+ * condition of test compares I with an expression, and every body
+ * statement is a LET (of a variable or an array element), PRINT,
+ * INPUT, PRINT #, INPUT # or REM.  Returns NULL otherwise,
+ * in particular when a body line is not parsed yet.
+ */
+
+template <typename Value>
+Statement<Value> *makeCountedLoop(IfStatement<Value> * test, std::vector<Statement<Value> *> & body);
+
+/*
+ * Function: makeForLoop
+ * Usage: Statement<Value> *loop = makeForLoop(stmt, body, next);
+ * --------------------------------------------------------------
+ * Returns a new ForLoop for the FOR stmt, the statements of the lines
+ * after it and the NEXT that closes it, if the values are 32-bit, the
+ * body has an element whose check can be hoisted, and every body
+ * statement is one makeCountedLoop accepts and does not assign the
+ * loop variable.  Returns NULL otherwise.
+ */
+
+template <typename Value>
+Statement<Value> *makeForLoop(ForStatement<Value> * stmt, std::vector<Statement<Value> *> & body,
+                              NextStatement<Value> * next);
+
+/*
+ * Function: readAffine
+ * Usage: if (readAffine(exp, induction, usesInduction, offset)) . . .
+ * -------------------------------------------------------------------
+ * Returns true if exp is the variable induction plus a constant, which
+ * sets usesInduction and stores the constant in offset, or a constant
+ * alone, which clears usesInduction.  This is the form of a subscript
+ * whose range over a loop can be checked before the loop runs.
+ */
+
+template <typename Value>
+bool readAffine(Expression<Value> * exp, std::string induction, bool & usesInduction, int & offset);
+
+#endif
@@ -0,0 +1,235 @@
+/*
+ * File: matrix.cpp
+ * ----------------
+ * This file implements the MAT kernels.
+ */
+
+#include "matrix.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+/*
+ * Implementation notes: scalar kernels
+ * ------------------------------------
+ * The arithmetic is done on unsigned ints, which wrap around by
+ * definition, and converted back.
+ */
+
+static void addScalar(int *c, const int *a, const int *b, int n)
+{
+    for (int i = 0; i < n; i++){
+        c[i] = (int) ((unsigned int) a[i] + (unsigned int) b[i]);
+    }
+}
+
+static void subtractScalar(int *c, const int *a, const int *b, int n)
+{
+    for (int i = 0; i < n; i++){
+        c[i] = (int) ((unsigned int) a[i] - (unsigned int) b[i]);
+    }
+}
+
+static void scaleScalar(int *c, int k, const int *a, int n)
+{
+    for (int i = 0; i < n; i++){
+        c[i] = (int) ((unsigned int) k * (unsigned int) a[i]);
+    }
+}
+
+//c[i] += k * b[i], the inner step of the product
+static void axpyScalar(int *c, int k, const int *b, int n)
+{
+    for (int i = 0; i < n; i++){
+        c[i] = (int) ((unsigned int) c[i] + (unsigned int) k * (unsigned int) b[i]);
+    }
+}
+
+static int sumScalar(const int *a, int n)
+{
+    unsigned int sum = 0;
+    for (int i = 0; i < n; i++){
+        sum += (unsigned int) a[i];
+    }
+    return (int) sum;
+}
+
+static int dotScalar(const int *a, const int *b, int n)
+{
+    unsigned int sum = 0;
+    for (int i = 0; i < n; i++){
+        sum += (unsigned int) a[i] * (unsigned int) b[i];
+    }
+    return (int) sum;
+}
+
+#ifdef HAVE_AVX2_KERNELS
+
+/*
+ * Implementation notes: AVX2 kernels
+ * ----------------------------------
+ * Each kernel handles eight elements per instruction and leaves the
+ * rest to the scalar kernel.  32-bit lane arithmetic wraps around just
+ * like the scalar kernels.  The functions are compiled for AVX2 on
+ * their own, so the rest of the program runs on any x86 processor.
+ */
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static void addAvx2(int *c, const int *a, const int *b, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8){
+        __m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+        _mm256_storeu_si256((__m256i *) (c + i), _mm256_add_epi32(x, y));
+    }
+    addScalar(c + i, a + i, b + i, n - i);
+}
+
+AVX2 static void subtractAvx2(int *c, const int *a, const int *b, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8){
+        __m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+        _mm256_storeu_si256((__m256i *) (c + i), _mm256_sub_epi32(x, y));
+    }
+    subtractScalar(c + i, a + i, b + i, n - i);
+}
+
+AVX2 static void scaleAvx2(int *c, int k, const int *a, int n)
+{
+    __m256i factor = _mm256_set1_epi32(k);
+    int i = 0;
+    for (; i + 8 <= n; i += 8){
+        __m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+        _mm256_storeu_si256((__m256i *) (c + i), _mm256_mullo_epi32(factor, x));
+    }
+    scaleScalar(c + i, k, a + i, n - i);
+}
+
+AVX2 static void axpyAvx2(int *c, int k, const int *b, int n)
+{
+    __m256i factor = _mm256_set1_epi32(k);
+    int i = 0;
+    for (; i + 8 <= n; i += 8){
+        __m256i x = _mm256_loadu_si256((const __m256i *) (c + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+        x = _mm256_add_epi32(x, _mm256_mullo_epi32(factor, y));
+        _mm256_storeu_si256((__m256i *) (c + i), x);
+    }
+    axpyScalar(c + i, k, b + i, n - i);
+}
+
+//the wrapped sum of the eight lanes
+AVX2 static unsigned int lanes(__m256i x)
+{
+    int parts[8];
+    _mm256_storeu_si256((__m256i *) parts, x);
+    return sumScalar(parts, 8);
+}
+
+AVX2 static int sumAvx2(const int *a, int n)
+{
+    __m256i sum = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= n; i += 8){
+        sum = _mm256_add_epi32(sum, _mm256_loadu_si256((const __m256i *) (a + i)));
+    }
+    return (int) (lanes(sum) + (unsigned int) sumScalar(a + i, n - i));
+}
+
+AVX2 static int dotAvx2(const int *a, const int *b, int n)
+{
+    __m256i sum = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= n; i += 8){
+        __m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(x, y));
+    }
+    return (int) (lanes(sum) + (unsigned int) dotScalar(a + i, b + i, n - i));
+}
+
+#endif
+
+/*
+ * Implementation notes: dispatch
+ * ------------------------------
+ * The kernels are chosen the first time one is called.
+ */
+
+struct Kernels {
+    void (*add)(int *, const int *, const int *, int);
+    void (*subtract)(int *, const int *, const int *, int);
+    void (*scale)(int *, int, const int *, int);
+    void (*axpy)(int *, int, const int *, int);
+    int (*sum)(const int *, int);
+    int (*dot)(const int *, const int *, int);
+};
+
+static Kernels chooseKernels()
+{
+    Kernels k = { addScalar, subtractScalar, scaleScalar, axpyScalar, sumScalar, dotScalar };
+#ifdef HAVE_AVX2_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")){
+        Kernels avx2 = { addAvx2, subtractAvx2, scaleAvx2, axpyAvx2, sumAvx2, dotAvx2 };
+        k = avx2;
+    }
+#endif
+    return k;
+}
+
+static const Kernels & kernels()
+{
+    static const Kernels chosen = chooseKernels();
+    return chosen;
+}
+
+void matAdd(int *c, const int *a, const int *b, int n)
+{
+    kernels().add(c, a, b, n);
+}
+
+void matSubtract(int *c, const int *a, const int *b, int n)
+{
+    kernels().subtract(c, a, b, n);
+}
+
+void matScale(int *c, int k, const int *a, int n)
+{
+    kernels().scale(c, k, a, n);
+}
+
+/*
+ * Implementation notes: matMultiply
+ * ---------------------------------
+ * The loops run in i, k, j order, so the innermost one adds a multiple
+ * of a row of b to a row of c, over contiguous memory.
+ */
+
+void matMultiply(int *c, const int *a, const int *b, int rows, int inner, int cols)
+{
+    const Kernels & k = kernels();
+    for (int i = 0; i < rows; i++){
+        int *row = c + (long long) i * cols;
+        for (int j = 0; j < cols; j++) row[j] = 0;
+        for (int m = 0; m < inner; m++){
+            k.axpy(row, a[(long long) i * inner + m], b + (long long) m * cols, cols);
+        }
+    }
+}
+
+int matSum(const int *a, int n)
+{
+    return kernels().sum(a, n);
+}
+
+int matDot(const int *a, const int *b, int n)
+{
+    return kernels().dot(a, b, n);
+}
@@ -0,0 +1,107 @@
+/*
+ * File: matrix.h
+ * --------------
+ * This interface exports the kernels behind the MAT statements.  Each
+ * works on contiguous buffers of ints and wraps around on overflow,
+ * like the arithmetic of the interpreter.  The kernels use AVX2 when
+ * the processor supports it, which is checked once at run time, and
+ * plain loops otherwise.
+ *
+ * The other value types use the templates at the end of this file,
+ * which are plain loops; overload resolution picks the int kernels for
+ * int buffers.
+ */
+
+#ifndef _matrix_h
+#define _matrix_h
+
+/*
+ * Functions: matAdd, matSubtract
+ * Usage: matAdd(c, a, b, n);
+ * --------------------------
+ * Set c[i] to a[i] + b[i], or a[i] - b[i], for i < n.  c may be a or b.
+ */
+
+void matAdd(int *c, const int *a, const int *b, int n);
+void matSubtract(int *c, const int *a, const int *b, int n);
+
+/*
+ * Function: matScale
+ * Usage: matScale(c, k, a, n);
+ * ----------------------------
+ * Sets c[i] to k * a[i] for i < n.  c may be a.
+ */
+
+void matScale(int *c, int k, const int *a, int n);
+
+/*
+ * Function: matMultiply
+ * Usage: matMultiply(c, a, b, rows, inner, cols);
+ * -----------------------------------------------
+ * Sets the rows x cols matrix c to the product of the rows x inner
+ * matrix a and the inner x cols matrix b, all stored row by row.  c
+ * must not overlap a or b.
+ */
+
+void matMultiply(int *c, const int *a, const int *b, int rows, int inner, int cols);
+
+/*
+ * Functions: matSum, matDot
+ * Usage: int sum = matSum(a, n);
+ * ------------------------------
+ * Return the sum of a[i], or of a[i] * b[i], for i < n.
+ */
+
+int matSum(const int *a, int n);
+int matDot(const int *a, const int *b, int n);
+
+/*
+ * Templates: the kernels for the other value types
+ * ------------------------------------------------
+ * These compute the same results as the int kernels, in the type of
+ * the values.
+ */
+
+template <typename Value>
+void matAdd(Value *c, const Value *a, const Value *b, int n) {
+   for (int i = 0; i < n; i++) c[i] = a[i] + b[i];
+}
+
+template <typename Value>
+void matSubtract(Value *c, const Value *a, const Value *b, int n) {
+   for (int i = 0; i < n; i++) c[i] = a[i] - b[i];
+}
+
+template <typename Value>
+void matScale(Value *c, Value k, const Value *a, int n) {
+   for (int i = 0; i < n; i++) c[i] = k * a[i];
+}
+
+template <typename Value>
+void matMultiply(Value *c, const Value *a, const Value *b, int rows, int inner, int cols) {
+   for (int i = 0; i < rows; i++) {
+      Value *row = c + (long long) i * cols;
+      for (int j = 0; j < cols; j++) row[j] = 0;
+      for (int k = 0; k < inner; k++) {
+         Value aik = a[(long long) i * inner + k];
+         const Value *brow = b + (long long) k * cols;
+         for (int j = 0; j < cols; j++) row[j] += aik * brow[j];
+      }
+   }
+}
+
+template <typename Value>
+Value matSum(const Value *a, int n) {
+   Value sum = 0;
+   for (int i = 0; i < n; i++) sum += a[i];
+   return sum;
+}
+
+template <typename Value>
+Value matDot(const Value *a, const Value *b, int n) {
+   Value sum = 0;
+   for (int i = 0; i < n; i++) sum += a[i] * b[i];
+   return sum;
+}
+
+#endif
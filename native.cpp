@@ -0,0 +1,227 @@
+/*
+ * File: native.cpp
+ * ----------------
+ * This file implements the registry of native functions and the
+ * built-in ones.
+ */
+
+#include <climits>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+#include "../StanfordCPPLib/error.h"
+#include "bigint.h"
+#include "native.h"
+
+using namespace std;
+
+/*
+ * Implementation notes: RND
+ * -------------------------
+ * The generator is splitmix64: one addition and three multiply-xorshift
+ * rounds per number, with a period of 2^64.  A number is scaled to the
+ * range by the high half of a 128-bit product, which needs no division.
+ * The state is the seed, so a checkpoint saves it as it is.
+ */
+
+static unsigned long long randomState = INITIAL_RANDOM_SEED;
+
+void seedRandom(unsigned long long seed) {
+   randomState = seed;
+}
+
+unsigned long long randomSeed() {
+   return randomState;
+}
+
+static unsigned long long nextRandom() {
+   unsigned long long z = (randomState += 0x9E3779B97F4A7C15ULL);
+   z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+   return z ^ (z >> 31);
+}
+
+/*
+ * Implementation notes: the built-in functions
+ * --------------------------------------------
+ * The functions are written once for every value type; where the
+ * types differ, an overload for each does the work.  SQR of an integer
+ * is the integer square root, found from the floating-point one and
+ * corrected, and for a BigInt by Newton's method from a power of ten
+ * above it.  MOD of doubles is fmod.
+ */
+
+static int squareRoot(int value) {
+   int root = (int) sqrt((double) value);
+   while ((long long) root * root > value) root--;
+   while ((long long) (root + 1) * (root + 1) <= value) root++;
+   return root;
+}
+
+static long long squareRoot(long long value) {
+   long long root = (long long) sqrtl((long double) value);
+   while (root > 0 && root > value / root) root--;
+   while (root + 1 <= value / (root + 1)) root++;
+   return root;
+}
+
+static double squareRoot(double value) {
+   return sqrt(value);
+}
+
+static BigInt squareRoot(const BigInt & value) {
+   if (value.isSmall()) return BigInt(squareRoot(value.toSmall()));
+   BigInt root;
+   BigInt::parse("1" + string(value.toString().size() / 2 + 1, '0'), root);
+   while (true) {
+      BigInt next = (root + value / root) / BigInt(2);
+      if (next >= root) return root;
+      root = next;
+   }
+}
+
+template <typename Value>
+static Value modulo(const Value & x, const Value & y) {
+   if (y == Value(-1)) return Value(0);
+   return x - (x / y) * y;
+}
+
+static double modulo(double x, double y) {
+   return fmod(x, y);
+}
+
+template <typename Value>
+static Value nativeAbs(const Value *args) {
+   return (args[0] < Value(0)) ? Value(0) - args[0] : args[0];
+}
+
+template <typename Value>
+static Value nativeMin(const Value *args) {
+   return (args[1] < args[0]) ? args[1] : args[0];
+}
+
+template <typename Value>
+static Value nativeMax(const Value *args) {
+   return (args[0] < args[1]) ? args[1] : args[0];
+}
+
+template <typename Value>
+static Value nativeMod(const Value *args) {
+   if (args[1] == Value(0)) error("DIVIDE BY ZERO");
+   return modulo(args[0], args[1]);
+}
+
+template <typename Value>
+static Value nativeSqr(const Value *args) {
+   if (args[0] < Value(0)) error("ILLEGAL FUNCTION CALL");
+   return squareRoot(args[0]);
+}
+
+template <typename Value>
+static Value nativeRnd(const Value *args) {
+   long long bound = ValueTraits<Value>::toInteger(args[0]);
+   if (bound <= 0) error("ILLEGAL FUNCTION CALL");
+   return Value((long long) (((unsigned __int128) nextRandom() * (unsigned long long) bound) >> 64));
+}
+
+/*
+ * Implementation notes: NativeRegistry
+ * ------------------------------------
+ * The table is a static local, so it is built, with the built-in
+ * functions, the first time it is used, whatever the order in which
+ * the files are initialized.
+ */
+
+template <typename Value>
+map<string, NativeFunction<Value> > & NativeRegistry<Value>::table() {
+   static map<string, NativeFunction<Value> > functions;
+   if (functions.empty()) {
+      NativeFunction<Value> builtins[] = {
+         { nativeAbs<Value>, 1 }, { nativeMin<Value>, 2 }, { nativeMax<Value>, 2 },
+         { nativeMod<Value>, 2 }, { nativeSqr<Value>, 1 }, { nativeRnd<Value>, 1 }
+      };
+      const char *names[] = { "ABS", "MIN", "MAX", "MOD", "SQR", "RND" };
+      for (int i = 0; i < 6; i++) functions[names[i]] = builtins[i];
+   }
+   return functions;
+}
+
+template <typename Value>
+void NativeRegistry<Value>::define(const string & name, int arity, Value (*function)(const Value *args)) {
+   if (arity < 0 || arity > MAX_NATIVE_ARGS) error("TOO MANY ARGUMENTS");
+   NativeFunction<Value> native = { function, arity };
+   table()[name] = native;
+}
+
+template <typename Value>
+const NativeFunction<Value> *NativeRegistry<Value>::find(const string & name) {
+   map<string, NativeFunction<Value> > & functions = table();
+   typename map<string, NativeFunction<Value> >::const_iterator it = functions.find(name);
+   return (it == functions.end()) ? NULL : &it->second;
+}
+
+/*
+ * Implementation notes: the NativeCallExp subclass
+ * ------------------------------------------------
+ * The parser has checked the number of arguments against the arity,
+ * so they fit in the array.
+ */
+
+template <typename Value>
+NativeCallExp<Value>::NativeCallExp(string name, Value (*function)(const Value *args), vector<Expression<Value> *> args)
+   :name(name), function(function), args(args) {}
+
+template <typename Value>
+NativeCallExp<Value>::~NativeCallExp() {
+   for (size_t i = 0; i < args.size(); i++) delete args[i];
+}
+
+template <typename Value>
+Value NativeCallExp<Value>::eval(EvalState<Value> & state) {
+   Value values[MAX_NATIVE_ARGS];
+   for (size_t i = 0; i < args.size(); i++) {
+      values[i] = args[i]->eval(state);
+   }
+   return function(values);
+}
+
+template <typename Value>
+string NativeCallExp<Value>::toString() {
+   string str = "FN " + name + "(";
+   for (size_t i = 0; i < args.size(); i++) {
+      if (i > 0) str += ", ";
+      str += args[i]->toString();
+   }
+   return str + ")";
+}
+
+template <typename Value>
+ExpressionType NativeCallExp<Value>::getType() {
+   return NATIVE;
+}
+
+template <typename Value>
+string NativeCallExp<Value>::getName() {
+   return name;
+}
+
+template <typename Value>
+Value (*NativeCallExp<Value>::getFunction())(const Value *args) {
+   return function;
+}
+
+template <typename Value>
+int NativeCallExp<Value>::getArgumentCount() {
+   return args.size();
+}
+
+template <typename Value>
+Expression<Value> *NativeCallExp<Value>::getArgument(int index) {
+   return args[index];
+}
+
+#define INSTANTIATE_NATIVE(Value) \
+   template class NativeRegistry<Value>; \
+   template class NativeCallExp<Value>;
+FOR_EACH_VALUE_TYPE(INSTANTIATE_NATIVE)
@@ -0,0 +1,148 @@
+/*
+ * File: native.h
+ * --------------
+ * This interface exports the registry of native functions, C++
+ * functions that BASIC expressions call as FN name(args), and the
+ * NativeCallExp node of such a call.
+ */
+
+#ifndef _native_h
+#define _native_h
+
+#include <map>
+#include <string>
+#include <vector>
+#include "evalstate.h"
+#include "exp.h"
+
+/*
+ * Constant: MAX_NATIVE_ARGS
+ * -------------------------
+ * The most arguments a native function can take.
+ */
+
+const int MAX_NATIVE_ARGS = 8;
+
+/*
+ * Type: NativeFunction
+ * --------------------
+ * A native function and the number of arguments it takes.  The
+ * function gets the values of the arguments in an array and returns
+ * its result; it reports an error with error(), like the interpreter.
+ */
+
+template <typename Value>
+struct NativeFunction {
+   Value (*function)(const Value *args);
+   int arity;
+};
+
+/*
+ * Class: NativeRegistry
+ * ---------------------
+ * The native functions, by name, for one value type.  The built-in
+ * functions are defined before anything else is looked up:
+ *
+ *    ABS(X)     the absolute value of X
+ *    MIN(X, Y)  the smaller of X and Y
+ *    MAX(X, Y)  the larger of X and Y
+ *    MOD(X, Y)  the remainder of X / Y, with the sign of X
+ *    SQR(X)     the square root of X, rounded down unless the values
+ *               are doubles
+ *    RND(N)     a pseudo-random integer from 0 to N - 1
+ *
+ * A program that embeds the interpreter adds its own functions with
+ * define before it parses any line that calls them.  A call is bound
+ * to its function when the line is parsed.
+ */
+
+template <typename Value>
+class NativeRegistry {
+
+public:
+
+/*
+ * Method: define
+ * Usage: NativeRegistry<Value>::define(name, arity, function);
+ * ------------------------------------------------------------
+ * Defines the native function name, or redefines it for the lines
+ * parsed from now on.  arity is at most MAX_NATIVE_ARGS.
+ */
+
+   static void define(const std::string & name, int arity, Value (*function)(const Value *args));
+
+/*
+ * Method: find
+ * Usage: const NativeFunction<Value> *native = NativeRegistry<Value>::find(name);
+ * -------------------------------------------------------------------------------
+ * Returns the native function name, or NULL if there is none.
+ */
+
+   static const NativeFunction<Value> *find(const std::string & name);
+
+private:
+
+   //the functions, with the built-in ones defined the first time
+   static std::map<std::string, NativeFunction<Value> > & table();
+
+};
+
+/*
+ * Functions: seedRandom, randomSeed
+ * Usage: seedRandom(seed);
+ *        unsigned long long seed = randomSeed();
+ * ----------------------------------------------
+ * seedRandom restarts the sequence of RND from the given seed, and
+ * randomSeed returns the seed that continues it from where it is.
+ * Every run starts the sequence from INITIAL_RANDOM_SEED, so it is the
+ * same in every run unless it is seeded.
+ */
+
+const unsigned long long INITIAL_RANDOM_SEED = 0x9E3779B97F4A7C15ULL;
+
+void seedRandom(unsigned long long seed);
+unsigned long long randomSeed();
+
+/*
+ * Class: NativeCallExp
+ * --------------------
+ * This subclass of Expression represents a call FN name(e1, e2) of a
+ * native function.  The call holds the pointer to the function, so
+ * evaluating it evaluates the arguments into an array on the stack
+ * and makes one indirect call.
+ */
+
+template <typename Value>
+class NativeCallExp : public Expression<Value> {
+
+public:
+
+   NativeCallExp(std::string name, Value (*function)(const Value *args), std::vector<Expression<Value> *> args);
+   virtual ~NativeCallExp();
+
+   virtual Value eval(EvalState<Value> & state);
+   virtual std::string toString();
+   virtual ExpressionType getType();
+
+/*
+ * Methods: getName, getFunction, getArgumentCount, getArgument
+ * Usage: Expression<Value> *arg = ((NativeCallExp<Value> *) exp)->getArgument(i);
+ * -------------------------------------------------------------------------------
+ * Return the name and the function called, and the arguments of the
+ * call.
+ */
+
+   std::string getName();
+   Value (*getFunction())(const Value *args);
+   int getArgumentCount();
+   Expression<Value> *getArgument(int index);
+
+private:
+
+   std::string name;
+   Value (*function)(const Value *args);
+   std::vector<Expression<Value> *> args;
+
+};
+
+#endif
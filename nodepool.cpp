@@ -0,0 +1,63 @@
+/*
+ * File: nodepool.cpp
+ * ------------------
+ * This file implements the node pool.
+ */
+
+#include <mutex>
+#include <new>
+#include "nodepool.h"
+
+using namespace std;
+
+/*
+ * Implementation notes: the node pool
+ * -----------------------------------
+ * There is a free list for each multiple of 8 bytes up to
+ * MAX_POOLED_NODE, linked through the first word of each free node.  An
+ * empty list is refilled by carving a new chunk into nodes of its size.
+ * Chunks are never returned, since a program that shrinks usually grows
+ * again; the storage of freed nodes is reused by later lines.
+ */
+
+static const size_t GRAIN = 8;
+static const size_t CHUNK_SIZE = 64 * 1024;
+static const size_t CLASSES = MAX_POOLED_NODE / GRAIN;
+
+struct FreeNode {
+   FreeNode *next;
+};
+
+static mutex poolLock;
+static FreeNode *freeLists[CLASSES];
+
+void *allocateNode(size_t size) {
+   if (size == 0 || size > MAX_POOLED_NODE) return ::operator new(size);
+   size_t k = (size - 1) / GRAIN;
+   lock_guard<mutex> guard(poolLock);
+   if (freeLists[k] == NULL) {
+      size_t nodeSize = (k + 1) * GRAIN;
+      char *chunk = (char *) ::operator new(CHUNK_SIZE);
+      for (size_t offset = 0; offset + nodeSize <= CHUNK_SIZE; offset += nodeSize) {
+         FreeNode *node = (FreeNode *) (chunk + offset);
+         node->next = freeLists[k];
+         freeLists[k] = node;
+      }
+   }
+   FreeNode *node = freeLists[k];
+   freeLists[k] = node->next;
+   return node;
+}
+
+void freeNode(void *node, size_t size) {
+   if (node == NULL) return;
+   if (size == 0 || size > MAX_POOLED_NODE) {
+      ::operator delete(node);
+      return;
+   }
+   size_t k = (size - 1) / GRAIN;
+   lock_guard<mutex> guard(poolLock);
+   FreeNode *free = (FreeNode *) node;
+   free->next = freeLists[k];
+   freeLists[k] = free;
+}
@@ -0,0 +1,33 @@
+/*
+ * File: nodepool.h
+ * ----------------
+ * This interface exports the node pool, from which the statements and
+ * expression nodes of a program are allocated, so that a program with
+ * millions of lines does not pay the header and rounding of the general
+ * allocator for every small node.
+ */
+
+#ifndef _nodepool_h
+#define _nodepool_h
+
+#include <cstddef>
+
+/*
+ * Functions: allocateNode, freeNode
+ * Usage: void *node = allocateNode(size);
+ *        freeNode(node, size);
+ * -------------------------------------
+ * Allocate and free a node of size bytes.  A node up to MAX_POOLED_NODE
+ * bytes comes from a chunk shared with other nodes of its size, rounded
+ * up to 8 bytes, and its storage is kept for the next node of that size
+ * when it is freed; a larger one comes from operator new.  freeNode must
+ * be given the size the node was allocated with.  Both may be called
+ * from any thread.
+ */
+
+const size_t MAX_POOLED_NODE = 256;
+
+void *allocateNode(size_t size);
+void freeNode(void *node, size_t size);
+
+#endif
@@ -0,0 +1,333 @@
+/*
+ * File: parallel.cpp
+ * ------------------
+ * This file implements the ParallelLoop class.
+ */
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include "parallel.h"
+#include "pool.h"
+#include "loop.h"
+#include "evalstate.h"
+#include "exp.h"
+#include "statement.h"
+#include "../StanfordCPPLib/error.h"
+using namespace std;
+
+/*
+ * Constant: CHUNKS_PER_WORKER
+ * ---------------------------
+ * The iterations are split into this many chunks per worker, so that
+ * there is work left to steal when the chunks take unequal time.
+ */
+
+static const int CHUNKS_PER_WORKER = 4;
+
+//true if names contains name
+static bool contains(const vector<string> & names, const string & name)
+{
+    return find(names.begin(), names.end(), name) != names.end();
+}
+
+/*
+ * Implementation notes: checkExp
+ * ------------------------------
+ * Collects the variables and the array elements an expression of the
+ * body reads, and checks that it cannot divide by zero, or overflow a
+ * division by dividing by -1.
+ */
+
+template <typename Value>
+static bool checkExp(Expression<Value> * exp, vector<string> & names, vector<ArrayExp<Value> *> & elements, string & reason)
+{
+    if (exp->getType() == IDENTIFIER){
+        names.push_back(((IdentifierExp<Value> *) exp)->getName());
+    }else if (exp->getType() == ARRAY){
+        ArrayExp<Value> * element = (ArrayExp<Value> *) exp;
+        elements.push_back(element);
+        if (!checkExp(element->getRow(), names, elements, reason)) return false;
+        if (element->getCol() != NULL && !checkExp(element->getCol(), names, elements, reason)) return false;
+    }else if (exp->getType() == COMPOUND){
+        CompoundExp<Value> * compound = (CompoundExp<Value> *) exp;
+        if (compound->getOp() == "/"){
+            Expression<Value> * divisor = compound->getRHS();
+            if (divisor->getType() != CONSTANT || ((ConstantExp<Value> *) divisor)->getValue() == 0
+                    || ((ConstantExp<Value> *) divisor)->getValue() == -1){
+                reason = "DIVIDES BY A VARIABLE";
+                return false;
+            }
+        }
+        if (!checkExp(compound->getLHS(), names, elements, reason)) return false;
+        if (!checkExp(compound->getRHS(), names, elements, reason)) return false;
+    }else if (exp->getType() == LENGTH){
+        reason = "READS A STRING";
+        return false;
+    }else if (exp->getType() == CALL || exp->getType() == NATIVE){
+        reason = "CALLS A FUNCTION";
+        return false;
+    }
+    return true;
+}
+
+//the amount a reduction LET S = S + e, S = e + S or S = S - e adds, or NULL
+template <typename Value>
+static Expression<Value> * readReduction(LetStatement<Value> * let)
+{
+    if (let->getExp()->getType() != COMPOUND) return NULL;
+    CompoundExp<Value> * exp = (CompoundExp<Value> *) let->getExp();
+    Expression<Value> * lhs = exp->getLHS();
+    Expression<Value> * rhs = exp->getRHS();
+    bool selfLeft = lhs->getType() == IDENTIFIER && ((IdentifierExp<Value> *) lhs)->getName() == let->getName();
+    bool selfRight = rhs->getType() == IDENTIFIER && ((IdentifierExp<Value> *) rhs)->getName() == let->getName();
+    if ((exp->getOp() == "+" || exp->getOp() == "-") && selfLeft) return rhs;
+    if (exp->getOp() == "+" && selfRight) return lhs;
+    return NULL;
+}
+
+template <typename Value>
+Statement<Value> *makeParallelLoop(ForStatement<Value> * stmt, vector<Statement<Value> *> & body, string & reason)
+{
+    if (!ValueTraits<Value>::INT32){
+        reason = "NEEDS 32-BIT INTEGERS";
+        return NULL;
+    }
+    string induction = stmt->getName();
+    const vector<string> & reductions = stmt->getReductions();
+    vector<string> names;
+    vector<ArrayExp<Value> *> elements;
+    vector<string> written;
+    for (size_t i = 0; i < body.size(); i++){
+        if (body[i] == NULL){
+            reason = "A LINE IS NOT PARSED YET";
+            return NULL;
+        }
+        StatementType type = body[i]->getType();
+        if (type == REM_STMT) continue;
+        if (type == LET_STMT){
+            LetStatement<Value> * let = (LetStatement<Value> *) body[i];
+            Expression<Value> * amount = readReduction(let);
+            if (!contains(reductions, let->getName()) || amount == NULL){
+                reason = "ASSIGNS " + let->getName();
+                return NULL;
+            }
+            if (!checkExp(amount, names, elements, reason)) return NULL;
+        }else if (type == ARRAY_LET_STMT){
+            ArrayLetStatement<Value> * let = (ArrayLetStatement<Value> *) body[i];
+            written.push_back(let->getTarget()->getName());
+            if (!checkExp(let->getTarget(), names, elements, reason)) return NULL;
+            if (!checkExp(let->getExp(), names, elements, reason)) return NULL;
+        }else{
+            string text = body[i]->toString();
+            reason = "CONTAINS " + text.substr(0, text.find(' '));
+            return NULL;
+        }
+    }
+    for (size_t i = 0; i < names.size(); i++){
+        if (contains(reductions, names[i])){
+            reason = "READS " + names[i];
+            return NULL;
+        }
+    }
+    for (size_t i = 0; i < elements.size(); i++){
+        bool usesInduction;
+        int offset;
+        string name = elements[i]->getName();
+        bool affine = readAffine(elements[i]->getRow(), induction, usesInduction, offset);
+        if (affine && contains(written, name) && !(usesInduction && offset == 0)){
+            reason = "ITERATIONS SHARE ELEMENTS OF " + name;
+            return NULL;
+        }
+        if (affine && elements[i]->getCol() != NULL){
+            affine = readAffine(elements[i]->getCol(), induction, usesInduction, offset);
+        }
+        if (!affine){
+            reason = "SUBSCRIPT OF " + name + " IS NOT " + induction + " PLUS A CONSTANT";
+            return NULL;
+        }
+    }
+    return new ParallelLoop<Value>(stmt, body);
+}
+
+/* Implementation of the ParallelLoop class */
+
+template <typename Value>
+ParallelLoop<Value>::ParallelLoop(ForStatement<Value> * init_loop, vector<Statement<Value> *> init_body)
+    :loop(init_loop), body(init_body)
+{
+    induction = loop->getName();
+    reductions = loop->getReductions();
+    vector<string> names;
+    vector<ArrayExp<Value> *> elements;
+    string reason;
+    for (size_t i = 0; i < body.size(); i++){
+        if (body[i]->getType() == LET_STMT){
+            checkExp(readReduction((LetStatement<Value> *) body[i]), names, elements, reason);
+        }else if (body[i]->getType() == ARRAY_LET_STMT){
+            checkExp(((ArrayLetStatement<Value> *) body[i])->getTarget(), names, elements, reason);
+            checkExp(((ArrayLetStatement<Value> *) body[i])->getExp(), names, elements, reason);
+        }
+    }
+    for (size_t i = 0; i < names.size(); i++){
+        if (names[i] != induction && !contains(reads, names[i])) reads.push_back(names[i]);
+    }
+    for (size_t i = 0; i < elements.size(); i++){
+        Access access;
+        access.element = elements[i];
+        access.colInduction = false;
+        access.colOffset = 0;
+        readAffine(elements[i]->getRow(), induction, access.rowInduction, access.rowOffset);
+        if (elements[i]->getCol() != NULL){
+            readAffine(elements[i]->getCol(), induction, access.colInduction, access.colOffset);
+        }
+        accesses.push_back(access);
+    }
+}
+
+template <typename Value>
+ParallelLoop<Value>::~ParallelLoop()
+{
+    /* Empty */
+}
+
+//true if every subscript from lo + offset to hi + offset is below extent
+static bool inRange(bool usesInduction, int offset, long long lo, long long hi, int extent)
+{
+    if (!usesInduction) return offset >= 0 && offset < extent;
+    return lo + offset >= 0 && hi + offset < extent;
+}
+
+//true if every element the body accesses exists while I runs from first to last
+template <typename Value>
+bool ParallelLoop<Value>::inBounds(EvalState<Value> & state, long long first, long long last)
+{
+    long long lo = min(first, last);
+    long long hi = max(first, last);
+    for (size_t i = 0; i < accesses.size(); i++){
+        Access & access = accesses[i];
+        ArrayValue<Value> * array = state.getArray(access.element->getSlot());
+        if (array == NULL) return false;
+        if ((access.element->getCol() == NULL) != (array->cols == 0)) return false;
+        if (!inRange(access.rowInduction, access.rowOffset, lo, hi, array->rows)) return false;
+        if (access.element->getCol() != NULL
+                && !inRange(access.colInduction, access.colOffset, lo, hi, array->cols)) return false;
+    }
+    return true;
+}
+
+/*
+ * Implementation notes: execute
+ * -----------------------------
+ * The limit and step are evaluated once, as by FOR, and evaluating
+ * them again for the serial loop gives the same values, since
+ * expressions have no side effects.  Running the FOR statement itself
+ * pushes a loop frame, which also drops the frames of enclosing loops
+ * over the same variable; the parallel loop pushes and pops one to do
+ * the same.
+ */
+
+template <typename Value>
+void ParallelLoop<Value>::execute(EvalState<Value> & state)
+{
+    int first = ValueTraits<Value>::toInteger(loop->getFrom()->eval(state));
+    int limit = ValueTraits<Value>::toInteger(loop->getTo()->eval(state));
+    int step = (loop->getStep() == NULL) ? 1 : ValueTraits<Value>::toInteger(loop->getStep()->eval(state));
+    long long trips = 0;
+    if (step > 0 && first <= limit) trips = ((long long) limit - first) / step + 1;
+    if (step < 0 && first >= limit) trips = ((long long) first - limit) / -(long long) step + 1;
+    bool ready = trips > 0 && inBounds(state, first, first + (trips - 1) * step);
+    for (size_t i = 0; ready && i < reads.size(); i++){
+        ready = state.isDefined(reads[i]);
+    }
+    for (size_t i = 0; ready && i < reductions.size(); i++){
+        ready = state.isDefined(reductions[i]);
+    }
+    if (!ready){
+        loop->execute(state);
+        return;
+    }
+
+    WorkPool & pool = WorkPool::shared();
+    int workers = pool.getWorkers();
+    int chunks = (int) min(trips, (long long) workers * CHUNKS_PER_WORKER);
+    EvalState<Value> * views = new EvalState<Value>[workers];
+    for (int w = 0; w < workers; w++){
+        views[w].makeView(state);
+    }
+    vector<Value> partials(chunks * reductions.size());
+    mutex lock;
+    string failure;
+    pool.run(chunks, [&](int chunk, int worker){
+        try {
+            runChunk(views[worker], chunk, chunks, first, trips, step, partials);
+        } catch (ErrorException & ex) {
+            lock_guard<mutex> guard(lock);
+            if (failure.empty()) failure = ex.getMessage();
+        }
+    });
+    delete[] views;
+    if (!failure.empty()) error(failure);
+
+    for (size_t r = 0; r < reductions.size(); r++){
+        unsigned int sum = ValueTraits<Value>::toInteger(state.getValue(reductions[r]));
+        for (int c = 0; c < chunks; c++){
+            sum += (unsigned int) ValueTraits<Value>::toInteger(partials[c * reductions.size() + r]);
+        }
+        state.setValue(reductions[r], (int) sum);
+    }
+    LoopFrame<Value> frame;
+    frame.var = state.getReference(induction);
+    frame.limit = limit;
+    frame.step = step;
+    frame.body = EvalState<Value>::HALT;
+    frame.name = &induction;
+    frame.clocks = state.getClocks(induction);
+    state.pushLoop(frame);
+    state.popLoop();
+    *frame.var = (int) (first + trips * step);
+    state.nextEpoch(frame.clocks);
+    state.setPC(loop->getExit());
+}
+
+//run the iterations of a chunk on a view, summing its part of each reduction
+template <typename Value>
+void ParallelLoop<Value>::runChunk(EvalState<Value> & view, int chunk, int chunks, long long first, long long trips,
+                            int step, vector<Value> & partials)
+{
+    long long begin = trips * chunk / chunks;
+    long long end = trips * (chunk + 1) / chunks;
+    Value * var = view.getReference(induction);
+    vector<Value *> sums(reductions.size());
+    for (size_t r = 0; r < reductions.size(); r++){
+        sums[r] = view.getReference(reductions[r]);
+        *sums[r] = 0;
+    }
+    for (long long k = begin; k < end; k++){
+        *var = (int) (first + k * step);
+        for (size_t i = 0; i < body.size(); i++){
+            body[i]->execute(view);
+        }
+    }
+    for (size_t r = 0; r < reductions.size(); r++){
+        partials[chunk * reductions.size() + r] = *sums[r];
+    }
+}
+
+template <typename Value>
+StatementType ParallelLoop<Value>::getType()
+{
+    return FOR_STMT;
+}
+
+template <typename Value>
+string ParallelLoop<Value>::toString()
+{
+    return loop->toString();
+}
+
+#define INSTANTIATE_PARALLEL(Value) \
+    template class ParallelLoop<Value>; \
+    template Statement<Value> *makeParallelLoop<Value>(ForStatement<Value> * stmt, vector<Statement<Value> *> & body, string & reason);
+FOR_EACH_VALUE_TYPE(INSTANTIATE_PARALLEL)
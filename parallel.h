@@ -0,0 +1,116 @@
+/*
+ * File: parallel.h
+ * ----------------
+ * This interface exports the ParallelLoop class, which runs the
+ * iterations of a PARALLEL FOR on the threads of a WorkPool.
+ */
+
+#ifndef _parallel_h
+#define _parallel_h
+
+#include <string>
+#include <vector>
+#include "evalstate.h"
+#include "exp.h"
+#include "statement.h"
+
+/*
+ * Class: ParallelLoop
+ * -------------------
+ * A ParallelLoop stands in for the line of a PARALLEL FOR whose
+ * iterations are independent: the body only assigns array elements
+ * subscripted by the loop variable, in the first subscript, and adds
+ * to the declared reduction variables.  It runs the iterations in
+ * chunks on the shared WorkPool, each worker with its own view of the
+ * state, then jumps past the NEXT with the variables set as the serial
+ * loop would leave them.
+ *
+ * Before that, it checks that no iteration can fail: every variable
+ * the body reads is defined and every subscript stays in bounds over
+ * the whole loop.  Otherwise, or when the loop runs zero times, it
+ * runs the FOR serially, so errors are raised as before.
+ *
+ * Each chunk sums its own part of each reduction, and the parts are
+ * added in chunk order.  Since the additions wrap around, the result
+ * is that of the serial loop whatever the schedule.
+ */
+
+template <typename Value>
+class ParallelLoop : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: ParallelLoop
+ * ----------------------
+ * The constructor initializes a loop from its FOR statement and the
+ * statements of the lines between the FOR and its NEXT, which must
+ * have passed the check of makeParallelLoop.  The statements are not
+ * owned.
+ */
+
+   ParallelLoop(ForStatement<Value> * init_loop, std::vector<Statement<Value> *> init_body);
+
+/*
+ * Destructor: ~ParallelLoop
+ * Usage: delete loop;
+ * -------------------
+ * The destructor deallocates the storage for this loop, but not for the
+ * statements it runs.
+ */
+
+   virtual ~ParallelLoop();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  run the iterations in parallel, or the FOR serially
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+    private:
+        //an array element of the body with subscripts I + offset or offset
+        struct Access {
+            ArrayExp<Value> * element;
+            bool rowInduction;
+            int rowOffset;
+            bool colInduction;
+            int colOffset;
+        };
+
+        bool inBounds(EvalState<Value> & state, long long first, long long last);
+        void runChunk(EvalState<Value> & view, int chunk, int chunks, long long first, long long trips,
+                      int step, std::vector<Value> & partials);
+
+        ForStatement<Value> * loop;
+        std::vector<Statement<Value> *> body;
+        std::string induction;
+        std::vector<std::string> reductions;
+        std::vector<std::string> reads;      //the other variables read
+        std::vector<Access> accesses;
+};
+
+/*
+ * Function: makeParallelLoop
+ * Usage: Statement<Value> *loop = makeParallelLoop(stmt, body, reason);
+ * ---------------------------------------------------------------------
+ * Returns a new ParallelLoop if the iterations of the PARALLEL FOR
+ * stmt over the statements of body are independent.  Otherwise it
+ * returns NULL and sets reason to why they are not.  The body may only
+ * contain REM lines, LET lines of the form S = S + e or S = S - e
+ * for a reduction variable S, and assignments to array elements.  All
+ * subscripts must be the loop variable plus a constant, or constant;
+ * an array the body assigns must be subscripted by the loop variable
+ * itself, in its first subscript, everywhere in the body.  Reduction
+ * variables may not be read otherwise, and a division must be by a
+ * constant other than 0 and -1.  The reductions are split modulo 2^32,
+ * so the values must be 32-bit integers.
+ */
+
+template <typename Value>
+Statement<Value> *makeParallelLoop(ForStatement<Value> * stmt, std::vector<Statement<Value> *> & body, std::string & reason);
+
+#endif
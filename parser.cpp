@@ -4,12 +4,19 @@
  * Implements the parser.h interface.
  */
 
+#include <climits>
 #include <iostream>
 #include <string>
+#include <vector>
 
+#include "data.h"
 #include "exp.h"
+#include "fileio.h"
+#include "function.h"
+#include "native.h"
 #include "parser.h"
 #include "statement.h"
+#include "strexp.h"
 #include "utility.h"
 
 #include "../StanfordCPPLib/error.h"
@@ -19,14 +26,29 @@
 
 using namespace std;
 
+/*
+ * Implementation notes: setupScanner
+ * ----------------------------------
+ * $ is a word character, so that a string variable A$ and the string
+ * functions such as LEFT$ are single words.
+ */
+
+void setupScanner(TokenScanner & scanner) {
+   scanner.ignoreWhitespace();
+   scanner.scanNumbers();
+   scanner.scanStrings();
+   scanner.addWordCharacters("$");
+}
+
 /*
  * Implementation notes: parseExp
  * ------------------------------
  * This code just reads an expression.
  */
 
-Expression *parseExp(TokenScanner & scanner) {
-   Expression *exp = readE(scanner);
+template <typename Value>
+Expression<Value> *parseExp(TokenScanner & scanner) {
+   Expression<Value> *exp = readE<Value>(scanner);
    return exp;
 }
 
@@ -37,16 +59,40 @@ bool is_keyword(string id)
     if (id == "QUIT") return true;
     if (id == "LIST") return true;
     if (id == "RUN") return true;
+    if (id == "LINK") return true;
+    if (id == "CHECK") return true;
     if (id == "CLEAR") return true;
     if (id == "HELP") return true;
     if (id == "IF") return true;
     if (id == "THEN") return true;
     if (id == "GOTO") return true;
+    if (id == "ON") return true;
     if (id == "REM") return true;
     if (id == "LET") return true;
     if (id == "PRINT") return true;
     if (id == "INPUT") return true;
     if (id == "END") return true;
+    if (id == "DIM") return true;
+    if (id == "FOR") return true;
+    if (id == "TO") return true;
+    if (id == "STEP") return true;
+    if (id == "NEXT") return true;
+    if (id == "GOSUB") return true;
+    if (id == "RETURN") return true;
+    if (id == "MAT") return true;
+    if (id == "PARALLEL") return true;
+    if (id == "REDUCE") return true;
+    if (id == "DEF") return true;
+    if (id == "FN") return true;
+    if (id == "DATA") return true;
+    if (id == "READ") return true;
+    if (id == "RESTORE") return true;
+    if (id == "OPEN") return true;
+    if (id == "CLOSE") return true;
+    if (id == "LEN") return true;
+    if (id == "MID$") return true;
+    if (id == "LEFT$") return true;
+    if (id == "RIGHT$") return true;
     return false;
 }
 
@@ -59,36 +105,147 @@ bool is_keyword(string id)
  * subexpressions until it finds an operator whose precedence is greater
  * than the prevailing one.  When a higher-precedence operator is found,
  * readE calls itself recursively to read in that subexpression as a unit.
+ * The operands of an operator are interned, so equal subexpressions of
+ * the whole program share one node; the expression read is not.
  */
 
-Expression *readE(TokenScanner & scanner, int prec) {
-   Expression *exp = readT(scanner);
+//whether the operands read are interned: only in the numeric
+//expressions of program lines outside DEF, all of which the
+//definite-assignment analysis sees, since a read it marks unchecked
+//is unchecked wherever the node is shared; each entry point sets it
+static bool interning = false;
+
+template <typename Value>
+Expression<Value> *readE(TokenScanner & scanner, int prec) {
+   Expression<Value> *exp = readT<Value>(scanner);
    string token;
    while (true) {
       token = scanner.nextToken();
       int newPrec = precedence(token);
       if (newPrec <= prec) break;
-      Expression *rhs = readE(scanner, newPrec);
-      exp = new CompoundExp(token, exp, rhs);
+      Expression<Value> *rhs = readE<Value>(scanner, newPrec);
+      if (interning) {
+         exp = new CompoundExp<Value>(token, Expression<Value>::intern(exp), Expression<Value>::intern(rhs));
+      } else {
+         exp = new CompoundExp<Value>(token, exp, rhs);
+      }
    }
    scanner.saveToken(token);
    return exp;
 }
 
+/*
+ * Implementation notes: readSubscripts
+ * ------------------------------------
+ * Reads the subscripts of an array after its name, "(E)" or "(E, E)".
+ * col is set to NULL when there is only one.
+ */
+
+template <typename Value>
+void readSubscripts(TokenScanner & scanner, Expression<Value> * & row, Expression<Value> * & col) {
+   if (scanner.nextToken() != "(") error("SYNTAX ERROR");
+   row = readE<Value>(scanner);
+   col = NULL;
+   string token = scanner.nextToken();
+   if (token == ",") {
+      col = readE<Value>(scanner);
+      token = scanner.nextToken();
+   }
+   if (token != ")") error("SYNTAX ERROR");
+}
+
+//read an array element after the array name
+template <typename Value>
+ArrayExp<Value> *readElement(TokenScanner & scanner, string name) {
+   Expression<Value> *row, *col;
+   readSubscripts<Value>(scanner, row, col);
+   return new ArrayExp<Value>(name, row, col);
+}
+
+//the parameters of the function whose body is being read, or NULL
+static const vector<string> *parameters = NULL;
+
+//read the arguments of a function call, "(E, E, ...)" or "()"
+template <typename Value>
+vector<Expression<Value> *> readArguments(TokenScanner & scanner) {
+   vector<Expression<Value> *> args;
+   if (scanner.nextToken() != "(") error("SYNTAX ERROR");
+   string token = scanner.nextToken();
+   if (token != ")") {
+      scanner.saveToken(token);
+      do {
+         args.push_back(readE<Value>(scanner));
+      } while ((token = scanner.nextToken()) == ",");
+      if (token != ")") error("SYNTAX ERROR");
+   }
+   return args;
+}
+
+/*
+ * Implementation notes: readNativeCall
+ * ------------------------------------
+ * Reads FN name(args) after the FN.  A native function is bound here,
+ * once; any other name is the DEF FN function FNname, resolved when
+ * the program runs.
+ */
+
+template <typename Value>
+Expression<Value> *readNativeCall(TokenScanner & scanner) {
+   string name = scanner.nextToken();
+   if (scanner.getTokenType(name) != WORD || is_keyword(name) || name.find('$') != string::npos) {
+      error("SYNTAX ERROR");
+   }
+   vector<Expression<Value> *> args = readArguments<Value>(scanner);
+   const NativeFunction<Value> *native = NativeRegistry<Value>::find(name);
+   if (native == NULL) return new CallExp<Value>("FN" + name, args);
+   if ((int) args.size() != native->arity) {
+      for (size_t i = 0; i < args.size(); i++) delete args[i];
+      error("WRONG NUMBER OF ARGUMENTS");
+   }
+   return new NativeCallExp<Value>(name, native->function, args);
+}
+
 /*
  * Implementation notes: readT
  * ---------------------------
  * This function scans a term, which is either an integer, an identifier,
- * or a parenthesized subexpression.
+ * an array element, a function call, a native function call, the
+ * length of a string, or a parenthesized subexpression.  In the body of a function, the names of
+ * its parameters are parameters rather than variables.
  */
 
-Expression *readT(TokenScanner & scanner) {
+template <typename Value>
+Expression<Value> *readT(TokenScanner & scanner) {
    string token = scanner.nextToken();
    TokenType type = scanner.getTokenType(token);
-   if (type == NUMBER) return new ConstantExp(str2int(token));
-   if (type == WORD && !is_keyword(token)) return new IdentifierExp(token);
+   if (type == NUMBER){
+      Value value;
+      if (!ValueTraits<Value>::parse(token, value)) error("SYNTAX ERROR");
+      return new ConstantExp<Value>(value);
+   }
+   if (token == "FN") return readNativeCall<Value>(scanner);
+   if (token == "LEN") {
+      if (scanner.nextToken() != "(") error("SYNTAX ERROR");
+      StringExp<Value> *source = parseStringExp<Value>(scanner);
+      if (scanner.nextToken() != ")") error("SYNTAX ERROR");
+      return new LengthExp<Value>(source);
+   }
+   if (type == WORD && !is_keyword(token) && token.find('$') == string::npos) {
+      string next = scanner.nextToken();
+      scanner.saveToken(next);
+      if (next == "(" && token.size() > 2 && token.compare(0, 2, "FN") == 0) {
+         return new CallExp<Value>(token, readArguments<Value>(scanner));
+      }
+      if (next == "(") return readElement<Value>(scanner, token);
+      if (parameters != NULL) {
+         for (size_t i = 0; i < parameters->size(); i++) {
+            if ((*parameters)[i] == token) return new ParameterExp<Value>(token, i);
+         }
+      }
+      return new IdentifierExp<Value>(token);
+   }
    if (token != "(") error("SYNTAX ERROR");
-   Expression *exp = readE(scanner);
+   Expression<Value> *exp = readE<Value>(scanner);
    if (scanner.nextToken() != ")") {
       error("SYNTAX ERROR");
    }
@@ -109,13 +266,80 @@ int precedence(string token) {
    return 0;
 }
 
+//true if token names a string variable: a word that is not a keyword
+//and ends with its only $
+bool isStringName(TokenScanner & scanner, string token)
+{
+    return scanner.getTokenType(token) == WORD && !is_keyword(token) && token.size() > 1
+        && token.find('$') == token.size() - 1;
+}
+
+//true if the next token starts a string expression
+bool startsString(TokenScanner & scanner)
+{
+    string token = scanner.nextToken();
+    scanner.saveToken(token);
+    return scanner.getTokenType(token) == STRING || isStringName(scanner, token)
+        || token == "LEFT$" || token == "RIGHT$" || token == "MID$";
+}
+
+/*
+ * Implementation notes: readStringT
+ * ---------------------------------
+ * This function scans a string term, which is either a literal, a
+ * string variable, or LEFT$, RIGHT$ or MID$ of a string expression.
+ */
+
+template <typename Value>
+StringExp<Value> *readStringT(TokenScanner & scanner) {
+   string token = scanner.nextToken();
+   if (scanner.getTokenType(token) == STRING) {
+      return new StringLiteralExp<Value>(scanner.getStringValue(token));
+   }
+   if (isStringName(scanner, token)) return new StringVariableExp<Value>(token);
+   if (token != "LEFT$" && token != "RIGHT$" && token != "MID$") error("SYNTAX ERROR");
+   if (scanner.nextToken() != "(") error("SYNTAX ERROR");
+   StringExp<Value> *source = parseStringExp<Value>(scanner);
+   if (scanner.nextToken() != ",") error("SYNTAX ERROR");
+   Expression<Value> *first = readE<Value>(scanner);
+   Expression<Value> *second = NULL;
+   string next = scanner.nextToken();
+   if (token == "MID$" && next == ",") {
+      second = readE<Value>(scanner);
+      next = scanner.nextToken();
+   }
+   if (next != ")") error("SYNTAX ERROR");
+   return new SubstringExp<Value>(token, source, first, second);
+}
+
+/*
+ * Implementation notes: parseStringExp
+ * ------------------------------------
+ * The only string operator is +, so a string expression is a chain of
+ * terms joined from the left.
+ */
+
+template <typename Value>
+StringExp<Value> *parseStringExp(TokenScanner & scanner) {
+   bool saved = interning;
+   interning = false;
+   StringExp<Value> *exp = readStringT<Value>(scanner);
+   string token;
+   while ((token = scanner.nextToken()) == "+") {
+      exp = new ConcatExp<Value>(exp, readStringT<Value>(scanner));
+   }
+   scanner.saveToken(token);
+   interning = saved;
+   return exp;
+}
+
 //read a name
 string parseName(TokenScanner & scanner)
 {
     if (!scanner.hasMoreTokens())
         error("SYNTAX ERROR");
     string token = scanner.nextToken();
-    if ((scanner.getTokenType(token) != WORD) || is_keyword(token)){
+    if ((scanner.getTokenType(token) != WORD) || is_keyword(token) || token.find('$') != string::npos){
         error("SYNTAX ERROR");
     }
     return token;
@@ -138,42 +362,221 @@ LineNumber * parseLineNumber(TokenScanner & scanner)
 }
 
 //read a bool expression
-BoolExp * parseBoolExp(TokenScanner & scanner)
+template <typename Value>
+BoolExp<Value> * parseBoolExp(TokenScanner & scanner)
 {
-    Expression * lhs = parseExp(scanner);
+    Expression<Value> * lhs = parseExp<Value>(scanner);
     if (!scanner.hasMoreTokens())
         error("SYNTAX ERROR");
     string token = scanner.nextToken();
     if (token == "=" || token == ">" || token == "<"){
-        Expression * rhs = parseExp(scanner);
-        BoolExp * res = new BoolExp(token, lhs, rhs);
+        Expression<Value> * rhs = parseExp<Value>(scanner);
+        BoolExp<Value> * res = new BoolExp<Value>(token, lhs, rhs);
         return res;
     }
     error("SYNTAX ERROR");
 }
 
+//read a let statement of a string variable (after the let keyword)
+template <typename Value>
+StringLetStatement<Value> * parseStringLet(TokenScanner & scanner)
+{
+    string name = scanner.nextToken();
+    if (scanner.nextToken() != "="){
+        error("SYNTAX ERROR");
+    }
+    StringExp<Value> * exp = parseStringExp<Value>(scanner);
+    if (scanner.hasMoreTokens()){
+        error("SYNTAX ERROR");
+    }
+    return new StringLetStatement<Value>(name, exp);
+}
+
 //read a let statement (after the let keyword)
-LetStatement * parseLet(TokenScanner & scanner)
+template <typename Value>
+Statement<Value> * parseLet(TokenScanner & scanner)
 {
+    string first = scanner.nextToken();
+    scanner.saveToken(first);
+    if (isStringName(scanner, first)) return parseStringLet<Value>(scanner);
     string name = parseName(scanner);
     if (!scanner.hasMoreTokens())
         error("SYNTAX ERROR");
     string token = scanner.nextToken();
+    ArrayExp<Value> * target = NULL;
+    if (token == "("){
+        scanner.saveToken(token);
+        target = readElement<Value>(scanner, name);
+        token = scanner.nextToken();
+    }
     if (token != "="){
         error("SYNTAX ERROR");
     }
-    Expression * exp = parseExp(scanner);
+    Expression<Value> * exp = parseExp<Value>(scanner);
     if (scanner.hasMoreTokens()){
         error("SYNTAX ERROR");
     }
-    LetStatement * stmt = new LetStatement(name, exp);
+    if (target != NULL){
+        return new ArrayLetStatement<Value>(target, exp);
+    }
+    LetStatement<Value> * stmt = new LetStatement<Value>(name, exp);
     return stmt;
 }
 
+//read a dim statement (after the dim keyword)
+template <typename Value>
+DimStatement<Value> * parseDim(TokenScanner & scanner)
+{
+    DimStatement<Value> * stmt = new DimStatement<Value>;
+    string token;
+    do {
+        string name = parseName(scanner);
+        Expression<Value> * rows;
+        Expression<Value> * cols;
+        readSubscripts<Value>(scanner, rows, cols);
+        stmt->addArray(name, rows, cols);
+        token = scanner.nextToken();
+    } while (token == ",");
+    if (token != ""){
+        error("SYNTAX ERROR");
+    }
+    return stmt;
+}
+
+//read a for statement (after the for keyword), with the REDUCE clause of
+//a parallel one
+template <typename Value>
+ForStatement<Value> * parseFor(TokenScanner & scanner, bool parallel)
+{
+    string name = parseName(scanner);
+    if (scanner.nextToken() != "="){
+        error("SYNTAX ERROR");
+    }
+    Expression<Value> * from = parseExp<Value>(scanner);
+    if (scanner.nextToken() != "TO"){
+        error("SYNTAX ERROR");
+    }
+    Expression<Value> * to = parseExp<Value>(scanner);
+    Expression<Value> * step = NULL;
+    string token = scanner.nextToken();
+    if (token == "STEP"){
+        step = parseExp<Value>(scanner);
+        token = scanner.nextToken();
+    }
+    vector<string> reductions;
+    if (parallel && token == "REDUCE"){
+        do {
+            string reduction = parseName(scanner);
+            if (reduction == name){
+                error("SYNTAX ERROR");
+            }
+            reductions.push_back(reduction);
+            token = scanner.nextToken();
+        } while (token == ",");
+    }
+    if (token != ""){
+        error("SYNTAX ERROR");
+    }
+    ForStatement<Value> * stmt = new ForStatement<Value>(name, from, to, step);
+    if (parallel) stmt->setParallel(reductions);
+    return stmt;
+}
+
+//read a parallel for statement (after the parallel keyword)
+template <typename Value>
+ForStatement<Value> * parseParallelFor(TokenScanner & scanner)
+{
+    if (scanner.nextToken() != "FOR"){
+        error("SYNTAX ERROR");
+    }
+    return parseFor<Value>(scanner, true);
+}
+
+//read a next statement (after the next keyword)
+template <typename Value>
+NextStatement<Value> * parseNext(TokenScanner & scanner)
+{
+    string name;
+    if (scanner.hasMoreTokens()){
+        name = parseName(scanner);
+    }
+    if (scanner.hasMoreTokens()){
+        error("SYNTAX ERROR");
+    }
+    NextStatement<Value> * stmt = new NextStatement<Value>(name);
+    return stmt;
+}
+
+/*
+ * Implementation notes: parseMat
+ * ------------------------------
+ * SUM and DOT are not keywords, so that they can still name variables
+ * and arrays; they start the MAT SUM and MAT DOT forms only when a
+ * name follows them.
+ */
+
+template <typename Value>
+MatStatement<Value> * parseMat(TokenScanner & scanner)
+{
+    string target = parseName(scanner);
+    string token = scanner.nextToken();
+    if ((target == "SUM" || target == "DOT") && scanner.getTokenType(token) == WORD){
+        scanner.saveToken(token);
+        string var = parseName(scanner);
+        if (scanner.nextToken() != "="){
+            error("SYNTAX ERROR");
+        }
+        string a = parseName(scanner);
+        string b;
+        if (target == "DOT"){
+            if (scanner.nextToken() != ","){
+                error("SYNTAX ERROR");
+            }
+            b = parseName(scanner);
+        }
+        if (scanner.hasMoreTokens()){
+            error("SYNTAX ERROR");
+        }
+        return new MatStatement<Value>((target == "SUM") ? MAT_SUM : MAT_DOT, var, a, b, NULL);
+    }
+    if (token != "="){
+        error("SYNTAX ERROR");
+    }
+    token = scanner.nextToken();
+    if (token == "("){
+        Expression<Value> * factor = parseExp<Value>(scanner);
+        if (scanner.nextToken() != ")" || scanner.nextToken() != "*"){
+            error("SYNTAX ERROR");
+        }
+        string a = parseName(scanner);
+        if (scanner.hasMoreTokens()){
+            error("SYNTAX ERROR");
+        }
+        return new MatStatement<Value>(MAT_SCALE, target, a, "", factor);
+    }
+    scanner.saveToken(token);
+    string a = parseName(scanner);
+    token = scanner.nextToken();
+    if (token == ""){
+        return new MatStatement<Value>(MAT_COPY, target, a, "", NULL);
+    }
+    MatOp op;
+    if (token == "+") op = MAT_ADD;
+    else if (token == "-") op = MAT_SUBTRACT;
+    else if (token == "*") op = MAT_MULTIPLY;
+    else error("SYNTAX ERROR");
+    string b = parseName(scanner);
+    if (scanner.hasMoreTokens()){
+        error("SYNTAX ERROR");
+    }
+    return new MatStatement<Value>(op, target, a, b, NULL);
+}
+
 //read a if statement (after the if keyword)
-IfStatement * parseIf(TokenScanner & scanner)
+template <typename Value>
+IfStatement<Value> * parseIf(TokenScanner & scanner)
 {
-    BoolExp * exp = parseBoolExp(scanner);
+    BoolExp<Value> * exp = parseBoolExp<Value>(scanner);
     if (!scanner.hasMoreTokens())
         error("SYNTAX ERROR");
     string token = scanner.nextToken();
@@ -184,84 +587,404 @@ IfStatement * parseIf(TokenScanner & scanner)
     if (scanner.hasMoreTokens()){
         error("SYNTAX ERROR");
     }
-    IfStatement * stmt = new IfStatement(exp, ln);
+    IfStatement<Value> * stmt = new IfStatement<Value>(exp, ln);
     return stmt;
 }
 
+//read a channel #n, with n from 1 to MAX_FILES
+int parseChannel(TokenScanner & scanner)
+{
+    if (scanner.nextToken() != "#") error("SYNTAX ERROR");
+    string token = scanner.nextToken();
+    if (scanner.getTokenType(token) != NUMBER) error("SYNTAX ERROR");
+    int channel = str2int(token);
+    if (channel < 1 || channel > MAX_FILES) error("SYNTAX ERROR");
+    return channel;
+}
+
+//read an open statement (after the open keyword):
+//OPEN path FOR INPUT AS #n or OPEN path FOR OUTPUT AS #n
+template <typename Value>
+OpenStatement<Value> * parseOpen(TokenScanner & scanner)
+{
+    if (!startsString(scanner)) error("SYNTAX ERROR");
+    StringExp<Value> * path = parseStringExp<Value>(scanner);
+    if (scanner.nextToken() != "FOR") error("SYNTAX ERROR");
+    string mode = scanner.nextToken();
+    if (mode != "INPUT" && mode != "OUTPUT") error("SYNTAX ERROR");
+    if (scanner.nextToken() != "AS") error("SYNTAX ERROR");
+    int channel = parseChannel(scanner);
+    if (scanner.hasMoreTokens()){
+        error("SYNTAX ERROR");
+    }
+    return new OpenStatement<Value>(path, mode == "OUTPUT", channel);
+}
+
+//read a close statement (after the close keyword)
+template <typename Value>
+CloseStatement<Value> * parseClose(TokenScanner & scanner)
+{
+    int channel = parseChannel(scanner);
+    if (scanner.hasMoreTokens()){
+        error("SYNTAX ERROR");
+    }
+    return new CloseStatement<Value>(channel);
+}
+
 //read a input statement (after the input keyword)
-InputStatement * parseInput(TokenScanner & scanner)
+template <typename Value>
+Statement<Value> * parseInput(TokenScanner & scanner)
 {
+    string token = scanner.nextToken();
+    if (token == "#"){
+        scanner.saveToken(token);
+        int channel = parseChannel(scanner);
+        if (scanner.nextToken() != ",") error("SYNTAX ERROR");
+        string name = scanner.nextToken();
+        if (!isStringName(scanner, name)){
+            scanner.saveToken(name);
+            name = parseName(scanner);
+        }
+        if (scanner.hasMoreTokens()){
+            error("SYNTAX ERROR");
+        }
+        return new FileInputStatement<Value>(channel, name);
+    }
+    if (isStringName(scanner, token)){
+        if (scanner.hasMoreTokens()){
+            error("SYNTAX ERROR");
+        }
+        return new StringInputStatement<Value>(token);
+    }
+    scanner.saveToken(token);
     string name = parseName(scanner);
     if (scanner.hasMoreTokens()){
         error("SYNTAX ERROR");
     }
-    InputStatement * stmt = new InputStatement(name);
+    InputStatement<Value> * stmt = new InputStatement<Value>(name);
+    return stmt;
+}
+
+//true if exp is made of constants alone, so its value is known when
+//it is parsed
+template <typename Value>
+bool isConstantExp(Expression<Value> * exp)
+{
+    if (exp->getType() == CONSTANT) return true;
+    if (exp->getType() != COMPOUND) return false;
+    CompoundExp<Value> * compound = (CompoundExp<Value> *) exp;
+    return isConstantExp(compound->getLHS()) && isConstantExp(compound->getRHS());
+}
+
+//read a goto statement (after the goto keyword): a line number, or
+//an expression whose value is one; an expression of constants alone
+//is a plain goto, and a syntax error unless its value is a line number
+template <typename Value>
+Statement<Value> * parseGoto(TokenScanner & scanner)
+{
+    string token = scanner.nextToken();
+    if (scanner.getTokenType(token) == NUMBER && !scanner.hasMoreTokens()){
+        scanner.saveToken(token);
+        LineNumber * ln = parseLineNumber(scanner);
+        GotoStatement<Value> * stmt = new GotoStatement<Value>(ln);
+        return stmt;
+    }
+    scanner.saveToken(token);
+    Expression<Value> * exp = parseExp<Value>(scanner);
+    if (scanner.hasMoreTokens()){
+        delete exp;
+        error("SYNTAX ERROR");
+    }
+    if (!isConstantExp(exp)){
+        return new ComputedGotoStatement<Value>(exp);
+    }
+    long long line = -1;
+    try {
+        EvalState<Value> state;
+        line = ValueTraits<Value>::toInteger(exp->eval(state));
+    } catch (ErrorException &) {
+    }
+    delete exp;
+    if (line < 0 || line > INT_MAX){
+        error("SYNTAX ERROR");
+    }
+    return new GotoStatement<Value>(new LineNumber(line));
+}
+
+//read an on-goto statement (after the on keyword): ON exp GOTO and
+//line numbers separated by commas
+template <typename Value>
+OnGotoStatement<Value> * parseOnGoto(TokenScanner & scanner)
+{
+    Expression<Value> * exp = parseExp<Value>(scanner);
+    if (scanner.nextToken() != "GOTO"){
+        error("SYNTAX ERROR");
+    }
+    vector<int> targets;
+    string token;
+    do {
+        LineNumber * ln = parseLineNumber(scanner);
+        targets.push_back(ln->getValue());
+        delete ln;
+    } while ((token = scanner.nextToken()) == ",");
+    if (token != ""){
+        error("SYNTAX ERROR");
+    }
+    return new OnGotoStatement<Value>(exp, targets);
+}
+
+//read a gosub statement (after the gosub keyword)
+template <typename Value>
+GosubStatement<Value> * parseGosub(TokenScanner & scanner)
+{
+    LineNumber * ln = parseLineNumber(scanner);
+    if (scanner.hasMoreTokens()){
+        error("SYNTAX ERROR");
+    }
+    GosubStatement<Value> * stmt = new GosubStatement<Value>(ln);
     return stmt;
 }
 
-//read a goto statement (after the goto keyword)
-GotoStatement * parseGoto(TokenScanner & scanner)
+//read a data statement (after the data keyword): signed constants
+//separated by commas
+template <typename Value>
+DataStatement<Value> * parseData(TokenScanner & scanner)
+{
+    vector<Value> values;
+    string token;
+    do {
+        string text = scanner.nextToken();
+        if (text == "-" || text == "+") text += scanner.nextToken();
+        Value value;
+        if (!ValueTraits<Value>::parse(text, value)) error("SYNTAX ERROR");
+        values.push_back(value);
+    } while ((token = scanner.nextToken()) == ",");
+    if (token != "") error("SYNTAX ERROR");
+    return new DataStatement<Value>(values);
+}
+
+//read a read statement (after the read keyword): variables and array
+//elements separated by commas
+template <typename Value>
+ReadStatement<Value> * parseRead(TokenScanner & scanner)
 {
+    vector<Expression<Value> *> targets;
+    string token;
+    do {
+        string name = parseName(scanner);
+        token = scanner.nextToken();
+        scanner.saveToken(token);
+        if (token == "("){
+            targets.push_back(readElement<Value>(scanner, name));
+        }else{
+            targets.push_back(new IdentifierExp<Value>(name));
+        }
+    } while ((token = scanner.nextToken()) == ",");
+    if (token != "") error("SYNTAX ERROR");
+    return new ReadStatement<Value>(targets);
+}
+
+//read a restore statement (after the restore keyword)
+template <typename Value>
+RestoreStatement<Value> * parseRestore(TokenScanner & scanner)
+{
+    if (!scanner.hasMoreTokens()) return new RestoreStatement<Value>(-1);
     LineNumber * ln = parseLineNumber(scanner);
+    int line = ln->getValue();
+    delete ln;
     if (scanner.hasMoreTokens()){
         error("SYNTAX ERROR");
     }
-    GotoStatement * stmt = new GotoStatement(ln);
+    return new RestoreStatement<Value>(line);
+}
+
+//read a return statement (after the return keyword)
+template <typename Value>
+ReturnStatement<Value> * parseReturn(TokenScanner & scanner)
+{
+    if (scanner.hasMoreTokens()){
+        error("SYNTAX ERROR");
+    }
+    ReturnStatement<Value> * stmt = new ReturnStatement<Value>;
     return stmt;
 }
 
 //read a print statement (after the print keyword)
-PrintStatement * parsePrint(TokenScanner & scanner)
+template <typename Value>
+Statement<Value> * parsePrint(TokenScanner & scanner)
 {
-    Expression * exp = parseExp(scanner);
+    string token = scanner.nextToken();
+    scanner.saveToken(token);
+    if (token == "#"){
+        int channel = parseChannel(scanner);
+        if (scanner.nextToken() != ",") error("SYNTAX ERROR");
+        Expression<Value> * exp = NULL;
+        StringExp<Value> * text = NULL;
+        if (startsString(scanner)){
+            text = parseStringExp<Value>(scanner);
+        }else{
+            exp = parseExp<Value>(scanner);
+        }
+        if (scanner.hasMoreTokens()){
+            error("SYNTAX ERROR");
+        }
+        return new FilePrintStatement<Value>(channel, exp, text);
+    }
+    if (startsString(scanner)){
+        StringExp<Value> * exp = parseStringExp<Value>(scanner);
+        if (scanner.hasMoreTokens()){
+            error("SYNTAX ERROR");
+        }
+        return new StringPrintStatement<Value>(exp);
+    }
+    Expression<Value> * exp = parseExp<Value>(scanner);
     if (scanner.hasMoreTokens()){
         error("SYNTAX ERROR");
     }
-    PrintStatement * stmt = new PrintStatement(exp);
+    PrintStatement<Value> * stmt = new PrintStatement<Value>(exp);
     return stmt;
 }
 
 //read a rem statement (after the rem keyword)
-RemStatement * parseRem(TokenScanner & scanner)
+template <typename Value>
+RemStatement<Value> * parseRem(TokenScanner & scanner)
 {
-    RemStatement * stmt = new RemStatement;
+    string text;
+    while (scanner.hasMoreTokens()){
+        if (!text.empty()) text += ' ';
+        text += scanner.nextToken();
+    }
+    RemStatement<Value> * stmt = new RemStatement<Value>(text);
     return stmt;
 }
 
+//read a def statement (after the def keyword): FNname(params) = exp
+template <typename Value>
+DefStatement<Value> * parseDef(TokenScanner & scanner)
+{
+    string name = parseName(scanner);
+    if (name.size() <= 2 || name.compare(0, 2, "FN") != 0) error("SYNTAX ERROR");
+    if (scanner.nextToken() != "(") error("SYNTAX ERROR");
+    vector<string> params;
+    string token = scanner.nextToken();
+    if (token != ")"){
+        scanner.saveToken(token);
+        do {
+            string param = parseName(scanner);
+            for (size_t i = 0; i < params.size(); i++){
+                if (params[i] == param) error("SYNTAX ERROR");
+            }
+            params.push_back(param);
+        } while ((token = scanner.nextToken()) == ",");
+        if (token != ")") error("SYNTAX ERROR");
+    }
+    if (scanner.nextToken() != "=") error("SYNTAX ERROR");
+    parameters = &params;
+    interning = false;
+    Expression<Value> * body;
+    try {
+        body = parseExp<Value>(scanner);
+    } catch (...) {
+        parameters = NULL;
+        throw;
+    }
+    parameters = NULL;
+    if (scanner.hasMoreTokens()) error("SYNTAX ERROR");
+    return new DefStatement<Value>(name, params, body);
+}
+
 //read a end statement (after the end keyword)
-EndStatement * parseEnd(TokenScanner & scanner)
+template <typename Value>
+EndStatement<Value> * parseEnd(TokenScanner & scanner)
 {
     if (scanner.hasMoreTokens()){
         error("SYNTAX ERROR");
     }
-    EndStatement * stmt = new EndStatement;
+    EndStatement<Value> * stmt = new EndStatement<Value>;
     return stmt;
 }
 
 //parse a direct executed statement
-Statement * parseDirect(TokenScanner & scanner)
+template <typename Value>
+Statement<Value> * parseDirect(TokenScanner & scanner)
 {
+    interning = false;
     if (!scanner.hasMoreTokens())
         error("SYNTAX ERROR");
     string token = scanner.nextToken();
-    if (token == "LET") return parseLet(scanner);
-    if (token == "INPUT") return parseInput(scanner);
-    if (token == "PRINT") return parsePrint(scanner);
+    if (token == "LET") return parseLet<Value>(scanner);
+    if (token == "INPUT") return parseInput<Value>(scanner);
+    if (token == "PRINT") return parsePrint<Value>(scanner);
+    if (token == "DIM") return parseDim<Value>(scanner);
+    if (token == "MAT") return parseMat<Value>(scanner);
     error("SYNTAX ERROR");
 }
 
 //parse a statement
-Statement * parseStatement(TokenScanner & scanner)
+template <typename Value>
+Statement<Value> * parseStatement(TokenScanner & scanner)
 {
+    interning = true;
     if (!scanner.hasMoreTokens())
         error("SYNTAX ERROR");
     string token = scanner.nextToken();
-    if (token == "LET") return parseLet(scanner);
-    if (token == "INPUT") return parseInput(scanner);
-    if (token == "PRINT") return parsePrint(scanner);
-    if (token == "REM") return parseRem(scanner);
-    if (token == "IF") return parseIf(scanner);
-    if (token == "GOTO") return parseGoto(scanner);
-    if (token == "END") return parseEnd(scanner);
+    if (token == "LET") return parseLet<Value>(scanner);
+    if (token == "INPUT") return parseInput<Value>(scanner);
+    if (token == "PRINT") return parsePrint<Value>(scanner);
+    if (token == "REM") return parseRem<Value>(scanner);
+    if (token == "IF") return parseIf<Value>(scanner);
+    if (token == "GOTO") return parseGoto<Value>(scanner);
+    if (token == "ON") return parseOnGoto<Value>(scanner);
+    if (token == "END") return parseEnd<Value>(scanner);
+    if (token == "DIM") return parseDim<Value>(scanner);
+    if (token == "FOR") return parseFor<Value>(scanner, false);
+    if (token == "PARALLEL") return parseParallelFor<Value>(scanner);
+    if (token == "NEXT") return parseNext<Value>(scanner);
+    if (token == "GOSUB") return parseGosub<Value>(scanner);
+    if (token == "RETURN") return parseReturn<Value>(scanner);
+    if (token == "MAT") return parseMat<Value>(scanner);
+    if (token == "DEF") return parseDef<Value>(scanner);
+    if (token == "DATA") return parseData<Value>(scanner);
+    if (token == "READ") return parseRead<Value>(scanner);
+    if (token == "RESTORE") return parseRestore<Value>(scanner);
+    if (token == "OPEN") return parseOpen<Value>(scanner);
+    if (token == "CLOSE") return parseClose<Value>(scanner);
     error("SYNTAX ERROR");
 }
+
+//check the keyword of a statement
+void checkStatement(TokenScanner & scanner)
+{
+    if (!scanner.hasMoreTokens())
+        error("SYNTAX ERROR");
+    string token = scanner.nextToken();
+    scanner.saveToken(token);
+    if (token == "LET" || token == "INPUT" || token == "PRINT" || token == "REM"
+            || token == "IF" || token == "GOTO" || token == "END" || token == "DIM"
+            || token == "FOR" || token == "NEXT" || token == "GOSUB" || token == "RETURN"
+            || token == "MAT" || token == "PARALLEL" || token == "DEF"
+            || token == "DATA" || token == "READ" || token == "RESTORE" || token == "OPEN"
+            || token == "CLOSE" || token == "ON") return;
+    error("SYNTAX ERROR");
+}
+
+//parse the statement of a program line
+template <typename Value>
+Statement<Value> * parseSourceLine(string line)
+{
+    TokenScanner scanner;
+    setupScanner(scanner);
+    scanner.setInput(line);
+    scanner.nextToken();  //the line number
+    return parseStatement<Value>(scanner);
+}
+
+#define INSTANTIATE_PARSER(Value) \
+    template Expression<Value> *parseExp<Value>(TokenScanner & scanner); \
+    template StringExp<Value> *parseStringExp<Value>(TokenScanner & scanner); \
+    template Statement<Value> *parseDirect<Value>(TokenScanner & scanner); \
+    template Statement<Value> *parseStatement<Value>(TokenScanner & scanner); \
+    template Statement<Value> *parseSourceLine<Value>(string line); \
+    template Expression<Value> *readE<Value>(TokenScanner & scanner, int prec); \
+    template Expression<Value> *readT<Value>(TokenScanner & scanner);
+FOR_EACH_VALUE_TYPE(INSTANTIATE_PARSER)
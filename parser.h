@@ -1,7 +1,10 @@
 /*
  * File: parser.h
  * --------------
- * This file acts as the interface to the parser module.
+ * This file acts as the interface to the parser module.  The parse
+ * functions are templates over the type of the values, like the
+ * expressions and statements they build, and take it explicitly:
+ * parseExp<double>(scanner).
  */
 
 #ifndef _parser_h
@@ -10,58 +13,108 @@
 #include <string>
 #include "exp.h"
 #include "statement.h"
+#include "strexp.h"
 
 #include "../StanfordCPPLib/tokenscanner.h"
 
+/*
+ * Function: setupScanner
+ * Usage: setupScanner(scanner);
+ * -----------------------------
+ * Sets up a scanner for BASIC source: it ignores whitespace, scans
+ * numbers and string literals, and reads a name ending in $ as one
+ * word.
+ */
+
+void setupScanner(TokenScanner & scanner);
+
 /*
  * Function: parseExp
- * Usage: Expression *exp = parseExp(scanner);
- * -------------------------------------------
+ * Usage: Expression<Value> *exp = parseExp<Value>(scanner);
+ * ---------------------------------------------------------
  * Parses an expression by reading tokens from the scanner, which must
- * be provided by the client.  The scanner should be set to ignore
- * whitespace and to scan numbers.
+ * be provided by the client.  The scanner should be set up by
+ * setupScanner.
  */
 
-Expression *parseExp(TokenScanner & scanner);
+template <typename Value>
+Expression<Value> *parseExp(TokenScanner & scanner);
+
+/*
+ * Function: parseStringExp
+ * Usage: StringExp<Value> *exp = parseStringExp<Value>(scanner);
+ * --------------------------------------------------------------
+ * Parses a string expression: string literals, string variables and
+ * LEFT$, RIGHT$ and MID$, joined by +.
+ */
+
+template <typename Value>
+StringExp<Value> *parseStringExp(TokenScanner & scanner);
 
 /*
  * Function: parseDirect
- * Usage: Statement *stmt = parseDirect(scanner);
- * -------------------------------------------
+ * Usage: Statement<Value> *stmt = parseDirect<Value>(scanner);
+ * ------------------------------------------------------------
  * Parse a direct executed statement
  */
 
-Statement *parseDirect(TokenScanner & scanner);
+template <typename Value>
+Statement<Value> *parseDirect(TokenScanner & scanner);
 
 /*
  * Function: parseStatement
- * Usage: Statement *stmt = parseStatement(scanner);
- * -------------------------------------------
+ * Usage: Statement<Value> *stmt = parseStatement<Value>(scanner);
+ * ---------------------------------------------------------------
  * Parse a statement
  */
 
-Statement *parseStatement(TokenScanner & scanner);
+template <typename Value>
+Statement<Value> *parseStatement(TokenScanner & scanner);
+
+/*
+ * Function: checkStatement
+ * Usage: checkStatement(scanner);
+ * -------------------------------------------
+ * Checks that the next token starts a statement, without reading it
+ * and without parsing the rest of the statement.  This is the cheap
+ * check a line gets when it is stored unparsed.
+ */
+
+void checkStatement(TokenScanner & scanner);
+
+/*
+ * Function: parseSourceLine
+ * Usage: Statement<Value> *stmt = parseSourceLine<Value>(line);
+ * -------------------------------------------------------------
+ * Parse the statement of a program line, which starts with its line
+ * number
+ */
+
+template <typename Value>
+Statement<Value> *parseSourceLine(std::string line);
 
 /*
  * Function: readE
- * Usage: Expression *exp = readE(scanner, prec);
- * ----------------------------------------------
+ * Usage: Expression<Value> *exp = readE<Value>(scanner, prec);
+ * ------------------------------------------------------------
  * Returns the next expression from the scanner involving only operators
  * whose precedence is at least prec.  The prec argument is optional and
  * defaults to 0, which means that the function reads the entire expression.
  */
 
-Expression *readE(TokenScanner & scanner, int prec = 0);
+template <typename Value>
+Expression<Value> *readE(TokenScanner & scanner, int prec = 0);
 
 /*
  * Function: readT
- * Usage: Expression *exp = readT(scanner);
- * ----------------------------------------
+ * Usage: Expression<Value> *exp = readT<Value>(scanner);
+ * ------------------------------------------------------
  * Returns the next individual term, which is either a constant, an
  * identifier, or a parenthesized subexpression.
  */
 
-Expression *readT(TokenScanner & scanner);
+template <typename Value>
+Expression<Value> *readT(TokenScanner & scanner);
 
 /*
  * Function: precedence
@@ -0,0 +1,126 @@
+/*
+ * File: pool.cpp
+ * --------------
+ * This file implements the WorkPool class.
+ */
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include "pool.h"
+using namespace std;
+
+WorkPool & WorkPool::shared() {
+   static WorkPool pool(max(1, (int) thread::hardware_concurrency()));
+   return pool;
+}
+
+WorkPool::WorkPool(int init_workers)
+    :workers(init_workers), job(NULL), generation(0), busy(0), stopping(false)
+{
+    for (int w = 0; w < workers; w++){
+        queues.push_back(new Queue);
+    }
+    for (int w = 1; w < workers; w++){
+        threads.push_back(thread(&WorkPool::serve, this, w));
+    }
+}
+
+WorkPool::~WorkPool()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (size_t i = 0; i < threads.size(); i++){
+        threads[i].join();
+    }
+    for (int w = 0; w < workers; w++){
+        delete queues[w];
+    }
+}
+
+int WorkPool::getWorkers()
+{
+    return workers;
+}
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * The blocks are queued before the threads are woken, and no task is
+ * queued while a job runs, so a worker that finds every queue empty
+ * is done with the job.
+ */
+
+void WorkPool::run(int tasks, const function<void(int, int)> & task)
+{
+    for (int w = 0; w < workers; w++){
+        int begin = (long long) tasks * w / workers;
+        int end = (long long) tasks * (w + 1) / workers;
+        for (int t = begin; t < end; t++){
+            queues[w]->tasks.push_back(t);
+        }
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        job = &task;
+        generation++;
+        busy = workers - 1;
+    }
+    wake.notify_all();
+    work(0);
+    unique_lock<mutex> guard(lock);
+    while (busy > 0) done.wait(guard);
+    job = NULL;
+}
+
+//the loop of a thread: wait for a job, work on it, report
+void WorkPool::serve(int worker)
+{
+    long long seen = 0;
+    while (true){
+        {
+            unique_lock<mutex> guard(lock);
+            while (!stopping && generation == seen) wake.wait(guard);
+            if (stopping) return;
+            seen = generation;
+        }
+        work(worker);
+        lock_guard<mutex> guard(lock);
+        if (--busy == 0) done.notify_all();
+    }
+}
+
+void WorkPool::work(int worker)
+{
+    int task;
+    while (take(worker, task)){
+        (*job)(task, worker);
+    }
+}
+
+//take a task from the front of the own queue, or steal one from the back of another
+bool WorkPool::take(int worker, int & task)
+{
+    for (int i = 0; i < workers; i++){
+        int w = (worker + i) % workers;
+        Queue * queue = queues[w];
+        lock_guard<mutex> guard(queue->lock);
+        if (queue->tasks.empty()) continue;
+        if (w == worker){
+            task = queue->tasks.front();
+            queue->tasks.pop_front();
+        }else{
+            task = queue->tasks.back();
+            queue->tasks.pop_back();
+        }
+        return true;
+    }
+    return false;
+}
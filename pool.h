@@ -0,0 +1,105 @@
+/*
+ * File: pool.h
+ * ------------
+ * This interface exports the WorkPool class, a pool of threads that
+ * runs the iterations of a PARALLEL FOR.
+ */
+
+#ifndef _pool_h
+#define _pool_h
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/*
+ * Class: WorkPool
+ * ---------------
+ * A job is a number of tasks, numbered from 0, and a function that
+ * runs one task on a worker.  The tasks are split into one contiguous
+ * block per worker.  A worker runs its own block from the front, and
+ * when it is empty steals tasks from the back of the others', so a
+ * worker that finishes early helps the slow ones.
+ *
+ * The calling thread is worker 0; the other workers are threads that
+ * live as long as the pool and sleep between jobs.
+ */
+
+class WorkPool {
+
+public:
+
+/*
+ * Method: shared
+ * Usage: WorkPool & pool = WorkPool::shared();
+ * --------------------------------------------
+ * Returns the pool of the program, with one worker per hardware
+ * thread, created the first time it is needed.
+ */
+
+   static WorkPool & shared();
+
+/*
+ * Method: getWorkers
+ * Usage: int n = pool.getWorkers();
+ * ---------------------------------
+ * Returns the number of workers, the calling thread included.
+ */
+
+   int getWorkers();
+
+/*
+ * Method: run
+ * Usage: pool.run(tasks, task);
+ * -----------------------------
+ * Runs task(t, w) for every task t < tasks, where w < getWorkers() is
+ * the worker running it, and returns when all are done.  A worker runs
+ * one task at a time.  task must not throw.
+ */
+
+   void run(int tasks, const std::function<void(int, int)> & task);
+
+/*
+ * Destructor: ~WorkPool
+ * Usage: usually implicit
+ * -----------------------
+ * Stops and joins the threads.
+ */
+
+   ~WorkPool();
+
+private:
+
+   explicit WorkPool(int workers);
+   void serve(int worker);
+   void work(int worker);
+   bool take(int worker, int & task);
+
+   //the tasks of a worker, and the lock that guards them
+   struct Queue {
+      std::mutex lock;
+      std::deque<int> tasks;
+   };
+
+   int workers;
+   std::vector<Queue *> queues;
+   std::vector<std::thread> threads;
+
+   std::mutex lock;
+   std::condition_variable wake;     //a job started, or the pool stops
+   std::condition_variable done;     //the last thread finished the job
+   const std::function<void(int, int)> * job;
+   long long generation;             //counts the jobs
+   int busy;                         //threads still working on the job
+   bool stopping;
+
+   //not copyable: the threads are owned
+   WorkPool(const WorkPool &);
+   WorkPool & operator=(const WorkPool &);
+
+};
+
+#endif
@@ -5,80 +5,1025 @@
  */
 
 #include <string>
-#include <map>
-#include <memory>
+#include <vector>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include "program.h"
 #include "statement.h"
 #include "evalstate.h"
+#include "analysis.h"
+#include "loop.h"
+#include "subroutine.h"
+#include "parallel.h"
+#include "data.h"
+#include "dispatch.h"
+#include "cse.h"
+#include "licm.h"
+#include "parser.h"
+#include "native.h"
+#include "../StanfordCPPLib/strlib.h"
 using namespace std;
 
-/* Implementation of the ProgramLine class */
+/* Implementation of the LineStore class */
 
-ProgramLine::ProgramLine(string origin_line, Statement * parsed_line):line(origin_line), stmt(parsed_line) {}
+template <typename Value>
+LineStore<Value>::LineStore():garbage(0), keepSource(true) {}
 
-ProgramLine::ProgramLine():line(""), stmt(nullptr) {}
+template <typename Value>
+LineStore<Value>::~LineStore()
+{
+    clear();
+}
 
-void ProgramLine::show()
+template <typename Value>
+void LineStore<Value>::clear()
 {
-    cout << line << endl;
+    for (size_t i = 0; i < stmts.size(); i++){
+        delete stmts[i];
+    }
+    numbers.clear();
+    offsets.clear();
+    lengths.clear();
+    stmts.clear();
+    text.clear();
+    garbage = 0;
 }
 
-void ProgramLine::execute(EvalState & state)
+/*
+ * Implementation notes: put
+ * -------------------------
+ * Lines are usually entered in increasing order, so the common case
+ * appends to the arrays.  A replaced line reuses its text slot when the
+ * new text fits, otherwise the new text goes to the end of the buffer.
+ */
+
+template <typename Value>
+void LineStore<Value>::put(int lineNumber, const string & line, Statement<Value> * stmt)
 {
-    stmt->execute(state);
+    const string & source = (keepSource || stmt == NULL) ? line : string();
+    vector<int>::iterator it = lower_bound(numbers.begin(), numbers.end(), lineNumber);
+    size_t index = it - numbers.begin();
+    if (it != numbers.end() && *it == lineNumber){
+        delete stmts[index];
+        stmts[index] = stmt;
+        if (source.size() <= lengths[index]){
+            text.replace(offsets[index], source.size(), source);
+            garbage += lengths[index] - source.size();
+        }else{
+            garbage += lengths[index];
+            offsets[index] = text.size();
+            text += source;
+        }
+        lengths[index] = source.size();
+    }else{
+        numbers.insert(it, lineNumber);
+        offsets.insert(offsets.begin() + index, text.size());
+        lengths.insert(lengths.begin() + index, source.size());
+        stmts.insert(stmts.begin() + index, stmt);
+        text += source;
+    }
+    if (garbage > text.size() / 2) compact();
 }
 
-Program::Program() {
-   // Empty 
+template <typename Value>
+bool LineStore<Value>::remove(int lineNumber)
+{
+    int index = find(lineNumber);
+    if (index < 0) return false;
+    delete stmts[index];
+    garbage += lengths[index];
+    numbers.erase(numbers.begin() + index);
+    offsets.erase(offsets.begin() + index);
+    lengths.erase(lengths.begin() + index);
+    stmts.erase(stmts.begin() + index);
+    if (garbage > text.size() / 2) compact();
+    return true;
 }
 
-Program::~Program() {
-   // Empty 
+template <typename Value>
+void LineStore<Value>::compact()
+{
+    string live;
+    live.reserve(text.size() - garbage);
+    for (size_t i = 0; i < numbers.size(); i++){
+        unsigned int offset = live.size();
+        live.append(text, offsets[i], lengths[i]);
+        offsets[i] = offset;
+    }
+    text.swap(live);
+    garbage = 0;
 }
 
-void Program::clear() {
-    code.clear(); //proxy the message to the map
+template <typename Value>
+int LineStore<Value>::size()
+{
+    return numbers.size();
 }
 
-void Program::addSourceLine(int lineNumber, string line, Statement * stmt) {
-    code[lineNumber] = ProgramLine(line, stmt);
+template <typename Value>
+int LineStore<Value>::find(int lineNumber)
+{
+    vector<int>::iterator it = lower_bound(numbers.begin(), numbers.end(), lineNumber);
+    if (it == numbers.end() || *it != lineNumber) return -1;
+    return it - numbers.begin();
 }
 
-void Program::removeSourceLine(int lineNumber) {
-    map<int, ProgramLine>::iterator it = code.find(lineNumber);
-    if (it != code.end()){
-        code.erase(it);
+template <typename Value>
+int LineStore<Value>::getNumber(int index)
+{
+    return numbers[index];
+}
+
+template <typename Value>
+Statement<Value> * LineStore<Value>::getStatement(int index)
+{
+    return stmts[index];
+}
+
+template <typename Value>
+string LineStore<Value>::getSource(int index)
+{
+    if (lengths[index] == 0){
+        return integerToString(numbers[index]) + " " + stmts[index]->toString();
     }
+    return text.substr(offsets[index], lengths[index]);
+}
+
+template <typename Value>
+void LineStore<Value>::setStatement(int index, Statement<Value> * stmt)
+{
+    delete stmts[index];
+    stmts[index] = stmt;
 }
 
-void Program::list()
+template <typename Value>
+const vector<int> & LineStore<Value>::getNumbers()
 {
-    map<int, ProgramLine>::iterator it = code.begin();
-    while(it != code.end()){
-        it->second.show();
-        ++it;
+    return numbers;
+}
+
+template <typename Value>
+const vector<Statement<Value> *> & LineStore<Value>::getStatements()
+{
+    return stmts;
+}
+
+template <typename Value>
+void LineStore<Value>::setKeepSource(bool flag)
+{
+    keepSource = flag;
+}
+
+/* Implementation of the Program class */
+
+template <typename Value>
+const int Program<Value>::END_OF_IMAGE;
+template <typename Value>
+const int Program<Value>::NO_LINE;
+
+template <typename Value>
+Program<Value>::Program():prepared(true), lazy(false), entry(END_OF_IMAGE), lineShift(0), eliminatedLines(0),
+                          threadedJumps(0), paused(END_OF_IMAGE), debugImage(false),
+                          checkpointImage(false), checkpointInterval(0), nextCheckpoint(0), checkpointCountdown(CHECKPOINT_JUMPS),
+                          sourceHash(0), hashed(false) {}
+
+template <typename Value>
+Program<Value>::~Program() {
+    for (size_t i = 0; i < fast.size(); i++){
+        delete fast[i];
+    }
+    for (typename map<int, TrapStatement<Value> *>::iterator it = traps.begin(); it != traps.end(); it++){
+        delete it->second;
+    }
+}
+
+template <typename Value>
+void Program<Value>::clear() {
+    functions.clear();
+    code.clear(); //proxy the message to the store
+    prepared = false;
+    paused = END_OF_IMAGE;
+}
+
+template <typename Value>
+void Program<Value>::addSourceLine(int lineNumber, string line, Statement<Value> * stmt) {
+    functions.clear();
+    code.put(lineNumber, line, stmt);
+    prepared = false;
+    paused = END_OF_IMAGE;
+}
+
+template <typename Value>
+void Program<Value>::removeSourceLine(int lineNumber) {
+    functions.clear();
+    if (code.remove(lineNumber)){
+        prepared = false;
+        paused = END_OF_IMAGE;
+    }
+}
+
+template <typename Value>
+void Program<Value>::setKeepSource(bool flag) {
+    code.setKeepSource(flag);
+}
+
+template <typename Value>
+void Program<Value>::setLazy(bool flag) {
+    lazy = flag;
+}
+
+template <typename Value>
+bool Program<Value>::isLazy() {
+    return lazy;
+}
+
+template <typename Value>
+void Program<Value>::check()
+{
+    for (int i = 0; i < code.size(); i++){
+        if (code.getStatement(i) != NULL) continue;
+        try {
+            code.setStatement(i, parseSourceLine<Value>(code.getSource(i)));
+            prepared = false;
+        } catch (ErrorException & ex) {
+            cout << ex.getMessage() << " IN LINE " << code.getNumber(i) << endl;
+        }
     }
 }
 
-void Program::run(EvalState & state)
+template <typename Value>
+void Program<Value>::list()
 {
-    map<int, ProgramLine>::iterator it = code.begin();
-    while(it != code.end()){
-        state.setPC(EvalState::SEQUENTIAL);  //default
-        it->second.execute(state);
-        int pc = state.getPC();
-        if (pc == EvalState::HALT){          //end
-            return;
+    for (int i = 0; i < code.size(); i++){
+        cout << code.getSource(i) << endl;
+    }
+}
+
+//the keyword of a source line
+static string lineKeyword(const string & line)
+{
+    TokenScanner scanner;
+    scanner.ignoreWhitespace();
+    scanner.scanNumbers();
+    scanner.setInput(line);
+    scanner.nextToken();  //the line number
+    return scanner.nextToken();
+}
+
+/*
+ * Implementation notes: matchNext
+ * -------------------------------
+ * Returns the index of the NEXT that closes the FOR at index i, by
+ * following the nesting of the lines after it: a NEXT closes the
+ * innermost open loop, or the innermost one over the variable it
+ * names together with the loops inside it.  Returns -1 if there is
+ * none.  Unparsed FOR and NEXT lines on the way are parsed; if one
+ * has a syntax error, it is left for the run to report and the FOR
+ * stays unmatched.
+ */
+
+template <typename Value>
+int Program<Value>::matchNext(int i)
+{
+    const vector<Statement<Value> *> & stmts = code.getStatements();
+    vector<string> open(1, ((ForStatement<Value> *) stmts[i])->getName());
+    for (int j = i + 1; j < code.size(); j++){
+        if (stmts[j] == NULL){
+            string keyword = lineKeyword(code.getSource(j));
+            if (keyword != "FOR" && keyword != "NEXT") continue;
+            try {
+                code.setStatement(j, parseSourceLine<Value>(code.getSource(j)));
+            } catch (ErrorException &) {
+                return -1;
+            }
+        }
+        if (stmts[j]->getType() == FOR_STMT){
+            open.push_back(((ForStatement<Value> *) stmts[j])->getName());
+        }else if (stmts[j]->getType() == NEXT_STMT){
+            string name = ((NextStatement<Value> *) stmts[j])->getName();
+            int k = open.size() - 1;
+            while (k >= 0 && !name.empty() && open[k] != name) k--;
+            if (k < 0) continue;
+            open.resize(k);
+            if (open.empty()) return j;
+        }
+    }
+    return -1;
+}
+
+template <typename Value>
+void Program<Value>::linkLoop(int i)
+{
+    const vector<Statement<Value> *> & stmts = code.getStatements();
+    int body = (i + 1 < code.size()) ? code.getNumber(i + 1) : EvalState<Value>::HALT;
+    int match = matchNext(i);
+    int exit = -1;
+    if (match >= 0){
+        exit = (match + 1 < code.size()) ? code.getNumber(match + 1) : EvalState<Value>::HALT;
+        ((NextStatement<Value> *) stmts[match])->setBody(body);
+    }
+    ((ForStatement<Value> *) stmts[i])->setLines(body, exit);
+}
+
+/*
+ * Implementation notes: prepare
+ * -----------------------------
+ * The functions and the data segment are collected first, parsing the
+ * unparsed DEF, DATA and RESTORE lines, so a call can be resolved
+ * wherever its function is defined and READ sees every DATA line.  Every
+ * FOR is linked to the line after it and to the line after its
+ * NEXT first, since the analyses follow those jumps.
+ *
+ * A line IF I < N THEN h directly after LET I = I + c, with h not after
+ * the LET, closes a counted loop over the lines h .. LET.  Such IF
+ * lines are replaced by a CountedLoop that runs those lines natively.
+ * A ladder of IF lines that test one variable against constants is
+ * replaced, at its first line, by a SwitchDispatch.
+ * A GOSUB to a short subroutine that never jumps is replaced by an
+ * InlinedCall that runs the lines of the subroutine in place, and a
+ * PARALLEL FOR with independent iterations by a ParallelLoop.  A
+ * PARALLEL FOR that cannot run in parallel is reported, and runs as a
+ * plain FOR.  A plain FOR whose body never jumps and reads an array
+ * element its bounds can be checked for up front is replaced by a
+ * ForLoop.  No line is replaced while a breakpoint or watchpoint is
+ * set, so that every line runs on its own and can stop, or while a
+ * checkpoint file is set, since a checkpoint is only taken between two
+ * lines of the image and a replaced loop runs as one.
+ *
+ * The equal subexpressions of the lines share a memo of their value,
+ * which the state keeps until one of the variables they read changes,
+ * and so does each subexpression that does not change in a loop.
+ */
+
+template <typename Value>
+void Program<Value>::prepare()
+{
+    if (prepared) return;
+    const vector<Statement<Value> *> & stmts = code.getStatements();
+    for (int i = 0; i < code.size(); i++){
+        if (stmts[i] != NULL) continue;
+        string keyword = lineKeyword(code.getSource(i));
+        if (keyword != "DEF" && keyword != "DATA" && keyword != "RESTORE") continue;
+        try {
+            code.setStatement(i, parseSourceLine<Value>(code.getSource(i)));
+        } catch (ErrorException &) {
+            //left for the run to report
+        }
+    }
+    functions.build(code.getNumbers(), stmts);
+    buildDataSegment(code.getNumbers(), stmts, data);
+    prepared = true;
+    for (int i = 0; i < code.size(); i++){
+        if (stmts[i] != NULL && stmts[i]->getType() == NEXT_STMT) ((NextStatement<Value> *) stmts[i])->setBody(-1);
+    }
+    for (int i = 0; i < code.size(); i++){
+        if (stmts[i] != NULL && stmts[i]->getType() == FOR_STMT) linkLoop(i);
+    }
+    markDefinedReads(code.getNumbers(), stmts);
+    watched.clear();
+    markCommonSubexpressions(stmts, memos, watched);
+    markLoopInvariants(code.getNumbers(), stmts, invariants, watched);
+
+    for (size_t i = 0; i < fast.size(); i++){
+        delete fast[i];
+    }
+    fast.clear();
+    imageLines.clear();
+    hashed = false;
+    vector<Statement<Value> *> exec(stmts);
+    debugImage = !breakpoints.empty() || !watches.empty();
+    checkpointImage = checkpoint.isOpen();
+    if (!debugImage && !checkpointImage) replaceLines(exec);
+    buildImage(exec);
+}
+
+template <typename Value>
+void Program<Value>::replaceLines(vector<Statement<Value> *> & exec)
+{
+    const vector<Statement<Value> *> & stmts = code.getStatements();
+    for (int i = 1; i < code.size(); i++){
+        if (stmts[i] == NULL || stmts[i]->getType() != IF_STMT) continue;
+        IfStatement<Value> * test = (IfStatement<Value> *) stmts[i];
+        int target = code.find(test->getTarget());
+        if (target < 0 || target >= i) continue;
+        vector<Statement<Value> *> body(stmts.begin() + target, stmts.begin() + i);
+        Statement<Value> * loop = makeCountedLoop(test, body);
+        if (loop != NULL){
+            fast.push_back(loop);
+            exec[i] = loop;
+        }
+    }
+    for (int i = 0; i < code.size(); i++){
+        if (stmts[i] == NULL || stmts[i]->getType() != IF_STMT || exec[i] != stmts[i]) continue;
+        int length;
+        Statement<Value> * dispatch = makeSwitchDispatch(code.getNumbers(), stmts, i, length);
+        if (dispatch != NULL){
+            fast.push_back(dispatch);
+            exec[i] = dispatch;
+            i += length - 1;
+        }
+    }
+    for (int i = 0; i < code.size(); i++){
+        if (stmts[i] == NULL || stmts[i]->getType() != GOSUB_STMT) continue;
+        GosubStatement<Value> * gosub = (GosubStatement<Value> *) stmts[i];
+        int target = code.find(gosub->getTarget());
+        if (target < 0) continue;
+        int end = min(target + MAX_INLINED_LINES, code.size());
+        vector<Statement<Value> *> lines(stmts.begin() + target, stmts.begin() + end);
+        Statement<Value> * call = makeInlinedCall(gosub, lines);
+        if (call != NULL){
+            fast.push_back(call);
+            exec[i] = call;
+        }
+    }
+    for (int i = 0; i < code.size(); i++){
+        if (stmts[i] == NULL || stmts[i]->getType() != FOR_STMT) continue;
+        ForStatement<Value> * stmt = (ForStatement<Value> *) stmts[i];
+        if (!stmt->isParallel()){
+            int match = matchNext(i);
+            if (match < 0) continue;
+            vector<Statement<Value> *> body(stmts.begin() + i + 1, stmts.begin() + match);
+            Statement<Value> * loop = makeForLoop(stmt, body, (NextStatement<Value> *) stmts[match]);
+            if (loop != NULL){
+                fast.push_back(loop);
+                exec[i] = loop;
+            }
+            continue;
+        }
+        string reason = "NO MATCHING NEXT";
+        int match = matchNext(i);
+        Statement<Value> * loop = NULL;
+        if (match >= 0){
+            vector<Statement<Value> *> body(stmts.begin() + i + 1, stmts.begin() + match);
+            loop = makeParallelLoop(stmt, body, reason);
+        }
+        if (loop != NULL){
+            fast.push_back(loop);
+            exec[i] = loop;
+        }else{
+            cerr << "PARALLEL FOR IN LINE " << code.getNumber(i) << " RUNS SERIALLY: " << reason << endl;
+        }
+    }
+}
+
+//the line number a statement jumps to, -1 if it never jumps or is unknown
+template <typename Value>
+static int jumpTarget(Statement<Value> * stmt)
+{
+    if (stmt == NULL) return -1;
+    if (stmt->getType() == GOTO_STMT) return ((GotoStatement<Value> *) stmt)->getTarget();
+    if (stmt->getType() == IF_STMT) return ((IfStatement<Value> *) stmt)->getTarget();
+    if (stmt->getType() == GOSUB_STMT) return ((GosubStatement<Value> *) stmt)->getTarget();
+    if (stmt->getType() == FOR_STMT) return max(((ForStatement<Value> *) stmt)->getExit(), -1);
+    if (stmt->getType() == NEXT_STMT) return max(((NextStatement<Value> *) stmt)->getBody(), -1);
+    return -1;
+}
+
+/*
+ * Implementation notes: threadLine
+ * --------------------------------
+ * Returns the first line that does some work when control reaches
+ * line i: REM and DATA lines are passed to the next line, and GOTO
+ * lines to their target.  A GOTO to a missing line is kept, so that it
+ * raises the error when it runs, and so is a cycle of GOTOs, so that it
+ * loops forever as before, and every line of an image built for the
+ * debugger, so that a breakpoint may be set on any line while the run
+ * is paused.  Sets threaded if a GOTO was passed.
+ */
+
+template <typename Value>
+static int threadLine(int i, const vector<Statement<Value> *> & stmts, vector<int> & next,
+                      vector<int> & jump, const vector<bool> & stops, bool & threaded)
+{
+    int start = i;
+    bool passed = false;
+    for (size_t steps = 0; steps <= stmts.size(); steps++){
+        if (i < 0){
+            threaded = passed;
+            return i;
+        }
+        if (stmts[i] == NULL || stops[i]){
+            threaded = passed;
+            return i;
+        }
+        StatementType type = stmts[i]->getType();
+        if (type == REM_STMT || type == DATA_STMT){
+            i = next[i];
+        }else if (type == GOTO_STMT && jump[i] >= 0){
+            i = jump[i];
+            passed = true;
         }else{
-            if (pc == EvalState::SEQUENTIAL){
-                ++it;
-            }else{                           //jump
-                it = code.find(pc);
-                if (it == code.end()){
-                    error("LINE NUMBER ERROR");
+            threaded = passed;
+            return i;
+        }
+    }
+    return start;                            //a cycle of GOTOs
+}
+
+/*
+ * Implementation notes: buildImage
+ * --------------------------------
+ * The jumps of every line are threaded through REM, DATA and GOTO
+ * lines, and only the lines reachable from the first line through the
+ * threaded jumps go into the image.  The source of every line stays in the
+ * store for LIST.  A line that is not parsed yet and a computed GOTO may
+ * jump to any line, so if one can be reached, every line is kept.
+ *
+ * The line table holds the image index of every line in a slot chosen
+ * by a multiplicative hash of its number, and has at least two slots
+ * per line.  Two lines that want the same slot are rare, since the
+ * hash spreads line numbers in steps evenly; the later one is left out
+ * and found by the binary search instead.
+ */
+
+template <typename Value>
+void Program<Value>::buildImage(vector<Statement<Value> *> & exec)
+{
+    const vector<Statement<Value> *> & lines = code.getStatements();
+    int n = lines.size();
+    for (typename map<int, TrapStatement<Value> *>::iterator it = traps.begin(); it != traps.end(); it++){
+        delete it->second;
+    }
+    traps.clear();
+    paused = END_OF_IMAGE;
+    vector<bool> stops(n, debugImage);
+    vector<int> next(n), jump(n, NO_LINE);
+    for (int i = 0; i < n; i++){
+        next[i] = (i + 1 < n) ? i + 1 : END_OF_IMAGE;
+        int target = jumpTarget(lines[i]);
+        if (target >= 0){
+            int position = code.find(target);
+            if (position >= 0) jump[i] = position;
+        }
+    }
+
+    //thread every jump, then keep the lines reachable from the start
+    vector<int> threadedNext(n), threadedJump(n);
+    vector<bool> nextThreaded(n, false), jumpThreaded(n, false);
+    for (int i = 0; i < n; i++){
+        bool threaded = false;
+        threadedNext[i] = (next[i] >= 0) ? threadLine(next[i], lines, next, jump, stops, threaded) : next[i];
+        nextThreaded[i] = threaded;
+        threaded = false;
+        threadedJump[i] = (jump[i] >= 0) ? threadLine(jump[i], lines, next, jump, stops, threaded) : jump[i];
+        jumpThreaded[i] = threaded;
+    }
+    bool threaded = false;
+    int start = (n > 0) ? threadLine(0, lines, next, jump, stops, threaded) : END_OF_IMAGE;
+    vector<bool> reachable(n, false);
+    vector<int> work;
+    if (start >= 0){
+        reachable[start] = true;
+        work.push_back(start);
+    }
+    threadedJumps = threaded ? 1 : 0;
+    bool anywhere = false;
+    while (!work.empty()){
+        int i = work.back();
+        work.pop_back();
+        if (lines[i] == NULL) anywhere = true;
+        StatementType type = (lines[i] == NULL) ? LET_STMT : lines[i]->getType();
+        if (type == COMPUTED_GOTO_STMT) anywhere = true;
+        int succ[2] = { END_OF_IMAGE, END_OF_IMAGE };
+        if (type != GOTO_STMT && type != END_STMT && type != RETURN_STMT && type != COMPUTED_GOTO_STMT){
+            succ[0] = threadedNext[i];
+            if (nextThreaded[i]) threadedJumps++;
+        }
+        succ[1] = threadedJump[i];
+        if (jumpThreaded[i]) threadedJumps++;
+        for (int k = 0; k < 2; k++){
+            if (succ[k] >= 0 && !reachable[succ[k]]){
+                reachable[succ[k]] = true;
+                work.push_back(succ[k]);
+            }
+        }
+        if (type == ON_GOTO_STMT){
+            OnGotoStatement<Value> * stmt = (OnGotoStatement<Value> *) lines[i];
+            for (int k = 0; k < stmt->getCount(); k++){
+                int to = code.find(stmt->getTarget(k));
+                if (to >= 0) to = threadLine(to, lines, next, jump, stops, threaded);
+                if (to >= 0 && !reachable[to]){
+                    reachable[to] = true;
+                    work.push_back(to);
                 }
             }
         }
     }
+
+    if (anywhere) reachable.assign(n, true);
+
+    //lay out the image in line order
+    vector<int> index(n, NO_LINE);
+    image.clear();
+    for (int i = 0; i < n; i++){
+        if (reachable[i]){
+            index[i] = image.size();
+            ExecLine line;
+            line.stmt = exec[i];
+            line.source = i;
+            line.target = jumpTarget(lines[i]);
+            image.push_back(line);
+        }
+    }
+    for (int i = 0; i < n; i++){
+        if (!reachable[i]) continue;
+        ExecLine & line = image[index[i]];
+        line.next = (threadedNext[i] >= 0) ? index[threadedNext[i]] : END_OF_IMAGE;
+        line.jump = (threadedJump[i] >= 0) ? index[threadedJump[i]] : NO_LINE;
+    }
+    entry = (start >= 0) ? index[start] : END_OF_IMAGE;
+    jumpIndex.assign(n, NO_LINE);
+    for (int i = 0; i < n; i++){
+        int to = threadLine(i, lines, next, jump, stops, threaded);
+        if (to < 0){
+            jumpIndex[i] = to;
+        }else if (reachable[to]){
+            jumpIndex[i] = index[to];
+        }
+    }
+    for (int i = 0; i < n; i++){
+        if (lines[i] != NULL && lines[i]->getType() == ON_GOTO_STMT) linkTargets(i);
+    }
+    int bits = 1;
+    while ((1 << bits) < 2 * n) bits++;
+    lineShift = 32 - bits;
+    LineSlot empty = { -1, NO_LINE };
+    lineTable.assign(1 << bits, empty);
+    for (int i = 0; i < n; i++){
+        LineSlot & slot = lineTable[((unsigned int) code.getNumber(i) * 2654435769u) >> lineShift];
+        if (slot.line < 0){
+            slot.line = code.getNumber(i);
+            slot.index = jumpIndex[i];
+        }
+    }
+    eliminatedLines = n - image.size();
+}
+
+template <typename Value>
+void Program<Value>::link()
+{
+    prepare();
+    cout << eliminatedLines << " LINES ELIMINATED, " << threadedJumps << " JUMPS THREADED" << endl;
+}
+
+template <typename Value>
+void Program<Value>::prelink()
+{
+    if (debugImage != (!breakpoints.empty() || !watches.empty())) prepared = false;
+    if (checkpointImage != checkpoint.isOpen()) prepared = false;
+    prepare();
+}
+
+template <typename Value>
+int Program<Value>::findJump(int lineNumber)
+{
+    const LineSlot & slot = lineTable[((unsigned int) lineNumber * 2654435769u) >> lineShift];
+    if (slot.line == lineNumber) return slot.index;
+    int position = code.find(lineNumber);
+    return (position < 0) ? NO_LINE : jumpIndex[position];
+}
+
+/*
+ * Implementation notes: parseLine
+ * -------------------------------
+ * The parsed statement replaces the NULL in the store and in the image;
+ * a FOR may have had the line parsed already, while linking its loop.
+ * The image is otherwise left as it is for the rest of the run; the
+ * next run links again, now with the statement known.  The line gets
+ * its trap now, as arming skipped it.
+ */
+
+template <typename Value>
+void Program<Value>::linkTargets(int i)
+{
+    OnGotoStatement<Value> * stmt = (OnGotoStatement<Value> *) code.getStatement(i);
+    vector<int> indexes(stmt->getCount());
+    for (int k = 0; k < stmt->getCount(); k++){
+        int position = code.find(stmt->getTarget(k));
+        indexes[k] = (position < 0) ? NO_LINE : jumpIndex[position];
+    }
+    stmt->setIndexes(indexes);
+}
+
+template <typename Value>
+void Program<Value>::parseLine(ExecLine & line)
+{
+    Statement<Value> * stmt = code.getStatement(line.source);
+    if (stmt == NULL){
+        stmt = parseSourceLine<Value>(code.getSource(line.source));
+        code.setStatement(line.source, stmt);
+    }
+    if (stmt->getType() == FOR_STMT) linkLoop(line.source);
+    if (stmt->getType() == ON_GOTO_STMT) linkTargets(line.source);
+    line.stmt = stmt;
+    line.target = jumpTarget(stmt);
+    int position = (line.target >= 0) ? code.find(line.target) : -1;
+    line.jump = (position < 0) ? NO_LINE : jumpIndex[position];
+    prepared = false;
+    if (!breakpoints.empty() || !watches.empty()) armLine(&line - &image[0]);
+}
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * A jump to the line its statement names goes straight to the image
+ * index resolved at link time, and so does ON GOTO, whose statement
+ * holds the index of each of its lines and leaves JUMP as the program
+ * counter.  A computed GOTO is looked up in the line table.  GOSUB
+ * pushes the image index of the line after it, so RETURN goes straight
+ * there too.  A trap leaves BREAK as the program counter, which ends
+ * the loop at its line; without traps that test is never reached, as
+ * it sits among the jumps.
+ */
+
+template <typename Value>
+void Program<Value>::run(EvalState<Value> & state)
+{
+    startRun(state);
+    execute(state, entry, false);
+}
+
+template <typename Value>
+void Program<Value>::startRun(EvalState<Value> & state)
+{
+    if (paused != END_OF_IMAGE){
+        paused = END_OF_IMAGE;
+        files.closeAll();
+    }
+    if (debugImage != (!breakpoints.empty() || !watches.empty())) prepared = false;
+    if (checkpointImage != checkpoint.isOpen()) prepared = false;
+    prepare();
+    armTraps();
+    seedRandom(INITIAL_RANDOM_SEED);
+    state.setFunctions(&functions);
+    state.clearArguments();
+    state.setData(data.data(), data.size());
+    state.setFiles(&files);
+    state.setWatched(&watched);
+    state.clearLoops();
+    state.clearReturns();
+    checkpointCountdown = CHECKPOINT_JUMPS;
+    nextCheckpoint = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count()
+                     + checkpointInterval;
+}
+
+template <typename Value>
+void Program<Value>::resume(EvalState<Value> & state)
+{
+    if (paused == END_OF_IMAGE) error("CAN'T CONTINUE");
+    if (traps.count(paused)) traps[paused]->resume();
+    execute(state, paused, false);
+}
+
+template <typename Value>
+void Program<Value>::step(EvalState<Value> & state)
+{
+    if (paused == END_OF_IMAGE) error("CAN'T CONTINUE");
+    if (traps.count(paused)) traps[paused]->resume();
+    execute(state, paused, true);
+}
+
+/*
+ * Implementation notes: execute
+ * -----------------------------
+ * The files stay open while the run is paused, and are closed when it
+ * ends, fails or is abandoned by the next RUN.  A trap that stopped
+ * after its line leaves the run to continue from the line after it.
+ */
+
+template <typename Value>
+void Program<Value>::execute(EvalState<Value> & state, int pc_index, bool step)
+{
+    paused = END_OF_IMAGE;
+    int stop;
+    try {
+        if (step){
+            stop = runImage<true, false>(state, pc_index);
+        }else if (checkpoint.isOpen()){
+            stop = runImage<false, true>(state, pc_index);
+        }else{
+            stop = runImage<false, false>(state, pc_index);
+        }
+    } catch (ErrorException &) {
+        try {
+            files.closeAll();
+        } catch (ErrorException &) {
+            //the first error is the one reported
+        }
+        throw;
+    }
+    if (stop != END_OF_IMAGE && traps.count(stop) && traps[stop]->stoppedAfter()){
+        stop = image[stop].next;
+    }
+    if (stop == END_OF_IMAGE){
+        files.closeAll();
+        return;
+    }
+    paused = stop;
+    if (step) cout << "AT LINE " << code.getNumber(image[stop].source) << endl;
+}
+
+template <typename Value>
+template <bool STEP, bool SAVE>
+int Program<Value>::runImage(EvalState<Value> & state, int pc_index)
+{
+    while (pc_index != END_OF_IMAGE){
+        ExecLine & line = image[pc_index];
+        if (line.stmt == NULL) parseLine(line);
+        state.setPC(EvalState<Value>::SEQUENTIAL);  //default
+        line.stmt->execute(state);
+        int pc = state.getPC();
+        if (pc == EvalState<Value>::HALT){          //end
+            return END_OF_IMAGE;
+        }else if (pc == EvalState<Value>::SEQUENTIAL){
+            pc_index = line.next;
+        }else if (pc == EvalState<Value>::CALL){
+            state.pushReturn(line.next);
+            pc_index = line.jump;
+            if (pc_index == NO_LINE){
+                error("LINE NUMBER ERROR");
+            }
+        }else if (pc == EvalState<Value>::RETURN){
+            pc_index = state.popReturn();
+        }else if (pc == EvalState<Value>::BREAK){   //trap
+            return pc_index;
+        }else if (pc == EvalState<Value>::JUMP){    //ON GOTO
+            pc_index = state.getJump();
+            if (pc_index == NO_LINE){
+                error("LINE NUMBER ERROR");
+            }
+        }else{                               //jump
+            pc_index = (pc == line.target) ? line.jump : findJump(pc);
+            if (pc_index == NO_LINE){
+                error("LINE NUMBER ERROR");
+            }
+        }
+        if (STEP) return pc_index;
+        if (SAVE && pc != EvalState<Value>::SEQUENTIAL && --checkpointCountdown == 0){
+            checkpointIfDue(state, pc_index);
+        }
+    }
+    return END_OF_IMAGE;
 }
+
+/*
+ * Implementation notes: checkpointIfDue
+ * -------------------------------------
+ * The clock is read once every CHECKPOINT_JUMPS jumps, since every
+ * loop of a program jumps and a read of the clock costs more than a
+ * line.  Between two lines, the run is the state, the index of the
+ * next line and nothing else; the index is saved as its line number,
+ * after the state, so that the arrays the state saves first keep their
+ * offsets in the file from one checkpoint to the next.
+ */
+
+template <typename Value>
+void Program<Value>::checkpointIfDue(EvalState<Value> & state, int pc_index)
+{
+    checkpointCountdown = CHECKPOINT_JUMPS;
+    long long now = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    if (now < nextCheckpoint || pc_index == END_OF_IMAGE) return;
+    const vector<int> & numbers = imageNumbers();
+    string contents;
+    putString(contents, ValueTraits<Value>::NAME);
+    putNumber(contents, fingerprint());
+    state.save(contents, numbers);
+    putInteger(contents, numbers[pc_index]);
+    checkpoint.write(contents);
+    nextCheckpoint = now + checkpointInterval;
+}
+
+template <typename Value>
+unsigned long long Program<Value>::fingerprint()
+{
+    if (hashed) return sourceHash;
+    unsigned long long hash = 14695981039346656037ULL;
+    for (int i = 0; i < code.size(); i++){
+        string line = code.getSource(i);
+        for (size_t k = 0; k <= line.size(); k++){
+            hash = (hash ^ (unsigned char) (k < line.size() ? line[k] : '\n')) * 1099511628211ULL;
+        }
+    }
+    sourceHash = hash;
+    hashed = true;
+    return hash;
+}
+
+template <typename Value>
+const vector<int> & Program<Value>::imageNumbers()
+{
+    if (imageLines.size() != image.size()){
+        imageLines.resize(image.size());
+        for (size_t k = 0; k < image.size(); k++){
+            imageLines[k] = code.getNumber(image[k].source);
+        }
+    }
+    return imageLines;
+}
+
+template <typename Value>
+void Program<Value>::setCheckpoint(string path, int seconds)
+{
+    if (path.empty()){
+        checkpoint.close();
+        return;
+    }
+    if (seconds < 0) error("SYNTAX ERROR");
+    if (!checkpoint.open(path)) error("CHECKPOINT ERROR");
+    checkpointInterval = seconds * 1000000LL;
+}
+
+/*
+ * Implementation notes: restore
+ * -----------------------------
+ * The lines of the image are in line order, so load finds the index
+ * of a saved line number by binary search.
+ */
+
+template <typename Value>
+void Program<Value>::restore(EvalState<Value> & state, string path)
+{
+    string contents;
+    if (!CheckpointFile::read(path, contents)) error("NO CHECKPOINT");
+    startRun(state);
+    CheckpointReader in(contents);
+    if (in.readString() != ValueTraits<Value>::NAME || in.readNumber() != fingerprint()){
+        error("CHECKPOINT DOES NOT MATCH PROGRAM");
+    }
+    const vector<int> & numbers = imageNumbers();
+    state.load(in, numbers);
+    long long number = in.readInteger();
+    vector<int>::const_iterator it = lower_bound(numbers.begin(), numbers.end(), number);
+    if (it == numbers.end() || *it != number) error("CHECKPOINT DOES NOT MATCH PROGRAM");
+    execute(state, it - numbers.begin(), false);
+}
+
+template <typename Value>
+void Program<Value>::setBreakpoint(int lineNumber, bool on)
+{
+    if (on){
+        if (code.find(lineNumber) < 0) error("LINE NUMBER ERROR");
+        breakpoints.insert(lineNumber);
+    }else{
+        breakpoints.erase(lineNumber);
+    }
+    if (paused != END_OF_IMAGE) armTraps();
+}
+
+template <typename Value>
+void Program<Value>::setWatch(string name, bool on)
+{
+    if (on){
+        watches.insert(name);
+    }else{
+        watches.erase(name);
+    }
+    if (paused != END_OF_IMAGE) armTraps();
+}
+
+/*
+ * Implementation notes: armTraps
+ * ------------------------------
+ * The traps of the last arming are taken out first, so each line has
+ * at most one, and a trap that is set again starts with no breakpoint
+ * passed.  Lines not yet parsed are armed when they are parsed.
+ */
+
+template <typename Value>
+void Program<Value>::armTraps()
+{
+    for (typename map<int, TrapStatement<Value> *>::iterator it = traps.begin(); it != traps.end(); it++){
+        image[it->first].stmt = it->second->getOriginal();
+        delete it->second;
+    }
+    traps.clear();
+    if (breakpoints.empty() && watches.empty()) return;
+    for (size_t k = 0; k < image.size(); k++){
+        armLine(k);
+    }
+}
+
+template <typename Value>
+void Program<Value>::armLine(int index)
+{
+    ExecLine & line = image[index];
+    if (line.stmt == NULL) return;
+    bool stop = breakpoints.count(code.getNumber(line.source)) > 0;
+    string watch;
+    if (line.stmt->getType() == LET_STMT){
+        watch = ((LetStatement<Value> *) line.stmt)->getName();
+    }else if (line.stmt->getType() == INPUT_STMT){
+        watch = ((InputStatement<Value> *) line.stmt)->getName();
+    }
+    if (!watches.count(watch)) watch = "";
+    if (!stop && watch.empty()) return;
+    TrapStatement<Value> * trap = new TrapStatement<Value>(line.stmt, code.getNumber(line.source), stop, watch);
+    traps[index] = trap;
+    line.stmt = trap;
+}
+
+#define INSTANTIATE_PROGRAM(Value) \
+    template class LineStore<Value>; \
+    template class Program<Value>;
+FOR_EACH_VALUE_TYPE(INSTANTIATE_PROGRAM)
@@ -8,29 +8,73 @@
 #ifndef _program_h
 #define _program_h
 
-#include <string>
 #include <map>
-#include <memory>
+#include <set>
+#include <string>
+#include <vector>
 #include "statement.h"
+#include "checkpoint.h"
 #include "evalstate.h"
+#include "fileio.h"
+#include "function.h"
+#include "debug.h"
 using namespace std;
 
 /*
- * This class represent a line of the program, consist of the origin line and the parsed AST
+ * This class stores the lines of a program compactly, for programs with
+ * millions of lines.  Instead of a tree node, a string and a shared
+ * pointer per line, it keeps parallel arrays sorted by line number:
+ * the line numbers, the offset and length of each source line in one
+ * contiguous text buffer, and the statements, which it owns and which
+ * come, with their expression nodes, from the node pool.  Replacing
+ * or removing a line leaves its text as garbage in the buffer, which is
+ * compacted once garbage makes up half of it.
+ *
+ * When the source is not kept, the buffer stays empty and the text of
+ * a line is regenerated from its statement.
  */
-class ProgramLine
+template <typename Value>
+class LineStore
 {
     public:
-        ProgramLine(string origin_line, Statement * parsed_ast);
-        ProgramLine();
-        //excute the line
-        void execute(EvalState & state);
-        //Show the line
-        void show();
+        LineStore();
+        ~LineStore();
+        //remove all the lines
+        void clear();
+        //add a line, or replace the line with the same number; a NULL
+        //statement stores the line unparsed, and its source is kept
+        void put(int lineNumber, const string & line, Statement<Value> * stmt);
+        //remove a line, returns false if there is no such line
+        bool remove(int lineNumber);
+        //the number of lines
+        int size();
+        //the index of a line number, -1 if there is no such line
+        int find(int lineNumber);
+        //the components of the line at an index
+        int getNumber(int index);
+        Statement<Value> * getStatement(int index);
+        string getSource(int index);
+        //set the statement of an unparsed line
+        void setStatement(int index, Statement<Value> * stmt);
+        //the line numbers and statements, in line order
+        const vector<int> & getNumbers();
+        const vector<Statement<Value> *> & getStatements();
+        //keep the source text of the lines added from now on
+        void setKeepSource(bool flag);
     private:
-        //used smart pointer to handle the AST
-        shared_ptr<Statement> stmt;
-        string line;
+        //copy the live text into a new buffer
+        void compact();
+        //not copyable: the statements are owned
+        LineStore(const LineStore &);
+        LineStore & operator=(const LineStore &);
+
+        vector<int> numbers;
+        vector<unsigned int> offsets;
+        vector<unsigned int> lengths;
+        vector<Statement<Value> *> stmts;
+        string text;
+        size_t garbage;
+        bool keepSource;
 };
 
 
@@ -45,8 +89,11 @@ class ProgramLine
  *
  * 2. The parsed representation of that statement, which is a
  *    pointer to a Statement.
+ *
+ * The lines are kept in a LineStore.
  */
 
+template <typename Value>
 class Program {
 
 public:
@@ -84,10 +131,11 @@ public:
  * -----------------------------------------------
  * Adds a source line to the program with the specified line number.
  * If that line already exists, the line replaces the old one.
- * if the line is new, it is added.
+ * if the line is new, it is added.  A NULL ast stores the line
+ * unparsed: it is parsed the first time a run reaches it.
  */
 
-   void addSourceLine(int lineNumber, std::string line, Statement * parsed_line);
+   void addSourceLine(int lineNumber, std::string line, Statement<Value> * parsed_line);
 
 /*
  * Method: removeSourceLine
@@ -114,15 +162,354 @@ public:
  * Method: run
  * Usage: program.run()
  * ---------------------------------------------
- *  Run the program.
+ *  Run the program.  The files it leaves open are closed when it
+ *  stops, however it stops, unless a trap of the debugger stops it.
+ */
+
+   void run(EvalState<Value> & state);
+
+/*
+ * Methods: setBreakpoint, setWatch
+ * Usage: program.setBreakpoint(lineNumber, true);
+ *        program.setWatch(var, false);
+ * -----------------------------------------------
+ * Set or clear a breakpoint, which stops a run before the line with
+ * the number, or a watchpoint, which stops it after every LET or INPUT
+ * that assigns the variable.  While any is set, RUN links the lines
+ * without the optimized forms that run several lines at once, so that
+ * every line stops where it should.
+ */
+
+   void setBreakpoint(int lineNumber, bool on);
+   void setWatch(std::string var, bool on);
+
+/*
+ * Methods: resume, step
+ * Usage: program.resume(state);
+ * -----------------------------
+ * Continue a run stopped by the debugger from the line it stopped at:
+ * resume runs until the program or a trap stops it, and step runs one
+ * line and stops again, reporting the line it stops before.  They
+ * raise an error if no run is stopped, or the lines have changed
+ * since it stopped.
+ */
+
+   void resume(EvalState<Value> & state);
+   void step(EvalState<Value> & state);
+
+/*
+ * Methods: setCheckpoint, restore
+ * Usage: program.setCheckpoint(path, seconds);
+ *        program.restore(state, path);
+ * --------------------------------------------
+ * setCheckpoint makes the runs from now on save their state into the
+ * checkpoint file at path, between two lines, once every so many
+ * seconds; an empty path stops it.  restore loads the latest
+ * checkpoint of the file at path into state and continues the run it
+ * was saved from.  It raises an error if the file holds no checkpoint
+ * or the checkpoint is of another program or value type.  The open
+ * files are not saved, so a continued run starts with none.  While a
+ * checkpoint file is set, RUN links the lines without the optimized
+ * forms that run several lines at once, so that a long loop is still
+ * saved.
+ */
+
+   void setCheckpoint(std::string path, int seconds);
+   void restore(EvalState<Value> & state, std::string path);
+
+/*
+ * Method: link
+ * Usage: program.link()
+ * ---------------------------------------------
+ *  Build the executable image RUN would use and report how many lines
+ *  and jumps the optimizer eliminated.
+ */
+
+   void link();
+
+/*
+ * Method: prelink
+ * Usage: program.prelink();
+ * -------------------------
+ * Builds the executable image RUN would use, without reporting, so
+ * that the runs to come start at once.
+ */
+
+   void prelink();
+
+/*
+ * Method: setKeepSource
+ * Usage: program.setKeepSource(false);
+ * --------------------------------------------
+ * Chooses whether the source text of the lines added from now on is
+ * kept.  Without it LIST regenerates each line from its statement,
+ * which is what the original line parses to.
+ */
+
+   void setKeepSource(bool flag);
+
+/*
+ * Methods: setLazy, isLazy
+ * Usage: program.setLazy(true);
+ * --------------------------------------------
+ * In lazy mode the lines are stored unparsed and each is parsed the
+ * first time a run reaches it, so a syntax error is reported when the
+ * line would run.
+ */
+
+   void setLazy(bool flag);
+   bool isLazy();
+
+/*
+ * Method: check
+ * Usage: program.check()
+ * --------------------------------------------
+ * Parses every unparsed line and reports all the syntax errors.
  */
 
-   void run(EvalState & state);
+   void check();
 
 private:
 
-   //the map to store the code
-   map<int, ProgramLine> code;
+   static const int END_OF_IMAGE = -1;  //index after the last line to run
+   static const int NO_LINE = -2;       //index of a jump to a missing line
+   static const int CHECKPOINT_JUMPS = 1024;  //jumps between looks at the clock
+
+/*
+ * This struct is an entry of the executable image: a line that can be
+ * reached, with its jumps resolved to image indices.
+ */
+
+   struct ExecLine {
+      Statement<Value> * stmt;  //NULL until the line is parsed
+      int source;    //index of the line in the store
+      int target;    //line number the statement jumps to, -1 if none
+      int jump;      //image index of that target, or NO_LINE
+      int next;      //image index of the line that follows it
+   };
+
+/*
+ * This struct is a slot of the line table, which maps a line number to
+ * the image index of a jump there.  line is -1 in an empty slot.
+ */
+
+   struct LineSlot {
+      int line;
+      int index;
+   };
+
+/*
+ * Method: prepare
+ * Usage: prepare();
+ * -----------------
+ * Brings the analyses, the optimized forms of the lines and the
+ * executable image up to date with the source, if it changed since
+ * the last run.
+ */
+
+   void prepare();
+
+/*
+ * Method: matchNext
+ * Usage: int j = matchNext(i);
+ * ----------------------------
+ * Returns the index in the store of the NEXT that closes the FOR at
+ * index i, or -1 if there is none.
+ */
+
+   int matchNext(int i);
+
+/*
+ * Method: linkLoop
+ * Usage: linkLoop(i);
+ * -------------------
+ * Sets the lines the FOR at index i of the store jumps to, and links
+ * its matching NEXT back to it.
+ */
+
+   void linkLoop(int i);
+
+/*
+ * Method: linkTargets
+ * Usage: linkTargets(i);
+ * ----------------------
+ * Sets the image indexes the ON GOTO at index i of the store jumps to,
+ * once the image is built.
+ */
+
+   void linkTargets(int i);
+
+/*
+ * Method: buildImage
+ * Usage: buildImage(exec);
+ * ------------------------
+ * Links the lines into the executable image.  exec gives the statement
+ * to run for each line of the store.
+ */
+
+   void buildImage(vector<Statement<Value> *> & exec);
+
+/*
+ * Method: findJump
+ * Usage: int pc_index = findJump(lineNumber);
+ * -------------------------------------------
+ * Returns the image index to run for a jump to a line number that is
+ * known only when the jump runs, or NO_LINE if there is no such line.
+ */
+
+   int findJump(int lineNumber);
+
+/*
+ * Method: parseLine
+ * Usage: parseLine(line);
+ * -----------------------
+ * Parses an unparsed line of the image when a run reaches it.
+ */
+
+   void parseLine(ExecLine & line);
+
+/*
+ * Method: replaceLines
+ * Usage: replaceLines(exec);
+ * --------------------------
+ * Puts the optimized forms of the lines that have one into exec, and
+ * keeps them in fast.
+ */
+
+   void replaceLines(vector<Statement<Value> *> & exec);
+
+/*
+ * Method: startRun
+ * Usage: startRun(state);
+ * -----------------------
+ * Abandons a stopped run, links the program if needed and sets up
+ * state for a run of it, with the sequence of RND restarted.
+ */
+
+   void startRun(EvalState<Value> & state);
+
+/*
+ * Method: execute
+ * Usage: execute(state, pc_index, false);
+ * ---------------------------------------
+ * Runs the image from an index, or only the line there if step is
+ * true, and records where a trap or the step stopped it.
+ */
+
+   void execute(EvalState<Value> & state, int pc_index, bool step);
+
+/*
+ * Method: runImage
+ * Usage: int stop = runImage<false, false>(state, pc_index);
+ * ----------------------------------------------------------
+ * Runs the lines of the image from an index until the program stops,
+ * or only one line if STEP is true.  Returns the index of the line a
+ * trap stopped at or the next line of a step, and END_OF_IMAGE if the
+ * program ended.  A loop without STEP checks nothing per line; with
+ * SAVE it counts the jumps, to save a checkpoint when one is due.
+ */
+
+   template <bool STEP, bool SAVE>
+   int runImage(EvalState<Value> & state, int pc_index);
+
+/*
+ * Methods: checkpointIfDue, fingerprint, imageNumbers
+ * Usage: checkpointIfDue(state, pc_index);
+ * ----------------------------------------
+ * checkpointIfDue saves the state of the run, about to continue at an
+ * image index, if the time for a checkpoint has come.  fingerprint
+ * hashes the lines of the program, so that a checkpoint is only
+ * restored into the program it was saved from, and imageNumbers
+ * returns the line number of each index of the image.  Both are
+ * computed once per prepare.
+ */
+
+   void checkpointIfDue(EvalState<Value> & state, int pc_index);
+   unsigned long long fingerprint();
+   const std::vector<int> & imageNumbers();
+
+/*
+ * Methods: armTraps, armLine
+ * Usage: armTraps();
+ * ------------------
+ * Put the traps of the breakpoints and watchpoints into the image in
+ * place of the statements of their lines, after removing the traps
+ * there; armLine does it for the line at one index.
+ */
+
+   void armTraps();
+   void armLine(int index);
+
+   //the lines of the code
+   LineStore<Value> code;
+
+   //the functions defined by the DEF lines, built by prepare
+   FunctionTable<Value> functions;
+
+   //the constants of the DATA lines, built by prepare
+   vector<Value> data;
+
+   //the files the program opens, all closed when a run stops
+   FileTable files;
+
+   //false when the lines changed since the last prepare
+   bool prepared;
+
+   //store new lines unparsed
+   bool lazy;
+
+   //the reachable lines in line order, and where to start
+   vector<ExecLine> image;
+   int entry;
+
+   //the optimized forms of lines, built by prepare
+   vector<Statement<Value> *> fast;
+
+   //the memos of the common subexpressions and of the loop invariants,
+   //and the clocks watching the variables they read, built by prepare
+   vector<ExpMemo<Value> > memos;
+   vector<ExpMemo<Value> > invariants;
+   map<string, vector<int> > watched;
+
+   //for each line of the store, the image index to run for a jump there
+   vector<int> jumpIndex;
+
+   //the same by line number, direct-mapped, and the shift of its hash
+   vector<LineSlot> lineTable;
+   int lineShift;
+
+   //what the last link eliminated
+   int eliminatedLines;
+   int threadedJumps;
+
+   //the breakpoints by line number and the watched variables
+   set<int> breakpoints;
+   set<string> watches;
+
+   //the traps in the image, by index
+   map<int, TrapStatement<Value> *> traps;
+
+   //the index a run stopped by the debugger continues from, or
+   //END_OF_IMAGE
+   int paused;
+
+   //true if the image was linked for the debugger, or while a
+   //checkpoint file was set
+   bool debugImage;
+   bool checkpointImage;
+
+   //the checkpoint file, the microseconds between checkpoints, when the
+   //next is due on the steady clock, and the jumps until it is checked
+   CheckpointFile checkpoint;
+   long long checkpointInterval;
+   long long nextCheckpoint;
+   int checkpointCountdown;
+
+   //the line number of each image index and the fingerprint of the
+   //lines, made by the first checkpoint after prepare
+   std::vector<int> imageLines;
+   unsigned long long sourceHash;
+   bool hashed;
 
 };
 
@@ -7,122 +7,1019 @@
  * BASIC statements.
  */
 
+#include <climits>
 #include <string>
 #include "statement.h"
+#include "../StanfordCPPLib/strlib.h"
 #include "utility.h"
+#include "matrix.h"
 using namespace std;
 
 /* Implementation of the Statement class */
 
-Statement::Statement() {
+template <typename Value>
+Statement<Value>::Statement() {
    /* Empty */
 }
 
-Statement::~Statement() {
+template <typename Value>
+Statement<Value>::~Statement() {
    /* Empty */
 }
 
 /* Implementation of the let statement class */
 
-LetStatement::LetStatement(std::string init_name, Expression * init_exp):name(init_name), exp(init_exp) {}
+template <typename Value>
+LetStatement<Value>::LetStatement(std::string init_name, Expression<Value> * init_exp):name(init_name), exp(init_exp) {}
 
-LetStatement::~LetStatement()
+template <typename Value>
+LetStatement<Value>::~LetStatement()
 {
     delete exp;
 }
 
-void LetStatement::execute(EvalState & state)
+template <typename Value>
+void LetStatement<Value>::execute(EvalState<Value> & state)
 {
-    int res = exp->eval(state);
+    Value res = exp->eval(state);
     state.setValue(name, res);
 }
 
-/* Implementation of the RemStatement class */
+template <typename Value>
+StatementType LetStatement<Value>::getType()
+{
+    return LET_STMT;
+}
 
-RemStatement::RemStatement() {
-   /* Empty */
+template <typename Value>
+string LetStatement<Value>::toString()
+{
+    return "LET " + name + " = " + exp->toString();
+}
+
+template <typename Value>
+string LetStatement<Value>::getName()
+{
+    return name;
+}
+
+template <typename Value>
+Expression<Value> * LetStatement<Value>::getExp()
+{
+    return exp;
 }
 
-RemStatement::~RemStatement() {
+/* Implementation of the RemStatement class */
+
+template <typename Value>
+RemStatement<Value>::RemStatement(std::string init_text):text(init_text) {}
+
+template <typename Value>
+RemStatement<Value>::~RemStatement() {
    /* Empty */
 }
 
-void RemStatement::execute(EvalState & state)
+template <typename Value>
+void RemStatement<Value>::execute(EvalState<Value> & state)
 {
   /* Empty */
 }
 
+template <typename Value>
+StatementType RemStatement<Value>::getType()
+{
+    return REM_STMT;
+}
+
+template <typename Value>
+string RemStatement<Value>::toString()
+{
+    return text.empty() ? "REM" : "REM " + text;
+}
+
 /* Implementation of the input statement class */
 
-InputStatement::InputStatement(std::string init_name):name(init_name) {}
+template <typename Value>
+InputStatement<Value>::InputStatement(std::string init_name):name(init_name) {}
 
-InputStatement::~InputStatement()
+template <typename Value>
+InputStatement<Value>::~InputStatement()
 {
     /* Empty */
 }
 
-void InputStatement::execute(EvalState & state)
+template <typename Value>
+void InputStatement<Value>::execute(EvalState<Value> & state)
 {
-    int res = input_int();
+    Value res = input_value<Value>();
     state.setValue(name, res);
 }
 
+template <typename Value>
+StatementType InputStatement<Value>::getType()
+{
+    return INPUT_STMT;
+}
+
+template <typename Value>
+string InputStatement<Value>::toString()
+{
+    return "INPUT " + name;
+}
+
+template <typename Value>
+string InputStatement<Value>::getName()
+{
+    return name;
+}
+
 /* Implementation of the print statement class */
 
-PrintStatement::PrintStatement(Expression * init_exp):exp(init_exp) {}
+template <typename Value>
+PrintStatement<Value>::PrintStatement(Expression<Value> * init_exp):exp(init_exp) {}
 
-PrintStatement::~PrintStatement()
+template <typename Value>
+PrintStatement<Value>::~PrintStatement()
 {
     delete exp;
 }
 
-void PrintStatement::execute(EvalState & state)
+template <typename Value>
+void PrintStatement<Value>::execute(EvalState<Value> & state)
+{
+    Value res = exp->eval(state);
+    ValueTraits<Value>::print(cout, res);
+    cout << endl;
+}
+
+template <typename Value>
+StatementType PrintStatement<Value>::getType()
+{
+    return PRINT_STMT;
+}
+
+template <typename Value>
+string PrintStatement<Value>::toString()
 {
-    int res = exp->eval(state);
-    cout << res <<endl;
+    return "PRINT " + exp->toString();
+}
+
+template <typename Value>
+Expression<Value> * PrintStatement<Value>::getExp()
+{
+    return exp;
 }
 
 /* Implementation of the EndStatement class */
 
-EndStatement::EndStatement() {
+template <typename Value>
+EndStatement<Value>::EndStatement() {
    /* Empty */
 }
 
-EndStatement::~EndStatement() {
+template <typename Value>
+EndStatement<Value>::~EndStatement() {
    /* Empty */
 }
 
-void EndStatement::execute(EvalState & state)
+template <typename Value>
+void EndStatement<Value>::execute(EvalState<Value> & state)
+{
+    state.setPC(EvalState<Value>::HALT);
+}
+
+template <typename Value>
+StatementType EndStatement<Value>::getType()
 {
-    state.setPC(EvalState::HALT);
+    return END_STMT;
+}
+
+template <typename Value>
+string EndStatement<Value>::toString()
+{
+    return "END";
 }
 
 /* Implementation of the GotoStatement class */
 
-GotoStatement::GotoStatement(LineNumber * ln) :line_number(ln) {}
+template <typename Value>
+GotoStatement<Value>::GotoStatement(LineNumber * ln) :line_number(ln) {}
 
-GotoStatement::~GotoStatement() {
+template <typename Value>
+GotoStatement<Value>::~GotoStatement() {
    delete line_number;
 }
 
-void GotoStatement::execute(EvalState & state)
+template <typename Value>
+void GotoStatement<Value>::execute(EvalState<Value> & state)
 {
     state.setPC(line_number->eval(state));
 }
 
+template <typename Value>
+StatementType GotoStatement<Value>::getType()
+{
+    return GOTO_STMT;
+}
+
+template <typename Value>
+string GotoStatement<Value>::toString()
+{
+    return "GOTO " + integerToString(line_number->getValue());
+}
+
+template <typename Value>
+int GotoStatement<Value>::getTarget()
+{
+    return line_number->getValue();
+}
+
+/* Implementation of the OnGotoStatement class */
+
+template <typename Value>
+OnGotoStatement<Value>::OnGotoStatement(Expression<Value> * init_exp, vector<int> init_targets)
+    :exp(init_exp), targets(init_targets) {}
+
+template <typename Value>
+OnGotoStatement<Value>::~OnGotoStatement() {
+   delete exp;
+}
+
+template <typename Value>
+void OnGotoStatement<Value>::execute(EvalState<Value> & state)
+{
+    long long k = ValueTraits<Value>::toInteger(exp->eval(state));
+    if (k < 1 || k > (long long) targets.size()) return;
+    if (indexes.empty()){
+        state.setPC(targets[k - 1]);
+    }else{
+        state.setJump(indexes[k - 1]);
+    }
+}
+
+template <typename Value>
+StatementType OnGotoStatement<Value>::getType()
+{
+    return ON_GOTO_STMT;
+}
+
+template <typename Value>
+string OnGotoStatement<Value>::toString()
+{
+    string str = "ON " + exp->toString() + " GOTO ";
+    for (size_t i = 0; i < targets.size(); i++){
+        if (i > 0) str += ", ";
+        str += integerToString(targets[i]);
+    }
+    return str;
+}
+
+template <typename Value>
+Expression<Value> * OnGotoStatement<Value>::getExp()
+{
+    return exp;
+}
+
+template <typename Value>
+int OnGotoStatement<Value>::getCount()
+{
+    return targets.size();
+}
+
+template <typename Value>
+int OnGotoStatement<Value>::getTarget(int i)
+{
+    return targets[i];
+}
+
+template <typename Value>
+void OnGotoStatement<Value>::setIndexes(const vector<int> & init_indexes)
+{
+    indexes = init_indexes;
+}
+
+/* Implementation of the ComputedGotoStatement class */
+
+template <typename Value>
+ComputedGotoStatement<Value>::ComputedGotoStatement(Expression<Value> * init_exp) :exp(init_exp) {}
+
+template <typename Value>
+ComputedGotoStatement<Value>::~ComputedGotoStatement() {
+   delete exp;
+}
+
+template <typename Value>
+void ComputedGotoStatement<Value>::execute(EvalState<Value> & state)
+{
+    long long line = ValueTraits<Value>::toInteger(exp->eval(state));
+    if (line < 0 || line > INT_MAX){
+        error("LINE NUMBER ERROR");
+    }
+    state.setPC(line);
+}
+
+template <typename Value>
+StatementType ComputedGotoStatement<Value>::getType()
+{
+    return COMPUTED_GOTO_STMT;
+}
+
+template <typename Value>
+string ComputedGotoStatement<Value>::toString()
+{
+    return "GOTO " + exp->toString();
+}
+
+template <typename Value>
+Expression<Value> * ComputedGotoStatement<Value>::getExp()
+{
+    return exp;
+}
+
 /* Implementation of the IfStatement class */
 
-IfStatement::IfStatement(BoolExp * exp, LineNumber * ln):cond(exp), line_number(ln) {}
+template <typename Value>
+IfStatement<Value>::IfStatement(BoolExp<Value> * exp, LineNumber * ln):cond(exp), line_number(ln) {}
 
-IfStatement::~IfStatement() {
+template <typename Value>
+IfStatement<Value>::~IfStatement() {
    delete cond;
    delete line_number;
 }
 
-void IfStatement::execute(EvalState & state)
+template <typename Value>
+void IfStatement<Value>::execute(EvalState<Value> & state)
 {
     bool res = cond->eval(state);
     if (res){
         state.setPC(line_number->eval(state));
     }
 }
+
+template <typename Value>
+StatementType IfStatement<Value>::getType()
+{
+    return IF_STMT;
+}
+
+template <typename Value>
+string IfStatement<Value>::toString()
+{
+    return "IF " + cond->toString() + " THEN " + integerToString(line_number->getValue());
+}
+
+template <typename Value>
+BoolExp<Value> * IfStatement<Value>::getCond()
+{
+    return cond;
+}
+
+template <typename Value>
+int IfStatement<Value>::getTarget()
+{
+    return line_number->getValue();
+}
+
+/* Implementation of the GosubStatement class */
+
+template <typename Value>
+GosubStatement<Value>::GosubStatement(LineNumber * ln) :line_number(ln) {}
+
+template <typename Value>
+GosubStatement<Value>::~GosubStatement() {
+   delete line_number;
+}
+
+template <typename Value>
+void GosubStatement<Value>::execute(EvalState<Value> & state)
+{
+    state.setPC(EvalState<Value>::CALL);
+}
+
+template <typename Value>
+StatementType GosubStatement<Value>::getType()
+{
+    return GOSUB_STMT;
+}
+
+template <typename Value>
+string GosubStatement<Value>::toString()
+{
+    return "GOSUB " + integerToString(line_number->getValue());
+}
+
+template <typename Value>
+int GosubStatement<Value>::getTarget()
+{
+    return line_number->getValue();
+}
+
+/* Implementation of the ReturnStatement class */
+
+template <typename Value>
+ReturnStatement<Value>::ReturnStatement() {
+   /* Empty */
+}
+
+template <typename Value>
+ReturnStatement<Value>::~ReturnStatement() {
+   /* Empty */
+}
+
+template <typename Value>
+void ReturnStatement<Value>::execute(EvalState<Value> & state)
+{
+    state.setPC(EvalState<Value>::RETURN);
+}
+
+template <typename Value>
+StatementType ReturnStatement<Value>::getType()
+{
+    return RETURN_STMT;
+}
+
+template <typename Value>
+string ReturnStatement<Value>::toString()
+{
+    return "RETURN";
+}
+
+/* Implementation of the ForStatement class */
+
+template <typename Value>
+ForStatement<Value>::ForStatement(string init_name, Expression<Value> * init_from, Expression<Value> * init_to, Expression<Value> * init_step)
+    :name(init_name), from(init_from), to(init_to), step(init_step), body(EvalState<Value>::HALT), exit(-1),
+     parallel(false) {}
+
+template <typename Value>
+ForStatement<Value>::~ForStatement()
+{
+    delete from;
+    delete to;
+    delete step;
+}
+
+/*
+ * Implementation notes: ForStatement::execute
+ * -------------------------------------------
+ * The limit and the step are evaluated once, here, and kept in the
+ * loop frame together with the storage of the variable, so that NEXT
+ * neither evaluates an expression nor looks up a variable.  Since the
+ * variable is not assigned through setValue, FOR and NEXT end the
+ * epochs of the clocks watching it themselves.
+ */
+
+template <typename Value>
+void ForStatement<Value>::execute(EvalState<Value> & state)
+{
+    Value first = from->eval(state);
+    LoopFrame<Value> frame;
+    frame.limit = to->eval(state);
+    frame.step = (step == NULL) ? 1 : step->eval(state);
+    frame.var = state.getReference(name);
+    frame.body = body;
+    frame.name = &name;
+    frame.clocks = state.getClocks(name);
+    *frame.var = first;
+    state.nextEpoch(frame.clocks);
+    if ((frame.step >= 0) ? first > frame.limit : first < frame.limit){
+        if (exit == -1) error("FOR WITHOUT NEXT");
+        state.setPC(exit);
+        return;
+    }
+    state.pushLoop(frame);
+}
+
+template <typename Value>
+StatementType ForStatement<Value>::getType()
+{
+    return FOR_STMT;
+}
+
+template <typename Value>
+string ForStatement<Value>::toString()
+{
+    string res = "FOR " + name + " = " + from->toString() + " TO " + to->toString();
+    if (step != NULL) res += " STEP " + step->toString();
+    if (!parallel) return res;
+    for (size_t i = 0; i < reductions.size(); i++){
+        res += (i == 0) ? " REDUCE " : ", ";
+        res += reductions[i];
+    }
+    return "PARALLEL " + res;
+}
+
+template <typename Value>
+void ForStatement<Value>::setParallel(const vector<string> & init_reductions)
+{
+    parallel = true;
+    reductions = init_reductions;
+}
+
+template <typename Value>
+bool ForStatement<Value>::isParallel()
+{
+    return parallel;
+}
+
+template <typename Value>
+const vector<string> & ForStatement<Value>::getReductions()
+{
+    return reductions;
+}
+
+template <typename Value>
+void ForStatement<Value>::setLines(int init_body, int init_exit)
+{
+    body = init_body;
+    exit = init_exit;
+}
+
+template <typename Value>
+string ForStatement<Value>::getName()
+{
+    return name;
+}
+
+template <typename Value>
+Expression<Value> * ForStatement<Value>::getFrom()
+{
+    return from;
+}
+
+template <typename Value>
+Expression<Value> * ForStatement<Value>::getTo()
+{
+    return to;
+}
+
+template <typename Value>
+Expression<Value> * ForStatement<Value>::getStep()
+{
+    return step;
+}
+
+template <typename Value>
+int ForStatement<Value>::getExit()
+{
+    return exit;
+}
+
+/* Implementation of the NextStatement class */
+
+template <typename Value>
+NextStatement<Value>::NextStatement(string init_name):name(init_name), body(-1) {}
+
+template <typename Value>
+NextStatement<Value>::~NextStatement()
+{
+    /* Empty */
+}
+
+/*
+ * Implementation notes: NextStatement::execute
+ * --------------------------------------------
+ * ValueTraits::advance adds the step exactly, so a loop up to the
+ * largest value ends instead of wrapping around.
+ */
+
+template <typename Value>
+void NextStatement<Value>::execute(EvalState<Value> & state)
+{
+    LoopFrame<Value> * frame = state.findLoop(name);
+    if (frame == NULL) error("NEXT WITHOUT FOR");
+    state.nextEpoch(frame->clocks);
+    if (ValueTraits<Value>::advance(*frame->var, frame->step, frame->limit)){
+        state.setPC(frame->body);
+    }else{
+        state.popLoop();
+    }
+}
+
+template <typename Value>
+StatementType NextStatement<Value>::getType()
+{
+    return NEXT_STMT;
+}
+
+template <typename Value>
+string NextStatement<Value>::toString()
+{
+    return name.empty() ? "NEXT" : "NEXT " + name;
+}
+
+template <typename Value>
+void NextStatement<Value>::setBody(int init_body)
+{
+    body = init_body;
+}
+
+template <typename Value>
+int NextStatement<Value>::getBody()
+{
+    return body;
+}
+
+template <typename Value>
+string NextStatement<Value>::getName()
+{
+    return name;
+}
+
+/* Implementation of the DimStatement class */
+
+template <typename Value>
+DimStatement<Value>::DimStatement() {
+   /* Empty */
+}
+
+template <typename Value>
+DimStatement<Value>::~DimStatement()
+{
+    for (size_t i = 0; i < names.size(); i++){
+        delete rows[i];
+        delete cols[i];
+    }
+}
+
+template <typename Value>
+void DimStatement<Value>::addArray(string name, Expression<Value> * init_rows, Expression<Value> * init_cols)
+{
+    names.push_back(name);
+    slots.push_back(EvalState<Value>::arraySlot(name));
+    rows.push_back(init_rows);
+    cols.push_back(init_cols);
+}
+
+template <typename Value>
+void DimStatement<Value>::execute(EvalState<Value> & state)
+{
+    for (size_t i = 0; i < names.size(); i++){
+        long long r = ValueTraits<Value>::toInteger(rows[i]->eval(state));
+        long long c = (cols[i] == NULL) ? -1 : ValueTraits<Value>::toInteger(cols[i]->eval(state));
+        if (r < 0 || r >= INT_MAX || (cols[i] != NULL && (c < 0 || c >= INT_MAX))) error("SUBSCRIPT OUT OF RANGE");
+        state.dimArray(slots[i], r + 1, c + 1);
+    }
+}
+
+template <typename Value>
+StatementType DimStatement<Value>::getType()
+{
+    return DIM_STMT;
+}
+
+template <typename Value>
+string DimStatement<Value>::toString()
+{
+    string res = "DIM ";
+    for (size_t i = 0; i < names.size(); i++){
+        if (i > 0) res += ", ";
+        res += names[i] + "(" + rows[i]->toString();
+        if (cols[i] != NULL) res += ", " + cols[i]->toString();
+        res += ")";
+    }
+    return res;
+}
+
+template <typename Value>
+int DimStatement<Value>::getCount()
+{
+    return names.size();
+}
+
+template <typename Value>
+Expression<Value> * DimStatement<Value>::getRows(int i)
+{
+    return rows[i];
+}
+
+template <typename Value>
+Expression<Value> * DimStatement<Value>::getCols(int i)
+{
+    return cols[i];
+}
+
+/* Implementation of the ArrayLetStatement class */
+
+template <typename Value>
+ArrayLetStatement<Value>::ArrayLetStatement(ArrayExp<Value> * init_target, Expression<Value> * init_exp):target(init_target), exp(init_exp) {}
+
+template <typename Value>
+ArrayLetStatement<Value>::~ArrayLetStatement()
+{
+    delete target;
+    delete exp;
+}
+
+template <typename Value>
+void ArrayLetStatement<Value>::execute(EvalState<Value> & state)
+{
+    Value * element = target->locate(state);
+    *element = exp->eval(state);
+}
+
+template <typename Value>
+StatementType ArrayLetStatement<Value>::getType()
+{
+    return ARRAY_LET_STMT;
+}
+
+template <typename Value>
+string ArrayLetStatement<Value>::toString()
+{
+    return "LET " + target->toString() + " = " + exp->toString();
+}
+
+template <typename Value>
+ArrayExp<Value> * ArrayLetStatement<Value>::getTarget()
+{
+    return target;
+}
+
+template <typename Value>
+Expression<Value> * ArrayLetStatement<Value>::getExp()
+{
+    return exp;
+}
+
+/* Implementation of the MatStatement class */
+
+template <typename Value>
+MatStatement<Value>::MatStatement(MatOp init_op, string init_target, string init_a, string init_b,
+                           Expression<Value> * init_factor)
+    :op(init_op), target(init_target), a(init_a), b(init_b), factor(init_factor)
+{
+    targetSlot = (op == MAT_SUM || op == MAT_DOT) ? -1 : EvalState<Value>::arraySlot(target);
+    aSlot = EvalState<Value>::arraySlot(a);
+    bSlot = b.empty() ? -1 : EvalState<Value>::arraySlot(b);
+}
+
+template <typename Value>
+MatStatement<Value>::~MatStatement()
+{
+    delete factor;
+}
+
+//an operand array, which must exist
+template <typename Value>
+ArrayValue<Value> * MatStatement<Value>::operand(EvalState<Value> & state, int slot)
+{
+    ArrayValue<Value> * array = state.getArray(slot);
+    if (array == NULL) error("ARRAY NOT DEFINED");
+    return array;
+}
+
+//the target array, created again unless it has the given shape
+template <typename Value>
+ArrayValue<Value> * MatStatement<Value>::result(EvalState<Value> & state, int rows, int cols)
+{
+    ArrayValue<Value> * array = state.getArray(targetSlot);
+    if (array == NULL || array->rows != rows || array->cols != cols){
+        state.dimArray(targetSlot, rows, cols);
+        array = state.getArray(targetSlot);
+    }
+    return array;
+}
+
+/*
+ * Implementation notes: MatStatement::execute
+ * -------------------------------------------
+ * Element-wise operations need operands of the same shape; the product
+ * needs 2-D operands whose inner extents agree.  A target that is also
+ * an operand keeps its shape, except for the product, which is
+ * computed into a new buffer first.
+ */
+
+template <typename Value>
+void MatStatement<Value>::execute(EvalState<Value> & state)
+{
+    Value k = (factor == NULL) ? 0 : factor->eval(state);
+    ArrayValue<Value> * x = operand(state, aSlot);
+    ArrayValue<Value> * y = (bSlot < 0) ? NULL : operand(state, bSlot);
+    int n = x->data.size();
+    if (op != MAT_MULTIPLY && y != NULL && (x->rows != y->rows || x->cols != y->cols)){
+        error("DIMENSION MISMATCH");
+    }
+    switch (op){
+        case MAT_COPY:
+            if (targetSlot != aSlot){
+                result(state, x->rows, x->cols)->data = x->data;
+            }
+            break;
+        case MAT_ADD:
+            matAdd(&result(state, x->rows, x->cols)->data[0], &x->data[0], &y->data[0], n);
+            break;
+        case MAT_SUBTRACT:
+            matSubtract(&result(state, x->rows, x->cols)->data[0], &x->data[0], &y->data[0], n);
+            break;
+        case MAT_SCALE:
+            matScale(&result(state, x->rows, x->cols)->data[0], k, &x->data[0], n);
+            break;
+        case MAT_MULTIPLY: {
+            if (x->cols == 0 || y->cols == 0 || x->cols != y->rows) error("DIMENSION MISMATCH");
+            vector<Value> product((long long) x->rows * y->cols);
+            matMultiply(&product[0], &x->data[0], &y->data[0], x->rows, x->cols, y->cols);
+            result(state, x->rows, y->cols)->data.swap(product);
+            break;
+        }
+        case MAT_SUM:
+            state.setValue(target, matSum(&x->data[0], n));
+            break;
+        case MAT_DOT:
+            state.setValue(target, matDot(&x->data[0], &y->data[0], n));
+            break;
+    }
+}
+
+template <typename Value>
+StatementType MatStatement<Value>::getType()
+{
+    return MAT_STMT;
+}
+
+template <typename Value>
+string MatStatement<Value>::toString()
+{
+    switch (op){
+        case MAT_COPY: return "MAT " + target + " = " + a;
+        case MAT_ADD: return "MAT " + target + " = " + a + " + " + b;
+        case MAT_SUBTRACT: return "MAT " + target + " = " + a + " - " + b;
+        case MAT_MULTIPLY: return "MAT " + target + " = " + a + " * " + b;
+        case MAT_SCALE: return "MAT " + target + " = (" + factor->toString() + ") * " + a;
+        case MAT_SUM: return "MAT SUM " + target + " = " + a;
+        case MAT_DOT: return "MAT DOT " + target + " = " + a + ", " + b;
+    }
+    return "MAT";
+}
+
+template <typename Value>
+MatOp MatStatement<Value>::getOp()
+{
+    return op;
+}
+
+template <typename Value>
+string MatStatement<Value>::getTarget()
+{
+    return target;
+}
+
+template <typename Value>
+Expression<Value> * MatStatement<Value>::getFactor()
+{
+    return factor;
+}
+
+/*
+ * Implementation notes: the StringLetStatement class
+ * --------------------------------------------------
+ * LET A$ = A$ + X$ + Y$ is how a string is built up piece by piece, so
+ * it appends to A$ in place instead of copying A$ into a new value
+ * every time.  The appended operands are evaluated into a scratch
+ * string first, so they see the old value of A$ even if they read it,
+ * and A$ is only changed once they all evaluated without an error.
+ */
+
+template <typename Value>
+StringLetStatement<Value>::StringLetStatement(std::string init_name, StringExp<Value> * init_exp):name(init_name), exp(init_exp)
+{
+    StringExp<Value> * head = exp;
+    while (head->getType() == CONCAT){
+        appended.insert(appended.begin(), ((ConcatExp<Value> *) head)->getRHS());
+        head = ((ConcatExp<Value> *) head)->getLHS();
+    }
+    if (head->getType() != STRING_VARIABLE || ((StringVariableExp<Value> *) head)->getName() != name){
+        appended.clear();
+    }
+}
+
+template <typename Value>
+StringLetStatement<Value>::~StringLetStatement()
+{
+    delete exp;
+}
+
+template <typename Value>
+void StringLetStatement<Value>::execute(EvalState<Value> & state)
+{
+    if (!appended.empty()){
+        StringValue * value = state.getString(name);
+        if (value == NULL) error("VARIABLE NOT DEFINED");
+        scratch.clear();
+        for (size_t i = 0; i < appended.size(); i++){
+            appended[i]->appendTo(state, scratch);
+        }
+        value->append(scratch);
+        return;
+    }
+    StringValue res = exp->eval(state);
+    state.getStringReference(name)->swap(res);
+}
+
+template <typename Value>
+StatementType StringLetStatement<Value>::getType()
+{
+    return STRING_LET_STMT;
+}
+
+template <typename Value>
+string StringLetStatement<Value>::toString()
+{
+    return "LET " + name + " = " + exp->toString();
+}
+
+template <typename Value>
+string StringLetStatement<Value>::getName()
+{
+    return name;
+}
+
+template <typename Value>
+StringExp<Value> * StringLetStatement<Value>::getExp()
+{
+    return exp;
+}
+
+/* Implementation of the StringPrintStatement class */
+
+template <typename Value>
+StringPrintStatement<Value>::StringPrintStatement(StringExp<Value> * init_exp):exp(init_exp) {}
+
+template <typename Value>
+StringPrintStatement<Value>::~StringPrintStatement()
+{
+    delete exp;
+}
+
+template <typename Value>
+void StringPrintStatement<Value>::execute(EvalState<Value> & state)
+{
+    StringValue res = exp->eval(state);
+    cout.write(res.data(), res.size());
+    cout << endl;
+}
+
+template <typename Value>
+StatementType StringPrintStatement<Value>::getType()
+{
+    return STRING_PRINT_STMT;
+}
+
+template <typename Value>
+string StringPrintStatement<Value>::toString()
+{
+    return "PRINT " + exp->toString();
+}
+
+/* Implementation of the StringInputStatement class */
+
+template <typename Value>
+StringInputStatement<Value>::StringInputStatement(std::string init_name):name(init_name) {}
+
+template <typename Value>
+StringInputStatement<Value>::~StringInputStatement()
+{
+    /* Empty */
+}
+
+template <typename Value>
+void StringInputStatement<Value>::execute(EvalState<Value> & state)
+{
+    StringValue res(input_line());
+    state.getStringReference(name)->swap(res);
+}
+
+template <typename Value>
+StatementType StringInputStatement<Value>::getType()
+{
+    return STRING_INPUT_STMT;
+}
+
+template <typename Value>
+string StringInputStatement<Value>::toString()
+{
+    return "INPUT " + name;
+}
+
+#define INSTANTIATE_STATEMENT(Value) \
+   template class Statement<Value>; \
+   template class LetStatement<Value>; \
+   template class RemStatement<Value>; \
+   template class InputStatement<Value>; \
+   template class PrintStatement<Value>; \
+   template class EndStatement<Value>; \
+   template class GotoStatement<Value>; \
+   template class OnGotoStatement<Value>; \
+   template class ComputedGotoStatement<Value>; \
+   template class IfStatement<Value>; \
+   template class GosubStatement<Value>; \
+   template class ReturnStatement<Value>; \
+   template class ForStatement<Value>; \
+   template class NextStatement<Value>; \
+   template class DimStatement<Value>; \
+   template class ArrayLetStatement<Value>; \
+   template class MatStatement<Value>; \
+   template class StringLetStatement<Value>; \
+   template class StringPrintStatement<Value>; \
+   template class StringInputStatement<Value>;
+FOR_EACH_VALUE_TYPE(INSTANTIATE_STATEMENT)
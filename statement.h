@@ -12,8 +12,26 @@
 #ifndef _statement_h
 #define _statement_h
 
+#include <vector>
 #include "evalstate.h"
+#include "nodepool.h"
 #include "exp.h"
+#include "strexp.h"
+
+/*
+ * Type: StatementType
+ * -------------------
+ * This enumerated type is used to differentiate the statement forms,
+ * so that the analyses over a whole program can inspect a statement
+ * in the same way the parser inspects an Expression.
+ */
+
+enum StatementType { LET_STMT, REM_STMT, INPUT_STMT, PRINT_STMT,
+                     END_STMT, GOTO_STMT, IF_STMT, DIM_STMT, ARRAY_LET_STMT,
+                     FOR_STMT, NEXT_STMT, GOSUB_STMT, RETURN_STMT, MAT_STMT,
+                     STRING_LET_STMT, STRING_PRINT_STMT, STRING_INPUT_STMT, DEF_STMT,
+                     DATA_STMT, READ_STMT, RESTORE_STMT, OPEN_STMT, CLOSE_STMT,
+                     FILE_INPUT_STMT, FILE_PRINT_STMT, ON_GOTO_STMT, COMPUTED_GOTO_STMT };
 
 /*
  * Class: Statement
@@ -22,9 +40,10 @@
  * The model for this class is Expression in the exp.h interface.
  * Like Expression, Statement is an abstract class with subclasses
  * for each of the statement and command types required for the
- * BASIC interpreter.
+ * BASIC interpreter, and a template over the type Value of the values.
  */
 
+template <typename Value>
 class Statement {
 
 public:
@@ -49,6 +68,22 @@ public:
 
    virtual ~Statement();
 
+/*
+ * Operators: new, delete
+ * Usage: delete stmt;
+ * -------------------
+ * Every statement is allocated from the node pool, and freed with the
+ * size of its subclass, which the virtual destructor gives.
+ */
+
+   static void *operator new(size_t size) {
+      return allocateNode(size);
+   }
+
+   static void operator delete(void *node, size_t size) {
+      freeNode(node, size);
+   }
+
 /*
  * Method: execute
  * Usage: stmt->execute(state);
@@ -60,7 +95,26 @@ public:
  * controlling the operation of the interpreter.
  */
 
-   virtual void execute(EvalState & state) = 0;
+   virtual void execute(EvalState<Value> & state) = 0;
+
+/*
+ * Method: getType
+ * Usage: StatementType type = stmt->getType();
+ * --------------------------------------------
+ * Returns the type of the statement.
+ */
+
+   virtual StatementType getType() = 0;
+
+/*
+ * Method: toString
+ * Usage: string str = stmt->toString();
+ * -------------------------------------
+ * Returns the statement as BASIC source, without the line number,
+ * that parses back to the same statement.
+ */
+
+   virtual std::string toString() = 0;
 
 };
 
@@ -75,7 +129,8 @@ public:
  * specify its own destructor method to free that memory.
  */
 
-class LetStatement : public Statement
+template <typename Value>
+class LetStatement : public Statement<Value>
 {
     public:
 /*
@@ -85,7 +140,7 @@ class LetStatement : public Statement
  * expression.
  */
 
-   LetStatement(std::string init_name, Expression * init_exp);
+   LetStatement(std::string init_name, Expression<Value> * init_exp);
 
 /*
  * Destructor: ~LetStatement
@@ -105,23 +160,37 @@ class LetStatement : public Statement
  *  execute a let statement will perform the assignment
  */
 
-   virtual void execute(EvalState & state);
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Methods: getName, getExp
+ * Usage: string name = ((LetStatement<Value> *) stmt)->getName();
+ * ---------------------------------------------------------------
+ * Return the assigned variable and the assigned expression.
+ */
+
+   std::string getName();
+   Expression<Value> * getExp();
 
     private:
         std::string name;
-        Expression * exp;
+        Expression<Value> * exp;
 };
 
-class RemStatement : public Statement
+template <typename Value>
+class RemStatement : public Statement<Value>
 {
     public:
 /*
  * Constructor: RemStatement
  * ----------------------
- * The constructor initializes a rem statement
+ * The constructor initializes a rem statement with the text of the
+ * remark.
  */
 
-   RemStatement();
+   RemStatement(std::string init_text = "");
 
 /*
  * Destructor: ~RemStatement
@@ -141,11 +210,16 @@ class RemStatement : public Statement
  *  execute a rem will do nothing
  */
 
-   virtual void execute(EvalState & state);
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
 
+    private:
+        std::string text;
 };
 
-class InputStatement : public Statement
+template <typename Value>
+class InputStatement : public Statement<Value>
 {
     public:
 /*
@@ -174,13 +248,25 @@ class InputStatement : public Statement
  *  execute a input statement will read a variable
  */
 
-   virtual void execute(EvalState & state);
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Method: getName
+ * Usage: string name = ((InputStatement<Value> *) stmt)->getName();
+ * -----------------------------------------------------------------
+ * Returns the variable read by the statement.
+ */
+
+   std::string getName();
 
     private:
         std::string name;
 };
 
-class PrintStatement : public Statement
+template <typename Value>
+class PrintStatement : public Statement<Value>
 {
     public:
 /*
@@ -190,7 +276,7 @@ class PrintStatement : public Statement
  * expression.
  */
 
-   PrintStatement(Expression * init_exp);
+   PrintStatement(Expression<Value> * init_exp);
 
 /*
  * Destructor: ~PrintStatement
@@ -210,13 +296,25 @@ class PrintStatement : public Statement
  *  execute a print statement will print the result of the expression
  */
 
-   virtual void execute(EvalState & state);
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Method: getExp
+ * Usage: Expression<Value> * exp = ((PrintStatement<Value> *) stmt)->getExp();
+ * ----------------------------------------------------------------------------
+ * Returns the printed expression.
+ */
+
+   Expression<Value> * getExp();
 
     private:
-        Expression * exp;
+        Expression<Value> * exp;
 };
 
-class EndStatement : public Statement
+template <typename Value>
+class EndStatement : public Statement<Value>
 {
     public:
 /*
@@ -245,11 +343,14 @@ class EndStatement : public Statement
  *  execute a end will halt the program
  */
 
-   virtual void execute(EvalState & state);
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
 
 };
 
-class GotoStatement : public Statement
+template <typename Value>
+class GotoStatement : public Statement<Value>
 {
     public:
 /*
@@ -279,13 +380,151 @@ class GotoStatement : public Statement
  *  set the program counter to the right value
  */
 
-   virtual void execute(EvalState & state);
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Method: getTarget
+ * Usage: int ln = ((GotoStatement<Value> *) stmt)->getTarget();
+ * -------------------------------------------------------------
+ * Returns the line number the statement jumps to.
+ */
+
+   int getTarget();
 
     private:
         LineNumber * line_number;
 };
 
-class IfStatement : public Statement
+/*
+ * Class: OnGotoStatement
+ * ----------------------
+ * This subclass of Statement represents ON exp GOTO n1, n2, ...,
+ * which jumps to the k-th line number when exp is k.  When exp is not
+ * between 1 and the number of lines, the statement does nothing.
+ */
+
+template <typename Value>
+class OnGotoStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: OnGotoStatement
+ * ----------------------
+ * The constructor initializes an on-goto statement from the selecting
+ * expression and the line numbers, which it keeps in a table indexed
+ * by the value of the expression.
+ */
+
+   OnGotoStatement(Expression<Value> * init_exp, std::vector<int> init_targets);
+
+/*
+ * Destructor: ~OnGotoStatement
+ * Usage: delete on_goto_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ */
+
+   virtual ~OnGotoStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  set the program counter to the line selected by the expression, or
+ *  to its image index once linked
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Methods: getExp, getCount, getTarget
+ * Usage: int ln = ((OnGotoStatement<Value> *) stmt)->getTarget(i);
+ * ----------------------------------------------------------------
+ * Return the selecting expression, the number of line numbers and the
+ * line number at index i, counting from 0.
+ */
+
+   Expression<Value> * getExp();
+   int getCount();
+   int getTarget(int i);
+
+/*
+ * Method: setIndexes
+ * Usage: stmt->setIndexes(indexes);
+ * ---------------------------------
+ * Sets the image index of each line number, in the same order, so that
+ * execute jumps straight there.  Until it is called, execute jumps by
+ * line number.
+ */
+
+   void setIndexes(const std::vector<int> & init_indexes);
+
+    private:
+        Expression<Value> * exp;
+        std::vector<int> targets;
+        std::vector<int> indexes;   //empty until linked
+};
+
+/*
+ * Class: ComputedGotoStatement
+ * ----------------------------
+ * This subclass of Statement represents GOTO exp, which jumps to the
+ * line whose number is the value of exp.  A value that is not a line
+ * number raises "LINE NUMBER ERROR".
+ */
+
+template <typename Value>
+class ComputedGotoStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: ComputedGotoStatement
+ * ----------------------
+ * The constructor initializes a computed goto statement from an
+ * expression.
+ */
+
+   ComputedGotoStatement(Expression<Value> * init_exp);
+
+/*
+ * Destructor: ~ComputedGotoStatement
+ * Usage: delete goto_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ */
+
+   virtual ~ComputedGotoStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  set the program counter to the value of the expression
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Method: getExp
+ * Usage: Expression<Value> * exp = ((ComputedGotoStatement<Value> *) stmt)->getExp();
+ * -----------------------------------------------------------------------------------
+ * Returns the expression of the line number.
+ */
+
+   Expression<Value> * getExp();
+
+    private:
+        Expression<Value> * exp;
+};
+
+template <typename Value>
+class IfStatement : public Statement<Value>
 {
     public:
 /*
@@ -295,7 +534,7 @@ class IfStatement : public Statement
  * line number.
  */
 
-   IfStatement(BoolExp * exp, LineNumber * ln);
+   IfStatement(BoolExp<Value> * exp, LineNumber * ln);
 
 /*
  * Destructor: ~IfStatement
@@ -315,10 +554,596 @@ class IfStatement : public Statement
  *  set the program counter to the right value
  */
 
-   virtual void execute(EvalState & state);
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Methods: getCond, getTarget
+ * Usage: BoolExp<Value> * cond = ((IfStatement<Value> *) stmt)->getCond();
+ *        int ln = ((IfStatement<Value> *) stmt)->getTarget();
+ * -------------------------------------------------------------------------
+ * Return the condition and the line number jumped to when it holds.
+ */
+
+   BoolExp<Value> * getCond();
+   int getTarget();
 
     private:
         LineNumber * line_number;
-        BoolExp * cond;
+        BoolExp<Value> * cond;
+};
+
+template <typename Value>
+class GosubStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: GosubStatement
+ * ----------------------
+ * The constructor initializes a gosub statement from an
+ * line number.
+ */
+
+   GosubStatement(LineNumber * ln);
+
+/*
+ * Destructor: ~GosubStatement
+ * Usage: delete gosub_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ * It must be declared virtual to ensure that the correct subclass
+ * destructor is called when deleting a statement.
+ */
+
+   virtual ~GosubStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  set the program counter to CALL; the program pushes the position
+ *  after the line and jumps to the target
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Method: getTarget
+ * Usage: int ln = ((GosubStatement<Value> *) stmt)->getTarget();
+ * --------------------------------------------------------------
+ * Returns the line number of the subroutine.
+ */
+
+   int getTarget();
+
+    private:
+        LineNumber * line_number;
+};
+
+template <typename Value>
+class ReturnStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: ReturnStatement
+ * ----------------------
+ * The constructor initializes a return statement
+ */
+
+   ReturnStatement();
+
+/*
+ * Destructor: ~ReturnStatement
+ * Usage: delete return_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ * It must be declared virtual to ensure that the correct subclass
+ * destructor is called when deleting a statement.
+ */
+
+   virtual ~ReturnStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  set the program counter to RETURN; the program resumes at the
+ *  position popped from the return stack
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+};
+
+template <typename Value>
+class ForStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: ForStatement
+ * ----------------------
+ * The constructor initializes a for statement from the loop variable,
+ * the initial value, the limit and the step, which is NULL when the
+ * statement has no STEP.
+ */
+
+   ForStatement(std::string init_name, Expression<Value> * init_from, Expression<Value> * init_to, Expression<Value> * init_step);
+
+/*
+ * Destructor: ~ForStatement
+ * Usage: delete for_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ * It must be declared virtual to ensure that the correct subclass
+ * destructor is called when deleting a statement.
+ */
+
+   virtual ~ForStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  execute a for statement will assign the initial value and push the
+ *  loop frame, or skip past the matching NEXT if the loop runs zero
+ *  times
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Method: setLines
+ * Usage: stmt->setLines(body, exit);
+ * ----------------------------------
+ * Sets the line number of the line after the statement, where NEXT
+ * jumps back to, and of the line after the matching NEXT.  Either is
+ * EvalState::HALT after the last line; exit is -1 when there is no
+ * matching NEXT.  The program sets them before a run.
+ */
+
+   void setLines(int body, int exit);
+
+/*
+ * Method: setParallel
+ * Usage: stmt->setParallel(reductions);
+ * -------------------------------------
+ * Marks the statement as a PARALLEL FOR with the given reduction
+ * variables, which the iterations may only add to.  The statement
+ * itself still runs the loop serially; the program replaces it when
+ * the iterations are independent.
+ */
+
+   void setParallel(const std::vector<std::string> & init_reductions);
+
+/*
+ * Methods: getName, getFrom, getTo, getStep, getExit
+ * Usage: string name = ((ForStatement<Value> *) stmt)->getName();
+ * ---------------------------------------------------------------
+ * Return the parts of the statement; getStep returns NULL without a
+ * STEP.
+ */
+
+   std::string getName();
+   Expression<Value> * getFrom();
+   Expression<Value> * getTo();
+   Expression<Value> * getStep();
+   int getExit();
+
+/*
+ * Methods: isParallel, getReductions
+ * Usage: if (((ForStatement<Value> *) stmt)->isParallel()) . . .
+ * --------------------------------------------------------------
+ * Return whether the statement is a PARALLEL FOR, and its reduction
+ * variables.
+ */
+
+   bool isParallel();
+   const std::vector<std::string> & getReductions();
+
+    private:
+        std::string name;
+        Expression<Value> * from;
+        Expression<Value> * to;
+        Expression<Value> * step;
+        int body;
+        int exit;
+        bool parallel;
+        std::vector<std::string> reductions;
+};
+
+template <typename Value>
+class NextStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: NextStatement
+ * ----------------------
+ * The constructor initializes a next statement from the loop variable,
+ * which is empty for a NEXT that closes the innermost loop.
+ */
+
+   NextStatement(std::string init_name);
+
+/*
+ * Destructor: ~NextStatement
+ * Usage: delete next_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ * It must be declared virtual to ensure that the correct subclass
+ * destructor is called when deleting a statement.
+ */
+
+   virtual ~NextStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  execute a next statement will step the loop variable and jump back
+ *  to the loop body until it passes the limit
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Methods: setBody, getBody
+ * Usage: stmt->setBody(body);
+ * ---------------------------
+ * Set and return the line number of the body of the FOR the statement
+ * matches in the program text, -1 if unknown.  The program links that
+ * jump directly; a NEXT that closes another loop at run time still
+ * works, through a line lookup.
+ */
+
+   void setBody(int init_body);
+   int getBody();
+
+/*
+ * Method: getName
+ * Usage: string name = ((NextStatement<Value> *) stmt)->getName();
+ * ----------------------------------------------------------------
+ * Returns the loop variable, empty if the statement names none.
+ */
+
+   std::string getName();
+
+    private:
+        std::string name;
+        int body;
+};
+
+template <typename Value>
+class DimStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: DimStatement
+ * ----------------------
+ * The constructor initializes a dim statement that creates no arrays;
+ * the parser adds them one by one.
+ */
+
+   DimStatement();
+
+/*
+ * Destructor: ~DimStatement
+ * Usage: delete dim_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ * It must be declared virtual to ensure that the correct subclass
+ * destructor is called when deleting a statement.
+ */
+
+   virtual ~DimStatement();
+
+/*
+ * Method: addArray
+ * Usage: dim->addArray(name, rows, cols);
+ * ---------------------------------------
+ * Adds the array name(rows) or name(rows, cols), where rows and cols
+ * are the largest subscripts.  cols is NULL for a 1-D array.
+ */
+
+   void addArray(std::string name, Expression<Value> * rows, Expression<Value> * cols);
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  execute a dim statement will create the arrays, all elements 0
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Methods: getCount, getRows, getCols
+ * Usage: Expression<Value> * rows = ((DimStatement<Value> *) stmt)->getRows(i);
+ * -----------------------------------------------------------------------------
+ * Return the number of arrays and the size expressions of each.
+ */
+
+   int getCount();
+   Expression<Value> * getRows(int i);
+   Expression<Value> * getCols(int i);
+
+    private:
+        std::vector<std::string> names;
+        std::vector<int> slots;
+        std::vector<Expression<Value> *> rows;
+        std::vector<Expression<Value> *> cols;
+};
+
+template <typename Value>
+class ArrayLetStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: ArrayLetStatement
+ * ----------------------
+ * The constructor initializes an assignment to an array element from
+ * the element and an expression.
+ */
+
+   ArrayLetStatement(ArrayExp<Value> * init_target, Expression<Value> * init_exp);
+
+/*
+ * Destructor: ~ArrayLetStatement
+ * Usage: delete let_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ * It must be declared virtual to ensure that the correct subclass
+ * destructor is called when deleting a statement.
+ */
+
+   virtual ~ArrayLetStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  execute an array let statement will assign the element
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Methods: getTarget, getExp
+ * Usage: ArrayExp<Value> * target = ((ArrayLetStatement<Value> *) stmt)->getTarget();
+ * -----------------------------------------------------------------------------------
+ * Return the assigned element and the assigned expression.
+ */
+
+   ArrayExp<Value> * getTarget();
+   Expression<Value> * getExp();
+
+    private:
+        ArrayExp<Value> * target;
+        Expression<Value> * exp;
+};
+
+/*
+ * Type: MatOp
+ * -----------
+ * The operation of a MAT statement.
+ */
+
+enum MatOp { MAT_COPY, MAT_ADD, MAT_SUBTRACT, MAT_MULTIPLY, MAT_SCALE, MAT_SUM, MAT_DOT };
+
+template <typename Value>
+class MatStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: MatStatement
+ * ----------------------
+ * The constructor initializes a mat statement from its operation, the
+ * target, which is an array or, for MAT_SUM and MAT_DOT, a variable,
+ * the operand arrays a and b, and the factor of MAT_SCALE.  The forms
+ * are
+ *
+ *    MAT C = A            MAT_COPY
+ *    MAT C = A + B        MAT_ADD, likewise - for MAT_SUBTRACT
+ *    MAT C = A * B        MAT_MULTIPLY, the matrix product
+ *    MAT C = (K) * A      MAT_SCALE
+ *    MAT SUM S = A        MAT_SUM, the sum of the elements
+ *    MAT DOT S = A, B     MAT_DOT, the sum of the products
+ *
+ * b is empty when the operation has one operand, and factor is NULL
+ * except for MAT_SCALE.
+ */
+
+   MatStatement(MatOp init_op, std::string init_target, std::string init_a, std::string init_b,
+                Expression<Value> * init_factor);
+
+/*
+ * Destructor: ~MatStatement
+ * Usage: delete mat_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ * It must be declared virtual to ensure that the correct subclass
+ * destructor is called when deleting a statement.
+ */
+
+   virtual ~MatStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  execute a mat statement will apply the operation to every element;
+ *  a target array of the wrong shape is created again
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Methods: getOp, getTarget, getFactor
+ * Usage: MatOp op = ((MatStatement<Value> *) stmt)->getOp();
+ * ----------------------------------------------------------
+ * Return the operation, the target and the factor of MAT_SCALE.
+ */
+
+   MatOp getOp();
+   std::string getTarget();
+   Expression<Value> * getFactor();
+
+    private:
+        ArrayValue<Value> * operand(EvalState<Value> & state, int slot);
+        ArrayValue<Value> * result(EvalState<Value> & state, int rows, int cols);
+
+        MatOp op;
+        std::string target;
+        std::string a;
+        std::string b;
+        int targetSlot;
+        int aSlot;
+        int bSlot;
+        Expression<Value> * factor;
+};
+
+template <typename Value>
+class StringLetStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: StringLetStatement
+ * ----------------------
+ * The constructor initializes an assignment to a string variable from
+ * its name and a string expression.
+ */
+
+   StringLetStatement(std::string init_name, StringExp<Value> * init_exp);
+
+/*
+ * Destructor: ~StringLetStatement
+ * Usage: delete let_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ * It must be declared virtual to ensure that the correct subclass
+ * destructor is called when deleting a statement.
+ */
+
+   virtual ~StringLetStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  execute a string let statement will perform the assignment; an
+ *  assignment of the form LET A$ = A$ + ... appends to A$ in place
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+/*
+ * Methods: getName, getExp
+ * Usage: string name = ((StringLetStatement<Value> *) stmt)->getName();
+ * ---------------------------------------------------------------------
+ * Return the assigned variable and the assigned expression.
+ */
+
+   std::string getName();
+   StringExp<Value> * getExp();
+
+    private:
+        std::string name;
+        StringExp<Value> * exp;
+        std::vector<StringExp<Value> *> appended;   //what LET A$ = A$ + ... appends
+        StringValue scratch;                 //their value, reused by every run
+};
+
+template <typename Value>
+class StringPrintStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: StringPrintStatement
+ * ----------------------
+ * The constructor initializes a print statement from a string
+ * expression.
+ */
+
+   StringPrintStatement(StringExp<Value> * init_exp);
+
+/*
+ * Destructor: ~StringPrintStatement
+ * Usage: delete print_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ * It must be declared virtual to ensure that the correct subclass
+ * destructor is called when deleting a statement.
+ */
+
+   virtual ~StringPrintStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  execute a string print statement will print the string
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+    private:
+        StringExp<Value> * exp;
+};
+
+template <typename Value>
+class StringInputStatement : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: StringInputStatement
+ * ----------------------
+ * The constructor initializes an input statement from the name of a
+ * string variable.
+ */
+
+   StringInputStatement(std::string init_name);
+
+/*
+ * Destructor: ~StringInputStatement
+ * Usage: delete input_stmt;
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ * It must be declared virtual to ensure that the correct subclass
+ * destructor is called when deleting a statement.
+ */
+
+   virtual ~StringInputStatement();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  execute a string input statement will read a whole line
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+    private:
+        std::string name;
 };
 #endif
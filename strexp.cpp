@@ -0,0 +1,281 @@
+/*
+ * File: strexp.cpp
+ * ----------------
+ * This file implements the StringExp class and its subclasses, and the
+ * LengthExp expression.
+ */
+
+#include <string>
+#include "../StanfordCPPLib/error.h"
+#include "evalstate.h"
+#include "strexp.h"
+
+using namespace std;
+
+/*
+ * Implementation notes: the StringExp class
+ * -----------------------------------------
+ * By default eval builds the value with appendTo, starting from an
+ * empty string.
+ */
+
+template <typename Value>
+StringExp<Value>::StringExp() {
+   /* Empty */
+}
+
+template <typename Value>
+StringExp<Value>::~StringExp() {
+   /* Empty */
+}
+
+template <typename Value>
+StringValue StringExp<Value>::eval(EvalState<Value> & state) {
+   StringValue result;
+   appendTo(state, result);
+   return result;
+}
+
+/*
+ * Implementation notes: the StringLiteralExp subclass
+ * ---------------------------------------------------
+ * toString quotes the text again, escaping the characters the scanner
+ * treats specially, so a listing without the source parses back to the
+ * same literal.
+ */
+
+template <typename Value>
+StringLiteralExp<Value>::StringLiteralExp(string text) :value(StringValue::intern(text)) {}
+
+template <typename Value>
+StringValue StringLiteralExp<Value>::eval(EvalState<Value> & state) {
+   return value;
+}
+
+template <typename Value>
+void StringLiteralExp<Value>::appendTo(EvalState<Value> & state, StringValue & result) {
+   result.append(value);
+}
+
+template <typename Value>
+string StringLiteralExp<Value>::toString() {
+   string text = "\"";
+   for (size_t i = 0; i < value.size(); i++) {
+      char ch = value.data()[i];
+      if (ch == '"' || ch == '\\') text += '\\';
+      text += ch;
+   }
+   return text + '"';
+}
+
+template <typename Value>
+StringExpType StringLiteralExp<Value>::getType() {
+   return STRING_LITERAL;
+}
+
+/* Implementation of the StringVariableExp subclass */
+
+template <typename Value>
+StringVariableExp<Value>::StringVariableExp(string id) :name(id) {}
+
+template <typename Value>
+StringValue StringVariableExp<Value>::eval(EvalState<Value> & state) {
+   return lookup(state);
+}
+
+template <typename Value>
+void StringVariableExp<Value>::appendTo(EvalState<Value> & state, StringValue & result) {
+   result.append(lookup(state));
+}
+
+template <typename Value>
+const StringValue & StringVariableExp<Value>::lookup(EvalState<Value> & state) {
+   StringValue *value = state.getString(name);
+   if (value == NULL) error("VARIABLE NOT DEFINED");
+   return *value;
+}
+
+template <typename Value>
+string StringVariableExp<Value>::toString() {
+   return name;
+}
+
+template <typename Value>
+StringExpType StringVariableExp<Value>::getType() {
+   return STRING_VARIABLE;
+}
+
+template <typename Value>
+string StringVariableExp<Value>::getName() {
+   return name;
+}
+
+/*
+ * Implementation notes: the ConcatExp subclass
+ * --------------------------------------------
+ * The parser builds A$ + B$ + C$ as ((A$ + B$) + C$), so toString does
+ * not need parentheses to read back the same tree.
+ */
+
+template <typename Value>
+ConcatExp<Value>::ConcatExp(StringExp<Value> *_lhs, StringExp<Value> *_rhs) :lhs(_lhs), rhs(_rhs) {}
+
+template <typename Value>
+ConcatExp<Value>::~ConcatExp() {
+   delete lhs;
+   delete rhs;
+}
+
+template <typename Value>
+void ConcatExp<Value>::appendTo(EvalState<Value> & state, StringValue & result) {
+   lhs->appendTo(state, result);
+   rhs->appendTo(state, result);
+}
+
+template <typename Value>
+string ConcatExp<Value>::toString() {
+   return lhs->toString() + " + " + rhs->toString();
+}
+
+template <typename Value>
+StringExpType ConcatExp<Value>::getType() {
+   return CONCAT;
+}
+
+template <typename Value>
+StringExp<Value> *ConcatExp<Value>::getLHS() {
+   return lhs;
+}
+
+template <typename Value>
+StringExp<Value> *ConcatExp<Value>::getRHS() {
+   return rhs;
+}
+
+/*
+ * Implementation notes: the SubstringExp subclass
+ * -----------------------------------------------
+ * The source is looked up in place when it is a variable, so taking a
+ * few characters of a long string does not copy all of it.
+ */
+
+template <typename Value>
+SubstringExp<Value>::SubstringExp(string _function, StringExp<Value> *_source, Expression<Value> *_first, Expression<Value> *_second)
+   :function(_function), source(_source), first(_first), second(_second) {}
+
+template <typename Value>
+SubstringExp<Value>::~SubstringExp() {
+   delete source;
+   delete first;
+   delete second;
+}
+
+template <typename Value>
+StringValue SubstringExp<Value>::eval(EvalState<Value> & state) {
+   size_t start, count;
+   if (source->getType() == STRING_VARIABLE) {
+      const StringValue & value = ((StringVariableExp<Value> *) source)->lookup(state);
+      range(state, value.size(), start, count);
+      return value.substr(start, count);
+   }
+   StringValue whole = source->eval(state);
+   range(state, whole.size(), start, count);
+   return whole.substr(start, count);
+}
+
+template <typename Value>
+void SubstringExp<Value>::appendTo(EvalState<Value> & state, StringValue & result) {
+   if (source->getType() == STRING_VARIABLE) {
+      const StringValue & value = ((StringVariableExp<Value> *) source)->lookup(state);
+      size_t start, count;
+      range(state, value.size(), start, count);
+      result.append(value.data() + start, count);
+   } else {
+      result.append(eval(state));
+   }
+}
+
+//evaluate the arguments into the characters to take of a string
+template <typename Value>
+void SubstringExp<Value>::range(EvalState<Value> & state, size_t length, size_t & start, size_t & count) {
+   long long m = ValueTraits<Value>::toInteger(first->eval(state));
+   long long n = (second == NULL) ? (long long) length : ValueTraits<Value>::toInteger(second->eval(state));
+   if (function == "MID$") {
+      if (m < 1 || n < 0) error("ILLEGAL FUNCTION CALL");
+      start = (m - 1 < (long long) length) ? m - 1 : length;
+      count = (n < (long long) (length - start)) ? n : length - start;
+      return;
+   }
+   if (m < 0) error("ILLEGAL FUNCTION CALL");
+   count = (m < (long long) length) ? m : length;
+   start = (function == "LEFT$") ? 0 : length - count;
+}
+
+template <typename Value>
+string SubstringExp<Value>::toString() {
+   string text = function + '(' + source->toString() + ", " + first->toString();
+   if (second != NULL) text += ", " + second->toString();
+   return text + ')';
+}
+
+template <typename Value>
+StringExpType SubstringExp<Value>::getType() {
+   return SUBSTRING;
+}
+
+template <typename Value>
+StringExp<Value> *SubstringExp<Value>::getSource() {
+   return source;
+}
+
+template <typename Value>
+Expression<Value> *SubstringExp<Value>::getFirst() {
+   return first;
+}
+
+template <typename Value>
+Expression<Value> *SubstringExp<Value>::getSecond() {
+   return second;
+}
+
+/* Implementation of the LengthExp class */
+
+template <typename Value>
+LengthExp<Value>::LengthExp(StringExp<Value> *_source) :source(_source) {}
+
+template <typename Value>
+LengthExp<Value>::~LengthExp() {
+   delete source;
+}
+
+template <typename Value>
+Value LengthExp<Value>::eval(EvalState<Value> & state) {
+   if (source->getType() == STRING_VARIABLE) {
+      return ((StringVariableExp<Value> *) source)->lookup(state).size();
+   }
+   return source->eval(state).size();
+}
+
+template <typename Value>
+string LengthExp<Value>::toString() {
+   return "LEN(" + source->toString() + ')';
+}
+
+template <typename Value>
+ExpressionType LengthExp<Value>::getType() {
+   return LENGTH;
+}
+
+template <typename Value>
+StringExp<Value> *LengthExp<Value>::getSource() {
+   return source;
+}
+
+#define INSTANTIATE_STREXP(Value) \
+   template class StringExp<Value>; \
+   template class StringLiteralExp<Value>; \
+   template class StringVariableExp<Value>; \
+   template class ConcatExp<Value>; \
+   template class SubstringExp<Value>; \
+   template class LengthExp<Value>;
+FOR_EACH_VALUE_TYPE(INSTANTIATE_STREXP)
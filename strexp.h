@@ -0,0 +1,269 @@
+/*
+ * File: strexp.h
+ * --------------
+ * This interface defines the class hierarchy for string expressions,
+ * which is kept apart from the integer expressions of exp.h: a string
+ * expression evaluates to a StringValue, and only LEN turns one into
+ * an integer.  Like the integer expressions, the classes are templates
+ * over the type Value of the values.
+ */
+
+#ifndef _strexp_h
+#define _strexp_h
+
+#include <string>
+#include "evalstate.h"
+#include "exp.h"
+#include "stringvalue.h"
+
+/*
+ * Type: StringExpType
+ * -------------------
+ * This enumerated type is used to differentiate the string expression
+ * types: STRING_LITERAL, STRING_VARIABLE, CONCAT and SUBSTRING.
+ */
+
+enum StringExpType { STRING_LITERAL, STRING_VARIABLE, CONCAT, SUBSTRING };
+
+/*
+ * Class: StringExp
+ * ----------------
+ * This class is used to represent a node in a string expression tree.
+ * Any object must be one of the concrete subclasses:
+ *
+ *  1. StringLiteralExp  -- a string literal, "TEXT"
+ *  2. StringVariableExp -- a string variable, A$
+ *  3. ConcatExp         -- two string expressions joined by +
+ *  4. SubstringExp      -- LEFT$, RIGHT$ or MID$ of a string expression
+ */
+
+template <typename Value>
+class StringExp {
+
+public:
+
+   StringExp();
+   virtual ~StringExp();
+
+/*
+ * Method: eval
+ * Usage: StringValue value = exp->eval(state);
+ * --------------------------------------------
+ * Evaluates this expression and returns its value in the context of
+ * the specified EvalState object.
+ */
+
+   virtual StringValue eval(EvalState<Value> & state);
+
+/*
+ * Method: appendTo
+ * Usage: exp->appendTo(state, result);
+ * ------------------------------------
+ * Evaluates this expression and appends its value to result, so that
+ * a chain of concatenations builds its value in one string instead of
+ * one temporary per +.
+ */
+
+   virtual void appendTo(EvalState<Value> & state, StringValue & result) = 0;
+
+/*
+ * Methods: toString, getType
+ * Usage: string str = exp->toString();
+ * ------------------------------------
+ * Return the expression as BASIC source and the type of the node.
+ */
+
+   virtual std::string toString() = 0;
+   virtual StringExpType getType() = 0;
+
+};
+
+/*
+ * Class: StringLiteralExp
+ * -----------------------
+ * This subclass represents a string literal.  Its value is interned, so
+ * evaluating it copies a pointer rather than the characters.
+ */
+
+template <typename Value>
+class StringLiteralExp : public StringExp<Value> {
+
+public:
+
+   StringLiteralExp(std::string text);
+
+   virtual StringValue eval(EvalState<Value> & state);
+   virtual void appendTo(EvalState<Value> & state, StringValue & result);
+   virtual std::string toString();
+   virtual StringExpType getType();
+
+private:
+
+   StringValue value;
+
+};
+
+/*
+ * Class: StringVariableExp
+ * ------------------------
+ * This subclass represents a string variable, whose name ends in $.
+ */
+
+template <typename Value>
+class StringVariableExp : public StringExp<Value> {
+
+public:
+
+   StringVariableExp(std::string id);
+
+   virtual StringValue eval(EvalState<Value> & state);
+   virtual void appendTo(EvalState<Value> & state, StringValue & result);
+   virtual std::string toString();
+   virtual StringExpType getType();
+
+/*
+ * Method: lookup
+ * Usage: const StringValue & value = var->lookup(state);
+ * ------------------------------------------------------
+ * Returns the value of the variable in place, without copying it.
+ * Raises "VARIABLE NOT DEFINED" if it has not been assigned.
+ */
+
+   const StringValue & lookup(EvalState<Value> & state);
+
+/*
+ * Method: getName
+ * Usage: string name = ((StringVariableExp<Value> *) exp)->getName();
+ * -------------------------------------------------------------------
+ * Returns the name of the variable, $ included.
+ */
+
+   std::string getName();
+
+private:
+
+   std::string name;
+
+};
+
+/*
+ * Class: ConcatExp
+ * ----------------
+ * This subclass represents the concatenation of two string expressions.
+ */
+
+template <typename Value>
+class ConcatExp : public StringExp<Value> {
+
+public:
+
+   ConcatExp(StringExp<Value> *lhs, StringExp<Value> *rhs);
+   virtual ~ConcatExp();
+
+   virtual void appendTo(EvalState<Value> & state, StringValue & result);
+   virtual std::string toString();
+   virtual StringExpType getType();
+
+/*
+ * Methods: getLHS, getRHS
+ * Usage: StringExp<Value> *lhs = ((ConcatExp<Value> *) exp)->getLHS();
+ * --------------------------------------------------------------------
+ * Return the operands of the concatenation.
+ */
+
+   StringExp<Value> *getLHS();
+   StringExp<Value> *getRHS();
+
+private:
+
+   StringExp<Value> *lhs, *rhs;
+
+};
+
+/*
+ * Class: SubstringExp
+ * -------------------
+ * This subclass represents the string functions
+ *
+ *    LEFT$(S$, N)       the first N characters of S$
+ *    RIGHT$(S$, N)      the last N characters of S$
+ *    MID$(S$, M)        the characters of S$ from the Mth on
+ *    MID$(S$, M, N)     N characters of S$ from the Mth on
+ *
+ * Characters are counted from 1.  A count past the end of the string
+ * stops at its end; a negative count or M < 1 raises
+ * "ILLEGAL FUNCTION CALL".  A substring of a literal shares the
+ * interned storage.
+ */
+
+template <typename Value>
+class SubstringExp : public StringExp<Value> {
+
+public:
+
+   SubstringExp(std::string function, StringExp<Value> *source, Expression<Value> *first, Expression<Value> *second);
+   virtual ~SubstringExp();
+
+   virtual StringValue eval(EvalState<Value> & state);
+   virtual void appendTo(EvalState<Value> & state, StringValue & result);
+   virtual std::string toString();
+   virtual StringExpType getType();
+
+/*
+ * Methods: getSource, getFirst, getSecond
+ * Usage: StringExp<Value> *source = ((SubstringExp<Value> *) exp)->getSource();
+ * -----------------------------------------------------------------------------
+ * Return the operands of the function; getSecond returns NULL for MID$
+ * with two arguments.
+ */
+
+   StringExp<Value> *getSource();
+   Expression<Value> *getFirst();
+   Expression<Value> *getSecond();
+
+private:
+
+   void range(EvalState<Value> & state, size_t length, size_t & start, size_t & count);
+
+   std::string function;  //LEFT$, RIGHT$ or MID$
+   StringExp<Value> *source;
+   Expression<Value> *first;
+   Expression<Value> *second;    //NULL for MID$ with two arguments
+
+};
+
+/*
+ * Class: LengthExp
+ * ----------------
+ * This subclass of Expression represents LEN(S$), the number of
+ * characters of a string expression.
+ */
+
+template <typename Value>
+class LengthExp : public Expression<Value> {
+
+public:
+
+   LengthExp(StringExp<Value> *source);
+   virtual ~LengthExp();
+
+   virtual Value eval(EvalState<Value> & state);
+   virtual std::string toString();
+   virtual ExpressionType getType();
+
+/*
+ * Method: getSource
+ * Usage: StringExp<Value> *source = ((LengthExp<Value> *) exp)->getSource();
+ * --------------------------------------------------------------------------
+ * Returns the string expression whose length this is.
+ */
+
+   StringExp<Value> *getSource();
+
+private:
+
+   StringExp<Value> *source;
+
+};
+
+#endif
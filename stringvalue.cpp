@@ -0,0 +1,158 @@
+/*
+ * File: stringvalue.cpp
+ * ---------------------
+ * This file implements the StringValue class.
+ */
+
+#include <cstring>
+#include <string>
+#include <set>
+#include "stringvalue.h"
+using namespace std;
+
+StringValue::StringValue() :length(0), mode(INLINE) {}
+
+StringValue::StringValue(const char *chars, size_t count) :length(0), mode(INLINE) {
+   assign(chars, count);
+}
+
+StringValue::StringValue(const string & text) :length(0), mode(INLINE) {
+   assign(text.data(), text.size());
+}
+
+StringValue::StringValue(const StringValue & other) :length(0), mode(INLINE) {
+   *this = other;
+}
+
+StringValue & StringValue::operator=(const StringValue & other) {
+   if (this == &other) return *this;
+   if (other.mode == LITERAL) {
+      release();
+      big = other.big;
+      length = other.length;
+      mode = LITERAL;
+   } else {
+      assign(other.data(), other.length);
+   }
+   return *this;
+}
+
+StringValue::~StringValue() {
+   release();
+}
+
+/*
+ * Implementation notes: intern
+ * ----------------------------
+ * The pool is a set of strings, whose elements never move, and it is
+ * never emptied, so the pointers into it stay valid.
+ */
+
+StringValue StringValue::intern(const string & text) {
+   static set<string> pool;
+   const string & stored = *pool.insert(text).first;
+   StringValue literal;
+   literal.big.chars = stored.data();
+   literal.big.capacity = 0;
+   literal.length = stored.size();
+   literal.mode = LITERAL;
+   return literal;
+}
+
+//free the heap buffer, if any, leaving an empty inline string
+void StringValue::release() {
+   if (mode == HEAP) delete[] big.chars;
+   mode = INLINE;
+   length = 0;
+}
+
+//replace the characters, reusing the heap buffer when they fit
+void StringValue::assign(const char *chars, size_t count) {
+   if (mode == HEAP && count <= big.capacity) {
+      memmove((char *) big.chars, chars, count);
+      length = count;
+      return;
+   }
+   if (count <= INLINE_CAPACITY) {
+      char copy[INLINE_CAPACITY];
+      memcpy(copy, chars, count);
+      release();
+      memcpy(small, copy, count);
+      length = count;
+      return;
+   }
+   char *buffer = new char[count];
+   memcpy(buffer, chars, count);
+   release();
+   big.chars = buffer;
+   big.capacity = count;
+   length = count;
+   mode = HEAP;
+}
+
+/*
+ * Implementation notes: append
+ * ----------------------------
+ * A full buffer is replaced by one twice as large.  The characters are
+ * copied before the old buffer is freed, since they may be part of it.
+ */
+
+void StringValue::append(const StringValue & other) {
+   append(other.data(), other.length);
+}
+
+void StringValue::append(const char *chars, size_t count) {
+   size_t total = length + count;
+   if (mode == INLINE && total <= INLINE_CAPACITY) {
+      memmove(small + length, chars, count);
+      length = total;
+      return;
+   }
+   if (mode == HEAP && total <= big.capacity) {
+      memmove((char *) big.chars + length, chars, count);
+      length = total;
+      return;
+   }
+   size_t capacity = (mode == HEAP) ? big.capacity : INLINE_CAPACITY;
+   while (capacity < total) capacity *= 2;
+   char *buffer = new char[capacity];
+   memcpy(buffer, data(), length);
+   memcpy(buffer + length, chars, count);
+   release();
+   big.chars = buffer;
+   big.capacity = capacity;
+   length = total;
+   mode = HEAP;
+}
+
+StringValue StringValue::substr(size_t start, size_t count) const {
+   if (count > length - start) count = length - start;
+   if (mode != LITERAL) return StringValue(data() + start, count);
+   StringValue part(*this);
+   part.big.chars += start;
+   part.length = count;
+   return part;
+}
+
+void StringValue::clear() {
+   if (mode == LITERAL) mode = INLINE;
+   length = 0;
+}
+
+/*
+ * Implementation notes: swap
+ * --------------------------
+ * None of the modes points into the object itself, so the objects can
+ * be exchanged byte by byte.
+ */
+
+void StringValue::swap(StringValue & other) {
+   char temp[sizeof(StringValue)];
+   memcpy(temp, (void *) this, sizeof(StringValue));
+   memcpy((void *) this, (void *) &other, sizeof(StringValue));
+   memcpy((void *) &other, temp, sizeof(StringValue));
+}
+
+string StringValue::toString() const {
+   return string(data(), length);
+}
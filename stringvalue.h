@@ -0,0 +1,148 @@
+/*
+ * File: stringvalue.h
+ * -------------------
+ * This interface exports the StringValue class, the value of a string
+ * variable or string expression.
+ */
+
+#ifndef _stringvalue_h
+#define _stringvalue_h
+
+#include <cstddef>
+#include <string>
+
+/*
+ * Class: StringValue
+ * ------------------
+ * A StringValue holds its characters in one of three ways:
+ *
+ *  1. Inline, in the object itself, when there are at most
+ *     INLINE_CAPACITY of them, so short strings never allocate.
+ *  2. In a heap buffer it owns, which grows geometrically, so a string
+ *     built by appending to it again and again is copied a constant
+ *     number of times per character.
+ *  3. In the interned storage of a literal, which lives as long as the
+ *     program and is never written.  Equal literals on all lines share
+ *     one copy, and copying or taking a substring of such a string
+ *     only copies a pointer.
+ *
+ * The characters are not null-terminated.
+ */
+
+class StringValue {
+
+public:
+
+   static const size_t INLINE_CAPACITY = 22;
+
+/*
+ * Constructor: StringValue
+ * Usage: StringValue str;
+ *        StringValue str(chars, length);
+ *        StringValue str(text);
+ * ------------------------------------
+ * Creates an empty string, or a copy of the given characters.
+ */
+
+   StringValue();
+   StringValue(const char *chars, size_t length);
+   explicit StringValue(const std::string & text);
+
+/*
+ * Copy constructor, assignment operator and destructor
+ * ----------------------------------------------------
+ * A copy has its own characters, except that a copy of a literal
+ * shares the interned storage.
+ */
+
+   StringValue(const StringValue & other);
+   StringValue & operator=(const StringValue & other);
+   ~StringValue();
+
+/*
+ * Method: intern
+ * Usage: StringValue literal = StringValue::intern(text);
+ * -------------------------------------------------------
+ * Returns the string literal with the given text, stored once for all
+ * the literals with that text.
+ */
+
+   static StringValue intern(const std::string & text);
+
+/*
+ * Methods: size, data
+ * Usage: cout.write(str.data(), str.size());
+ * ------------------------------------------
+ * Return the number of characters and a pointer to them.
+ */
+
+   size_t size() const {
+      return length;
+   }
+
+   const char *data() const {
+      return (mode == INLINE) ? small : big.chars;
+   }
+
+/*
+ * Method: append
+ * Usage: str.append(other);
+ * -------------------------
+ * Appends the characters of another string, or the given characters,
+ * which may be part of this string.
+ */
+
+   void append(const StringValue & other);
+   void append(const char *chars, size_t count);
+
+/*
+ * Method: substr
+ * Usage: StringValue part = str.substr(start, count);
+ * ---------------------------------------------------
+ * Returns count characters from index start, or fewer at the end of
+ * the string.  start must not be past the end.
+ */
+
+   StringValue substr(size_t start, size_t count) const;
+
+/*
+ * Methods: clear, swap
+ * Usage: str.clear();
+ *        str.swap(other);
+ * ------------------------
+ * clear empties the string but keeps its heap buffer for the next
+ * appends; swap exchanges two strings without copying characters.
+ */
+
+   void clear();
+   void swap(StringValue & other);
+
+/*
+ * Method: toString
+ * Usage: string text = str.toString();
+ * ------------------------------------
+ * Returns the characters as a std::string.
+ */
+
+   std::string toString() const;
+
+private:
+
+   enum Mode { INLINE, HEAP, LITERAL };
+
+   void assign(const char *chars, size_t count);
+   void release();
+
+   union {
+      char small[INLINE_CAPACITY];
+      struct {
+         const char *chars;
+         size_t capacity;
+      } big;
+   };
+   size_t length;
+   Mode mode;
+
+};
+
+#endif
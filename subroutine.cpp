@@ -0,0 +1,78 @@
+/*
+ * File: subroutine.cpp
+ * --------------------
+ * This file implements the InlinedCall class.
+ */
+
+#include <string>
+#include <vector>
+#include "subroutine.h"
+#include "evalstate.h"
+#include "fileio.h"
+#include "statement.h"
+using namespace std;
+
+/*
+ * Implementation notes: makeInlinedCall
+ * -------------------------------------
+ * None of the accepted statements can jump, so control always reaches
+ * the RETURN, and the subroutine behaves the same however it is
+ * entered.
+ */
+
+template <typename Value>
+Statement<Value> *makeInlinedCall(GosubStatement<Value> * gosub, const vector<Statement<Value> *> & lines)
+{
+    for (size_t i = 0; i < lines.size() && (int) i < MAX_INLINED_LINES; i++){
+        if (lines[i] == NULL) return NULL;
+        StatementType type = lines[i]->getType();
+        if (type == RETURN_STMT){
+            vector<Statement<Value> *> body(lines.begin(), lines.begin() + i);
+            return new InlinedCall<Value>(gosub, body);
+        }
+        if (type != LET_STMT && type != PRINT_STMT && type != INPUT_STMT && type != REM_STMT
+                && type != DIM_STMT && type != ARRAY_LET_STMT && type != STRING_LET_STMT
+                && type != STRING_PRINT_STMT && type != STRING_INPUT_STMT && type != FILE_INPUT_STMT
+                && type != FILE_PRINT_STMT) return NULL;
+    }
+    return NULL;
+}
+
+/* Implementation of the InlinedCall class */
+
+template <typename Value>
+InlinedCall<Value>::InlinedCall(GosubStatement<Value> * init_call, vector<Statement<Value> *> init_body)
+    :call(init_call), body(init_body) {}
+
+template <typename Value>
+InlinedCall<Value>::~InlinedCall()
+{
+    /* Empty */
+}
+
+template <typename Value>
+void InlinedCall<Value>::execute(EvalState<Value> & state)
+{
+    state.pushReturn(0);
+    for (size_t i = 0; i < body.size(); i++){
+        body[i]->execute(state);
+    }
+    state.popReturn();
+}
+
+template <typename Value>
+StatementType InlinedCall<Value>::getType()
+{
+    return GOSUB_STMT;
+}
+
+template <typename Value>
+string InlinedCall<Value>::toString()
+{
+    return call->toString();
+}
+
+#define INSTANTIATE_SUBROUTINE(Value) \
+    template class InlinedCall<Value>; \
+    template Statement<Value> *makeInlinedCall<Value>(GosubStatement<Value> * gosub, const vector<Statement<Value> *> & lines);
+FOR_EACH_VALUE_TYPE(INSTANTIATE_SUBROUTINE)
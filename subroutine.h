@@ -0,0 +1,97 @@
+/*
+ * File: subroutine.h
+ * ------------------
+ * This interface exports the InlinedCall class, which runs a call of a
+ * small subroutine in place of the GOSUB line.
+ */
+
+#ifndef _subroutine_h
+#define _subroutine_h
+
+#include <string>
+#include <vector>
+#include "evalstate.h"
+#include "statement.h"
+
+/*
+ * Class: InlinedCall
+ * ------------------
+ * A leaf subroutine is a run of lines that ends with RETURN and never
+ * jumps, such as
+ *
+ *    500 LET T = A
+ *    510 LET A = B
+ *    520 LET B = T
+ *    530 RETURN
+ *
+ * An InlinedCall stands in for a GOSUB line to such a subroutine.  It
+ * runs the lines of the subroutine directly and falls through to the
+ * line after the GOSUB, instead of jumping there and back through
+ * Program::run.  It still pushes and pops the return stack around the
+ * lines, so a call that would overflow the stack raises the same
+ * error.
+ */
+
+template <typename Value>
+class InlinedCall : public Statement<Value>
+{
+    public:
+/*
+ * Constructor: InlinedCall
+ * ----------------------
+ * The constructor initializes a call from the GOSUB statement and the
+ * statements of the subroutine before its RETURN.  The statements are
+ * not owned.
+ */
+
+   InlinedCall(GosubStatement<Value> * init_call, std::vector<Statement<Value> *> init_body);
+
+/*
+ * Destructor: ~InlinedCall
+ * Usage: delete call;
+ * -------------------
+ * The destructor deallocates the storage for this call, but not for the
+ * statements it runs.
+ */
+
+   virtual ~InlinedCall();
+
+/*
+ * Method: execute
+ * Usage: stmt->execute(state);
+ * ----------------------------
+ *  run the lines of the subroutine
+ */
+
+   virtual void execute(EvalState<Value> & state);
+   virtual StatementType getType();
+   virtual std::string toString();
+
+    private:
+        GosubStatement<Value> * call;
+        std::vector<Statement<Value> *> body;
+};
+
+/*
+ * Constant: MAX_INLINED_LINES
+ * ---------------------------
+ * The largest number of lines, RETURN included, of a subroutine that
+ * is inlined.
+ */
+
+const int MAX_INLINED_LINES = 8;
+
+/*
+ * Function: makeInlinedCall
+ * Usage: Statement<Value> *call = makeInlinedCall(gosub, lines);
+ * --------------------------------------------------------------
+ * Returns a new InlinedCall if lines, the lines from the target of
+ * the GOSUB on, start with at most MAX_INLINED_LINES - 1 LET, PRINT,
+ * INPUT, PRINT #, INPUT #, REM or DIM lines followed by a RETURN.  Returns NULL
+ * otherwise, in particular when one of those lines is not parsed yet.
+ */
+
+template <typename Value>
+Statement<Value> *makeInlinedCall(GosubStatement<Value> * gosub, const std::vector<Statement<Value> *> & lines);
+
+#endif
@@ -16,17 +16,10 @@ int str2int(std::string s)
     }
 }
 
-int input_int()
+std::string input_line()
 {
-    while(true){
-        std::string s;
-        std::cout << " ? ";  //prompt
-        std::getline(std::cin, s);
-        try{
-            return str2int(s);
-        }catch(...){
-            std::cout << "INVALID NUMBER" << std::endl;
-        }
-    }
+    std::string s;
+    std::cout << " ? ";  //prompt
+    if (!getInputLog().readLine(s)) error("END OF INPUT");
+    return s;
 }
-
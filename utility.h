@@ -7,11 +7,29 @@
 #include <sstream>
 #include <string>
 #include "../StanfordCPPLib/error.h"
+#include "inputlog.h"
+#include "value.h"
 
 //convert a string to int
 int str2int(std::string);
 
-//input a valid int, for INPUT statement
-int input_int();
+//input a valid number, for INPUT statement; the lines come through the
+//input log, so that a recorded run replays its retries too, and the end
+//of the input is an error
+template <typename Value>
+Value input_value()
+{
+    while(true){
+        std::string s;
+        std::cout << " ? ";  //prompt
+        if (!getInputLog().readLine(s)) error("END OF INPUT");
+        Value res;
+        if (ValueTraits<Value>::parse(s, res)) return res;
+        std::cout << "INVALID NUMBER" << std::endl;
+    }
+}
+
+//input a whole line, for INPUT of a string variable
+std::string input_line();
 
 #endif //UNTILITY_H
@@ -0,0 +1,193 @@
+/*
+ * File: value.cpp
+ * ---------------
+ * This file implements the ValueTraits specializations.
+ */
+
+#include <climits>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "../StanfordCPPLib/error.h"
+#include "checkpoint.h"
+#include "value.h"
+using namespace std;
+
+//read a whole token as a value of type T, as str2int does: a number too
+//large for T gives the largest value
+template <typename T>
+static bool readToken(const string & token, T & value)
+{
+    istringstream iss(token);
+    iss >> value >> ws;
+    return iss.eof();
+}
+
+/* Implementation of ValueTraits<int> */
+
+const char *ValueTraits<int>::NAME = "int32";
+
+bool ValueTraits<int>::parse(const string & token, int & value)
+{
+    return readToken(token, value);
+}
+
+void ValueTraits<int>::print(ostream & out, int value)
+{
+    out << value;
+}
+
+/*
+ * Implementation notes: advance
+ * -----------------------------
+ * The integer steps are added in a wider type, or with an overflow
+ * check for 64 bits, and the variable gets the wrapped sum.
+ */
+
+bool ValueTraits<int>::advance(int & var, int step, int limit)
+{
+    long long value = (long long) var + step;
+    var = (int) value;
+    return (step >= 0) ? value <= limit : value >= limit;
+}
+
+void ValueTraits<int>::save(string & out, int value)
+{
+    putBytes(out, &value, sizeof value);
+}
+
+void ValueTraits<int>::load(CheckpointReader & in, int & value)
+{
+    in.readBytes(&value, sizeof value);
+}
+
+/* Implementation of ValueTraits<long long> */
+
+const char *ValueTraits<long long>::NAME = "int64";
+
+bool ValueTraits<long long>::parse(const string & token, long long & value)
+{
+    return readToken(token, value);
+}
+
+void ValueTraits<long long>::print(ostream & out, long long value)
+{
+    out << value;
+}
+
+bool ValueTraits<long long>::advance(long long & var, long long step, long long limit)
+{
+    long long value;
+    bool overflow = __builtin_add_overflow(var, step, &value);
+    var = value;
+    if (overflow) return false;
+    return (step >= 0) ? value <= limit : value >= limit;
+}
+
+void ValueTraits<long long>::save(string & out, long long value)
+{
+    putBytes(out, &value, sizeof value);
+}
+
+void ValueTraits<long long>::load(CheckpointReader & in, long long & value)
+{
+    in.readBytes(&value, sizeof value);
+}
+
+/* Implementation of ValueTraits<double> */
+
+const char *ValueTraits<double>::NAME = "double";
+
+bool ValueTraits<double>::parse(const string & token, double & value)
+{
+    return readToken(token, value);
+}
+
+/*
+ * Implementation notes: print
+ * ---------------------------
+ * A double prints with up to 15 significant digits, the most that
+ * always survive a round trip through the decimal text, so integral
+ * values print without a fraction or an exponent.
+ */
+
+void ValueTraits<double>::print(ostream & out, double value)
+{
+    ostringstream oss;
+    oss.precision(15);
+    oss << value;
+    out << oss.str();
+}
+
+long long ValueTraits<double>::toInteger(double value)
+{
+    if (!(value > -9.2e18 && value < 9.2e18)) return LLONG_MIN;
+    return (long long) value;
+}
+
+bool ValueTraits<double>::advance(double & var, double step, double limit)
+{
+    var += step;
+    return (step >= 0) ? var <= limit : var >= limit;
+}
+
+void ValueTraits<double>::save(string & out, double value)
+{
+    putBytes(out, &value, sizeof value);
+}
+
+void ValueTraits<double>::load(CheckpointReader & in, double & value)
+{
+    in.readBytes(&value, sizeof value);
+}
+
+/* Implementation of ValueTraits<BigInt> */
+
+const char *ValueTraits<BigInt>::NAME = "bigint";
+
+bool ValueTraits<BigInt>::parse(const string & token, BigInt & value)
+{
+    return BigInt::parse(token, value);
+}
+
+void ValueTraits<BigInt>::print(ostream & out, const BigInt & value)
+{
+    out << value;
+}
+
+bool ValueTraits<BigInt>::advance(BigInt & var, const BigInt & step, const BigInt & limit)
+{
+    var += step;
+    return (step >= 0) ? var <= limit : var >= limit;
+}
+
+/*
+ * Implementation notes: save
+ * --------------------------
+ * A value that fits in a long long is saved as its bytes after a 0,
+ * and any other as its decimal digits after a 1.
+ */
+
+void ValueTraits<BigInt>::save(string & out, const BigInt & value)
+{
+    if (value.isSmall()){
+        long long small = value.toSmall();
+        putNumber(out, 0);
+        putBytes(out, &small, sizeof small);
+    }else{
+        putNumber(out, 1);
+        putString(out, value.toString());
+    }
+}
+
+void ValueTraits<BigInt>::load(CheckpointReader & in, BigInt & value)
+{
+    if (in.readNumber() == 0){
+        long long small;
+        in.readBytes(&small, sizeof small);
+        value = BigInt(small);
+    }else if (!BigInt::parse(in.readString(), value)){
+        error("CHECKPOINT ERROR");
+    }
+}
@@ -0,0 +1,124 @@
+/*
+ * File: value.h
+ * -------------
+ * This interface exports ValueTraits, which describes the numeric types
+ * the interpreter can run on.  The expressions, statements and state of
+ * the interpreter are templates over the type of the values, which are
+ * instantiated for
+ *
+ *    int         32-bit integers that wrap around, the original type
+ *    long long   64-bit integers that wrap around
+ *    double      floating-point numbers
+ *    BigInt      exact integers of any size
+ *
+ * and the program chooses one of the instantiations at startup, so the
+ * interpreter itself never tests the type of a value.  Everything that
+ * differs between the types is collected here.
+ */
+
+#ifndef _value_h
+#define _value_h
+
+#include <climits>
+#include <iostream>
+#include <string>
+#include "bigint.h"
+
+class CheckpointReader;
+
+/*
+ * Macro: FOR_EACH_VALUE_TYPE
+ * Usage: FOR_EACH_VALUE_TYPE(INSTANTIATE_EXP)
+ * -------------------------------------------
+ * Applies a macro to each value type.  The templates are defined in the
+ * .cpp files and instantiated there for each type with this macro.
+ */
+
+#define FOR_EACH_VALUE_TYPE(macro) \
+   macro(int) \
+   macro(long long) \
+   macro(double) \
+   macro(BigInt)
+
+/*
+ * Class: ValueTraits
+ * ------------------
+ * The properties of a value type.  Each value type has a
+ * specialization with these members:
+ *
+ *    NAME        the name of the type for the --values option
+ *    INT32       true for int; the loop optimizations that compute
+ *                trip counts and closed forms rely on 32-bit
+ *                wrap-around arithmetic and only apply then
+ *    parse       converts a number token, returns false if the token
+ *                is not a number of this type
+ *    print       writes a value as PRINT shows it
+ *    toInteger   converts a value to a subscript or a count; a value
+ *                that is not a finite number or does not fit in a
+ *                long long gives LLONG_MIN, which is out of range for
+ *                every use
+ *    advance     adds the step of a FOR loop to its variable, and
+ *                returns true while the exact sum has not passed the
+ *                limit, so a loop up to the largest value ends
+ *    save, load  append a value to a checkpoint exactly, and read it
+ *                back
+ */
+
+template <typename Value>
+struct ValueTraits;
+
+template <>
+struct ValueTraits<int> {
+   static const char *NAME;
+   static const bool INT32 = true;
+   static bool parse(const std::string & token, int & value);
+   static void print(std::ostream & out, int value);
+   static long long toInteger(int value) {
+      return value;
+   }
+   static bool advance(int & var, int step, int limit);
+   static void save(std::string & out, int value);
+   static void load(CheckpointReader & in, int & value);
+};
+
+template <>
+struct ValueTraits<long long> {
+   static const char *NAME;
+   static const bool INT32 = false;
+   static bool parse(const std::string & token, long long & value);
+   static void print(std::ostream & out, long long value);
+   static long long toInteger(long long value) {
+      return value;
+   }
+   static bool advance(long long & var, long long step, long long limit);
+   static void save(std::string & out, long long value);
+   static void load(CheckpointReader & in, long long & value);
+};
+
+template <>
+struct ValueTraits<double> {
+   static const char *NAME;
+   static const bool INT32 = false;
+   static bool parse(const std::string & token, double & value);
+   static void print(std::ostream & out, double value);
+   static long long toInteger(double value);
+   static bool advance(double & var, double step, double limit);
+   static void save(std::string & out, double value);
+   static void load(CheckpointReader & in, double & value);
+};
+
+template <>
+struct ValueTraits<BigInt> {
+   static const char *NAME;
+   static const bool INT32 = false;
+   static bool parse(const std::string & token, BigInt & value);
+   static void print(std::ostream & out, const BigInt & value);
+   static long long toInteger(const BigInt & value) {
+      return value.isSmall() ? value.toSmall() : LLONG_MIN;
+   }
+   static bool advance(BigInt & var, const BigInt & step, const BigInt & limit);
+   static void save(std::string & out, const BigInt & value);
+   static void load(CheckpointReader & in, BigInt & value);
+};
+
+#endif